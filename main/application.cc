@@ -11,11 +11,13 @@
 #include "settings.h"
 
 #include <cstring>
+#include <algorithm>
 #include <esp_log.h>
 #include <cJSON.h>
 #include <driver/gpio.h>
 #include <arpa/inet.h>
 #include <font_awesome.h>
+#include <freertos/semphr.h>
 
 #define TAG "Application"
 
@@ -83,6 +85,9 @@ void Application::Initialize() {
     callbacks.on_vad_change = [this](bool speaking) {
         xEventGroupSetBits(event_group_, MAIN_EVENT_VAD_CHANGE);
     };
+    callbacks.on_sound_direction = [this](int degrees) {
+        xEventGroupSetBits(event_group_, MAIN_EVENT_SOUND_DIRECTION);
+    };
     audio_service_.SetCallbacks(callbacks);
 
     // Add state change listeners
@@ -152,6 +157,10 @@ void Application::Initialize() {
             case NetworkEvent::ModemErrorTimeout:
                 display->SetStatus(Lang::Strings::REGISTERING_NETWORK);
                 break;
+            case NetworkEvent::Switched:
+                // Dual network boards moved to the other network, the protocol has to follow
+                xEventGroupSetBits(event_group_, MAIN_EVENT_NETWORK_SWITCHED);
+                break;
         }
     });
 
@@ -175,6 +184,8 @@ void Application::Run() {
         MAIN_EVENT_ERROR |
         MAIN_EVENT_NETWORK_CONNECTED |
         MAIN_EVENT_NETWORK_DISCONNECTED |
+        MAIN_EVENT_NETWORK_SWITCHED |
+        MAIN_EVENT_SOUND_DIRECTION |
         MAIN_EVENT_TOGGLE_CHAT |
         MAIN_EVENT_START_LISTENING |
         MAIN_EVENT_STOP_LISTENING |
@@ -197,6 +208,10 @@ void Application::Run() {
             HandleNetworkDisconnectedEvent();
         }
 
+        if (bits & MAIN_EVENT_NETWORK_SWITCHED) {
+            HandleNetworkSwitchedEvent();
+        }
+
         if (bits & MAIN_EVENT_ACTIVATION_DONE) {
             HandleActivationDoneEvent();
         }
@@ -218,10 +233,18 @@ void Application::Run() {
         }
 
         if (bits & MAIN_EVENT_SEND_AUDIO) {
+            int sent = 0, failed = 0;
             while (auto packet = audio_service_.PopPacketFromSendQueue()) {
                 if (protocol_ && !protocol_->SendAudio(std::move(packet))) {
+                    failed++;
                     break;
                 }
+                sent++;
+            }
+            if (sent > 0 || failed > 0) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                link_stats_.packets_sent += sent;
+                link_stats_.packets_failed += failed;
             }
         }
 
@@ -236,6 +259,11 @@ void Application::Run() {
             }
         }
 
+        if (bits & MAIN_EVENT_SOUND_DIRECTION) {
+            auto led = Board::GetInstance().GetLed();
+            led->OnSoundDirection(audio_service_.GetSoundDirection());
+        }
+
         if (bits & MAIN_EVENT_SCHEDULE) {
             std::unique_lock<std::mutex> lock(mutex_);
             auto tasks = std::move(main_tasks_);
@@ -247,8 +275,19 @@ void Application::Run() {
 
         if (bits & MAIN_EVENT_CLOCK_TICK) {
             clock_ticks_++;
-            auto display = Board::GetInstance().GetDisplay();
+            auto& board = Board::GetInstance();
+            auto display = board.GetDisplay();
             display->UpdateStatusBar();
+            ShowOperationProgress();
+
+            std::unique_lock<std::mutex> lock(mutex_);
+            LinkStats link_stats = link_stats_;
+            link_stats_ = LinkStats();
+            lock.unlock();
+            if (link_stats.open_latency_ms >= 0 || link_stats.open_failures > 0 ||
+                link_stats.packets_sent > 0 || link_stats.packets_failed > 0) {
+                board.ReportLinkStats(link_stats);
+            }
         
             // Print debug info every 10 seconds
             if (clock_ticks_ % 10 == 0) {
@@ -296,6 +335,41 @@ void Application::HandleNetworkDisconnectedEvent() {
     display->UpdateStatusBar(true);
 }
 
+void Application::HandleNetworkSwitchedEvent() {
+    // Not activated yet, the protocol will be created on the new network
+    if (!protocol_) {
+        return;
+    }
+
+    auto state = GetDeviceState();
+    bool in_conversation = state == kDeviceStateConnecting || state == kDeviceStateListening || state == kDeviceStateSpeaking;
+    ESP_LOGI(TAG, "Network switched, moving the protocol session (state: %s)", DeviceStateMachine::GetStateName(state));
+
+    // Sockets of the old network are closed, the server session is opened again on the new one
+    if (protocol_->IsAudioChannelOpened()) {
+        protocol_->CloseAudioChannel();
+    }
+    protocol_->Start();
+
+    if (in_conversation) {
+        // Queued after the idle state set by the channel close, the conversation goes on
+        // listening after a short pause, a reply being spoken is lost
+        auto mode = listening_mode_;
+        Schedule([this, mode]() {
+            if (!protocol_->IsAudioChannelOpened()) {
+                SetDeviceState(kDeviceStateConnecting);
+                if (!OpenAudioChannel()) {
+                    return;
+                }
+            }
+            SetListeningMode(mode);
+        });
+    }
+
+    auto display = Board::GetInstance().GetDisplay();
+    display->UpdateStatusBar(true);
+}
+
 void Application::HandleActivationDoneEvent() {
     ESP_LOGI(TAG, "Activation done");
 
@@ -368,13 +442,10 @@ void Application::CheckAssetsVersion() {
         board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
         display->SetChatMessage("system", Lang::Strings::PLEASE_WAIT);
 
-        bool success = assets.Download(download_url, [display](int progress, size_t speed) -> void {
-            std::thread([display, progress, speed]() {
-                char buffer[32];
-                snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
-                display->SetChatMessage("system", buffer);
-            }).detach();
+        bool success = assets.Download(download_url, [this](int progress, size_t speed) -> void {
+            SetOperationProgress(progress, speed);
         });
+        ClearOperationProgress();
 
         board.SetPowerSaveLevel(PowerSaveLevel::LOW_POWER);
         vTaskDelay(pdMS_TO_TICKS(1000));
@@ -516,17 +587,21 @@ void Application::InitializeProtocol() {
         });
     });
     
-    protocol_->OnIncomingJson([this, display](const cJSON* root) {
-        // Parse JSON data
-        auto type = cJSON_GetObjectItem(root, "type");
-        if (strcmp(type->valuestring, "tts") == 0) {
-            auto state = cJSON_GetObjectItem(root, "state");
-            if (strcmp(state->valuestring, "start") == 0) {
+    protocol_->OnIncomingJson([this, display](const JsonMessage& message) {
+        // Dispatch on the hashed type, the fields are views into the received buffer
+        auto type = message.type();
+        switch (JsonMessage::Hash(type)) {
+        case JsonMessage::Hash("tts"): {
+            if (type != "tts") {
+                break;
+            }
+            auto state = message.GetString("state");
+            if (state == "start") {
                 Schedule([this]() {
                     aborted_ = false;
                     SetDeviceState(kDeviceStateSpeaking);
                 });
-            } else if (strcmp(state->valuestring, "stop") == 0) {
+            } else if (state == "stop") {
                 Schedule([this]() {
                     if (GetDeviceState() == kDeviceStateSpeaking) {
                         if (listening_mode_ == kListeningModeManualStop) {
@@ -536,77 +611,122 @@ void Application::InitializeProtocol() {
                         }
                     }
                 });
-            } else if (strcmp(state->valuestring, "sentence_start") == 0) {
-                auto text = cJSON_GetObjectItem(root, "text");
-                if (cJSON_IsString(text)) {
-                    ESP_LOGI(TAG, "<< %s", text->valuestring);
-                    Schedule([display, message = std::string(text->valuestring)]() {
-                        display->SetChatMessage("assistant", message.c_str());
+            } else if (state == "sentence_start") {
+                if (message.Has("text", JsonMessage::kValueString)) {
+                    auto text = JsonMessage::Unescape(message.GetString("text"));
+                    ESP_LOGI(TAG, "<< %s", text.c_str());
+                    Schedule([display, text = std::move(text)]() {
+                        display->SetChatMessage("assistant", text.c_str());
                     });
                 }
             }
-        } else if (strcmp(type->valuestring, "stt") == 0) {
-            auto text = cJSON_GetObjectItem(root, "text");
-            if (cJSON_IsString(text)) {
-                ESP_LOGI(TAG, ">> %s", text->valuestring);
-                Schedule([display, message = std::string(text->valuestring)]() {
-                    display->SetChatMessage("user", message.c_str());
+            return;
+        }
+        case JsonMessage::Hash("stt"): {
+            if (type != "stt") {
+                break;
+            }
+            if (message.Has("text", JsonMessage::kValueString)) {
+                auto text = JsonMessage::Unescape(message.GetString("text"));
+                ESP_LOGI(TAG, ">> %s", text.c_str());
+                Schedule([display, text = std::move(text)]() {
+                    display->SetChatMessage("user", text.c_str());
                 });
             }
-        } else if (strcmp(type->valuestring, "llm") == 0) {
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(emotion)) {
-                Schedule([display, emotion_str = std::string(emotion->valuestring)]() {
+            return;
+        }
+        case JsonMessage::Hash("llm"): {
+            if (type != "llm") {
+                break;
+            }
+            if (message.Has("emotion", JsonMessage::kValueString)) {
+                Schedule([display, emotion_str = JsonMessage::Unescape(message.GetString("emotion"))]() {
                     display->SetEmotion(emotion_str.c_str());
                 });
             }
-        } else if (strcmp(type->valuestring, "mcp") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            if (cJSON_IsObject(payload)) {
-                McpServer::GetInstance().ParseMessage(payload);
+            return;
+        }
+        case JsonMessage::Hash("mcp"): {
+            if (type != "mcp") {
+                break;
+            }
+            // MCP payloads are the only messages parsed into a cJSON tree
+            if (message.Has("payload", JsonMessage::kValueObject)) {
+                McpServer::GetInstance().ParseMessage(std::string(message.GetRaw("payload")));
+            }
+            return;
+        }
+        case JsonMessage::Hash("system"): {
+            if (type != "system") {
+                break;
             }
-        } else if (strcmp(type->valuestring, "system") == 0) {
-            auto command = cJSON_GetObjectItem(root, "command");
-            if (cJSON_IsString(command)) {
-                ESP_LOGI(TAG, "System command: %s", command->valuestring);
-                if (strcmp(command->valuestring, "reboot") == 0) {
+            if (message.Has("command", JsonMessage::kValueString)) {
+                auto command = message.GetString("command");
+                ESP_LOGI(TAG, "System command: %.*s", (int)command.size(), command.data());
+                if (command == "reboot") {
                     // Do a reboot if user requests a OTA update
                     Schedule([this]() {
                         Reboot();
                     });
                 } else {
-                    ESP_LOGW(TAG, "Unknown system command: %s", command->valuestring);
+                    ESP_LOGW(TAG, "Unknown system command: %.*s", (int)command.size(), command.data());
                 }
             }
-        } else if (strcmp(type->valuestring, "alert") == 0) {
-            auto status = cJSON_GetObjectItem(root, "status");
-            auto message = cJSON_GetObjectItem(root, "message");
-            auto emotion = cJSON_GetObjectItem(root, "emotion");
-            if (cJSON_IsString(status) && cJSON_IsString(message) && cJSON_IsString(emotion)) {
-                Alert(status->valuestring, message->valuestring, emotion->valuestring, Lang::Sounds::OGG_VIBRATION);
+            return;
+        }
+        case JsonMessage::Hash("alert"): {
+            if (type != "alert") {
+                break;
+            }
+            if (message.Has("status", JsonMessage::kValueString) && message.Has("message", JsonMessage::kValueString) &&
+                message.Has("emotion", JsonMessage::kValueString)) {
+                Alert(JsonMessage::Unescape(message.GetString("status")).c_str(),
+                      JsonMessage::Unescape(message.GetString("message")).c_str(),
+                      JsonMessage::Unescape(message.GetString("emotion")).c_str(), Lang::Sounds::OGG_VIBRATION);
             } else {
                 ESP_LOGW(TAG, "Alert command requires status, message and emotion");
             }
+            return;
+        }
 #if CONFIG_RECEIVE_CUSTOM_MESSAGE
-        } else if (strcmp(type->valuestring, "custom") == 0) {
-            auto payload = cJSON_GetObjectItem(root, "payload");
-            ESP_LOGI(TAG, "Received custom message: %s", cJSON_PrintUnformatted(root));
-            if (cJSON_IsObject(payload)) {
-                Schedule([this, display, payload_str = std::string(cJSON_PrintUnformatted(payload))]() {
+        case JsonMessage::Hash("custom"): {
+            if (type != "custom") {
+                break;
+            }
+            auto source = message.source();
+            ESP_LOGI(TAG, "Received custom message: %.*s", (int)source.size(), source.data());
+            if (message.Has("payload", JsonMessage::kValueObject)) {
+                Schedule([this, display, payload_str = std::string(message.GetRaw("payload"))]() {
                     display->SetChatMessage("system", payload_str.c_str());
                 });
             } else {
                 ESP_LOGW(TAG, "Invalid custom message format: missing payload");
             }
+            return;
+        }
 #endif
-        } else {
-            ESP_LOGW(TAG, "Unknown message type: %s", type->valuestring);
+        default:
+            break;
         }
+        ESP_LOGW(TAG, "Unknown message type: %.*s", (int)type.size(), type.data());
     });
     
     protocol_->Start();
 }
 
+bool Application::OpenAudioChannel() {
+    auto start_time = esp_timer_get_time();
+    bool opened = protocol_->OpenAudioChannel();
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (opened) {
+        link_stats_.open_latency_ms = (esp_timer_get_time() - start_time) / 1000;
+    } else {
+        link_stats_.open_failures++;
+    }
+    return opened;
+}
+
 void Application::ShowActivationCode(const std::string& code, const std::string& message) {
     struct digit_sound {
         char digit;
@@ -625,7 +745,6 @@ void Application::ShowActivationCode(const std::string& code, const std::string&
         digit_sound{'9', Lang::Sounds::OGG_9}
     }};
 
-    // This sentence uses 9KB of SRAM, so we need to wait for it to finish
     Alert(Lang::Strings::ACTIVATION, message.c_str(), "link", Lang::Sounds::OGG_ACTIVATION);
 
     for (const auto& digit : code) {
@@ -693,7 +812,7 @@ void Application::HandleToggleChatEvent() {
     if (state == kDeviceStateIdle) {
         if (!protocol_->IsAudioChannelOpened()) {
             SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
+            if (!OpenAudioChannel()) {
                 return;
             }
         }
@@ -726,7 +845,7 @@ void Application::HandleStartListeningEvent() {
     if (state == kDeviceStateIdle) {
         if (!protocol_->IsAudioChannelOpened()) {
             SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
+            if (!OpenAudioChannel()) {
                 return;
             }
         }
@@ -765,7 +884,7 @@ void Application::HandleWakeWordDetectedEvent() {
 
         if (!protocol_->IsAudioChannelOpened()) {
             SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
+            if (!OpenAudioChannel()) {
                 audio_service_.EnableWakeWordDetection(true);
                 return;
             }
@@ -811,15 +930,21 @@ void Application::HandleStateChangedEvent() {
             display->SetEmotion("neutral");
             audio_service_.EnableVoiceProcessing(false);
             audio_service_.EnableWakeWordDetection(true);
+            audio_service_.OnInteraction(false);
             break;
         case kDeviceStateConnecting:
             display->SetStatus(Lang::Strings::CONNECTING);
             display->SetEmotion("neutral");
             display->SetChatMessage("system", "");
+            audio_service_.OnInteraction(true);
+            // Listening and the reply follow shortly, power up the codec while connecting
+            audio_service_.PrewarmCodec(true, true);
             break;
         case kDeviceStateListening:
             display->SetStatus(Lang::Strings::LISTENING);
             display->SetEmotion("neutral");
+            audio_service_.PrewarmCodec(false, true);
+            audio_service_.OnInteraction(true);
 
             // Make sure the audio processor is running
             if (!audio_service_.IsAudioProcessorRunning()) {
@@ -827,6 +952,9 @@ void Application::HandleStateChangedEvent() {
                 protocol_->SendStartListening(listening_mode_);
                 audio_service_.EnableVoiceProcessing(true);
                 audio_service_.EnableWakeWordDetection(false);
+            } else if (audio_service_.IsWakeWordRunning()) {
+                // Left running from speaking in realtime mode
+                audio_service_.EnableWakeWordDetection(false);
             }
 
             // Play popup sound after ResetDecoder (in EnableVoiceProcessing) has been called
@@ -837,11 +965,15 @@ void Application::HandleStateChangedEvent() {
             break;
         case kDeviceStateSpeaking:
             display->SetStatus(Lang::Strings::SPEAKING);
+            audio_service_.OnInteraction(true);
 
             if (listening_mode_ != kListeningModeRealtime) {
                 audio_service_.EnableVoiceProcessing(false);
                 // Only AFE wake word can be detected in speaking mode
                 audio_service_.EnableWakeWordDetection(audio_service_.IsAfeWakeWord());
+            } else if (audio_service_.IsFrontEndShared()) {
+                // The wake word runs next to the voice processing, so it can interrupt the reply
+                audio_service_.EnableWakeWordDetection(true);
             }
             audio_service_.ResetDecoder();
             break;
@@ -853,6 +985,7 @@ void Application::HandleStateChangedEvent() {
             // Do nothing
             break;
     }
+    state_machine_.MarkStateHandled(new_state);
 }
 
 void Application::Schedule(std::function<void()>&& callback) {
@@ -863,6 +996,16 @@ void Application::Schedule(std::function<void()>&& callback) {
     xEventGroupSetBits(event_group_, MAIN_EVENT_SCHEDULE);
 }
 
+void Application::ScheduleAndWait(std::function<void()>&& callback) {
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    Schedule([&callback, done]() {
+        callback();
+        xSemaphoreGive(done);
+    });
+    xSemaphoreTake(done, portMAX_DELAY);
+    vSemaphoreDelete(done);
+}
+
 void Application::AbortSpeaking(AbortReason reason) {
     ESP_LOGI(TAG, "Abort speaking");
     aborted_ = true;
@@ -896,39 +1039,54 @@ bool Application::UpgradeFirmware(const std::string& url, const std::string& ver
     std::string upgrade_url = url;
     std::string version_info = version.empty() ? "(Manual upgrade)" : version;
 
-    // Close audio channel if it's open
-    if (protocol_ && protocol_->IsAudioChannelOpened()) {
-        ESP_LOGI(TAG, "Closing audio channel before firmware upgrade");
-        protocol_->CloseAudioChannel();
-    }
-    ESP_LOGI(TAG, "Starting firmware upgrade from URL: %s", upgrade_url.c_str());
-
-    Alert(Lang::Strings::OTA_UPGRADE, Lang::Strings::UPGRADING, "download", Lang::Sounds::OGG_UPGRADE);
+    // The protocol, audio service and device state belong to the main task, only the download
+    // and flash below run in the calling task
+    bool from_version_check = false;
+    ScheduleAndWait([this, &upgrade_url, &from_version_check]() {
+        // Close audio channel if it's open
+        if (protocol_ && protocol_->IsAudioChannelOpened()) {
+            ESP_LOGI(TAG, "Closing audio channel before firmware upgrade");
+            protocol_->CloseAudioChannel();
+        }
+        ESP_LOGI(TAG, "Starting firmware upgrade from URL: %s", upgrade_url.c_str());
+        from_version_check = ota_ && ota_->GetFirmwareUrl() == upgrade_url;
+        Alert(Lang::Strings::OTA_UPGRADE, Lang::Strings::UPGRADING, "download", Lang::Sounds::OGG_UPGRADE);
+    });
     vTaskDelay(pdMS_TO_TICKS(3000));
 
-    SetDeviceState(kDeviceStateUpgrading);
+    ScheduleAndWait([this, &board, display, &version_info]() {
+        SetDeviceState(kDeviceStateUpgrading);
 
-    std::string message = std::string(Lang::Strings::NEW_VERSION) + version_info;
-    display->SetChatMessage("system", message.c_str());
+        std::string message = std::string(Lang::Strings::NEW_VERSION) + version_info;
+        display->SetChatMessage("system", message.c_str());
 
-    board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
-    audio_service_.Stop();
+        board.SetPowerSaveLevel(PowerSaveLevel::PERFORMANCE);
+        audio_service_.Stop();
+    });
     vTaskDelay(pdMS_TO_TICKS(1000));
 
-    bool upgrade_success = Ota::Upgrade(upgrade_url, [display](int progress, size_t speed) {
-        std::thread([display, progress, speed]() {
-            char buffer[32];
-            snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
-            display->SetChatMessage("system", buffer);
-        }).detach();
-    });
+    auto progress_callback = [this](int progress, size_t speed) {
+        SetOperationProgress(progress, speed);
+    };
+
+    bool upgrade_success;
+    if (from_version_check) {
+        // Upgrade found by version check, use the patch if the server provides one
+        upgrade_success = ota_->StartUpgrade(progress_callback);
+    } else {
+        upgrade_success = Ota::Upgrade(upgrade_url, progress_callback);
+    }
+
+    ClearOperationProgress();
 
     if (!upgrade_success) {
         // Upgrade failed, restart audio service and continue running
         ESP_LOGE(TAG, "Firmware upgrade failed, restarting audio service and continuing operation...");
-        audio_service_.Start(); // Restart audio service
-        board.SetPowerSaveLevel(PowerSaveLevel::LOW_POWER); // Restore power save level
-        Alert(Lang::Strings::ERROR, Lang::Strings::UPGRADE_FAILED, "circle_xmark", Lang::Sounds::OGG_EXCLAMATION);
+        ScheduleAndWait([this, &board]() {
+            audio_service_.Start(); // Restart audio service
+            board.SetPowerSaveLevel(PowerSaveLevel::LOW_POWER); // Restore power save level
+            Alert(Lang::Strings::ERROR, Lang::Strings::UPGRADE_FAILED, "circle_xmark", Lang::Sounds::OGG_EXCLAMATION);
+        });
         vTaskDelay(pdMS_TO_TICKS(3000));
         return false;
     } else {
@@ -936,7 +1094,9 @@ bool Application::UpgradeFirmware(const std::string& url, const std::string& ver
         ESP_LOGI(TAG, "Firmware upgrade successful, rebooting...");
         display->SetChatMessage("system", "Upgrade successful, rebooting...");
         vTaskDelay(pdMS_TO_TICKS(1000)); // Brief pause to show message
-        Reboot();
+        Schedule([this]() {
+            Reboot();
+        });
         return true;
     }
 }
@@ -953,7 +1113,7 @@ void Application::WakeWordInvoke(const std::string& wake_word) {
 
         if (!protocol_->IsAudioChannelOpened()) {
             SetDeviceState(kDeviceStateConnecting);
-            if (!protocol_->OpenAudioChannel()) {
+            if (!OpenAudioChannel()) {
                 audio_service_.EnableWakeWordDetection(true);
                 return;
             }
@@ -1055,3 +1215,42 @@ void Application::ResetProtocol() {
     });
 }
 
+
+#define OPERATION_PROGRESS_VALID (1UL << 31)
+
+void Application::SetOperationProgress(int progress, size_t speed) {
+    uint32_t percent = std::clamp(progress, 0, 100);
+    uint32_t speed_kb = std::min<size_t>(speed / 1024, 0xFFFFFF);
+    operation_progress_.store(OPERATION_PROGRESS_VALID | (percent << 24) | speed_kb);
+}
+
+void Application::ClearOperationProgress() {
+    operation_progress_.store(0);
+}
+
+bool Application::GetOperationProgress(int& progress, size_t& speed) const {
+    uint32_t record = operation_progress_.load();
+    if (!(record & OPERATION_PROGRESS_VALID)) {
+        return false;
+    }
+    progress = (record >> 24) & 0x7F;
+    speed = (record & 0xFFFFFF) * 1024;
+    return true;
+}
+
+void Application::ShowOperationProgress() {
+    uint32_t record = operation_progress_.load();
+    if (record == shown_operation_progress_) {
+        return;
+    }
+    shown_operation_progress_ = record;
+
+    int progress;
+    size_t speed;
+    if (GetOperationProgress(progress, speed)) {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%d%% %uKB/s", progress, speed / 1024);
+        auto display = Board::GetInstance().GetDisplay();
+        display->SetChatMessage("system", buffer);
+    }
+}
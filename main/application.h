@@ -10,7 +10,9 @@
 #include <mutex>
 #include <deque>
 #include <memory>
+#include <atomic>
 
+#include "board.h"
 #include "protocol.h"
 #include "ota.h"
 #include "audio_service.h"
@@ -31,6 +33,8 @@
 #define MAIN_EVENT_START_LISTENING      (1 << 10)
 #define MAIN_EVENT_STOP_LISTENING       (1 << 11)
 #define MAIN_EVENT_STATE_CHANGED        (1 << 12)
+#define MAIN_EVENT_NETWORK_SWITCHED     (1 << 13)
+#define MAIN_EVENT_SOUND_DIRECTION      (1 << 14)
 
 
 enum AecMode {
@@ -64,6 +68,16 @@ public:
     void Run();
 
     DeviceState GetDeviceState() const { return state_machine_.GetState(); }
+    cJSON* GetStateHistoryJson() const { return state_machine_.GetTransitionLogJson(); }
+
+    /**
+     * Observe device state changes instead of polling GetDeviceState()
+     * See DeviceStateMachine::AddStateChangeListener, returns -1 if no listener slot is free
+     */
+    int AddStateChangeListener(DeviceStateMachine::StateCallback callback) {
+        return state_machine_.AddStateChangeListener(std::move(callback));
+    }
+    void RemoveStateChangeListener(int listener_id) { state_machine_.RemoveStateChangeListener(listener_id); }
     bool IsVoiceDetected() const { return audio_service_.IsVoiceDetected(); }
     
     /**
@@ -105,6 +119,7 @@ public:
 
     void Reboot();
     void WakeWordInvoke(const std::string& wake_word);
+    // Blocks until the download finished (the device reboots on success), must not be called from the main task
     bool UpgradeFirmware(const std::string& url, const std::string& version = "");
     bool CanEnterSleepMode();
     void SendMcpMessage(const std::string& payload);
@@ -112,6 +127,15 @@ public:
     AecMode GetAecMode() const { return aec_mode_; }
     void PlaySound(const std::string_view& sound);
     AudioService& GetAudioService() { return audio_service_; }
+
+    /**
+     * Report the progress of a long-running operation (firmware upgrade, assets download, etc.)
+     * Lock-free and allocation-free, can be called from any task.
+     * The progress is shown on the display at the next clock tick.
+     */
+    void SetOperationProgress(int progress, size_t speed);
+    void ClearOperationProgress();
+    bool GetOperationProgress(int& progress, size_t& speed) const;
     
     /**
      * Reset protocol resources (thread-safe)
@@ -141,7 +165,12 @@ private:
     bool assets_version_checked_ = false;
     bool play_popup_on_listening_ = false;  // Flag to play popup sound after state changes to listening
     int clock_ticks_ = 0;
+    // Packed progress record: valid flag, percent and speed in KB/s
+    std::atomic<uint32_t> operation_progress_{0};
+    uint32_t shown_operation_progress_ = 0;
     TaskHandle_t activation_task_handle_ = nullptr;
+    // Audio channel statistics since the last clock tick, guarded by mutex_
+    LinkStats link_stats_;
 
 
     // Event handlers
@@ -151,6 +180,7 @@ private:
     void HandleStopListeningEvent();
     void HandleNetworkConnectedEvent();
     void HandleNetworkDisconnectedEvent();
+    void HandleNetworkSwitchedEvent();
     void HandleActivationDoneEvent();
     void HandleWakeWordDetectedEvent();
 
@@ -161,8 +191,12 @@ private:
     void CheckAssetsVersion();
     void CheckNewVersion();
     void InitializeProtocol();
+    bool OpenAudioChannel();
     void ShowActivationCode(const std::string& code, const std::string& message);
     void SetListeningMode(ListeningMode mode);
+    void ShowOperationProgress();
+    // Run the callback on the main task and wait for it, must not be called from the main task
+    void ScheduleAndWait(std::function<void()>&& callback);
     
     // State change handler called by state machine
     void OnStateChanged(DeviceState old_state, DeviceState new_state);
@@ -0,0 +1,166 @@
+#include "asset_pack.h"
+
+#include <algorithm>
+#include <cstring>
+
+bool AssetPack::IsAssetPack(const void* data, size_t size) {
+    return size >= sizeof(asset_pack_header) && memcmp(data, ASSET_PACK_MAGIC, 4) == 0;
+}
+
+bool AssetPack::Open(const void* data, size_t size) {
+    Close();
+    if (!IsAssetPack(data, size)) {
+        return false;
+    }
+
+    auto bytes = static_cast<const uint8_t*>(data);
+    auto header = reinterpret_cast<const asset_pack_header*>(bytes);
+    if (header->version != ASSET_PACK_VERSION || header->header_size < sizeof(asset_pack_header)
+        || header->header_size % 4 != 0 || header->total_size > size) {
+        return false;
+    }
+    uint64_t index_end = header->header_size + uint64_t(header->file_count) * sizeof(asset_pack_entry);
+    uint64_t names_end = uint64_t(header->names_offset) + header->names_size;
+    if (index_end > header->names_offset || names_end > header->total_size) {
+        return false;
+    }
+
+    data_ = bytes;
+    header_ = header;
+    index_ = reinterpret_cast<const asset_pack_entry*>(bytes + header->header_size);
+    names_ = reinterpret_cast<const char*>(bytes + header->names_offset);
+
+    // Check every entry once, so lookups can trust the index
+    for (size_t i = 0; i < header->file_count; i++) {
+        auto entry = &index_[i];
+        bool valid = uint64_t(entry->name_offset) + entry->name_length <= header->names_size
+            && entry->offset >= names_end
+            && uint64_t(entry->offset) + entry->stored_size <= header->total_size
+            && ((entry->codec == kCodecStored && entry->stored_size == entry->size) || entry->codec == kCodecLz4);
+        if (!valid || (i > 0 && CompareName(entry, GetName(&index_[i - 1])) <= 0)) {
+            Close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetPack::Close() {
+    data_ = nullptr;
+    header_ = nullptr;
+    index_ = nullptr;
+    names_ = nullptr;
+}
+
+std::string AssetPack::GetName(const asset_pack_entry* entry) const {
+    return std::string(names_ + entry->name_offset, entry->name_length);
+}
+
+int AssetPack::CompareName(const asset_pack_entry* entry, const std::string& name) const {
+    size_t length = std::min<size_t>(entry->name_length, name.size());
+    int result = memcmp(names_ + entry->name_offset, name.data(), length);
+    if (result != 0) {
+        return result;
+    }
+    return entry->name_length < name.size() ? -1 : (entry->name_length > name.size() ? 1 : 0);
+}
+
+const asset_pack_entry* AssetPack::Find(const std::string& name) const {
+    size_t low = 0;
+    size_t high = count();
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        int result = CompareName(&index_[middle], name);
+        if (result == 0) {
+            return &index_[middle];
+        }
+        if (result < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return nullptr;
+}
+
+bool AssetPack::Decompress(const asset_pack_entry* entry, uint8_t* dst) const {
+    auto src = GetStoredData(entry);
+    if (entry->codec == kCodecStored) {
+        // Empty assets may come with a null buffer
+        if (entry->size > 0) {
+            memcpy(dst, src, entry->size);
+        }
+        return true;
+    }
+    return DecompressLz4(src, entry->stored_size, dst, entry->size) == static_cast<int>(entry->size);
+}
+
+int AssetPack::DecompressLz4(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + src_size;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_size;
+
+    // Each sequence is a token, literals, a 16-bit match offset and the match length
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t literals = token >> 4;
+        if (literals == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                byte = *ip++;
+                literals += byte;
+            } while (byte == 255);
+        }
+        if (literals > size_t(iend - ip) || literals > size_t(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, literals);
+        op += literals;
+        ip += literals;
+
+        // The last sequence has literals only
+        if (ip == iend) {
+            break;
+        }
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > size_t(op - dst)) {
+            return -1;
+        }
+
+        size_t match = token & 0x0F;
+        if (match == 15) {
+            uint8_t byte;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                byte = *ip++;
+                match += byte;
+            } while (byte == 255);
+        }
+        match += 4;
+        if (match > size_t(oend - op)) {
+            return -1;
+        }
+
+        const uint8_t* from = op - offset;
+        if (offset >= match) {
+            memcpy(op, from, match);
+            op += match;
+        } else {
+            // Overlapping match repeats the last `offset` bytes
+            for (size_t i = 0; i < match; i++) {
+                *op++ = from[i];
+            }
+        }
+    }
+    return op - dst;
+}
@@ -0,0 +1,90 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+/*
+ * Asset pack container written by scripts/build_default_assets.py
+ *
+ *   header | index (sorted by name) | names | data
+ *
+ * Offsets are from the start of the container, all fields are little endian. The SHA-256 in the
+ * header covers everything after the header. Identical files share their data, LVGL raw images
+ * start on a 4 KB boundary, other files on a 4 byte boundary. Files may be stored as LZ4 blocks,
+ * which are decompressed by the reader on demand.
+ */
+#define ASSET_PACK_MAGIC "XZAP"
+#define ASSET_PACK_VERSION 1
+
+struct asset_pack_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t file_count;
+    uint32_t names_offset;
+    uint32_t names_size;
+    uint32_t total_size;
+    uint8_t sha256[32];
+};
+
+struct asset_pack_entry {
+    uint32_t name_offset;   /*!< Offset of the name in the name table */
+    uint16_t name_length;
+    uint8_t codec;          /*!< AssetPack::Codec */
+    uint8_t flags;          /*!< AssetPack::kFlagAligned */
+    uint32_t offset;        /*!< Offset of the stored data */
+    uint32_t stored_size;
+    uint32_t size;          /*!< Size after decompression */
+    uint16_t width;
+    uint16_t height;
+};
+
+static_assert(sizeof(asset_pack_header) == 56, "asset_pack_header must be 56 bytes");
+static_assert(sizeof(asset_pack_entry) == 24, "asset_pack_entry must be 24 bytes");
+
+// Read-only view of an asset pack in memory (the memory mapped assets partition)
+class AssetPack {
+public:
+    enum Codec : uint8_t {
+        kCodecStored = 0,
+        kCodecLz4 = 1,
+    };
+    static constexpr uint8_t kFlagAligned = 0x01;
+
+    static bool IsAssetPack(const void* data, size_t size);
+
+    // Check the header and the index, the SHA-256 of the content is checked by the caller
+    bool Open(const void* data, size_t size);
+    void Close();
+
+    bool is_open() const { return header_ != nullptr; }
+    size_t count() const { return header_ != nullptr ? header_->file_count : 0; }
+    size_t total_size() const { return header_ != nullptr ? header_->total_size : 0; }
+    const uint8_t* sha256() const { return header_->sha256; }
+    // The part of the container covered by the SHA-256
+    const uint8_t* content() const { return data_ + header_->header_size; }
+    size_t content_size() const { return header_->total_size - header_->header_size; }
+
+    const asset_pack_entry* GetEntry(size_t index) const { return &index_[index]; }
+    std::string GetName(const asset_pack_entry* entry) const;
+    // Binary search in the sorted index, nullptr if not found
+    const asset_pack_entry* Find(const std::string& name) const;
+    const uint8_t* GetStoredData(const asset_pack_entry* entry) const { return data_ + entry->offset; }
+    // Decompress an entry into `dst`, which holds entry->size bytes
+    bool Decompress(const asset_pack_entry* entry, uint8_t* dst) const;
+
+    // Decode an LZ4 block, returns the decoded size or -1 if the block is corrupted
+    static int DecompressLz4(const uint8_t* src, size_t src_size, uint8_t* dst, size_t dst_size);
+
+private:
+    const uint8_t* data_ = nullptr;
+    const asset_pack_header* header_ = nullptr;
+    const asset_pack_entry* index_ = nullptr;
+    const char* names_ = nullptr;
+
+    int CompareName(const asset_pack_entry* entry, const std::string& name) const;
+};
+
+#endif // ASSET_PACK_H
@@ -12,7 +12,11 @@
 
 #include <esp_log.h>
 #include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <mbedtls/sha256.h>
 #include <cbin_font.h>
+#include <cstring>
+#include "settings.h"
 
 
 #define TAG "Assets"
@@ -151,6 +155,10 @@ bool Assets::LvglStrategy::InitializePartition(Assets* assets) {
 
     assets->partition_valid_ = true;
 
+    if (AssetPack::IsAssetPack(mmap_root_, assets->partition_->size)) {
+        return InitializeAssetPack(assets);
+    }
+
     uint32_t stored_files = *(uint32_t*)(mmap_root_ + 0);
     uint32_t stored_chksum = *(uint32_t*)(mmap_root_ + 4);
     uint32_t stored_len = *(uint32_t*)(mmap_root_ + 8);
@@ -183,7 +191,84 @@ bool Assets::LvglStrategy::InitializePartition(Assets* assets) {
     return checksum_valid_;
 }
 
+bool Assets::LvglStrategy::InitializeAssetPack(Assets* assets) {
+    if (!pack_.Open(mmap_root_, assets->partition_->size)) {
+        ESP_LOGE(TAG, "The asset pack header or index is not valid");
+        return false;
+    }
+
+    // Hashing the whole pack is only needed once after it is written, remember the verified hash
+    char hash[65];
+    for (int i = 0; i < 32; i++) {
+        snprintf(hash + i * 2, 3, "%02x", pack_.sha256()[i]);
+    }
+    Settings settings("assets", true);
+    if (settings.GetString("sha256") != hash) {
+        auto start_time = esp_timer_get_time();
+        uint8_t calculated[32];
+        mbedtls_sha256(pack_.content(), pack_.content_size(), calculated, 0);
+        auto end_time = esp_timer_get_time();
+        ESP_LOGI(TAG, "The SHA-256 calculation time is %d ms", int((end_time - start_time) / 1000));
+        if (memcmp(calculated, pack_.sha256(), sizeof(calculated)) != 0) {
+            ESP_LOGE(TAG, "The SHA-256 of the asset pack does not match");
+            pack_.Close();
+            return false;
+        }
+        settings.SetString("sha256", hash);
+    }
+
+    ESP_LOGI(TAG, "Asset pack with %u files, %u KB", pack_.count(), pack_.total_size() / 1024);
+    checksum_valid_ = true;
+    return true;
+}
+
+bool Assets::LvglStrategy::GetPackedAssetData(const std::string& name, void*& ptr, size_t& size) {
+    auto entry = pack_.Find(name);
+    if (entry == nullptr) {
+        return false;
+    }
+    if (entry->codec == AssetPack::kCodecStored) {
+        ptr = const_cast<uint8_t*>(pack_.GetStoredData(entry));
+        size = entry->size;
+        return true;
+    }
+
+    // Deduplicated assets share the stored data, so they also share the decompressed copy
+    std::lock_guard<std::mutex> lock(decompressed_mutex_);
+    auto it = decompressed_.find(entry->offset);
+    if (it == decompressed_.end()) {
+        auto data = (uint8_t*)heap_caps_malloc(entry->size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (data == nullptr) {
+            data = (uint8_t*)heap_caps_malloc(entry->size, MALLOC_CAP_8BIT);
+        }
+        if (data == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate %lu bytes for the asset %s", entry->size, name.c_str());
+            return false;
+        }
+        auto start_time = esp_timer_get_time();
+        if (!pack_.Decompress(entry, data)) {
+            ESP_LOGE(TAG, "The asset %s is corrupted", name.c_str());
+            heap_caps_free(data);
+            return false;
+        }
+        ESP_LOGI(TAG, "Decompressed %s (%lu -> %lu bytes) in %d ms", name.c_str(), entry->stored_size, entry->size,
+            int((esp_timer_get_time() - start_time) / 1000));
+        it = decompressed_.emplace(entry->offset, data).first;
+    }
+    ptr = it->second;
+    size = entry->size;
+    return true;
+}
+
 void Assets::LvglStrategy::UnApplyPartition(Assets* assets) {
+    {
+        std::lock_guard<std::mutex> lock(decompressed_mutex_);
+        for (auto& [offset, data] : decompressed_) {
+            heap_caps_free(data);
+        }
+        decompressed_.clear();
+    }
+    pack_.Close();
     if (mmap_handle_ != 0) {
         esp_partition_munmap(mmap_handle_);
         mmap_handle_ = 0;
@@ -195,6 +280,10 @@ void Assets::LvglStrategy::UnApplyPartition(Assets* assets) {
 }
 
 bool Assets::LvglStrategy::GetAssetData(Assets* assets, const std::string& name, void*& ptr, size_t& size) {
+    if (pack_.is_open()) {
+        return GetPackedAssetData(name, ptr, size);
+    }
+
     auto asset = assets_.find(name);
     if (asset == assets_.end()) {
         return false;
@@ -428,6 +517,13 @@ bool Assets::Download(std::string url, std::function<void(int progress, size_t s
     // 取消当前资源分区的内存映射
     UnApplyPartition();
 
+    // 分区内容将被改写，下次加载时重新校验资源包的SHA-256
+    {
+        Settings settings("assets", true);
+        settings.EraseKey("sha256");
+    }
+    Settings::Flush();
+
     // 下载新的资源文件
     auto network = Board::GetInstance().GetNetwork();
     auto http = network->CreateHttp(0);
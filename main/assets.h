@@ -9,12 +9,15 @@
 #include <esp_partition.h>
 #include <model_path.h>
 #include <map>
+#include <mutex>
 #include <string>
 
 #if HAVE_LVGL
 #include <spi_flash_mmap.h>
 #endif
 
+#include "asset_pack.h"
+
 struct Asset {
     size_t size;
     size_t offset;
@@ -62,10 +65,17 @@ private:
         bool GetAssetData(Assets* assets, const std::string& name, void*& ptr, size_t& size) override;
     private:
         static uint32_t CalculateChecksum(const char* data, uint32_t length);
+        bool InitializeAssetPack(Assets* assets);
+        bool GetPackedAssetData(const std::string& name, void*& ptr, size_t& size);
         std::map<std::string, Asset> assets_;
         esp_partition_mmap_handle_t mmap_handle_ = 0;
         const char* mmap_root_ = nullptr;
         bool checksum_valid_ = false;
+        // Asset pack format, compressed assets are decompressed on first use and kept by data offset.
+        // LVGL and the audio paths look up assets concurrently, decompressed_ is guarded by decompressed_mutex_
+        AssetPack pack_;
+        std::mutex decompressed_mutex_;
+        std::map<size_t, void*> decompressed_;
     };
     
     class EmoteStrategy : public AssetStrategy {
@@ -0,0 +1,185 @@
+#include "audio_power_manager.h"
+#include "application.h"
+#include "settings.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <esp_log.h>
+#include <esp_timer.h>
+
+#define TAG "AudioPowerManager"
+
+// Hours with a usage score above this keep the codec on for at least half of the maximum timeout
+#define AUDIO_POWER_BUSY_HOUR_SCORE 128
+
+AudioPowerManager::AudioPowerManager(int min_timeout_ms, int max_timeout_ms)
+    : min_timeout_ms_(min_timeout_ms), max_timeout_ms_(max_timeout_ms), idle_gap_ms_(max_timeout_ms) {
+}
+
+void AudioPowerManager::Initialize() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Settings settings("audio", false);
+    auto usage = settings.GetString("usage_hours");
+    if (usage.size() != sizeof(hourly_usage_) * 2) {
+        return;
+    }
+    for (size_t i = 0; i < sizeof(hourly_usage_); i++) {
+        hourly_usage_[i] = std::strtoul(usage.substr(i * 2, 2).c_str(), nullptr, 16);
+    }
+}
+
+void AudioPowerManager::OnActivity(AudioPowerChannel channel) {
+    int64_t now_us = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& stats = channels_[channel];
+    if (stats.prewarm_pending) {
+        stats.prewarm_pending = false;
+        stats.prewarm_hits++;
+    }
+    stats.last_activity_us = now_us;
+}
+
+void AudioPowerManager::OnInteraction(bool active) {
+    int64_t now_us = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (active == in_interaction_) {
+        return;
+    }
+    in_interaction_ = active;
+    if (!active) {
+        last_interaction_end_us_ = now_us;
+        return;
+    }
+
+    used_this_hour_ = true;
+    if (last_interaction_end_us_ != 0) {
+        int64_t gap_ms = (now_us - last_interaction_end_us_) / 1000;
+        // Cap the sample so one long pause does not erase the recent cadence
+        idle_gap_ms_ = (idle_gap_ms_ * 3 + std::min<int64_t>(gap_ms, max_timeout_ms_ * 2)) / 4;
+    }
+}
+
+void AudioPowerManager::OnPowerUp(AudioPowerChannel channel, AudioPowerUpReason reason, int64_t warmup_us) {
+    int64_t now_us = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& stats = channels_[channel];
+    if (stats.powered_since_us != 0) {
+        return;
+    }
+    stats.powered_since_us = now_us;
+    stats.last_activity_us = now_us;
+    if (reason == kAudioPowerUpStartup) {
+        return;
+    }
+    stats.power_ups++;
+    if (reason == kAudioPowerUpPrewarm) {
+        stats.prewarms++;
+        stats.prewarm_pending = true;
+    } else {
+        stats.cold_starts++;
+        stats.cold_start_wait_us += warmup_us;
+    }
+}
+
+void AudioPowerManager::OnPowerDown(AudioPowerChannel channel) {
+    int64_t now_us = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& stats = channels_[channel];
+    if (stats.powered_since_us != 0) {
+        stats.on_time_us += now_us - stats.powered_since_us;
+        stats.powered_since_us = 0;
+    }
+    stats.prewarm_pending = false;
+}
+
+void AudioPowerManager::UpdateHour() {
+    time_t now = time(nullptr);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    // Wall clock is not set yet
+    if (tm.tm_year + 1900 < 2025) {
+        return;
+    }
+    if (tm.tm_hour == current_hour_) {
+        return;
+    }
+
+    if (current_hour_ >= 0) {
+        auto& score = hourly_usage_[current_hour_];
+        if (used_this_hour_) {
+            score += (255 - score) / 4;
+        } else {
+            score -= score / 4;
+        }
+
+        char usage[sizeof(hourly_usage_) * 2 + 1];
+        for (size_t i = 0; i < sizeof(hourly_usage_); i++) {
+            snprintf(usage + i * 2, 3, "%02x", hourly_usage_[i]);
+        }
+        // Called from the power timer, leave the NVS write to the main task
+        Application::GetInstance().Schedule([usage = std::string(usage)]() {
+            Settings settings("audio", true);
+            settings.SetString("usage_hours", usage);
+        });
+    }
+    current_hour_ = tm.tm_hour;
+    used_this_hour_ = false;
+}
+
+int AudioPowerManager::GetIdleTimeoutMsLocked() {
+    UpdateHour();
+    int timeout_ms = min_timeout_ms_;
+    // Stay on long enough to catch the next interaction if they have been coming at a steady pace
+    if (idle_gap_ms_ < max_timeout_ms_) {
+        timeout_ms = std::max<int>(timeout_ms, std::min<int64_t>(idle_gap_ms_ * 5 / 4, max_timeout_ms_));
+    }
+    if (current_hour_ >= 0 && hourly_usage_[current_hour_] >= AUDIO_POWER_BUSY_HOUR_SCORE) {
+        timeout_ms = std::max(timeout_ms, max_timeout_ms_ / 2);
+    }
+    return timeout_ms;
+}
+
+int AudioPowerManager::GetIdleTimeoutMs() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return GetIdleTimeoutMsLocked();
+}
+
+bool AudioPowerManager::ShouldPowerDown(AudioPowerChannel channel) {
+    int64_t now_us = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& stats = channels_[channel];
+    return (now_us - stats.last_activity_us) / 1000 > GetIdleTimeoutMsLocked();
+}
+
+cJSON* AudioPowerManager::GetStatsJson() {
+    int64_t now_us = esp_timer_get_time();
+    std::lock_guard<std::mutex> lock(mutex_);
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "idle_timeout_ms", GetIdleTimeoutMsLocked());
+    cJSON_AddNumberToObject(json, "idle_gap_ms", idle_gap_ms_);
+    if (current_hour_ >= 0) {
+        cJSON_AddNumberToObject(json, "hour_usage", hourly_usage_[current_hour_]);
+    }
+
+    const char* names[] = {"input", "output"};
+    for (int i = 0; i < 2; i++) {
+        auto& stats = channels_[i];
+        int64_t on_time_us = stats.on_time_us;
+        if (stats.powered_since_us != 0) {
+            on_time_us += now_us - stats.powered_since_us;
+        }
+        cJSON* channel = cJSON_CreateObject();
+        cJSON_AddBoolToObject(channel, "enabled", stats.powered_since_us != 0);
+        cJSON_AddNumberToObject(channel, "on_ms", on_time_us / 1000);
+        cJSON_AddNumberToObject(channel, "on_percent", now_us > 0 ? on_time_us * 100 / now_us : 0);
+        cJSON_AddNumberToObject(channel, "power_ups", stats.power_ups);
+        cJSON_AddNumberToObject(channel, "cold_starts", stats.cold_starts);
+        cJSON_AddNumberToObject(channel, "cold_start_wait_ms", stats.cold_start_wait_us / 1000);
+        cJSON_AddNumberToObject(channel, "prewarms", stats.prewarms);
+        cJSON_AddNumberToObject(channel, "prewarm_hits", stats.prewarm_hits);
+        cJSON_AddItemToObject(json, names[i], channel);
+    }
+    return json;
+}
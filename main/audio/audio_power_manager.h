@@ -0,0 +1,81 @@
+#ifndef AUDIO_POWER_MANAGER_H
+#define AUDIO_POWER_MANAGER_H
+
+#include <cstdint>
+#include <mutex>
+
+#include <cJSON.h>
+
+enum AudioPowerChannel {
+    kAudioPowerInput,
+    kAudioPowerOutput,
+};
+
+enum AudioPowerUpReason {
+    kAudioPowerUpStartup,
+    kAudioPowerUpOnDemand,  // The caller waits for the codec before its first frame
+    kAudioPowerUpPrewarm,   // Powered up ahead of an expected use
+};
+
+/**
+ * Decides when the codec input / output can be powered down, and keeps energy / latency counters.
+ *
+ * The idle timeout is not fixed: it follows the recent interaction cadence (the typical pause
+ * between the end of one interaction and the start of the next) and the usage learned per hour
+ * of the day, so the codec stays on through a conversation or a busy hour and is powered down
+ * quickly otherwise.
+ * The manager only makes decisions, powering the codec is up to AudioService.
+ */
+class AudioPowerManager {
+public:
+    AudioPowerManager(int min_timeout_ms, int max_timeout_ms);
+
+    // Restore the learned hourly usage, NVS must be initialized
+    void Initialize();
+
+    // Called for every frame read from / written to the codec
+    void OnActivity(AudioPowerChannel channel);
+    // Called when the device leaves idle for a conversation (active) and when it returns to idle.
+    // Codec frames do not mark interactions, the wake word keeps reading the input all the time.
+    void OnInteraction(bool active);
+    // warmup_us: time spent enabling the channel
+    void OnPowerUp(AudioPowerChannel channel, AudioPowerUpReason reason, int64_t warmup_us = 0);
+    void OnPowerDown(AudioPowerChannel channel);
+
+    bool ShouldPowerDown(AudioPowerChannel channel);
+    int GetIdleTimeoutMs();
+
+    // Caller takes ownership of the returned object
+    cJSON* GetStatsJson();
+
+private:
+    struct ChannelStats {
+        int64_t last_activity_us = 0;
+        int64_t powered_since_us = 0;   // 0 while powered down
+        int64_t on_time_us = 0;
+        uint32_t power_ups = 0;
+        uint32_t cold_starts = 0;       // kAudioPowerUpOnDemand
+        int64_t cold_start_wait_us = 0;
+        uint32_t prewarms = 0;
+        uint32_t prewarm_hits = 0;      // prewarmed channel used before it was powered down
+        bool prewarm_pending = false;
+    };
+
+    std::mutex mutex_;
+    int min_timeout_ms_;
+    int max_timeout_ms_;
+    ChannelStats channels_[2];
+    bool in_interaction_ = false;
+    int64_t last_interaction_end_us_ = 0;
+    int64_t idle_gap_ms_;               // Moving average of the pause between interactions
+
+    // Usage score of each hour of the day, 0 (never used) to 255 (always used)
+    uint8_t hourly_usage_[24] = {};
+    int current_hour_ = -1;
+    bool used_this_hour_ = false;
+
+    void UpdateHour();
+    int GetIdleTimeoutMsLocked();
+};
+
+#endif // AUDIO_POWER_MANAGER_H
@@ -7,6 +7,7 @@
 
 #include <model_path.h>
 #include "audio_codec.h"
+#include "mic_array.h"
 
 class AudioProcessor {
 public:
@@ -21,6 +22,8 @@ public:
     virtual void OnVadStateChange(std::function<void(bool speaking)> callback) = 0;
     virtual size_t GetFeedSize() = 0;
     virtual void EnableDeviceAec(bool enable) = 0;
+    // Boards with a microphone array pass it to engines that take a single channel
+    virtual void SetMicArray(MicArray* mic_array) { (void)mic_array; }
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include "audio_service.h"
+#include "sample_format.h"
 #include <esp_log.h>
 #include <cstring>
+#include <algorithm>
 
 #define RATE_CVT_CFG(_src_rate, _dest_rate, _channel)        \
     (esp_ae_rate_cvt_cfg_t)                                  \
@@ -57,12 +59,29 @@ AudioService::~AudioService() {
     if (output_resampler_ != nullptr) {
         esp_ae_rate_cvt_close(output_resampler_);
     }
+    if (sound_decoder_ != nullptr) {
+        esp_opus_dec_close(sound_decoder_);
+    }
+    if (sound_resampler_ != nullptr) {
+        esp_ae_rate_cvt_close(sound_resampler_);
+    }
+    if (wake_word_pm_lock_ != nullptr) {
+        esp_pm_lock_delete(wake_word_pm_lock_);
+    }
 }
 
 void AudioService::Initialize(AudioCodec* codec) {
     codec_ = codec;
     codec_->Start();
 
+    power_manager_.Initialize();
+    if (codec_->input_enabled()) {
+        power_manager_.OnPowerUp(kAudioPowerInput, kAudioPowerUpStartup);
+    }
+    if (codec_->output_enabled()) {
+        power_manager_.OnPowerUp(kAudioPowerOutput, kAudioPowerUpStartup);
+    }
+
     esp_opus_dec_cfg_t opus_dec_cfg = OPUS_DEC_CFG(codec->output_sample_rate(), OPUS_FRAME_DURATION_MS);
     auto ret = esp_opus_dec_open(&opus_dec_cfg, sizeof(esp_opus_dec_cfg_t), &opus_decoder_);
     if (opus_decoder_ == nullptr) {
@@ -92,11 +111,37 @@ void AudioService::Initialize(AudioCodec* codec) {
         }
     }
 
+#if CONFIG_USE_AUDIO_OUTPUT_DSP
+    OutputDsp::Config output_dsp_config;
+    if (Board::GetInstance().GetOutputDspConfig(output_dsp_config)
+        && output_dsp_.Configure(output_dsp_config, codec->output_sample_rate())) {
+        ESP_LOGI(TAG, "Output DSP: %u filters, loudness target %d dBFS, limiter %.1f dBFS",
+            (unsigned)output_dsp_config.eq.size(), output_dsp_config.loudness_target_db,
+            output_dsp_config.limiter_threshold_db);
+    }
+#endif
+
+#if CONFIG_USE_MIC_ARRAY
+    int mics = codec->input_channels() - (codec->input_reference() ? 1 : 0);
+    if (mics > 1) {
+        MicArray::Config mic_array_config;
+        mic_array_config.spacing_mm = CONFIG_MIC_ARRAY_SPACING_MM;
+        mic_array_.SetConfig(mic_array_config);
+        mic_array_.Reset(codec->input_channels(), mics);
+        ESP_LOGI(TAG, "Microphone array: %d microphones, %d mm", mics, CONFIG_MIC_ARRAY_SPACING_MM);
+    }
+#endif
+
 #if CONFIG_USE_AUDIO_PROCESSOR
-    audio_processor_ = std::make_unique<AfeAudioProcessor>();
+    // Shared with the AFE wake word, if the models have one
+    afe_front_end_ = std::make_shared<AfeFrontEnd>();
+    audio_processor_ = std::make_unique<AfeAudioProcessor>(afe_front_end_);
 #else
     audio_processor_ = std::make_unique<NoAudioProcessor>();
 #endif
+    if (mic_array_.enabled()) {
+        audio_processor_->SetMicArray(&mic_array_);
+    }
 
     audio_processor_->OnOutput([this](std::vector<int16_t>&& data) {
         PushTaskToEncodeQueue(kAudioTaskTypeEncodeToSendQueue, std::move(data));
@@ -178,14 +223,14 @@ void AudioService::Stop() {
     audio_decode_queue_.clear();
     audio_playback_queue_.clear();
     audio_testing_queue_.clear();
+    sound_queue_.clear();
+    sound_mix_buffer_.clear();
     audio_queue_cv_.notify_all();
 }
 
 bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
     if (!codec_->input_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableInput(true);
+        EnableCodecPower(kAudioPowerInput, kAudioPowerUpOnDemand);
     }
 
     if (codec_->input_sample_rate() != sample_rate) {
@@ -212,8 +257,7 @@ bool AudioService::ReadAudioData(std::vector<int16_t>& data, int sample_rate, in
         }
     }
 
-    /* Update the last input time */
-    last_input_time_ = std::chrono::steady_clock::now();
+    power_manager_.OnActivity(kAudioPowerInput);
     debug_statistics_.input_count++;
 
 #if CONFIG_USE_AUDIO_DEBUGGER
@@ -241,6 +285,9 @@ void AudioService::AudioInputTask() {
             vTaskDelay(pdMS_TO_TICKS(120));
             continue;
         }
+        if (wake_word_gated_ && !low_power_listening_) {
+            StopWakeWordGate();
+        }
 
         /* Used for audio testing in NetworkConfiguring mode by clicking the BOOT button */
         if (bits & AS_EVENT_AUDIO_TESTING_RUNNING) {
@@ -254,26 +301,31 @@ void AudioService::AudioInputTask() {
             if (ReadAudioData(data, 16000, samples)) {
                 // If input channels is 2, we need to fetch the left channel data
                 if (codec_->input_channels() == 2) {
-                    auto mono_data = std::vector<int16_t>(data.size() / 2);
-                    for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                        mono_data[i] = data[j];
-                    }
-                    data = std::move(mono_data);
+                    sample_format::Deinterleave(data.data(), data.data(), data.size() / 2, 2, 0);
+                    data.resize(data.size() / 2);
                 }
                 PushTaskToEncodeQueue(kAudioTaskTypeEncodeToTestingQueue, std::move(data));
                 continue;
             }
         }
 
-        /* Feed the wake word */
+        /* Feed the wake word, through the energy gate in power save mode.
+           A shared front end hands the same input to the audio processor */
         if (bits & AS_EVENT_WAKE_WORD_RUNNING) {
-            std::vector<int16_t> data;
-            int samples = wake_word_->GetFeedSize();
-            if (samples > 0) {
-                if (ReadAudioData(data, 16000, samples)) {
-                    wake_word_->Feed(data);
+            if (low_power_listening_) {
+                if (FeedWakeWordGated()) {
                     continue;
                 }
+            } else {
+                std::vector<int16_t> data;
+                int samples = wake_word_->GetFeedSize();
+                if (samples > 0) {
+                    if (ReadAudioData(data, 16000, samples)) {
+                        UpdateMicArray(data);
+                        wake_word_->Feed(data);
+                        continue;
+                    }
+                }
             }
         }
 
@@ -283,6 +335,7 @@ void AudioService::AudioInputTask() {
             int samples = audio_processor_->GetFeedSize();
             if (samples > 0) {
                 if (ReadAudioData(data, 16000, samples)) {
+                    UpdateMicArray(data);
                     audio_processor_->Feed(std::move(data));
                     continue;
                 }
@@ -296,6 +349,63 @@ void AudioService::AudioInputTask() {
     ESP_LOGW(TAG, "Audio input task stopped");
 }
 
+bool AudioService::FeedWakeWordGated() {
+    if (!wake_word_gated_) {
+        wake_word_gate_.Reset(codec_->input_channels());
+        // The wake word engine is paused until the gate opens
+        wake_word_->Stop();
+        wake_word_gated_ = true;
+    }
+
+    std::vector<int16_t> data;
+    if (!ReadAudioData(data, 16000, WAKE_WORD_GATE_BLOCK_MS * 16)) {
+        return false;
+    }
+    UpdateMicArray(data);
+
+    auto event = wake_word_gate_.Process(data);
+    if (event == WakeWordGate::kEventOpened) {
+        ESP_LOGD(TAG, "Wake word gate opened");
+        if (wake_word_pm_lock_ != nullptr) {
+            esp_pm_lock_acquire(wake_word_pm_lock_);
+        }
+        wake_word_->Start();
+    } else if (event == WakeWordGate::kEventClosed) {
+        ESP_LOGD(TAG, "Wake word gate closed");
+        wake_word_->Stop();
+        if (wake_word_pm_lock_ != nullptr) {
+            esp_pm_lock_release(wake_word_pm_lock_);
+        }
+    }
+
+    if (wake_word_gate_.open()) {
+        // Feed the preroll and the new block in the chunk size of the engine
+        size_t feed_size = wake_word_->GetFeedSize() * codec_->input_channels();
+        while (wake_word_gate_.Pop(data, feed_size)) {
+            wake_word_->Feed(data);
+        }
+    }
+    return true;
+}
+
+void AudioService::StopWakeWordGate() {
+    wake_word_gated_ = false;
+    if (wake_word_gate_.open()) {
+        if (wake_word_pm_lock_ != nullptr) {
+            esp_pm_lock_release(wake_word_pm_lock_);
+        }
+    } else if (IsWakeWordRunning()) {
+        // Resume the engine paused by the closed gate
+        wake_word_->Start();
+    }
+}
+
+void AudioService::UpdateMicArray(const std::vector<int16_t>& data) {
+    if (mic_array_.enabled() && mic_array_.Process(data) && callbacks_.on_sound_direction) {
+        callbacks_.on_sound_direction(mic_array_.direction());
+    }
+}
+
 void AudioService::AudioOutputTask() {
     while (true) {
         std::unique_lock<std::mutex> lock(audio_queue_mutex_);
@@ -310,14 +420,17 @@ void AudioService::AudioOutputTask() {
         lock.unlock();
 
         if (!codec_->output_enabled()) {
-            esp_timer_stop(audio_power_timer_);
-            esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-            codec_->EnableOutput(true);
+            EnableCodecPower(kAudioPowerOutput, kAudioPowerUpOnDemand);
+        }
+        if (output_dsp_.enabled()) {
+            if (output_dsp_reset_.exchange(false)) {
+                output_dsp_.Reset();
+            }
+            output_dsp_.Process(task->pcm.data(), task->pcm.size());
         }
         codec_->OutputData(task->pcm);
 
-        /* Update the last output time */
-        last_output_time_ = std::chrono::steady_clock::now();
+        power_manager_.OnActivity(kAudioPowerOutput);
         debug_statistics_.playback_count++;
 
 #if CONFIG_USE_SERVER_AEC
@@ -338,7 +451,8 @@ void AudioService::OpusCodecTask() {
         audio_queue_cv_.wait(lock, [this]() {
             return service_stopped_ ||
                 (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) ||
-                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
+                (!audio_decode_queue_.empty() && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) ||
+                ((!sound_queue_.empty() || !sound_mix_buffer_.empty()) && audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE);
         });
         if (service_stopped_) {
             break;
@@ -385,6 +499,7 @@ void AudioService::OpusCodecTask() {
                         resampled.resize(actual_output);
                         task->pcm = std::move(resampled);
                     }
+                    MixSound(task->pcm);
                     lock.lock();
                     audio_playback_queue_.push_back(std::move(task));
                     audio_queue_cv_.notify_all();
@@ -399,6 +514,26 @@ void AudioService::OpusCodecTask() {
             }
             debug_statistics_.decode_count++;
         }
+        /* Play sounds on their own while there is no speech to mix them into */
+        if (audio_decode_queue_.empty() && (!sound_queue_.empty() || !sound_mix_buffer_.empty()) &&
+            audio_playback_queue_.size() < MAX_PLAYBACK_TASKS_IN_QUEUE) {
+            auto task = std::make_unique<AudioTask>();
+            task->type = kAudioTaskTypeDecodeToPlaybackQueue;
+            task->timestamp = 0;
+            // Flush what is left over from mixing first
+            task->pcm.swap(sound_mix_buffer_);
+            lock.unlock();
+
+            if (task->pcm.empty()) {
+                DecodeSoundPacket(task->pcm);
+            }
+            CloseSoundDecoderIfIdle();
+            lock.lock();
+            if (!task->pcm.empty()) {
+                audio_playback_queue_.push_back(std::move(task));
+                audio_queue_cv_.notify_all();
+            }
+        }
         /* Encode the audio to send queue */
         if (!audio_encode_queue_.empty() && audio_send_queue_.size() < MAX_SEND_PACKETS_IN_QUEUE) {
             auto task = std::move(audio_encode_queue_.front());
@@ -569,8 +704,9 @@ void AudioService::EnableWakeWordDetection(bool enable) {
             wake_word_initialized_ = true;
         }
         // Reset input resampler to clear cached data from previous mode (e.g. AudioProcessor)
-        // This prevents buffer overflow when switching between different feed sizes
-        {
+        // This prevents buffer overflow when switching between different feed sizes.
+        // A shared front end keeps its feed size, the input is not interrupted
+        if (!(IsFrontEndShared() && IsAudioProcessorRunning())) {
             std::lock_guard<std::mutex> lock(input_resampler_mutex_);
             if (input_resampler_ != nullptr) {
                 esp_ae_rate_cvt_reset(input_resampler_);
@@ -584,6 +720,18 @@ void AudioService::EnableWakeWordDetection(bool enable) {
     }
 }
 
+void AudioService::EnableLowPowerListening(bool enable) {
+    if (enable && wake_word_pm_lock_ == nullptr) {
+        auto ret = esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "wake_word", &wake_word_pm_lock_);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Failed to create wake word PM lock: %s", esp_err_to_name(ret));
+        }
+    }
+    ESP_LOGI(TAG, "%s low power listening", enable ? "Enabling" : "Disabling");
+    // Applied by the audio input task
+    low_power_listening_ = enable;
+}
+
 void AudioService::EnableVoiceProcessing(bool enable) {
     ESP_LOGD(TAG, "%s voice processing", enable ? "Enabling" : "Disabling");
     if (enable) {
@@ -594,10 +742,12 @@ void AudioService::EnableVoiceProcessing(bool enable) {
 
         /* We should make sure no audio is playing */
         ResetDecoder();
-        audio_input_need_warmup_ = true;
-        // Reset input resampler to clear cached data from previous mode (e.g. WakeWord)
-        // This prevents buffer overflow when switching between different feed sizes
-        {
+        // The shared front end is already running for the wake word, so it needs no warmup
+        // and its input continues without a gap
+        if (!(IsFrontEndShared() && IsWakeWordRunning())) {
+            audio_input_need_warmup_ = true;
+            // Reset input resampler to clear cached data from previous mode (e.g. WakeWord)
+            // This prevents buffer overflow when switching between different feed sizes
             std::lock_guard<std::mutex> lock(input_resampler_mutex_);
             if (input_resampler_ != nullptr) {
                 esp_ae_rate_cvt_reset(input_resampler_);
@@ -639,105 +789,150 @@ void AudioService::SetCallbacks(AudioServiceCallbacks& callbacks) {
 }
 
 void AudioService::PlaySound(const std::string_view& ogg) {
+    auto sound = OggSound::Get(ogg);
+    if (sound->packets().empty()) {
+        ESP_LOGW(TAG, "No audio packets in sound");
+        return;
+    }
+
     if (!codec_->output_enabled()) {
-        esp_timer_stop(audio_power_timer_);
-        esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
-        codec_->EnableOutput(true);
+        EnableCodecPower(kAudioPowerOutput, kAudioPowerUpOnDemand);
     }
 
-    const uint8_t* buf = reinterpret_cast<const uint8_t*>(ogg.data());
-    size_t size = ogg.size();
-    size_t offset = 0;
+    std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+    sound_queue_.push_back({sound, 0});
+    audio_queue_cv_.notify_all();
+}
+
+bool AudioService::DecodeSoundPacket(std::vector<int16_t>& pcm) {
+    const OggSound* sound;
+    OggSound::Packet packet;
+    bool first_packet;
+    {
+        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+        if (sound_queue_.empty()) {
+            return false;
+        }
+        auto& playback = sound_queue_.front();
+        sound = playback.sound;
+        first_packet = playback.next_packet == 0;
+        packet = sound->packets()[playback.next_packet++];
+        if (playback.next_packet >= sound->packets().size()) {
+            sound_queue_.pop_front();
+        }
+    }
 
-    auto find_page = [&](size_t start)->size_t {
-        for (size_t i = start; i + 4 <= size; ++i) {
-            if (buf[i] == 'O' && buf[i+1] == 'g' && buf[i+2] == 'g' && buf[i+3] == 'S') return i;
+    if (sound_decoder_ != nullptr && (sound_decoder_sample_rate_ != sound->sample_rate() ||
+        sound_decoder_duration_ms_ != sound->frame_duration())) {
+        esp_opus_dec_close(sound_decoder_);
+        sound_decoder_ = nullptr;
+    }
+    if (sound_decoder_ == nullptr) {
+        esp_opus_dec_cfg_t opus_dec_cfg = OPUS_DEC_CFG(sound->sample_rate(), sound->frame_duration());
+        auto ret = esp_opus_dec_open(&opus_dec_cfg, sizeof(esp_opus_dec_cfg_t), &sound_decoder_);
+        if (sound_decoder_ == nullptr) {
+            ESP_LOGE(TAG, "Failed to create sound decoder, error code: %d", ret);
+            return true;
         }
-        return static_cast<size_t>(-1);
+        sound_decoder_sample_rate_ = sound->sample_rate();
+        sound_decoder_duration_ms_ = sound->frame_duration();
+        if (sound_resampler_ != nullptr) {
+            esp_ae_rate_cvt_close(sound_resampler_);
+            sound_resampler_ = nullptr;
+        }
+        if (sound_decoder_sample_rate_ != codec_->output_sample_rate()) {
+            esp_ae_rate_cvt_cfg_t resampler_cfg = RATE_CVT_CFG(
+                sound_decoder_sample_rate_, codec_->output_sample_rate(), ESP_AUDIO_MONO);
+            esp_ae_rate_cvt_open(&resampler_cfg, &sound_resampler_);
+        }
+    } else if (first_packet) {
+        esp_opus_dec_reset(sound_decoder_);
+        if (sound_resampler_ != nullptr) {
+            esp_ae_rate_cvt_reset(sound_resampler_);
+        }
+    }
+
+    pcm.resize(sound_decoder_sample_rate_ / 1000 * sound_decoder_duration_ms_);
+    esp_audio_dec_in_raw_t raw = {
+        .buffer = const_cast<uint8_t*>(packet.data),
+        .len = packet.size,
+        .consumed = 0,
+        .frame_recover = ESP_AUDIO_DEC_RECOVERY_NONE,
+    };
+    esp_audio_dec_out_frame_t out_frame = {
+        .buffer = (uint8_t *)(pcm.data()),
+        .len = (uint32_t)(pcm.size() * sizeof(int16_t)),
+        .decoded_size = 0,
     };
+    esp_audio_dec_info_t dec_info = {};
+    auto ret = esp_opus_dec_decode(sound_decoder_, &raw, &out_frame, &dec_info);
+    if (ret != ESP_AUDIO_ERR_OK) {
+        ESP_LOGE(TAG, "Failed to decode sound, error code: %d", ret);
+        pcm.clear();
+        return true;
+    }
+    pcm.resize(out_frame.decoded_size / sizeof(int16_t));
+
+    if (sound_resampler_ != nullptr) {
+        uint32_t target_size = 0;
+        esp_ae_rate_cvt_get_max_out_sample_num(sound_resampler_, pcm.size(), &target_size);
+        std::vector<int16_t> resampled(target_size);
+        uint32_t actual_output = target_size;
+        esp_ae_rate_cvt_process(sound_resampler_, (esp_ae_sample_t)pcm.data(), pcm.size(),
+                                (esp_ae_sample_t)resampled.data(), &actual_output);
+        resampled.resize(actual_output);
+        pcm = std::move(resampled);
+    }
+    return true;
+}
 
-    bool seen_head = false;
-    bool seen_tags = false;
-    int sample_rate = 16000; // 默认值
+void AudioService::MixSound(std::vector<int16_t>& pcm) {
+    std::unique_lock<std::mutex> lock(audio_queue_mutex_);
+    if (sound_queue_.empty() && sound_mix_buffer_.empty()) {
+        return;
+    }
+    while (sound_mix_buffer_.size() < pcm.size() && !sound_queue_.empty()) {
+        lock.unlock();
+        std::vector<int16_t> sound_pcm;
+        DecodeSoundPacket(sound_pcm);
+        lock.lock();
+        sound_mix_buffer_.insert(sound_mix_buffer_.end(), sound_pcm.begin(), sound_pcm.end());
+    }
 
-    while (true) {
-        size_t pos = find_page(offset);
-        if (pos == static_cast<size_t>(-1)) break;
-        offset = pos;
-        if (offset + 27 > size) break;
-
-        const uint8_t* page = buf + offset;
-        uint8_t page_segments = page[26];
-        size_t seg_table_off = offset + 27;
-        if (seg_table_off + page_segments > size) break;
-
-        size_t body_size = 0;
-        for (size_t i = 0; i < page_segments; ++i) body_size += page[27 + i];
-
-        size_t body_off = seg_table_off + page_segments;
-        if (body_off + body_size > size) break;
-
-        // Parse packets using lacing
-        size_t cur = body_off;
-        size_t seg_idx = 0;
-        while (seg_idx < page_segments) {
-            size_t pkt_len = 0;
-            size_t pkt_start = cur;
-            bool continued = false;
-            do {
-                uint8_t l = page[27 + seg_idx++];
-                pkt_len += l;
-                cur += l;
-                continued = (l == 255);
-            } while (continued && seg_idx < page_segments);
-
-            if (pkt_len == 0) continue;
-            const uint8_t* pkt_ptr = buf + pkt_start;
-
-            if (!seen_head) {
-                // 解析OpusHead包
-                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
-                    seen_head = true;
-                    // OpusHead结构：[0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
-                    // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
-                    if (pkt_len >= 12) {
-                        uint8_t version = pkt_ptr[8];
-                        uint8_t channel_count = pkt_ptr[9];
-                        if (pkt_len >= 16) {
-                            // 读取输入采样率 (little-endian)
-                            sample_rate = pkt_ptr[12] | (pkt_ptr[13] << 8) |
-                                        (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
-                            ESP_LOGI(TAG, "OpusHead: version=%d, channels=%d, sample_rate=%d",
-                                   version, channel_count, sample_rate);
-                        }
-                    }
-                }
-                continue;
-            }
-            if (!seen_tags) {
-                // Expect OpusTags in second packet
-                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
-                    seen_tags = true;
-                }
-                continue;
-            }
+    // Duck the speech under the sound
+    size_t mixed = std::min(pcm.size(), sound_mix_buffer_.size());
+    for (size_t i = 0; i < mixed; i++) {
+        int32_t sample = (pcm[i] >> AUDIO_SOUND_DUCK_SHIFT) + sound_mix_buffer_[i];
+        pcm[i] = std::clamp<int32_t>(sample, INT16_MIN, INT16_MAX);
+    }
+    sound_mix_buffer_.erase(sound_mix_buffer_.begin(), sound_mix_buffer_.begin() + mixed);
+    lock.unlock();
 
-            // Audio packet (Opus)
-            auto packet = std::make_unique<AudioStreamPacket>();
-            packet->sample_rate = sample_rate;
-            packet->frame_duration = 60;
-            packet->payload.resize(pkt_len);
-            std::memcpy(packet->payload.data(), pkt_ptr, pkt_len);
-            PushPacketToDecodeQueue(std::move(packet), true);
-        }
+    CloseSoundDecoderIfIdle();
+}
 
-        offset = body_off + body_size;
+void AudioService::CloseSoundDecoderIfIdle() {
+    {
+        std::lock_guard<std::mutex> lock(audio_queue_mutex_);
+        if (!sound_queue_.empty() || !sound_mix_buffer_.empty()) {
+            return;
+        }
+    }
+    // Free the decoder memory until the next sound
+    if (sound_decoder_ != nullptr) {
+        esp_opus_dec_close(sound_decoder_);
+        sound_decoder_ = nullptr;
+    }
+    if (sound_resampler_ != nullptr) {
+        esp_ae_rate_cvt_close(sound_resampler_);
+        sound_resampler_ = nullptr;
     }
 }
 
 bool AudioService::IsIdle() {
     std::lock_guard<std::mutex> lock(audio_queue_mutex_);
-    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty();
+    return audio_encode_queue_.empty() && audio_decode_queue_.empty() && audio_playback_queue_.empty() && audio_testing_queue_.empty() &&
+        sound_queue_.empty() && sound_mix_buffer_.empty();
 }
 
 void AudioService::ResetDecoder() {
@@ -751,18 +946,42 @@ void AudioService::ResetDecoder() {
     audio_decode_queue_.clear();
     audio_playback_queue_.clear();
     audio_testing_queue_.clear();
+    sound_queue_.clear();
+    sound_mix_buffer_.clear();
+    // Do not let the filter and limiter state of the old stream ring into the next one
+    output_dsp_reset_ = true;
     audio_queue_cv_.notify_all();
 }
 
+void AudioService::EnableCodecPower(AudioPowerChannel channel, AudioPowerUpReason reason) {
+    esp_timer_stop(audio_power_timer_);
+    esp_timer_start_periodic(audio_power_timer_, AUDIO_POWER_CHECK_INTERVAL_MS * 1000);
+    int64_t start_time = esp_timer_get_time();
+    if (channel == kAudioPowerInput) {
+        codec_->EnableInput(true);
+    } else {
+        codec_->EnableOutput(true);
+    }
+    power_manager_.OnPowerUp(channel, reason, esp_timer_get_time() - start_time);
+}
+
+void AudioService::PrewarmCodec(bool input, bool output) {
+    if (input && !codec_->input_enabled()) {
+        EnableCodecPower(kAudioPowerInput, kAudioPowerUpPrewarm);
+    }
+    if (output && !codec_->output_enabled()) {
+        EnableCodecPower(kAudioPowerOutput, kAudioPowerUpPrewarm);
+    }
+}
+
 void AudioService::CheckAndUpdateAudioPowerState() {
-    auto now = std::chrono::steady_clock::now();
-    auto input_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_input_time_).count();
-    auto output_elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_output_time_).count();
-    if (input_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->input_enabled()) {
+    if (codec_->input_enabled() && power_manager_.ShouldPowerDown(kAudioPowerInput)) {
         codec_->EnableInput(false);
+        power_manager_.OnPowerDown(kAudioPowerInput);
     }
-    if (output_elapsed > AUDIO_POWER_TIMEOUT_MS && codec_->output_enabled()) {
+    if (codec_->output_enabled() && power_manager_.ShouldPowerDown(kAudioPowerOutput)) {
         codec_->EnableOutput(false);
+        power_manager_.OnPowerDown(kAudioPowerOutput);
     }
     if (!codec_->input_enabled() && !codec_->output_enabled()) {
         esp_timer_stop(audio_power_timer_);
@@ -776,7 +995,7 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
     if (esp_srmodel_filter(models_list_, ESP_MN_PREFIX, NULL) != nullptr) {
         wake_word_ = std::make_unique<CustomWakeWord>();
     } else if (esp_srmodel_filter(models_list_, ESP_WN_PREFIX, NULL) != nullptr) {
-        wake_word_ = std::make_unique<AfeWakeWord>();
+        wake_word_ = std::make_unique<AfeWakeWord>(afe_front_end_);
     } else {
         wake_word_ = nullptr;
     }
@@ -789,7 +1008,13 @@ void AudioService::SetModelsList(srmodel_list_t* models_list) {
 #endif
 
     if (wake_word_) {
+        if (mic_array_.enabled()) {
+            wake_word_->SetMicArray(&mic_array_);
+        }
         wake_word_->OnWakeWordDetected([this](const std::string& wake_word) {
+            if (low_power_listening_) {
+                wake_word_gate_.OnWakeWordDetected();
+            }
             if (callbacks_.on_wake_word_detected) {
                 callbacks_.on_wake_word_detected(wake_word);
             }
@@ -804,3 +1029,11 @@ bool AudioService::IsAfeWakeWord() {
     return false;
 #endif
 }
+
+bool AudioService::IsFrontEndShared() {
+#if CONFIG_USE_AUDIO_PROCESSOR
+    return afe_front_end_ != nullptr && afe_front_end_->shared() && IsAfeWakeWord();
+#else
+    return false;
+#endif
+}
@@ -6,11 +6,13 @@
 #include <condition_variable>
 #include <chrono>
 #include <mutex>
+#include <atomic>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
 #include <freertos/event_groups.h>
 #include <esp_timer.h>
+#include <esp_pm.h>
 #include <model_path.h>
 #include "esp_audio_enc.h"
 #include "esp_opus_enc.h"
@@ -20,10 +22,16 @@
 
 #include "audio_codec.h"
 #include "audio_processor.h"
+#include "audio_power_manager.h"
+#include "ogg_sound.h"
 #include "processors/audio_debugger.h"
 #include "wake_word.h"
+#include "wake_word_gate.h"
+#include "output_dsp.h"
+#include "mic_array.h"
 #include "protocol.h"
 
+class AfeFrontEnd;
 
 /*
  * There are two types of audio data flow:
@@ -42,11 +50,18 @@
 #define MAX_DECODE_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define MAX_SEND_PACKETS_IN_QUEUE (2400 / OPUS_FRAME_DURATION_MS)
 #define AUDIO_TESTING_MAX_DURATION_MS 10000
+// Speech is attenuated by this many bits (6 dB each) while a sound is mixed over it
+#define AUDIO_SOUND_DUCK_SHIFT 1
 #define MAX_TIMESTAMPS_IN_QUEUE 3
 
+// The codec is powered down after an idle time between these, see AudioPowerManager
+#define AUDIO_POWER_MIN_TIMEOUT_MS 3000
 #define AUDIO_POWER_TIMEOUT_MS 15000
 #define AUDIO_POWER_CHECK_INTERVAL_MS 1000
 
+// Block read at a time while the wake word is gated, longer blocks wake the input task less often
+#define WAKE_WORD_GATE_BLOCK_MS 100
+
 #define AS_EVENT_AUDIO_TESTING_RUNNING      (1 << 0)
 #define AS_EVENT_WAKE_WORD_RUNNING          (1 << 1)
 #define AS_EVENT_AUDIO_PROCESSOR_RUNNING    (1 << 2)
@@ -80,6 +95,7 @@ struct AudioServiceCallbacks {
     std::function<void(const std::string&)> on_wake_word_detected;
     std::function<void(bool)> on_vad_change;
     std::function<void(void)> on_audio_testing_queue_full;
+    std::function<void(int)> on_sound_direction;
 };
 
 
@@ -95,6 +111,11 @@ struct AudioTask {
     uint32_t timestamp;
 };
 
+struct SoundPlayback {
+    const OggSound* sound;
+    size_t next_packet;
+};
+
 struct DebugStatistics {
     uint32_t input_count = 0;
     uint32_t decode_count = 0;
@@ -118,6 +139,8 @@ public:
     bool IsWakeWordRunning() const { return xEventGroupGetBits(event_group_) & AS_EVENT_WAKE_WORD_RUNNING; }
     bool IsAudioProcessorRunning() const { return xEventGroupGetBits(event_group_) & AS_EVENT_AUDIO_PROCESSOR_RUNNING; }
     bool IsAfeWakeWord();
+    // The wake word and the audio processor run on one front end and can be enabled together
+    bool IsFrontEndShared();
 
     void EnableWakeWordDetection(bool enable);
     void EnableVoiceProcessing(bool enable);
@@ -133,9 +156,34 @@ public:
     void ResetDecoder();
     void SetModelsList(srmodel_list_t* models_list);
 
+    /**
+     * Power up the codec ahead of an expected use, so the first frame is not delayed
+     */
+    void PrewarmCodec(bool input, bool output);
+    // Interaction boundaries the codec idle timeout learns from, see AudioPowerManager
+    void OnInteraction(bool active) { power_manager_.OnInteraction(active); }
+    cJSON* GetPowerStatsJson() { return power_manager_.GetStatsJson(); }
+
+    /**
+     * Put the wake word behind an energy gate while the device is in power save mode,
+     * the wake word engine and the full CPU frequency are only used while the gate is open
+     */
+    void EnableLowPowerListening(bool enable);
+    bool IsLowPowerListening() const { return low_power_listening_; }
+    cJSON* GetWakeWordGateStatsJson() { return wake_word_gate_.GetStatsJson(); }
+
+    /**
+     * Direction of the talker from the microphone array in degrees, -1 if unknown or the board
+     * has a single microphone
+     */
+    int GetSoundDirection() const { return mic_array_.direction(); }
+    bool HasMicArray() const { return mic_array_.enabled(); }
+    cJSON* GetMicArrayStatsJson() { return mic_array_.GetStatsJson(); }
+
 private:
     AudioCodec* codec_ = nullptr;
     AudioServiceCallbacks callbacks_;
+    std::shared_ptr<AfeFrontEnd> afe_front_end_;
     std::unique_ptr<AudioProcessor> audio_processor_;
     std::unique_ptr<WakeWord> wake_word_;
     std::unique_ptr<AudioDebugger> audio_debugger_;
@@ -173,6 +221,14 @@ private:
     // For server AEC
     std::deque<uint32_t> timestamp_queue_;
 
+    // Sounds are decoded by their own decoder, so they can be mixed over speech
+    std::deque<SoundPlayback> sound_queue_;
+    std::vector<int16_t> sound_mix_buffer_;
+    void* sound_decoder_ = nullptr;
+    int sound_decoder_sample_rate_ = 0;
+    int sound_decoder_duration_ms_ = 0;
+    esp_ae_rate_cvt_handle_t sound_resampler_ = nullptr;
+
     bool wake_word_initialized_ = false;
     bool audio_processor_initialized_ = false;
     bool voice_detected_ = false;
@@ -180,8 +236,17 @@ private:
     bool audio_input_need_warmup_ = false;
 
     esp_timer_handle_t audio_power_timer_ = nullptr;
-    std::chrono::steady_clock::time_point last_input_time_;
-    std::chrono::steady_clock::time_point last_output_time_;
+    AudioPowerManager power_manager_{AUDIO_POWER_MIN_TIMEOUT_MS, AUDIO_POWER_TIMEOUT_MS};
+
+    std::atomic<bool> low_power_listening_{false};
+    bool wake_word_gated_ = false;      // Only used by the audio input task
+    WakeWordGate wake_word_gate_;
+    esp_pm_lock_handle_t wake_word_pm_lock_ = nullptr;
+
+    MicArray mic_array_;                // Analyzed by the audio input task after Initialize()
+
+    OutputDsp output_dsp_;              // Only used by the audio output task after Initialize()
+    std::atomic<bool> output_dsp_reset_{false};
 
     void AudioInputTask();
     void AudioOutputTask();
@@ -189,6 +254,13 @@ private:
     void PushTaskToEncodeQueue(AudioTaskType type, std::vector<int16_t>&& pcm);
     void SetDecodeSampleRate(int sample_rate, int frame_duration);
     void CheckAndUpdateAudioPowerState();
+    void EnableCodecPower(AudioPowerChannel channel, AudioPowerUpReason reason);
+    bool DecodeSoundPacket(std::vector<int16_t>& pcm);
+    void MixSound(std::vector<int16_t>& pcm);
+    void CloseSoundDecoderIfIdle();
+    bool FeedWakeWordGated();
+    void UpdateMicArray(const std::vector<int16_t>& data);
+    void StopWakeWordGate();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "mic_array.h"
+#include "sample_format.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+void MicArray::Reset(int channels, int mics) {
+    channels_ = std::max(channels, 1);
+    mics_ = std::clamp(mics, 0, channels_);
+    // One lag of margin, so a talker at the end of the array still has a peak to interpolate
+    max_lag_ = (int)std::ceil(config_.spacing_mm * kSampleRate / (1000.0f * kSpeedOfSound)) + 1;
+
+    noise_floor_q4_.assign(mics_, -1);
+    speech_level_q4_.assign(mics_, 0);
+    correlation_.assign(max_lag_ * 2 + 1, 0);
+    correlation_valid_ = false;
+    reported_direction_ = -1;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    lag_ = 0;
+    direction_ = -1;
+    best_channel_ = 0;
+}
+
+int MicArray::direction() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return direction_;
+}
+
+int MicArray::best_channel() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return best_channel_;
+}
+
+bool MicArray::Process(const std::vector<int16_t>& data) {
+    if (!enabled()) {
+        return false;
+    }
+
+    size_t frames = data.size() / channels_;
+    bool updated = false;
+    for (size_t start = 0; start + kFrameSamples <= frames; start += kFrameSamples) {
+        const int16_t* frame = data.data() + start * channels_;
+        bool speech = false;
+        for (int m = 0; m < mics_; m++) {
+            int sum = 0;
+            for (int i = 0; i < kFrameSamples; i++) {
+                sum += std::abs(frame[i * channels_ + m]);
+            }
+            int level = sum / kFrameSamples;
+
+            int& floor_q4 = noise_floor_q4_[m];
+            if (floor_q4 < 0) {
+                floor_q4 = level * 16;
+            }
+            bool loud = level >= config_.min_level && level >= floor_q4 / 16 * config_.speech_ratio;
+            // Same tracking as the wake word gate: down quickly, up slowly and only while quiet
+            if (level * 16 < floor_q4) {
+                floor_q4 += (level * 16 - floor_q4) / 4;
+            } else if (!loud) {
+                floor_q4 += std::max((level * 16 - floor_q4) / 128, 1);
+            }
+            if (loud) {
+                speech_level_q4_[m] += (level * 16 - speech_level_q4_[m]) / 8;
+                speech = true;
+            }
+        }
+        if (speech) {
+            AnalyzeFrame(frame);
+            updated = true;
+        }
+    }
+    if (!updated) {
+        return false;
+    }
+
+    // The microphone that hears speech best relative to its own noise
+    int best = 0;
+    int64_t best_score = -1;
+    for (int m = 0; m < mics_; m++) {
+        int64_t score = int64_t(speech_level_q4_[m]) * 1024 / std::max(noise_floor_q4_[m], 16);
+        if (score > best_score) {
+            best_score = score;
+            best = m;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        best_channel_ = best;
+    }
+
+    int direction = UpdateDirection();
+    if (direction < 0 || (reported_direction_ >= 0 && std::abs(direction - reported_direction_) < config_.report_step)) {
+        return false;
+    }
+    reported_direction_ = direction;
+    std::lock_guard<std::mutex> lock(mutex_);
+    direction_reports_++;
+    return true;
+}
+
+void MicArray::AnalyzeFrame(const int16_t* frame) {
+    // First difference of the first and the last microphone, which whitens speech enough for a
+    // sharp correlation peak without an FFT
+    int32_t a[kFrameSamples];
+    int32_t b[kFrameSamples];
+    const int last = mics_ - 1;
+    a[0] = 0;
+    b[0] = 0;
+    int64_t energy_a = 0;
+    int64_t energy_b = 0;
+    for (int i = 1; i < kFrameSamples; i++) {
+        a[i] = frame[i * channels_] - frame[(i - 1) * channels_];
+        b[i] = frame[i * channels_ + last] - frame[(i - 1) * channels_ + last];
+        energy_a += int64_t(a[i]) * a[i];
+        energy_b += int64_t(b[i]) * b[i];
+    }
+    if (energy_a == 0 || energy_b == 0) {
+        return;
+    }
+
+    float norm = 1.0f / std::sqrt(float(energy_a) * float(energy_b));
+    for (int k = -max_lag_; k <= max_lag_; k++) {
+        int64_t sum = 0;
+        int begin = std::max(1, 1 - k);
+        int end = std::min(kFrameSamples, kFrameSamples - k);
+        for (int i = begin; i < end; i++) {
+            sum += int64_t(a[i]) * b[i + k];
+        }
+        float value = sum * norm;
+        float& smoothed = correlation_[k + max_lag_];
+        smoothed = correlation_valid_ ? smoothed + (value - smoothed) / 4 : value;
+    }
+    correlation_valid_ = true;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    speech_frames_++;
+}
+
+int MicArray::UpdateDirection() {
+    int peak = 0;
+    for (int i = 1; i < (int)correlation_.size(); i++) {
+        if (correlation_[i] > correlation_[peak]) {
+            peak = i;
+        }
+    }
+    float value = correlation_[peak];
+    std::lock_guard<std::mutex> lock(mutex_);
+    peak_correlation_ = (int)std::lround(value * 100);
+    if (value * 100 < config_.min_correlation) {
+        return direction_;
+    }
+
+    // Parabolic interpolation between the lags around the peak
+    float offset = 0;
+    if (peak > 0 && peak < (int)correlation_.size() - 1) {
+        float left = correlation_[peak - 1];
+        float right = correlation_[peak + 1];
+        float denominator = left - 2 * value + right;
+        if (denominator < 0) {
+            offset = std::clamp(0.5f * (left - right) / denominator, -0.5f, 0.5f);
+        }
+    }
+    lag_ = peak - max_lag_ + offset;
+
+    // The last microphone hears the talker `lag_` samples later, so it is on the side of the first
+    float cosine = lag_ * kSpeedOfSound * 1000.0f / (config_.spacing_mm * kSampleRate);
+    direction_ = (int)std::lround(std::acos(std::clamp(cosine, -1.0f, 1.0f)) * 180 / M_PI);
+    direction_updates_++;
+    return direction_;
+}
+
+void MicArray::Mixer::Mix(const std::vector<int16_t>& data, std::vector<int16_t>& mono) {
+    const int channels = array_.channels_;
+    size_t frames = data.size() / channels;
+    mono.resize(frames);
+    if (!array_.enabled()) {
+        sample_format::Deinterleave(data.data(), mono.data(), frames, channels, 0);
+        return;
+    }
+
+    const int last = array_.mics_ - 1;
+    const int history = array_.max_lag_;
+    if (history_.size() != size_t(history * 2)) {
+        history_.assign(history * 2, 0);
+    }
+    int direction;
+    int best_channel;
+    float steering_lag;
+    {
+        std::lock_guard<std::mutex> lock(array_.mutex_);
+        direction = array_.direction_;
+        best_channel = array_.best_channel_;
+        steering_lag = array_.lag_;
+    }
+
+    // Sample n of the first (pair 0) or the last (pair 1) microphone, negative n from the previous block
+    auto sample = [&](int pair, int n) -> int32_t {
+        if (n >= 0) {
+            return data[n * channels + (pair == 0 ? 0 : last)];
+        }
+        return history_[pair * history + history + n];
+    };
+
+    if (direction < 0) {
+        sample_format::Deinterleave(data.data(), mono.data(), frames, channels, best_channel);
+    } else {
+        // Delay the microphone the talker reaches first, then average
+        int lag = std::clamp((int)std::lround(steering_lag), -history, history);
+        int delay_first = lag > 0 ? lag : 0;
+        int delay_last = lag < 0 ? -lag : 0;
+        for (size_t i = 0; i < frames; i++) {
+            int n = (int)i;
+            mono[i] = static_cast<int16_t>((sample(0, n - delay_first) + sample(1, n - delay_last)) >> 1);
+        }
+    }
+
+    // Keep the tail of both microphones for the next block. With a block shorter than the
+    // history the reads are ahead of the writes, so the shift can be done in place.
+    for (int pair = 0; pair < 2; pair++) {
+        for (int i = 0; i < history; i++) {
+            history_[pair * history + i] = sample(pair, (int)frames - history + i);
+        }
+    }
+}
+
+cJSON* MicArray::GetStatsJson() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "microphones", mics_);
+    cJSON_AddNumberToObject(json, "spacing_mm", config_.spacing_mm);
+    cJSON_AddNumberToObject(json, "direction", direction_);
+    cJSON_AddNumberToObject(json, "lag_samples", std::round(lag_ * 100) / 100);
+    cJSON_AddNumberToObject(json, "peak_correlation_percent", peak_correlation_);
+    cJSON_AddNumberToObject(json, "best_channel", best_channel_);
+    cJSON_AddNumberToObject(json, "speech_frames", speech_frames_);
+    cJSON_AddNumberToObject(json, "direction_updates", direction_updates_);
+    cJSON_AddNumberToObject(json, "direction_reports", direction_reports_);
+    return json;
+}
@@ -0,0 +1,98 @@
+#ifndef MIC_ARRAY_H
+#define MIC_ARRAY_H
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+#include <cJSON.h>
+
+/**
+ * Direction of arrival and channel selection for boards with two or more microphones.
+ *
+ * Input blocks are 16 kHz with interleaved channels, the microphones come first (a reference
+ * channel may follow). Blocks are analyzed in 10 ms frames. Each microphone tracks its noise
+ * floor like the wake word gate, and frames well above it count as speech. On speech frames the
+ * first and the last microphone are cross-correlated over the lags the spacing allows. The
+ * smoothed correlation peak gives the time difference of arrival and so the angle.
+ *
+ * A Mixer turns a block into one channel for engines that only take one. While the direction is
+ * known the pair is delayed and summed toward the talker, otherwise the microphone with the best
+ * speech to noise ratio is used.
+ *
+ * Reset() is called before the array is shared and Process() runs on one task. Each consumer of
+ * mixed audio owns a Mixer, so the tail kept from its previous block belongs to its own stream.
+ * The direction, the lag and the best channel they read are guarded by a mutex.
+ */
+class MicArray {
+public:
+    class Mixer {
+    public:
+        explicit Mixer(MicArray& array) : array_(array) {}
+
+        // Mix the microphones of a block into one channel
+        void Mix(const std::vector<int16_t>& data, std::vector<int16_t>& mono);
+
+    private:
+        MicArray& array_;
+        // Tail of the previous block, so the steering delay is continuous across blocks
+        std::vector<int16_t> history_;
+    };
+
+    struct Config {
+        int spacing_mm = 65;        // Distance between the first and the last microphone
+        int min_level = 64;         // Mean absolute level below this is silence
+        int speech_ratio = 3;       // Frame level above the noise floor by this factor (9.5 dB)
+        int min_correlation = 30;   // Percent, weaker peaks (diffuse noise, echo) do not move the direction
+        int report_step = 15;       // Degrees the direction has to move before it is reported
+    };
+
+    void SetConfig(const Config& config) { config_ = config; }
+    const Config& config() const { return config_; }
+
+    // `mics` of the `channels` are microphones, fewer than two disables the array
+    void Reset(int channels, int mics);
+    bool enabled() const { return mics_ > 1; }
+
+    // Analyze a block, returns true if the direction moved by report_step or more
+    bool Process(const std::vector<int16_t>& data);
+
+    // 0 to 180 degrees from the first microphone toward the last, 90 is broadside, -1 if unknown
+    int direction() const;
+    int best_channel() const;
+
+    // Caller takes ownership of the returned object
+    cJSON* GetStatsJson();
+
+private:
+    static constexpr int kSampleRate = 16000;
+    static constexpr int kFrameSamples = kSampleRate / 100;
+    static constexpr int kSpeedOfSound = 343;  // m/s
+
+    Config config_;
+    int channels_ = 1;
+    int mics_ = 0;
+    int max_lag_ = 0;
+
+    std::vector<int> noise_floor_q4_;       // Per microphone, level x16, negative until the first frame
+    std::vector<int> speech_level_q4_;      // Per microphone, level of speech frames x16
+    std::vector<float> correlation_;        // Smoothed normalized correlation, lags -max_lag_ to max_lag_
+    bool correlation_valid_ = false;
+    int reported_direction_ = -1;
+
+    // Read by the mixers and the stats, written by Process()
+    mutable std::mutex mutex_;
+    float lag_ = 0;                         // Samples the last microphone lags behind the first
+    int direction_ = -1;
+    int best_channel_ = 0;
+    uint32_t speech_frames_ = 0;
+    uint32_t direction_updates_ = 0;
+    uint32_t direction_reports_ = 0;
+    int peak_correlation_ = 0;
+
+    void AnalyzeFrame(const int16_t* frame);
+    // Returns the current direction, -1 if unknown
+    int UpdateDirection();
+};
+
+#endif // MIC_ARRAY_H
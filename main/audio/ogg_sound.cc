@@ -0,0 +1,138 @@
+#include "ogg_sound.h"
+
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <esp_log.h>
+
+#define TAG "OggSound"
+
+const OggSound* OggSound::Get(const std::string_view& ogg) {
+    static std::mutex mutex;
+    static std::vector<std::unique_ptr<OggSound>> sounds;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto data = reinterpret_cast<const uint8_t*>(ogg.data());
+    for (auto& sound : sounds) {
+        if (sound->data_ == data) {
+            return sound.get();
+        }
+    }
+    sounds.emplace_back(new OggSound(ogg));
+    return sounds.back().get();
+}
+
+OggSound::OggSound(const std::string_view& ogg) : data_(reinterpret_cast<const uint8_t*>(ogg.data())) {
+    Parse(data_, ogg.size());
+    ESP_LOGI(TAG, "Indexed %u packets, sample_rate=%d, frame_duration=%d", packets_.size(), sample_rate_, frame_duration_);
+}
+
+void OggSound::Parse(const uint8_t* buf, size_t size) {
+    bool seen_head = false;
+    bool seen_tags = false;
+    size_t offset = 0;
+
+    while (offset + 27 <= size) {
+        // Pages are contiguous, only scan for the capture pattern after damaged data
+        if (std::memcmp(buf + offset, "OggS", 4) != 0) {
+            auto next = static_cast<const uint8_t*>(memmem(buf + offset + 1, size - offset - 1, "OggS", 4));
+            if (next == nullptr) {
+                break;
+            }
+            offset = next - buf;
+            continue;
+        }
+
+        const uint8_t* page = buf + offset;
+        uint8_t page_segments = page[26];
+        size_t body_off = offset + 27 + page_segments;
+        if (body_off > size) {
+            break;
+        }
+        size_t body_size = 0;
+        for (size_t i = 0; i < page_segments; ++i) {
+            body_size += page[27 + i];
+        }
+        if (body_off + body_size > size) {
+            break;
+        }
+
+        // Parse packets using lacing
+        size_t cur = body_off;
+        size_t seg_idx = 0;
+        while (seg_idx < page_segments) {
+            size_t pkt_start = cur;
+            size_t pkt_len = 0;
+            uint8_t lacing;
+            do {
+                lacing = page[27 + seg_idx++];
+                pkt_len += lacing;
+                cur += lacing;
+            } while (lacing == 255 && seg_idx < page_segments);
+
+            if (lacing == 255) {
+                // Packets spanning pages are not contiguous in flash, sounds are encoded with small packets
+                ESP_LOGW(TAG, "Skipping packet continued on the next page");
+                continue;
+            }
+            if (pkt_len == 0) {
+                continue;
+            }
+            const uint8_t* pkt_ptr = buf + pkt_start;
+
+            if (!seen_head) {
+                // OpusHead: [0-7] "OpusHead", [8] version, [9] channel_count, [10-11] pre_skip
+                // [12-15] input_sample_rate, [16-17] output_gain, [18] mapping_family
+                if (pkt_len >= 19 && std::memcmp(pkt_ptr, "OpusHead", 8) == 0) {
+                    seen_head = true;
+                    sample_rate_ = pkt_ptr[12] | (pkt_ptr[13] << 8) | (pkt_ptr[14] << 16) | (pkt_ptr[15] << 24);
+                }
+                continue;
+            }
+            if (!seen_tags) {
+                // Expect OpusTags in second packet
+                if (pkt_len >= 8 && std::memcmp(pkt_ptr, "OpusTags", 8) == 0) {
+                    seen_tags = true;
+                }
+                continue;
+            }
+
+            if (packets_.empty()) {
+                int duration = GetPacketDuration(pkt_ptr, pkt_len);
+                if (duration > 0) {
+                    frame_duration_ = duration;
+                }
+            }
+            packets_.push_back({pkt_ptr, static_cast<uint32_t>(pkt_len)});
+        }
+
+        offset = body_off + body_size;
+    }
+    packets_.shrink_to_fit();
+}
+
+int OggSound::GetPacketDuration(const uint8_t* packet, size_t size) {
+    // Frame size of each TOC config (RFC 6716, section 3.1), in 0.5 ms
+    static const uint8_t kFrameSizes[32] = {
+        20, 40, 80, 120, 20, 40, 80, 120, 20, 40, 80, 120,  // SILK
+        20, 40, 20, 40,                                      // Hybrid
+        5, 10, 20, 40, 5, 10, 20, 40, 5, 10, 20, 40, 5, 10, 20, 40,  // CELT
+    };
+    int frame_size = kFrameSizes[packet[0] >> 3];
+    int frames = 1;
+    switch (packet[0] & 3) {
+        case 1:
+        case 2:
+            frames = 2;
+            break;
+        case 3:
+            if (size < 2) {
+                return 0;
+            }
+            frames = packet[1] & 0x3F;
+            break;
+    }
+    int duration_x2 = frame_size * frames;
+    // Decoder only supports whole millisecond durations
+    return duration_x2 % 2 == 0 ? duration_x2 / 2 : 0;
+}
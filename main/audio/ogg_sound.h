@@ -0,0 +1,40 @@
+#ifndef OGG_SOUND_H
+#define OGG_SOUND_H
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Packet index of an Ogg/Opus sound embedded in flash.
+ *
+ * The file is parsed once, afterwards packets are read directly from the embedded data,
+ * so playing a sound copies nothing but the decoded PCM.
+ */
+class OggSound {
+public:
+    struct Packet {
+        const uint8_t* data;
+        uint32_t size;
+    };
+
+    // Index of the sound, built on first use and kept for the lifetime of the program
+    static const OggSound* Get(const std::string_view& ogg);
+
+    int sample_rate() const { return sample_rate_; }
+    // Duration of each Opus packet, read from the TOC byte of the first audio packet
+    int frame_duration() const { return frame_duration_; }
+    const std::vector<Packet>& packets() const { return packets_; }
+
+private:
+    const uint8_t* data_;
+    int sample_rate_ = 16000;
+    int frame_duration_ = 60;
+    std::vector<Packet> packets_;
+
+    explicit OggSound(const std::string_view& ogg);
+    void Parse(const uint8_t* buf, size_t size);
+    static int GetPacketDuration(const uint8_t* packet, size_t size);
+};
+
+#endif // OGG_SOUND_H
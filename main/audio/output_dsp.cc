@@ -0,0 +1,256 @@
+#include "output_dsp.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Frames quieter than -50 dBFS RMS are pauses and do not count for loudness
+#define LOUDNESS_GATE_MEAN_SQUARE (103.6f * 103.6f)
+// Time constant of the loudness measurement
+#define LOUDNESS_WINDOW_MS 3000
+// Maximum loudness gain change, so the level does not pump between sentences
+#define LOUDNESS_SLEW_DB_PER_SECOND 6.0f
+
+bool OutputDsp::Configure(const Config& config, int sample_rate) {
+    config_ = config;
+    sample_rate_ = sample_rate;
+
+    filter_count_ = 0;
+    for (auto& filter : config.eq) {
+        if (filter_count_ == kMaxFilters) {
+            break;
+        }
+        filters_[filter_count_++] = DesignFilter(filter, sample_rate);
+    }
+
+    threshold_ = 0;
+    lookahead_ = 0;
+    if (config.limiter_threshold_db < 0) {
+        threshold_ = 32767.0f * std::pow(10.0f, config.limiter_threshold_db / 20.0f) * 256;
+        lookahead_ = std::max<size_t>(1, int64_t(sample_rate) * config.limiter_lookahead_us / 1000000);
+        delay_.assign(lookahead_ - 1, 0);
+        hold_values_.assign(lookahead_, 0);
+        hold_times_.assign(lookahead_, 0);
+        average_.assign(lookahead_, 32768);
+        float release_samples = std::max(config.limiter_release_ms, 1) * sample_rate / 1000.0f;
+        release_q15_ = std::max<int32_t>(1, 32768 * (1 - std::exp(-1 / release_samples)));
+    }
+
+    power_ = -1;
+    loudness_gain_db_ = 0;
+    loudness_gain_q16_ = 65536;
+    limited_samples_ = 0;
+    Reset();
+
+    enabled_ = filter_count_ > 0 || threshold_ > 0 || config.loudness_target_db < 0;
+    return enabled_;
+}
+
+void OutputDsp::Reset() {
+    for (size_t i = 0; i < filter_count_; i++) {
+        auto& filter = filters_[i];
+        filter.x1 = filter.x2 = filter.y1 = filter.y2 = 0;
+        filter.error = 0;
+    }
+    std::fill(delay_.begin(), delay_.end(), 0);
+    delay_pos_ = 0;
+    hold_head_ = 0;
+    hold_size_ = 0;
+    std::fill(average_.begin(), average_.end(), 32768);
+    average_pos_ = 0;
+    average_sum_ = int64_t(32768) * lookahead_;
+    gain_q15_ = 32768;
+}
+
+OutputDsp::Biquad OutputDsp::DesignFilter(const Filter& filter, int sample_rate) {
+    // Audio EQ cookbook (R. Bristow-Johnson)
+    double w0 = 2 * M_PI * filter.frequency / sample_rate;
+    double cos_w0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2 * std::max(filter.q, 0.1f));
+    double a = std::pow(10.0, filter.gain_db / 40.0);
+    double sqrt_a_alpha = 2 * std::sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+
+    switch (filter.type) {
+        case kHighPass:
+            b0 = (1 + cos_w0) / 2;
+            b1 = -(1 + cos_w0);
+            b2 = (1 + cos_w0) / 2;
+            a0 = 1 + alpha;
+            a1 = -2 * cos_w0;
+            a2 = 1 - alpha;
+            break;
+        case kLowShelf:
+            b0 = a * ((a + 1) - (a - 1) * cos_w0 + sqrt_a_alpha);
+            b1 = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+            b2 = a * ((a + 1) - (a - 1) * cos_w0 - sqrt_a_alpha);
+            a0 = (a + 1) + (a - 1) * cos_w0 + sqrt_a_alpha;
+            a1 = -2 * ((a - 1) + (a + 1) * cos_w0);
+            a2 = (a + 1) + (a - 1) * cos_w0 - sqrt_a_alpha;
+            break;
+        case kHighShelf:
+            b0 = a * ((a + 1) + (a - 1) * cos_w0 + sqrt_a_alpha);
+            b1 = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+            b2 = a * ((a + 1) + (a - 1) * cos_w0 - sqrt_a_alpha);
+            a0 = (a + 1) - (a - 1) * cos_w0 + sqrt_a_alpha;
+            a1 = 2 * ((a - 1) - (a + 1) * cos_w0);
+            a2 = (a + 1) - (a - 1) * cos_w0 - sqrt_a_alpha;
+            break;
+        default:
+            b0 = 1 + alpha * a;
+            b1 = -2 * cos_w0;
+            b2 = 1 - alpha * a;
+            a0 = 1 + alpha / a;
+            a1 = -2 * cos_w0;
+            a2 = 1 - alpha / a;
+            break;
+    }
+
+    auto q28 = [a0](double value) {
+        return static_cast<int32_t>(std::lround(value / a0 * (1 << 28)));
+    };
+    return Biquad{q28(b0), q28(b1), q28(b2), q28(a1), q28(a2), 0, 0, 0, 0, 0};
+}
+
+void OutputDsp::Process(int16_t* data, size_t samples) {
+    if (!enabled_ || samples == 0) {
+        return;
+    }
+    if (work_.size() < samples) {
+        work_.resize(samples);
+    }
+
+    int32_t* work = work_.data();
+    for (size_t i = 0; i < samples; i++) {
+        work[i] = int32_t(data[i]) * 256;
+    }
+
+    for (size_t i = 0; i < filter_count_; i++) {
+        ApplyFilter(filters_[i], samples);
+    }
+    // Loudness is measured after the EQ, so the target is what comes out of the speaker
+    if (config_.loudness_target_db < 0) {
+        UpdateLoudness(samples);
+        ApplyLoudness(samples);
+    }
+    if (threshold_ > 0) {
+        ApplyLimiter(samples);
+    }
+
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = (work[i] + 128) >> 8;
+        data[i] = std::clamp<int32_t>(value, INT16_MIN, INT16_MAX);
+    }
+}
+
+void OutputDsp::UpdateLoudness(size_t samples) {
+    const int32_t* work = work_.data();
+    int64_t sum = 0;
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = work[i] >> 8;
+        sum += int64_t(value) * value;
+    }
+    float mean_square = float(sum) / samples;
+    float duration_ms = samples * 1000.0f / sample_rate_;
+
+    if (mean_square >= LOUDNESS_GATE_MEAN_SQUARE) {
+        if (power_ < 0) {
+            power_ = mean_square;
+        } else {
+            power_ += (mean_square - power_) * std::min(duration_ms / LOUDNESS_WINDOW_MS, 1.0f);
+        }
+    }
+    if (power_ < 0) {
+        return;
+    }
+
+    float level_db = 10 * std::log10(power_ / (32768.0f * 32768.0f));
+    float target_db = std::clamp<float>(config_.loudness_target_db - level_db,
+        -config_.loudness_max_cut_db, config_.loudness_max_gain_db);
+    float slew_db = LOUDNESS_SLEW_DB_PER_SECOND * duration_ms / 1000;
+    loudness_gain_db_ += std::clamp(target_db - loudness_gain_db_, -slew_db, slew_db);
+}
+
+void OutputDsp::ApplyLoudness(size_t samples) {
+    // Ramp from the previous gain over the frame
+    int32_t from = loudness_gain_q16_;
+    int32_t to = 65536 * std::pow(10.0f, loudness_gain_db_ / 20);
+    int32_t* work = work_.data();
+    for (size_t i = 0; i < samples; i++) {
+        int32_t gain = from + int64_t(to - from) * int32_t(i + 1) / int32_t(samples);
+        work[i] = (int64_t(work[i]) * gain) >> 16;
+    }
+    loudness_gain_q16_ = to;
+}
+
+void OutputDsp::ApplyFilter(Biquad& filter, size_t samples) {
+    // Direct form I, the state stays in registers over the frame. The fraction dropped from each
+    // output is added to the next one, otherwise poles close to DC (low shelves) get stuck on a
+    // small offset when the input goes silent.
+    const int64_t b0 = filter.b0, b1 = filter.b1, b2 = filter.b2, a1 = filter.a1, a2 = filter.a2;
+    int32_t x1 = filter.x1, x2 = filter.x2, y1 = filter.y1, y2 = filter.y2;
+    int32_t error = filter.error;
+    int32_t* work = work_.data();
+    for (size_t i = 0; i < samples; i++) {
+        int32_t x = work[i];
+        int64_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2 + error;
+        int32_t y = static_cast<int32_t>(acc >> 28);
+        error = static_cast<int32_t>(acc - int64_t(y) * (1 << 28));
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = y;
+        work[i] = y;
+    }
+    filter.x1 = x1;
+    filter.x2 = x2;
+    filter.y1 = y1;
+    filter.y2 = y2;
+    filter.error = error;
+}
+
+void OutputDsp::ApplyLimiter(size_t samples) {
+    const size_t window = lookahead_;
+    int32_t* work = work_.data();
+    for (size_t i = 0; i < samples; i++, time_++) {
+        int32_t x = work[i];
+        int32_t level = x < 0 ? -x : x;
+        int32_t required = level > threshold_ ? int32_t((int64_t(threshold_) << 15) / level) : 32768;
+
+        // Smallest gain required by the samples in the window
+        if (hold_size_ > 0 && time_ - hold_times_[hold_head_] >= window) {
+            hold_head_ = (hold_head_ + 1) % window;
+            hold_size_--;
+        }
+        while (hold_size_ > 0 && hold_values_[(hold_head_ + hold_size_ - 1) % window] >= required) {
+            hold_size_--;
+        }
+        size_t back = (hold_head_ + hold_size_) % window;
+        hold_values_[back] = required;
+        hold_times_[back] = time_;
+        hold_size_++;
+        int32_t held = hold_values_[hold_head_];
+
+        // Attack at once, release slowly
+        if (held <= gain_q15_) {
+            gain_q15_ = held;
+        } else {
+            gain_q15_ = std::min(held, gain_q15_ + ((held - gain_q15_) * release_q15_ >> 15) + 1);
+        }
+
+        average_sum_ += gain_q15_ - average_[average_pos_];
+        average_[average_pos_] = gain_q15_;
+        average_pos_ = average_pos_ + 1 == window ? 0 : average_pos_ + 1;
+        int32_t gain = average_sum_ / int64_t(window);
+
+        int32_t delayed = x;
+        if (!delay_.empty()) {
+            delayed = delay_[delay_pos_];
+            delay_[delay_pos_] = x;
+            delay_pos_ = delay_pos_ + 1 == delay_.size() ? 0 : delay_pos_ + 1;
+        }
+        if (gain < 32768) {
+            limited_samples_++;
+        }
+        work[i] = (int64_t(delayed) * gain) >> 15;
+    }
+}
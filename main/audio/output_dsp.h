@@ -0,0 +1,106 @@
+#ifndef OUTPUT_DSP_H
+#define OUTPUT_DSP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Playback processing between the decoder and the codec, configured per board.
+ *
+ * Mono 16-bit PCM goes through a biquad EQ, loudness normalization and a look-ahead peak limiter.
+ * The sample path is fixed-point (Q8 samples in 32 bits, Q28 filter coefficients) and runs stage
+ * by stage over the whole frame, only the per-frame control values are computed in float.
+ *
+ * The limiter delays the audio by its look-ahead (1.5 ms by default), much less than a frame.
+ * Its gain is held for the look-ahead and smoothed by a moving average of the same length, so
+ * the gain has fully come down when a peak leaves the delay line and no sample exceeds the
+ * threshold.
+ */
+class OutputDsp {
+public:
+    enum FilterType {
+        kHighPass,
+        kLowShelf,
+        kHighShelf,
+        kPeaking,
+    };
+
+    struct Filter {
+        FilterType type;
+        int frequency;
+        float gain_db;      // Shelf and peaking filters only
+        float q;
+    };
+
+    struct Config {
+        std::vector<Filter> eq;
+        // Loudness normalization towards this RMS level in dBFS, 0 to disable
+        int loudness_target_db = 0;
+        int loudness_max_gain_db = 9;
+        int loudness_max_cut_db = 9;
+        // Peak limiter threshold in dBFS, 0 to disable
+        float limiter_threshold_db = 0;
+        int limiter_lookahead_us = 1500;
+        int limiter_release_ms = 80;
+    };
+
+    static constexpr size_t kMaxFilters = 6;
+
+    // Returns false if nothing is enabled
+    bool Configure(const Config& config, int sample_rate);
+    // Clear the filter and limiter state, the learned loudness is kept
+    void Reset();
+    void Process(int16_t* data, size_t samples);
+
+    bool enabled() const { return enabled_; }
+    // Current loudness normalization gain
+    float loudness_gain_db() const { return loudness_gain_db_; }
+    // Samples the limiter has turned down since Configure()
+    uint32_t limited_samples() const { return limited_samples_; }
+
+private:
+    struct Biquad {
+        int32_t b0, b1, b2, a1, a2;     // Q28
+        int32_t x1, x2, y1, y2;         // Q8 samples
+        int32_t error;                  // Q28 fraction dropped from the last output
+    };
+
+    bool enabled_ = false;
+    int sample_rate_ = 0;
+    Config config_;
+    std::vector<int32_t> work_;
+
+    Biquad filters_[kMaxFilters];
+    size_t filter_count_ = 0;
+
+    // Loudness
+    float power_ = -1;                  // Smoothed mean square of speech frames, negative if unknown
+    float loudness_gain_db_ = 0;
+    int32_t loudness_gain_q16_ = 65536;
+
+    // Limiter
+    int32_t threshold_ = 0;             // Q8, 0 if disabled
+    int32_t release_q15_ = 0;
+    size_t lookahead_ = 0;
+    std::vector<int32_t> delay_;        // lookahead - 1 samples
+    size_t delay_pos_ = 0;
+    std::vector<int32_t> hold_values_;  // Monotonic queue of the gains required in the window
+    std::vector<uint32_t> hold_times_;
+    size_t hold_head_ = 0;
+    size_t hold_size_ = 0;
+    std::vector<int32_t> average_;      // Moving average of the held gain
+    size_t average_pos_ = 0;
+    int64_t average_sum_ = 0;
+    int32_t gain_q15_ = 32768;
+    uint32_t time_ = 0;
+    uint32_t limited_samples_ = 0;
+
+    static Biquad DesignFilter(const Filter& filter, int sample_rate);
+    void UpdateLoudness(size_t samples);
+    void ApplyLoudness(size_t samples);
+    void ApplyFilter(Biquad& filter, size_t samples);
+    void ApplyLimiter(size_t samples);
+};
+
+#endif // OUTPUT_DSP_H
@@ -2,20 +2,20 @@
 #define AFE_AUDIO_PROCESSOR_H
 
 #include <esp_afe_sr_models.h>
-#include <freertos/FreeRTOS.h>
-#include <freertos/task.h>
-#include <freertos/event_groups.h>
 
 #include <string>
 #include <vector>
+#include <memory>
 #include <functional>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
+#include "afe_front_end.h"
 
 class AfeAudioProcessor : public AudioProcessor {
 public:
-    AfeAudioProcessor();
+    // Pass a front end shared with the wake word, otherwise the processor creates its own
+    explicit AfeAudioProcessor(std::shared_ptr<AfeFrontEnd> front_end = nullptr);
     ~AfeAudioProcessor();
 
     void Initialize(AudioCodec* codec, int frame_duration_ms, srmodel_list_t* models_list) override;
@@ -29,9 +29,7 @@ public:
     void EnableDeviceAec(bool enable) override;
 
 private:
-    EventGroupHandle_t event_group_ = nullptr;
-    const esp_afe_sr_iface_t* afe_iface_ = nullptr;
-    esp_afe_sr_data_t* afe_data_ = nullptr;
+    std::shared_ptr<AfeFrontEnd> front_end_;
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
     AudioCodec* codec_ = nullptr;
@@ -39,7 +37,7 @@ private:
     bool is_speaking_ = false;
     std::vector<int16_t> output_buffer_;
 
-    void AudioProcessorTask();
+    void OnFetch(afe_fetch_result_t* res);
 };
 
 #endif 
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "afe_front_end.h"
+#include <esp_log.h>
+#include <esp_nsn_models.h>
+
+#include <string>
+
+#define TAG "AfeFrontEnd"
+
+AfeFrontEnd::AfeFrontEnd() {
+    event_group_ = xEventGroupCreate();
+}
+
+AfeFrontEnd::~AfeFrontEnd() {
+    if (afe_data_ != nullptr) {
+        afe_iface_->destroy(afe_data_);
+    }
+    if (owns_models_ && models_ != nullptr) {
+        esp_srmodel_deinit(models_);
+    }
+    vEventGroupDelete(event_group_);
+}
+
+void AfeFrontEnd::Attach(Consumer consumer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (afe_data_ != nullptr && (consumers_ & consumer) == 0) {
+        ESP_LOGW(TAG, "Consumer %d attached after the front end was created", consumer);
+    }
+    consumers_ |= consumer;
+}
+
+bool AfeFrontEnd::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (codec_ != nullptr) {
+        return initialize_result_;
+    }
+    codec_ = codec;
+
+    if (models_list == nullptr) {
+        models_ = esp_srmodel_init("model");
+        owns_models_ = true;
+    } else {
+        models_ = models_list;
+    }
+
+    initialize_result_ = CreateAfe();
+    return initialize_result_;
+}
+
+bool AfeFrontEnd::CreateAfe() {
+    bool wake_word = consumers_ & kConsumerWakeWord;
+    bool processor = consumers_ & kConsumerProcessor;
+    if (wake_word && (models_ == nullptr || models_->num == -1)) {
+        ESP_LOGE(TAG, "Failed to initialize wakenet model");
+        return false;
+    }
+
+    int ref_num = codec_->input_reference() ? 1 : 0;
+    std::string input_format;
+    for (int i = 0; i < codec_->input_channels() - ref_num; i++) {
+        input_format.push_back('M');
+    }
+    for (int i = 0; i < ref_num; i++) {
+        input_format.push_back('R');
+    }
+
+    // The wakenet is only picked from the models for the speech recognition type, which also
+    // gives the voice processing its echo cancellation when the two are shared
+    afe_config_t* afe_config = afe_config_init(input_format.c_str(), wake_word ? models_ : NULL,
+        wake_word ? AFE_TYPE_SR : AFE_TYPE_VC, AFE_MODE_HIGH_PERF);
+    afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
+#if CONFIG_USE_MIC_ARRAY
+    // Speech enhancement (BSS) separates the talker from noise with two or more microphones
+    afe_config->se_init = codec_->input_channels() - ref_num > 1;
+#endif
+
+    if (wake_word) {
+        afe_config->aec_init = codec_->input_reference();
+        afe_config->aec_mode = AEC_MODE_SR_HIGH_PERF;
+        afe_config->afe_perferred_core = 1;
+        afe_config->afe_perferred_priority = 1;
+    } else {
+        afe_config->aec_mode = AEC_MODE_VOIP_HIGH_PERF;
+    }
+
+    if (processor) {
+        char* ns_model_name = esp_srmodel_filter(models_, ESP_NSNET_PREFIX, NULL);
+        char* vad_model_name = esp_srmodel_filter(models_, ESP_VADN_PREFIX, NULL);
+
+        afe_config->vad_mode = VAD_MODE_0;
+        afe_config->vad_min_noise_ms = 100;
+        if (vad_model_name != nullptr) {
+            afe_config->vad_model_name = vad_model_name;
+        }
+
+        if (ns_model_name != nullptr) {
+            afe_config->ns_init = true;
+            afe_config->ns_model_name = ns_model_name;
+            afe_config->afe_ns_mode = AFE_NS_MODE_NET;
+        } else {
+            afe_config->ns_init = false;
+        }
+
+        afe_config->agc_init = false;
+#ifdef CONFIG_USE_DEVICE_AEC
+        afe_config->aec_init = true;
+        afe_config->vad_init = false;
+#else
+        // The wake word still needs the echo cancelled while the device is speaking
+        afe_config->aec_init = wake_word && codec_->input_reference();
+        afe_config->vad_init = true;
+#endif
+    }
+
+    has_wakenet_ = wake_word && afe_config->wakenet_init && afe_config->wakenet_model_name != nullptr;
+
+    afe_iface_ = esp_afe_handle_from_config(afe_config);
+    afe_data_ = afe_iface_->create_from_config(afe_config);
+    if (afe_data_ == nullptr) {
+        ESP_LOGE(TAG, "Failed to create AFE");
+        return false;
+    }
+    ESP_LOGI(TAG, "Created %s front end, input %s, wakenet %s",
+        shared() ? "shared" : (wake_word ? "wake word" : "voice processing"),
+        input_format.c_str(), has_wakenet_ ? afe_config->wakenet_model_name : "none");
+
+    // The wakenet only runs while the wake word consumer is started
+    if (has_wakenet_ && !IsRunning(kConsumerWakeWord)) {
+        afe_iface_->disable_wakenet(afe_data_);
+    }
+
+    xTaskCreate([](void* arg) {
+        auto this_ = (AfeFrontEnd*)arg;
+        this_->FetchTask();
+        vTaskDelete(NULL);
+    }, "audio_front_end", 4096, this, 3, nullptr);
+    return true;
+}
+
+void AfeFrontEnd::Feed(const std::vector<int16_t>& data) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    afe_iface_->feed(afe_data_, data.data());
+}
+
+size_t AfeFrontEnd::GetFeedSize() {
+    if (afe_data_ == nullptr) {
+        return 0;
+    }
+    return afe_iface_->get_feed_chunksize(afe_data_);
+}
+
+void AfeFrontEnd::Start(Consumer consumer) {
+    if (consumer == kConsumerWakeWord && has_wakenet_) {
+        afe_iface_->enable_wakenet(afe_data_);
+    }
+    xEventGroupSetBits(event_group_, consumer);
+}
+
+void AfeFrontEnd::Stop(Consumer consumer) {
+    xEventGroupClearBits(event_group_, consumer);
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (consumer == kConsumerWakeWord && has_wakenet_) {
+        afe_iface_->disable_wakenet(afe_data_);
+    }
+    // The buffered input is kept while another consumer still reads it
+    if ((xEventGroupGetBits(event_group_) & (kConsumerWakeWord | kConsumerProcessor)) == 0) {
+        afe_iface_->reset_buffer(afe_data_);
+    }
+}
+
+bool AfeFrontEnd::IsRunning(Consumer consumer) {
+    return xEventGroupGetBits(event_group_) & consumer;
+}
+
+void AfeFrontEnd::OnFetch(Consumer consumer, std::function<void(afe_fetch_result_t* result)> callback) {
+    std::lock_guard<std::mutex> lock(callback_mutex_);
+    if (consumer == kConsumerWakeWord) {
+        wake_word_callback_ = callback;
+    } else {
+        processor_callback_ = callback;
+    }
+}
+
+void AfeFrontEnd::FetchTask() {
+    auto fetch_size = afe_iface_->get_fetch_chunksize(afe_data_);
+    auto feed_size = afe_iface_->get_feed_chunksize(afe_data_);
+    ESP_LOGI(TAG, "Audio front end task started, feed size: %d fetch size: %d",
+        feed_size, fetch_size);
+
+    while (true) {
+        xEventGroupWaitBits(event_group_, kConsumerWakeWord | kConsumerProcessor, pdFALSE, pdFALSE, portMAX_DELAY);
+
+        auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
+        if (res == nullptr || res->ret_value == ESP_FAIL) {
+            if (res != nullptr) {
+                ESP_LOGI(TAG, "Error code: %d", res->ret_value);
+            }
+            continue;
+        }
+
+        // A consumer may have been stopped while the result was fetched
+        auto running = xEventGroupGetBits(event_group_);
+        std::lock_guard<std::mutex> lock(callback_mutex_);
+        if ((running & kConsumerWakeWord) && wake_word_callback_) {
+            wake_word_callback_(res);
+        }
+        if ((running & kConsumerProcessor) && processor_callback_) {
+            processor_callback_(res);
+        }
+    }
+}
+
+void AfeFrontEnd::EnableDeviceAec(bool enable) {
+    if (afe_data_ == nullptr) {
+        return;
+    }
+    if (enable) {
+#if CONFIG_USE_DEVICE_AEC
+        afe_iface_->disable_vad(afe_data_);
+        afe_iface_->enable_aec(afe_data_);
+#else
+        ESP_LOGE(TAG, "Device AEC is not supported");
+#endif
+    } else {
+        // The wake word keeps the echo cancellation of the reference channel
+        if (!has_wakenet_ || !codec_->input_reference()) {
+            afe_iface_->disable_aec(afe_data_);
+        }
+        afe_iface_->enable_vad(afe_data_);
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef AFE_FRONT_END_H
+#define AFE_FRONT_END_H
+
+#include <esp_afe_sr_models.h>
+#include <model_path.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/event_groups.h>
+
+#include <vector>
+#include <functional>
+#include <mutex>
+
+#include "audio_codec.h"
+
+/**
+ * One ESP-SR audio front end (AEC, NS, VAD, wakenet) shared by the wake word and the voice
+ * processor.
+ *
+ * The consumers attach before the first Initialize(), which creates a single AFE instance with
+ * the features all of them need and one task fetching from it. The input is fed once and every
+ * fetch result is handed to each running consumer, so the wake word can keep listening while the
+ * voice is processed for the uplink, and switching between them does not restart the pipeline.
+ */
+class AfeFrontEnd {
+public:
+    enum Consumer {
+        kConsumerWakeWord = 1 << 0,
+        kConsumerProcessor = 1 << 1,
+    };
+
+    AfeFrontEnd();
+    ~AfeFrontEnd();
+
+    // Only consumers attached before Initialize() are configured in the AFE
+    void Attach(Consumer consumer);
+    bool shared() const { return consumers_ == (kConsumerWakeWord | kConsumerProcessor); }
+
+    // The first call creates the AFE, later calls return its result
+    bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
+    bool initialized() const { return afe_data_ != nullptr; }
+    bool has_wakenet() const { return has_wakenet_; }
+    srmodel_list_t* models() const { return models_; }
+
+    void Feed(const std::vector<int16_t>& data);
+    size_t GetFeedSize();
+
+    void Start(Consumer consumer);
+    void Stop(Consumer consumer);
+    bool IsRunning(Consumer consumer);
+    // Called by the fetch task for every result while the consumer is running
+    void OnFetch(Consumer consumer, std::function<void(afe_fetch_result_t* result)> callback);
+
+    void EnableDeviceAec(bool enable);
+
+private:
+    EventGroupHandle_t event_group_ = nullptr;
+    std::mutex mutex_;
+    int consumers_ = 0;
+    bool initialize_result_ = false;
+    bool has_wakenet_ = false;
+    bool owns_models_ = false;
+    AudioCodec* codec_ = nullptr;
+    srmodel_list_t* models_ = nullptr;
+    const esp_afe_sr_iface_t* afe_iface_ = nullptr;
+    esp_afe_sr_data_t* afe_data_ = nullptr;
+
+    // Held by the fetch task while the callbacks run
+    std::mutex callback_mutex_;
+    std::function<void(afe_fetch_result_t* result)> wake_word_callback_;
+    std::function<void(afe_fetch_result_t* result)> processor_callback_;
+
+    bool CreateAfe();
+    void FetchTask();
+};
+
+#endif
@@ -1,4 +1,5 @@
 #include "no_audio_processor.h"
+#include "sample_format.h"
 #include <esp_log.h>
 
 #define TAG "NoAudioProcessor"
@@ -13,13 +14,18 @@ void NoAudioProcessor::Feed(std::vector<int16_t>&& data) {
         return;
     }
 
-    if (codec_->input_channels() == 2) {
-        // If input channels is 2, we need to fetch the left channel data
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
-        }
+    int channels = codec_->input_channels();
+    if (mic_mixer_ != nullptr) {
+        // Mix the microphones toward the talker
+        std::vector<int16_t> mono_data;
+        mic_mixer_->Mix(data, mono_data);
         output_callback_(std::move(mono_data));
+    } else if (channels > 1) {
+        // Keep the first microphone, drop the reference channel
+        size_t frames = data.size() / channels;
+        sample_format::Deinterleave(data.data(), data.data(), frames, channels, 0);
+        data.resize(frames);
+        output_callback_(std::move(data));
     } else {
         output_callback_(std::move(data));
     }
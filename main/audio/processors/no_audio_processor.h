@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <functional>
+#include <memory>
 
 #include "audio_processor.h"
 #include "audio_codec.h"
@@ -21,9 +22,11 @@ public:
     void OnVadStateChange(std::function<void(bool speaking)> callback) override;
     size_t GetFeedSize() override;
     void EnableDeviceAec(bool enable) override;
+    void SetMicArray(MicArray* mic_array) override { mic_mixer_ = std::make_unique<MicArray::Mixer>(*mic_array); }
 
 private:
     AudioCodec* codec_ = nullptr;
+    std::unique_ptr<MicArray::Mixer> mic_mixer_;
     int frame_samples_ = 0;
     std::function<void(std::vector<int16_t>&& data)> output_callback_;
     std::function<void(bool speaking)> vad_state_change_callback_;
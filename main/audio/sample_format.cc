@@ -0,0 +1,144 @@
+#include "sample_format.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace sample_format {
+
+static inline int16_t SaturateInt16(int32_t value) {
+    return static_cast<int16_t>(std::clamp<int32_t>(value, INT16_MIN, INT16_MAX));
+}
+
+static inline int32_t SaturateInt32(int64_t value) {
+    return static_cast<int32_t>(std::clamp<int64_t>(value, INT32_MIN, INT32_MAX));
+}
+
+int32_t VolumeToGain(int volume) {
+    volume = std::clamp(volume, 0, 100);
+    return volume * volume * 65536 / 10000;
+}
+
+void PcmToSlot32(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q16) {
+    size_t i = 0;
+    if (gain_q16 >= 0 && gain_q16 <= 65536) {
+        // |sample| * gain is at most 2^31, so a 32-bit multiply cannot overflow
+        for (; i + 4 <= samples; i += 4) {
+            int32_t s0 = src[i], s1 = src[i + 1], s2 = src[i + 2], s3 = src[i + 3];
+            dst[i] = s0 * gain_q16;
+            dst[i + 1] = s1 * gain_q16;
+            dst[i + 2] = s2 * gain_q16;
+            dst[i + 3] = s3 * gain_q16;
+        }
+        for (; i < samples; i++) {
+            dst[i] = int32_t(src[i]) * gain_q16;
+        }
+        return;
+    }
+    for (; i < samples; i++) {
+        dst[i] = SaturateInt32(int64_t(src[i]) * gain_q16);
+    }
+}
+
+void PcmToSlot32Dual(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q16) {
+    if (gain_q16 >= 0 && gain_q16 <= 65536) {
+        for (size_t i = 0; i < samples; i++) {
+            int32_t value = int32_t(src[i]) * gain_q16;
+            dst[i * 2] = value;
+            dst[i * 2 + 1] = value;
+        }
+        return;
+    }
+    for (size_t i = 0; i < samples; i++) {
+        int32_t value = SaturateInt32(int64_t(src[i]) * gain_q16);
+        dst[i * 2] = value;
+        dst[i * 2 + 1] = value;
+    }
+}
+
+void Slot32ToPcm(const int32_t* src, int16_t* dst, size_t samples, int shift) {
+    for (size_t i = 0; i < samples; i++) {
+        dst[i] = SaturateInt16(src[i] >> shift);
+    }
+}
+
+void ScalePcm(const int16_t* src, int16_t* dst, size_t samples, int32_t gain_q16) {
+    size_t i = 0;
+    if (gain_q16 >= 0 && gain_q16 <= 65536) {
+        // Attenuation only, the result always fits
+        for (; i + 4 <= samples; i += 4) {
+            int32_t s0 = src[i], s1 = src[i + 1], s2 = src[i + 2], s3 = src[i + 3];
+            dst[i] = static_cast<int16_t>((s0 * gain_q16) >> 16);
+            dst[i + 1] = static_cast<int16_t>((s1 * gain_q16) >> 16);
+            dst[i + 2] = static_cast<int16_t>((s2 * gain_q16) >> 16);
+            dst[i + 3] = static_cast<int16_t>((s3 * gain_q16) >> 16);
+        }
+        for (; i < samples; i++) {
+            dst[i] = static_cast<int16_t>((int32_t(src[i]) * gain_q16) >> 16);
+        }
+        return;
+    }
+    if ((gain_q16 & 0xFFFF) == 0 && gain_q16 > 0 && gain_q16 <= (INT16_MAX << 16)) {
+        // Whole number gains, the product of two int16 fits in 32 bits
+        int32_t gain = gain_q16 >> 16;
+        for (; i + 4 <= samples; i += 4) {
+            int32_t s0 = src[i] * gain, s1 = src[i + 1] * gain, s2 = src[i + 2] * gain, s3 = src[i + 3] * gain;
+            dst[i] = SaturateInt16(s0);
+            dst[i + 1] = SaturateInt16(s1);
+            dst[i + 2] = SaturateInt16(s2);
+            dst[i + 3] = SaturateInt16(s3);
+        }
+        for (; i < samples; i++) {
+            dst[i] = SaturateInt16(src[i] * gain);
+        }
+        return;
+    }
+    for (; i < samples; i++) {
+        int64_t value = (int64_t(src[i]) * gain_q16) >> 16;
+        dst[i] = static_cast<int16_t>(std::clamp<int64_t>(value, INT16_MIN, INT16_MAX));
+    }
+}
+
+void Deinterleave(const int16_t* src, int16_t* dst, size_t frames, int channels, int channel) {
+    src += channel;
+    if (channels == 2) {
+        size_t i = 0;
+        for (; i + 4 <= frames; i += 4) {
+            int16_t s0 = src[i * 2], s1 = src[i * 2 + 2], s2 = src[i * 2 + 4], s3 = src[i * 2 + 6];
+            dst[i] = s0;
+            dst[i + 1] = s1;
+            dst[i + 2] = s2;
+            dst[i + 3] = s3;
+        }
+        for (; i < frames; i++) {
+            dst[i] = src[i * 2];
+        }
+        return;
+    }
+    for (size_t i = 0; i < frames; i++) {
+        dst[i] = src[i * channels];
+    }
+}
+
+void DownmixStereo(const int16_t* src, int16_t* dst, size_t frames) {
+    for (size_t i = 0; i < frames; i++) {
+        dst[i] = static_cast<int16_t>((int32_t(src[i * 2]) + src[i * 2 + 1]) >> 1);
+    }
+}
+
+void ByteSwap16(const uint16_t* src, uint16_t* dst, size_t count) {
+    size_t i = 0;
+    if (((reinterpret_cast<uintptr_t>(src) | reinterpret_cast<uintptr_t>(dst)) & 3) == 0) {
+        // Two words per 32-bit load and store
+        for (; i + 2 <= count; i += 2) {
+            uint32_t value;
+            memcpy(&value, src + i, sizeof(value));
+            value = ((value & 0x00FF00FF) << 8) | ((value >> 8) & 0x00FF00FF);
+            memcpy(dst + i, &value, sizeof(value));
+        }
+    }
+    for (; i < count; i++) {
+        dst[i] = __builtin_bswap16(src[i]);
+    }
+}
+
+} // namespace sample_format
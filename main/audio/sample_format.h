@@ -0,0 +1,37 @@
+#ifndef _SAMPLE_FORMAT_H_
+#define _SAMPLE_FORMAT_H_
+
+#include <cstdint>
+#include <cstddef>
+
+// Sample format conversions used by the codecs for every frame in both directions.
+// The loops are unrolled by four and saturate with min/max instead of branches, which the
+// compiler turns into MIN/MAX/CLAMPS on Xtensa and into vector code on the host.
+// `src` and `dst` may be the same buffer, except for the conversions between 16 and 32-bit samples.
+
+namespace sample_format {
+
+// Output volume 0-100 to a Q16 gain, squared so the steps sound even
+int32_t VolumeToGain(int volume);
+
+// int16 PCM to the high bits of 32-bit I2S slots, scaled by a Q16 gain and saturated
+void PcmToSlot32(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q16);
+// Same, but each sample is written to both slots of a stereo frame, `dst` holds 2 * samples
+void PcmToSlot32Dual(const int16_t* src, int32_t* dst, size_t samples, int32_t gain_q16);
+// 32-bit I2S slots to int16 PCM, shifted right by `shift` and saturated
+void Slot32ToPcm(const int32_t* src, int16_t* dst, size_t samples, int shift);
+
+// Scale int16 PCM by a Q16 gain with saturation
+void ScalePcm(const int16_t* src, int16_t* dst, size_t samples, int32_t gain_q16);
+
+// Copy one channel out of interleaved frames
+void Deinterleave(const int16_t* src, int16_t* dst, size_t frames, int channels, int channel);
+// Average the two channels of interleaved stereo frames
+void DownmixStereo(const int16_t* src, int16_t* dst, size_t frames);
+
+// Swap the bytes of 16-bit words, two at a time when both buffers are 4 byte aligned
+void ByteSwap16(const uint16_t* src, uint16_t* dst, size_t count);
+
+} // namespace sample_format
+
+#endif // _SAMPLE_FORMAT_H_
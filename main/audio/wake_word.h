@@ -7,6 +7,7 @@
 
 #include <model_path.h>
 #include "audio_codec.h"
+#include "mic_array.h"
 
 class WakeWord {
 public:
@@ -21,6 +22,8 @@ public:
     virtual void EncodeWakeWordData() = 0;
     virtual bool GetWakeWordOpus(std::vector<uint8_t>& opus) = 0;
     virtual const std::string& GetLastDetectedWakeWord() const = 0;
+    // Boards with a microphone array pass it to engines that take a single channel
+    virtual void SetMicArray(MicArray* mic_array) { (void)mic_array; }
 };
 
 #endif
@@ -0,0 +1,110 @@
+#include "wake_word_gate.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+void WakeWordGate::Reset(int channels) {
+    channels_ = std::max(channels, 1);
+    buffer_.clear();
+    open_ = false;
+    noise_floor_q4_ = -1;
+    loud_frames_ = 0;
+    quiet_frames_ = 0;
+}
+
+WakeWordGate::Event WakeWordGate::Process(const std::vector<int16_t>& data) {
+    Event event = kEventNone;
+    size_t frames = data.size() / channels_;
+    int hang_frames = config_.hang_ms / 10;
+
+    for (size_t start = 0; start + kFrameSamples <= frames; start += kFrameSamples) {
+        // Mean absolute level of the microphone channel
+        int sum = 0;
+        for (size_t i = start; i < start + kFrameSamples; i++) {
+            sum += std::abs(data[i * channels_]);
+        }
+        int level = sum / kFrameSamples;
+
+        if (noise_floor_q4_ < 0) {
+            noise_floor_q4_ = level * 16;
+        }
+        int floor = noise_floor_q4_ / 16;
+        bool loud = level >= config_.min_level && level >= floor * config_.open_ratio;
+
+        // The floor follows quieter frames quickly and louder ones slowly (about 1.3 s),
+        // so steady noise stops opening the gate but speech does not raise the floor much
+        if (level * 16 < noise_floor_q4_) {
+            noise_floor_q4_ += (level * 16 - noise_floor_q4_) / 4;
+        } else if (!loud) {
+            noise_floor_q4_ += std::max((level * 16 - noise_floor_q4_) / 128, 1);
+        }
+
+        if (loud) {
+            loud_frames_++;
+            quiet_frames_ = 0;
+            if (!open_ && loud_frames_ >= config_.open_frames) {
+                open_ = true;
+                event = kEventOpened;
+                std::lock_guard<std::mutex> lock(stats_mutex_);
+                openings_++;
+            }
+        } else {
+            loud_frames_ = 0;
+            if (open_ && ++quiet_frames_ >= hang_frames) {
+                open_ = false;
+                event = event == kEventOpened ? kEventNone : kEventClosed;
+            }
+        }
+    }
+
+    buffer_.insert(buffer_.end(), data.begin(), data.end());
+    if (!open_) {
+        // Only the preroll is needed while closed
+        size_t preroll = config_.preroll_ms * kSampleRate / 1000 * channels_;
+        if (buffer_.size() > preroll) {
+            buffer_.erase(buffer_.begin(), buffer_.end() - preroll);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    listen_samples_ += frames;
+    if (open_ || event == kEventClosed) {
+        open_samples_ += frames;
+    }
+    return event;
+}
+
+bool WakeWordGate::Pop(std::vector<int16_t>& data, size_t samples) {
+    if (samples == 0 || buffer_.size() < samples) {
+        return false;
+    }
+    data.assign(buffer_.begin(), buffer_.begin() + samples);
+    buffer_.erase(buffer_.begin(), buffer_.begin() + samples);
+    return true;
+}
+
+void WakeWordGate::OnWakeWordDetected() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    wake_words_++;
+}
+
+cJSON* WakeWordGate::GetStatsJson() {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
+    int64_t listen_ms = listen_samples_ * 1000 / kSampleRate;
+    int64_t open_ms = open_samples_ * 1000 / kSampleRate;
+    int duty_permille = listen_samples_ > 0 ? open_samples_ * 1000 / listen_samples_ : 0;
+    int always_on_ma = config_.listen_current_ma + config_.afe_current_ma;
+    int estimated_ua = config_.listen_current_ma * 1000 + config_.afe_current_ma * duty_permille;
+
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "listen_ms", listen_ms);
+    cJSON_AddNumberToObject(json, "wake_word_engine_ms", open_ms);
+    cJSON_AddNumberToObject(json, "duty_percent", duty_permille / 10.0);
+    cJSON_AddNumberToObject(json, "gate_openings", openings_);
+    cJSON_AddNumberToObject(json, "wake_words", wake_words_);
+    cJSON_AddNumberToObject(json, "estimated_current_ma", estimated_ua / 1000.0);
+    cJSON_AddNumberToObject(json, "always_on_current_ma", always_on_ma);
+    // Battery life relative to always-on wake word detection, 100 means no gain
+    cJSON_AddNumberToObject(json, "battery_life_percent", always_on_ma * 100000 / std::max(estimated_ua, 1));
+    return json;
+}
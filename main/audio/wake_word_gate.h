@@ -0,0 +1,76 @@
+#ifndef WAKE_WORD_GATE_H
+#define WAKE_WORD_GATE_H
+
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+#include <cJSON.h>
+
+/**
+ * Cheap energy gate in front of the wake word, used while the device is in power save mode.
+ *
+ * Input blocks (16 kHz, interleaved channels, the first one is the microphone) are split into
+ * 10 ms frames. The gate opens when frames are well above the tracked noise floor, and stays
+ * open for `hang_ms` after the last loud frame, so the wake word engine only has to run while
+ * someone is talking. The last `preroll_ms` of audio are kept while the gate is closed and are
+ * fed first when it opens, so the beginning of the wake word is not lost.
+ *
+ * The gate also keeps the duty cycle of the wake word engine and estimates the battery life
+ * compared to always-on wake word detection.
+ */
+class WakeWordGate {
+public:
+    enum Event {
+        kEventNone,
+        kEventOpened,
+        kEventClosed,
+    };
+
+    struct Config {
+        int preroll_ms = 500;
+        int open_ratio = 4;         // Frame level above the noise floor by this factor (12 dB)
+        int min_level = 64;         // Mean absolute level below this is silence
+        int open_frames = 2;        // Consecutive loud frames needed to open
+        int hang_ms = 1500;
+        // Typical ESP32-S3 figures, only used for the battery estimate
+        int listen_current_ma = 12; // Codec input and the gate, CPU at the minimum frequency
+        int afe_current_ma = 45;    // Added while the wake word engine runs
+    };
+
+    void SetConfig(const Config& config) { config_ = config; }
+    const Config& config() const { return config_; }
+
+    // Start over with an empty buffer and the gate closed
+    void Reset(int channels);
+    // Analyze a block and append it to the buffer
+    Event Process(const std::vector<int16_t>& data);
+    // Take the oldest `samples` buffered samples, false if fewer are buffered
+    bool Pop(std::vector<int16_t>& data, size_t samples);
+    bool open() const { return open_; }
+
+    // Count a wake word detected while the gate was in use
+    void OnWakeWordDetected();
+    // Caller takes ownership of the returned object
+    cJSON* GetStatsJson();
+
+private:
+    static constexpr int kSampleRate = 16000;
+    static constexpr int kFrameSamples = kSampleRate / 100;
+
+    Config config_;
+    int channels_ = 1;
+    std::vector<int16_t> buffer_;
+    bool open_ = false;
+    int noise_floor_q4_ = -1;       // Noise floor level x16, negative until the first frame
+    int loud_frames_ = 0;
+    int quiet_frames_ = 0;
+
+    std::mutex stats_mutex_;
+    int64_t listen_samples_ = 0;
+    int64_t open_samples_ = 0;
+    uint32_t openings_ = 0;
+    uint32_t wake_words_ = 0;
+};
+
+#endif // WAKE_WORD_GATE_H
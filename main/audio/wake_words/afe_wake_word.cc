@@ -3,22 +3,18 @@
 #include <esp_log.h>
 #include <sstream>
 
-#define DETECTION_RUNNING_EVENT 1
-
 #define TAG "AfeWakeWord"
 
-AfeWakeWord::AfeWakeWord()
-    : afe_data_(nullptr),
+AfeWakeWord::AfeWakeWord(std::shared_ptr<AfeFrontEnd> front_end)
+    : front_end_(front_end ? front_end : std::make_shared<AfeFrontEnd>()),
       wake_word_pcm_(),
       wake_word_opus_() {
-
-    event_group_ = xEventGroupCreate();
+    front_end_->Attach(AfeFrontEnd::kConsumerWakeWord);
 }
 
 AfeWakeWord::~AfeWakeWord() {
-    if (afe_data_ != nullptr) {
-        afe_iface_->destroy(afe_data_);
-    }
+    front_end_->Stop(AfeFrontEnd::kConsumerWakeWord);
+    front_end_->OnFetch(AfeFrontEnd::kConsumerWakeWord, nullptr);
 
     if (wake_word_encode_task_stack_ != nullptr) {
         heap_caps_free(wake_word_encode_task_stack_);
@@ -27,33 +23,24 @@ AfeWakeWord::~AfeWakeWord() {
     if (wake_word_encode_task_buffer_ != nullptr) {
         heap_caps_free(wake_word_encode_task_buffer_);
     }
-
-    if (models_ != nullptr) {
-        esp_srmodel_deinit(models_);
-    }
-
-    vEventGroupDelete(event_group_);
 }
 
 bool AfeWakeWord::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
     codec_ = codec;
-    int ref_num = codec_->input_reference() ? 1 : 0;
 
-    if (models_list == nullptr) {
-        models_ = esp_srmodel_init("model");
-    } else {
-        models_ = models_list;
-    }
-
-    if (models_ == nullptr || models_->num == -1) {
+    front_end_->OnFetch(AfeFrontEnd::kConsumerWakeWord, [this](afe_fetch_result_t* res) {
+        OnFetch(res);
+    });
+    if (!front_end_->Initialize(codec, models_list) || !front_end_->has_wakenet()) {
         ESP_LOGE(TAG, "Failed to initialize wakenet model");
         return false;
     }
-    for (int i = 0; i < models_->num; i++) {
-        ESP_LOGI(TAG, "Model %d: %s", i, models_->model_name[i]);
-        if (strstr(models_->model_name[i], ESP_WN_PREFIX) != NULL) {
-            wakenet_model_ = models_->model_name[i];
-            auto words = esp_srmodel_get_wake_words(models_, wakenet_model_);
+
+    auto models = front_end_->models();
+    for (int i = 0; i < models->num; i++) {
+        ESP_LOGI(TAG, "Model %d: %s", i, models->model_name[i]);
+        if (strstr(models->model_name[i], ESP_WN_PREFIX) != NULL) {
+            auto words = esp_srmodel_get_wake_words(models, models->model_name[i]);
             // split by ";" to get all wake words
             std::stringstream ss(words);
             std::string word;
@@ -62,30 +49,6 @@ bool AfeWakeWord::Initialize(AudioCodec* codec, srmodel_list_t* models_list) {
             }
         }
     }
-
-    std::string input_format;
-    for (int i = 0; i < codec_->input_channels() - ref_num; i++) {
-        input_format.push_back('M');
-    }
-    for (int i = 0; i < ref_num; i++) {
-        input_format.push_back('R');
-    }
-    afe_config_t* afe_config = afe_config_init(input_format.c_str(), models_, AFE_TYPE_SR, AFE_MODE_HIGH_PERF);
-    afe_config->aec_init = codec_->input_reference();
-    afe_config->aec_mode = AEC_MODE_SR_HIGH_PERF;
-    afe_config->afe_perferred_core = 1;
-    afe_config->afe_perferred_priority = 1;
-    afe_config->memory_alloc_mode = AFE_MEMORY_ALLOC_MORE_PSRAM;
-    
-    afe_iface_ = esp_afe_handle_from_config(afe_config);
-    afe_data_ = afe_iface_->create_from_config(afe_config);
-
-    xTaskCreate([](void* arg) {
-        auto this_ = (AfeWakeWord*)arg;
-        this_->AudioDetectionTask();
-        vTaskDelete(NULL);
-    }, "audio_detection", 4096, this, 3, nullptr);
-
     return true;
 }
 
@@ -94,54 +57,31 @@ void AfeWakeWord::OnWakeWordDetected(std::function<void(const std::string& wake_
 }
 
 void AfeWakeWord::Start() {
-    xEventGroupSetBits(event_group_, DETECTION_RUNNING_EVENT);
+    front_end_->Start(AfeFrontEnd::kConsumerWakeWord);
 }
 
 void AfeWakeWord::Stop() {
-    xEventGroupClearBits(event_group_, DETECTION_RUNNING_EVENT);
-    if (afe_data_ != nullptr) {
-        afe_iface_->reset_buffer(afe_data_);
-    }
+    front_end_->Stop(AfeFrontEnd::kConsumerWakeWord);
 }
 
 void AfeWakeWord::Feed(const std::vector<int16_t>& data) {
-    if (afe_data_ == nullptr) {
-        return;
-    }
-    afe_iface_->feed(afe_data_, data.data());
+    front_end_->Feed(data);
 }
 
 size_t AfeWakeWord::GetFeedSize() {
-    if (afe_data_ == nullptr) {
-        return 0;
-    }
-    return afe_iface_->get_feed_chunksize(afe_data_);
+    return front_end_->GetFeedSize();
 }
 
-void AfeWakeWord::AudioDetectionTask() {
-    auto fetch_size = afe_iface_->get_fetch_chunksize(afe_data_);
-    auto feed_size = afe_iface_->get_feed_chunksize(afe_data_);
-    ESP_LOGI(TAG, "Audio detection task started, feed size: %d fetch size: %d",
-        feed_size, fetch_size);
-
-    while (true) {
-        xEventGroupWaitBits(event_group_, DETECTION_RUNNING_EVENT, pdFALSE, pdTRUE, portMAX_DELAY);
-
-        auto res = afe_iface_->fetch_with_delay(afe_data_, portMAX_DELAY);
-        if (res == nullptr || res->ret_value == ESP_FAIL) {
-            continue;;
-        }
-
-        // Store the wake word data for voice recognition, like who is speaking
-        StoreWakeWordData(res->data, res->data_size / sizeof(int16_t));
+void AfeWakeWord::OnFetch(afe_fetch_result_t* res) {
+    // Store the wake word data for voice recognition, like who is speaking
+    StoreWakeWordData(res->data, res->data_size / sizeof(int16_t));
 
-        if (res->wakeup_state == WAKENET_DETECTED) {
-            Stop();
-            last_detected_wake_word_ = wake_words_[res->wakenet_model_index - 1];
+    if (res->wakeup_state == WAKENET_DETECTED) {
+        Stop();
+        last_detected_wake_word_ = wake_words_[res->wakenet_model_index - 1];
 
-            if (wake_word_detected_callback_) {
-                wake_word_detected_callback_(last_detected_wake_word_);
-            }
+        if (wake_word_detected_callback_) {
+            wake_word_detected_callback_(last_detected_wake_word_);
         }
     }
 }
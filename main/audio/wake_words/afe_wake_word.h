@@ -3,25 +3,26 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/task.h>
-#include <freertos/event_groups.h>
 
 #include <esp_afe_sr_models.h>
-#include <esp_nsn_models.h>
 #include <model_path.h>
 
 #include <deque>
 #include <string>
 #include <vector>
+#include <memory>
 #include <functional>
 #include <mutex>
 #include <condition_variable>
 
 #include "audio_codec.h"
 #include "wake_word.h"
+#include "processors/afe_front_end.h"
 
 class AfeWakeWord : public WakeWord {
 public:
-    AfeWakeWord();
+    // Pass a front end shared with the audio processor, otherwise the wake word creates its own
+    explicit AfeWakeWord(std::shared_ptr<AfeFrontEnd> front_end = nullptr);
     ~AfeWakeWord();
 
     bool Initialize(AudioCodec* codec, srmodel_list_t* models_list);
@@ -35,12 +36,8 @@ public:
     const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
 
 private:
-    srmodel_list_t *models_ = nullptr;
-    const esp_afe_sr_iface_t* afe_iface_ = nullptr;
-    esp_afe_sr_data_t* afe_data_ = nullptr;
-    char* wakenet_model_ = NULL;
+    std::shared_ptr<AfeFrontEnd> front_end_;
     std::vector<std::string> wake_words_;
-    EventGroupHandle_t event_group_;
     std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
     AudioCodec* codec_ = nullptr;
     std::string last_detected_wake_word_;
@@ -54,7 +51,7 @@ private:
     std::condition_variable wake_word_cv_;
 
     void StoreWakeWordData(const int16_t* data, size_t size);
-    void AudioDetectionTask();
+    void OnFetch(afe_fetch_result_t* res);
 };
 
 #endif
@@ -2,6 +2,7 @@
 #include "audio_service.h"
 #include "system_info.h"
 #include "assets.h"
+#include "sample_format.h"
 
 #include <esp_log.h>
 #include <esp_mn_iface.h>
@@ -146,11 +147,15 @@ void CustomWakeWord::Feed(const std::vector<int16_t>& data) {
     }
 
     esp_mn_state_t mn_state;
-    // If input channels is 2, we need to fetch the left channel data
-    if (codec_->input_channels() == 2) {
-        auto mono_data = std::vector<int16_t>(data.size() / 2);
-        for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-            mono_data[i] = data[j];
+    // Multinet takes one channel: the microphones mixed toward the talker, or the first one
+    int channels = codec_->input_channels();
+    if (channels > 1) {
+        std::vector<int16_t> mono_data;
+        if (mic_mixer_ != nullptr) {
+            mic_mixer_->Mix(data, mono_data);
+        } else {
+            mono_data.resize(data.size() / channels);
+            sample_format::Deinterleave(data.data(), mono_data.data(), mono_data.size(), channels, 0);
         }
 
         StoreWakeWordData(mono_data);
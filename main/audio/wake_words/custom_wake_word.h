@@ -10,6 +10,7 @@
 #include <string>
 #include <vector>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
@@ -31,6 +32,7 @@ public:
     void EncodeWakeWordData();
     bool GetWakeWordOpus(std::vector<uint8_t>& opus);
     const std::string& GetLastDetectedWakeWord() const { return last_detected_wake_word_; }
+    void SetMicArray(MicArray* mic_array) { mic_mixer_ = std::make_unique<MicArray::Mixer>(*mic_array); }
 
 private:
     struct Command {
@@ -51,6 +53,7 @@ private:
  
     std::function<void(const std::string& wake_word)> wake_word_detected_callback_;
     AudioCodec* codec_ = nullptr;
+    std::unique_ptr<MicArray::Mixer> mic_mixer_;
     std::string last_detected_wake_word_;
     std::atomic<bool> running_ = false;
 
@@ -180,6 +180,17 @@ public:
         return &audio_codec;
     }
 
+    // 面包板常用 MAX98357A 配小喇叭：滤掉喇叭放不出的低频，提升人声清晰度，并限制峰值防止破音
+    virtual bool GetOutputDspConfig(OutputDsp::Config& config) override {
+        config.eq = {
+            {OutputDsp::kHighPass, 180, 0, 0.707f},
+            {OutputDsp::kPeaking, 3000, 3, 1.0f},
+        };
+        config.loudness_target_db = -20;
+        config.limiter_threshold_db = -1;
+        return true;
+    }
+
     virtual Display* GetDisplay() override {
         return display_;
     }
@@ -1,8 +1,11 @@
 #include "afsk_demod.h"
 #include <cstring>
+#include <cmath>
 #include <algorithm>
 #include "esp_log.h"
 #include "display.h"
+#include "application.h"
+#include "wifi_manager.h"
 #include "ssid_manager.h"
 
 #ifndef M_PI
@@ -20,10 +23,11 @@ namespace audio_wifi_config
                                     )
     {
         const int kInputSampleRate = 16000;                                    // Input sampling rate
-        const float kDownsampleStep = static_cast<float>(kInputSampleRate) / static_cast<float>(kAudioSampleRate); // Downsampling step
         std::vector<int16_t> audio_data;
         AudioSignalProcessor signal_processor(kAudioSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate, kWindowSize);
         AudioDataBuffer data_buffer;
+        // Downsampling phase in units of 1 / (kInputSampleRate * kAudioSampleRate) seconds, kept across chunks
+        int downsample_phase = 0;
 
         while (true)
         {
@@ -41,39 +45,30 @@ namespace audio_wifi_config
                 continue;
             }
 
-            if (input_channels == 2) { // 如果是双声道输入，转换为单声道
-                auto mono_data = std::vector<int16_t>(audio_data.size() / 2);
-                for (size_t i = 0, j = 0; i < mono_data.size(); ++i, j += 2) {
-                    mono_data[i] = audio_data[j];
-                }
-                audio_data = std::move(mono_data);
-            }
-            
-            // Downsample the audio data
-            std::vector<float> downsampled_data;
-            size_t last_index = 0;
-
-            if (kDownsampleStep > 1.0f) {
-                downsampled_data.reserve(audio_data.size() / static_cast<size_t>(kDownsampleStep));
-                for (size_t i = 0; i < audio_data.size(); ++i) {
-                    size_t sample_index = static_cast<size_t>(i / kDownsampleStep);
-                    if ((sample_index + 1) > last_index) {
-                        downsampled_data.push_back(static_cast<float>(audio_data[i]));
-                        last_index = sample_index + 1;
+            // Downsample the first channel in place of a converted copy, and feed the demodulator directly
+            bool received = false;
+            const size_t channels = input_channels == 2 ? 2 : 1;
+            for (size_t i = 0; i < audio_data.size(); i += channels) {
+                if (kInputSampleRate > static_cast<int>(kAudioSampleRate)) {
+                    bool keep = downsample_phase >= 0;
+                    if (keep) {
+                        downsample_phase -= kInputSampleRate;
+                    }
+                    downsample_phase += kAudioSampleRate;
+                    if (!keep) {
+                        continue;
                     }
                 }
-            } else {
-                downsampled_data.reserve(audio_data.size());
-                for (int16_t sample : audio_data) {
-                    downsampled_data.push_back(static_cast<float>(sample));
+
+                uint16_t mark_probability;
+                if (signal_processor.ProcessSample(audio_data[i], mark_probability) &&
+                    data_buffer.ProcessProbability(mark_probability)) {
+                    received = true;
+                    break;
                 }
             }
-            
-            // Process audio samples to get probability data
-            auto probabilities = signal_processor.ProcessAudioSamples(downsampled_data);
-            
-            // Feed probability data to the data buffer
-            if (data_buffer.ProcessProbabilityData(probabilities, 0.5f)) {
+
+            if (received) {
                 // If complete data was received, extract WiFi credentials
                 if (data_buffer.decoded_text.has_value()) {
                     ESP_LOGI(kLogTag, "Received text data: %s", data_buffer.decoded_text->c_str());
@@ -118,108 +113,80 @@ namespace audio_wifi_config
 
     // FrequencyDetector implementation
     FrequencyDetector::FrequencyDetector(float frequency, size_t window_size)
-        : frequency_(frequency), window_size_(window_size) {
-        frequency_bin_ = std::floor(frequency_ * static_cast<float>(window_size_));
-        angular_frequency_ = 2.0f * M_PI * frequency_;
-        cos_coefficient_ = std::cos(angular_frequency_);
-        sin_coefficient_ = std::sin(angular_frequency_);
-        filter_coefficient_ = 2.0f * cos_coefficient_;
-
-        // Initialize state buffer
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
+        : window_size_(window_size) {
+        // Coefficient is computed once, the per sample update is integer only
+        float angular_frequency = 2.0f * M_PI * frequency;
+        filter_coefficient_ = static_cast<int32_t>(std::lround(2.0f * std::cos(angular_frequency) * (1 << 14)));
     }
 
-    void FrequencyDetector::Reset() {
-        state_buffer_.clear();
-        state_buffer_.push_back(0.0f);
-        state_buffer_.push_back(0.0f);
-    }
-
-    void FrequencyDetector::ProcessSample(float sample) {
-        if (state_buffer_.size() < 2) {
-            return;
+    static uint32_t IntegerSqrt(uint64_t value) {
+        uint64_t result = 0;
+        uint64_t bit = 1ULL << 62;
+        while (bit > value) {
+            bit >>= 2;
         }
-
-        float s_minus_2 = state_buffer_.front();  // S[-2]
-        state_buffer_.pop_front();
-        float s_minus_1 = state_buffer_.front();  // S[-1]
-        state_buffer_.pop_front();
-
-        float s_current = sample + filter_coefficient_ * s_minus_1 - s_minus_2;
-
-        state_buffer_.push_back(s_minus_1);  // Put S[-1] back
-        state_buffer_.push_back(s_current);  // Add new S[0]
+        while (bit != 0) {
+            if (value >= result + bit) {
+                value -= result + bit;
+                result = (result >> 1) + bit;
+            } else {
+                result >>= 1;
+            }
+            bit >>= 2;
+        }
+        return static_cast<uint32_t>(result);
     }
 
-    float FrequencyDetector::GetAmplitude() const {
-        if (state_buffer_.size() < 2) {
-            return 0.0f;
+    uint32_t FrequencyDetector::GetAmplitude() const {
+        // |S[-1] - e^(-jw) * S[-2]|^2 = S[-1]^2 + S[-2]^2 - 2cos(w) * S[-1] * S[-2]
+        int64_t s1 = s_minus_1_;
+        int64_t s2 = s_minus_2_;
+        int64_t power = s1 * s1 + s2 * s2 - ((filter_coefficient_ * s1) >> 14) * s2;
+        if (power <= 0) {
+            return 0;
         }
-
-        float s_minus_1 = state_buffer_[1];                      // S[-1]
-        float s_minus_2 = state_buffer_[0];                      // S[-2]
-        float real_part = cos_coefficient_ * s_minus_1 - s_minus_2;  // Real part
-        float imaginary_part = sin_coefficient_ * s_minus_1;         // Imaginary part
-
-        return std::sqrt(real_part * real_part + imaginary_part * imaginary_part) / 
-               (static_cast<float>(window_size_) / 2.0f);
+        return IntegerSqrt(static_cast<uint64_t>(power)) * 2 / window_size_;
     }
 
     // AudioSignalProcessor implementation
     AudioSignalProcessor::AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
                                              size_t bit_rate, size_t window_size)
-        : input_buffer_size_(window_size), output_sample_count_(0) {
+        : window_size_(window_size), samples_per_bit_(sample_rate / bit_rate), sample_count_(0),
+          mark_detector_(static_cast<float>(mark_frequency) / static_cast<float>(sample_rate), window_size),
+          space_detector_(static_cast<float>(space_frequency) / static_cast<float>(sample_rate), window_size) {
         if (sample_rate % bit_rate != 0) {
             // On ESP32 we can continue execution, but log the error
             ESP_LOGW(kLogTag, "Sample rate %zu is not divisible by bit rate %zu", sample_rate, bit_rate);
         }
-
-        float normalized_mark_freq = static_cast<float>(mark_frequency) / static_cast<float>(sample_rate);
-        float normalized_space_freq = static_cast<float>(space_frequency) / static_cast<float>(sample_rate);
-
-        mark_detector_ = std::make_unique<FrequencyDetector>(normalized_mark_freq, window_size);
-        space_detector_ = std::make_unique<FrequencyDetector>(normalized_space_freq, window_size);
-
-        samples_per_bit_ = sample_rate / bit_rate;  // Number of samples per bit
+        if (window_size_ > samples_per_bit_) {
+            ESP_LOGW(kLogTag, "Window size %zu is longer than one bit, using %zu", window_size_, samples_per_bit_);
+            window_size_ = samples_per_bit_;
+        }
     }
 
-    std::vector<float> AudioSignalProcessor::ProcessAudioSamples(const std::vector<float> &samples) {
-        std::vector<float> result;
-
-        for (float sample : samples) {
-            if (input_buffer_.size() < input_buffer_size_) {
-                input_buffer_.push_back(sample);  // Just add, don't process yet
-            } else {
-                // Input buffer is full, process the data
-                input_buffer_.pop_front();   // Remove oldest sample
-                input_buffer_.push_back(sample);  // Add new sample
-                output_sample_count_++;
-
-                if (output_sample_count_ >= samples_per_bit_) {
-                    // Process all samples in the window using Goertzel algorithm
-                    for (float window_sample : input_buffer_) {
-                        mark_detector_->ProcessSample(window_sample);
-                        space_detector_->ProcessSample(window_sample);
-                    }
-
-                    float mark_amplitude = mark_detector_->GetAmplitude();   // Mark amplitude
-                    float space_amplitude = space_detector_->GetAmplitude(); // Space amplitude
-
-                    // Avoid division by zero
-                    float mark_probability = mark_amplitude / 
-                                           (space_amplitude + mark_amplitude + std::numeric_limits<float>::epsilon());
-                    result.push_back(mark_probability);
-
-                    // Reset detector windows
-                    mark_detector_->Reset();
-                    space_detector_->Reset();
-                    output_sample_count_ = 0;  // Reset output counter
-                }
-            }
+    bool AudioSignalProcessor::ProcessSample(int16_t sample, uint16_t &mark_probability) {
+        // The window is the tail of each bit period, so the detectors are updated as samples
+        // arrive and read out once per bit instead of re-running over a stored window
+        if (sample_count_ >= samples_per_bit_ - window_size_) {
+            mark_detector_.ProcessSample(sample);
+            space_detector_.ProcessSample(sample);
+        }
+        if (++sample_count_ < samples_per_bit_) {
+            return false;
         }
 
-        return result;
+        uint32_t mark_amplitude = mark_detector_.GetAmplitude();   // Mark amplitude
+        uint32_t space_amplitude = space_detector_.GetAmplitude(); // Space amplitude
+        uint64_t total_amplitude = static_cast<uint64_t>(mark_amplitude) + space_amplitude;
+        // Avoid division by zero, silence counts as space
+        mark_probability = total_amplitude == 0 ? 0 :
+            static_cast<uint16_t>((static_cast<uint64_t>(mark_amplitude) << 15) / total_amplitude);
+
+        // Reset detector windows
+        mark_detector_.Reset();
+        space_detector_.Reset();
+        sample_count_ = 0;
+        return true;
     }
 
     // AudioDataBuffer implementation
@@ -259,97 +226,95 @@ namespace audio_wifi_config
         bit_buffer_.clear();
     }
 
-    bool AudioDataBuffer::ProcessProbabilityData(const std::vector<float> &probabilities, float threshold) {
-        for (float probability : probabilities) {
-            uint8_t bit = (probability > threshold) ? 1 : 0;
+    bool AudioDataBuffer::ProcessProbability(uint16_t mark_probability, uint16_t threshold) {
+        uint8_t bit = (mark_probability > threshold) ? 1 : 0;
 
-            if (identifier_buffer_.size() >= identifier_buffer_size_) {
-                identifier_buffer_.pop_front();  // Maintain buffer size
+        if (identifier_buffer_.size() >= identifier_buffer_size_) {
+            identifier_buffer_.pop_front();  // Maintain buffer size
+        }
+        identifier_buffer_.push_back(bit);
+
+        // Process received bit based on state machine
+        switch (current_state_) {
+        case DataReceptionState::kInactive:
+            if (identifier_buffer_.size() >= start_of_transmission_.size()) {
+                current_state_ = DataReceptionState::kWaiting;  // Enter waiting state
+                ESP_LOGI(kLogTag, "Entering Waiting state");
             }
-            identifier_buffer_.push_back(bit);
-
-            // Process received bit based on state machine
-            switch (current_state_) {
-            case DataReceptionState::kInactive:
-                if (identifier_buffer_.size() >= start_of_transmission_.size()) {
-                    current_state_ = DataReceptionState::kWaiting;  // Enter waiting state
-                    ESP_LOGI(kLogTag, "Entering Waiting state");
-                }
-                break;
-
-            case DataReceptionState::kWaiting:
-                // Waiting state, possibly waiting for transmission end
-                if (identifier_buffer_.size() >= start_of_transmission_.size()) {
-                    std::vector<uint8_t> identifier_snapshot(identifier_buffer_.begin(), identifier_buffer_.end());
-                    if (identifier_snapshot == start_of_transmission_)
-                    {
-                        ClearBuffers();                                // Clear buffers
-                        current_state_ = DataReceptionState::kReceiving;  // Enter receiving state
-                        ESP_LOGI(kLogTag, "Entering Receiving state");
-                    }
+            break;
+
+        case DataReceptionState::kWaiting:
+            // Waiting state, possibly waiting for transmission end
+            if (identifier_buffer_.size() >= start_of_transmission_.size()) {
+                if (std::equal(identifier_buffer_.begin(), identifier_buffer_.end(),
+                               start_of_transmission_.begin(), start_of_transmission_.end()))
+                {
+                    ClearBuffers();                                // Clear buffers
+                    current_state_ = DataReceptionState::kReceiving;  // Enter receiving state
+                    ESP_LOGI(kLogTag, "Entering Receiving state");
                 }
-                break;
-
-            case DataReceptionState::kReceiving:
-                bit_buffer_.push_back(bit);
-                if (identifier_buffer_.size() >= end_of_transmission_.size()) {
-                    std::vector<uint8_t> identifier_snapshot(identifier_buffer_.begin(), identifier_buffer_.end());
-                    if (identifier_snapshot == end_of_transmission_) {
-                        current_state_ = DataReceptionState::kInactive;  // Enter inactive state
-
-                        // Convert bits to bytes
-                        std::vector<uint8_t> bytes = ConvertBitsToBytes(bit_buffer_);
-
-                        uint8_t received_checksum = 0;
-                        size_t minimum_length = 0;
-
-                        if (enable_checksum_validation_) {
-                            // If checksum is required, last byte is checksum
-                            minimum_length = 1 + start_of_transmission_.size() / 8;
-                            if (bytes.size() >= minimum_length)
-                            {
-                                received_checksum = bytes[bytes.size() - start_of_transmission_.size() / 8 - 1];
-                            }
-                        } else {
-                            minimum_length = start_of_transmission_.size() / 8;
+            }
+            break;
+
+        case DataReceptionState::kReceiving:
+            bit_buffer_.push_back(bit);
+            if (identifier_buffer_.size() >= end_of_transmission_.size()) {
+                if (std::equal(identifier_buffer_.begin(), identifier_buffer_.end(),
+                               end_of_transmission_.begin(), end_of_transmission_.end())) {
+                    current_state_ = DataReceptionState::kInactive;  // Enter inactive state
+
+                    // Convert bits to bytes
+                    std::vector<uint8_t> bytes = ConvertBitsToBytes(bit_buffer_);
+
+                    uint8_t received_checksum = 0;
+                    size_t minimum_length = 0;
+
+                    if (enable_checksum_validation_) {
+                        // If checksum is required, last byte is checksum
+                        minimum_length = 1 + start_of_transmission_.size() / 8;
+                        if (bytes.size() >= minimum_length)
+                        {
+                            received_checksum = bytes[bytes.size() - start_of_transmission_.size() / 8 - 1];
                         }
+                    } else {
+                        minimum_length = start_of_transmission_.size() / 8;
+                    }
 
-                        if (bytes.size() < minimum_length) {
-                            ClearBuffers();
-                            ESP_LOGW(kLogTag, "Data too short, clearing buffer");
-                            return false;  // Data too short, return failure
-                        }
+                    if (bytes.size() < minimum_length) {
+                        ClearBuffers();
+                        ESP_LOGW(kLogTag, "Data too short, clearing buffer");
+                        return false;  // Data too short, return failure
+                    }
 
-                        // Extract text data (remove trailing identifier part)
-                        std::vector<uint8_t> text_bytes(
-                            bytes.begin(), bytes.begin() + bytes.size() - minimum_length);
-
-                        std::string result(text_bytes.begin(), text_bytes.end());
-
-                        // Validate checksum if required
-                        if (enable_checksum_validation_) {
-                            uint8_t calculated_checksum = CalculateChecksum(result);
-                            if (calculated_checksum != received_checksum) {
-                                // Checksum mismatch
-                                ESP_LOGW(kLogTag, "Checksum mismatch: expected %d, got %d", 
-                                        received_checksum, calculated_checksum);
-                                ClearBuffers();
-                                return false;
-                            }
-                        }
+                    // Extract text data (remove trailing identifier part)
+                    std::vector<uint8_t> text_bytes(
+                        bytes.begin(), bytes.begin() + bytes.size() - minimum_length);
 
-                        ClearBuffers();
-                        decoded_text = result;
-                        return true;  // Return success
-                    } else if (bit_buffer_.size() >= max_bit_buffer_size_) {
-                        // If not end identifier and bit buffer is full, reset
-                        ClearBuffers();
-                        ESP_LOGW(kLogTag, "Buffer overflow, clearing buffer");
-                        current_state_ = DataReceptionState::kInactive;  // Reset state machine
+                    std::string result(text_bytes.begin(), text_bytes.end());
+
+                    // Validate checksum if required
+                    if (enable_checksum_validation_) {
+                        uint8_t calculated_checksum = CalculateChecksum(result);
+                        if (calculated_checksum != received_checksum) {
+                            // Checksum mismatch
+                            ESP_LOGW(kLogTag, "Checksum mismatch: expected %d, got %d", 
+                                    received_checksum, calculated_checksum);
+                            ClearBuffers();
+                            return false;
+                        }
                     }
+
+                    ClearBuffers();
+                    decoded_text = result;
+                    return true;  // Return success
+                } else if (bit_buffer_.size() >= max_bit_buffer_size_) {
+                    // If not end identifier and bit buffer is full, reset
+                    ClearBuffers();
+                    ESP_LOGW(kLogTag, "Buffer overflow, clearing buffer");
+                    current_state_ = DataReceptionState::kInactive;  // Reset state machine
                 }
-                break;
             }
+            break;
         }
 
         return false;
@@ -1,13 +1,14 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <deque>
 #include <string>
-#include <memory>
 #include <optional>
-#include <cmath>
-#include "wifi_manager.h"
-#include "application.h"
+
+class Application;
+class WifiManager;
+class Display;
 
 // Audio signal processing constants for WiFi configuration via audio
 const size_t kAudioSampleRate = 6400;
@@ -15,6 +16,7 @@ const size_t kMarkFrequency = 1800;
 const size_t kSpaceFrequency = 1500;
 const size_t kBitRate = 100;
 const size_t kWindowSize = 64;
+const uint16_t kProbabilityHalf = 1 << 14;  // 0.5 in Q15
 
 namespace audio_wifi_config
 {
@@ -23,20 +25,17 @@ namespace audio_wifi_config
                                          size_t input_channels = 1);
 
     /**
-     * Goertzel algorithm implementation for single frequency detection
-     * Used to detect specific audio frequencies in the AFSK demodulation process
+     * Streaming Goertzel detector for a single frequency, fixed point
+     * Samples are fed one at a time as they arrive, the two filter states are plain
+     * integers so no window buffer is needed and no floating point is used per sample
      */
     class FrequencyDetector
     {
     private:
-        float frequency_;              // Target frequency (normalized, i.e., f / fs)
         size_t window_size_;           // Window size for analysis
-        float frequency_bin_;          // Frequency bin
-        float angular_frequency_;      // Angular frequency
-        float cos_coefficient_;        // cos(w)
-        float sin_coefficient_;        // sin(w)
-        float filter_coefficient_;     // 2 * cos(w)
-        std::deque<float> state_buffer_;  // Circular buffer for storing S[-1] and S[-2]
+        int32_t filter_coefficient_;   // 2 * cos(w), Q14
+        int32_t s_minus_1_ = 0;        // S[-1]
+        int32_t s_minus_2_ = 0;        // S[-2]
 
     public:
         /**
@@ -49,19 +48,27 @@ namespace audio_wifi_config
         /**
          * Reset the detector state
          */
-        void Reset();
+        void Reset() {
+            s_minus_1_ = 0;
+            s_minus_2_ = 0;
+        }
 
         /**
          * Process one audio sample
          * @param sample Input audio sample
          */
-        void ProcessSample(float sample);
+        void ProcessSample(int16_t sample) {
+            int32_t s_current = sample + static_cast<int32_t>(
+                (static_cast<int64_t>(filter_coefficient_) * s_minus_1_) >> 14) - s_minus_2_;
+            s_minus_2_ = s_minus_1_;
+            s_minus_1_ = s_current;
+        }
 
         /**
          * Calculate current amplitude
-         * @return Amplitude value
+         * @return Amplitude value, in input sample units
          */
-        float GetAmplitude() const;
+        uint32_t GetAmplitude() const;
     };
 
     /**
@@ -71,12 +78,11 @@ namespace audio_wifi_config
     class AudioSignalProcessor
     {
     private:
-        std::deque<float> input_buffer_;             // Input sample buffer
-        size_t input_buffer_size_;                   // Input buffer size = window size
-        size_t output_sample_count_;                 // Output sample counter
+        size_t window_size_;                         // Samples per bit fed to the detectors
         size_t samples_per_bit_;                     // Samples per bit threshold
-        std::unique_ptr<FrequencyDetector> mark_detector_;   // Mark frequency detector
-        std::unique_ptr<FrequencyDetector> space_detector_;  // Space frequency detector
+        size_t sample_count_;                        // Samples received in the current bit
+        FrequencyDetector mark_detector_;            // Mark frequency detector
+        FrequencyDetector space_detector_;           // Space frequency detector
 
     public:
         /**
@@ -85,17 +91,18 @@ namespace audio_wifi_config
          * @param mark_frequency Mark frequency for digital '1'
          * @param space_frequency Space frequency for digital '0'
          * @param bit_rate Data transmission bit rate
-         * @param window_size Analysis window size
+         * @param window_size Analysis window size, at most one bit long
          */
         AudioSignalProcessor(size_t sample_rate, size_t mark_frequency, size_t space_frequency,
                            size_t bit_rate, size_t window_size);
 
         /**
-         * Process input audio samples
-         * @param samples Input audio sample vector
-         * @return Vector of Mark probability values (0.0 to 1.0)
+         * Process one input audio sample
+         * @param sample Input audio sample
+         * @param mark_probability Set to the Mark probability (Q15, 0 to 32768) when a bit is complete
+         * @return true if a bit period is complete
          */
-        std::vector<float> ProcessAudioSamples(const std::vector<float> &samples);
+        bool ProcessSample(int16_t sample, uint16_t &mark_probability);
     };
 
     /**
@@ -143,12 +150,12 @@ namespace audio_wifi_config
                       const std::vector<uint8_t> &end_identifier, bool enable_checksum = false);
 
         /**
-         * Process probability data and attempt to decode
-         * @param probabilities Vector of Mark probabilities
-         * @param threshold Decision threshold for bit detection
+         * Process the Mark probability of one bit and attempt to decode
+         * @param mark_probability Mark probability (Q15)
+         * @param threshold Decision threshold for bit detection (Q15)
          * @return true if complete data was successfully received and decoded
          */
-        bool ProcessProbabilityData(const std::vector<float> &probabilities, float threshold = 0.5f);
+        bool ProcessProbability(uint16_t mark_probability, uint16_t threshold = kProbabilityHalf);
 
         /**
          * Calculate checksum for ASCII text
@@ -13,6 +13,7 @@
 #include "backlight.h"
 #include "camera.h"
 #include "assets.h"
+#include "output_dsp.h"
 
 /**
  * Network events for unified callback
@@ -29,7 +30,9 @@ enum class NetworkEvent {
     ModemErrorNoSim,       // No SIM card detected
     ModemErrorRegDenied,   // Network registration denied
     ModemErrorInitFailed,  // Modem initialization failed
-    ModemErrorTimeout      // Operation timeout
+    ModemErrorTimeout,     // Operation timeout
+    // Dual network specific events
+    Switched               // Active network changed without reboot (data: network name)
 };
 
 // Power save level enumeration
@@ -43,6 +46,14 @@ enum class PowerSaveLevel {
 // data contains additional info like SSID for Connecting/Connected events
 using NetworkEventCallback = std::function<void(NetworkEvent event, const std::string& data)>;
 
+// Audio channel statistics reported by the application to rate the active network
+struct LinkStats {
+    int open_latency_ms = -1;   // Time to open the audio channel, -1 if none was opened
+    int open_failures = 0;
+    int packets_sent = 0;
+    int packets_failed = 0;
+};
+
 void* create_board();
 class AudioCodec;
 class Display;
@@ -77,6 +88,9 @@ public:
     virtual void StartNetwork() = 0;
     virtual void SetNetworkEventCallback(NetworkEventCallback callback) { (void)callback; }
     virtual const char* GetNetworkStateIcon() = 0;
+    virtual void ReportLinkStats(const LinkStats& stats) { (void)stats; }
+    // Playback EQ, loudness and limiter tuned for the board's speaker, return false for none
+    virtual bool GetOutputDspConfig(OutputDsp::Config& config) { (void)config; return false; }
     virtual bool GetBatteryLevel(int &level, bool& charging, bool& discharging);
     virtual std::string GetSystemInfoJson();
     virtual void SetPowerSaveLevel(PowerSaveLevel level) = 0;
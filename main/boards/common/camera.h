@@ -10,6 +10,9 @@ public:
     virtual bool SetHMirror(bool enabled) = 0;
     virtual bool SetVFlip(bool enabled) = 0;
     virtual std::string Explain(const std::string& question) = 0;
+    // Continuous preview on the display, only cameras with a streaming mode have it
+    virtual bool HasLivePreview() { return false; }
+    virtual bool SetLivePreview(bool enabled) { return false; }
 };
 
 #endif // CAMERA_H
@@ -0,0 +1,50 @@
+#include "detection_filter.h"
+
+DetectionFilter::Event DetectionFilter::Update(int score, int64_t now_us) {
+    int threshold = state_ == kStateIdle ? config_.threshold : config_.threshold - config_.hysteresis;
+    bool detected = score >= 0 && score > threshold;
+    if (detected) {
+        last_seen_us_ = now_us;
+    }
+
+    switch (state_) {
+        case kStateIdle:
+            if (detected) {
+                state_ = kStateValidating;
+                first_seen_us_ = now_us;
+            }
+            break;
+        case kStateValidating:
+            if (detected) {
+                if (now_us - first_seen_us_ >= config_.confirm_ms * 1000LL) {
+                    state_ = kStateCooldown;
+                    cooldown_start_us_ = now_us;
+                    return kEventConfirmed;
+                }
+            } else if (now_us - last_seen_us_ >= config_.release_ms * 1000LL) {
+                state_ = kStateIdle;
+                return kEventReleased;
+            }
+            break;
+        case kStateCooldown:
+            if (!detected && now_us - last_seen_us_ >= config_.release_ms * 1000LL &&
+                now_us - cooldown_start_us_ >= config_.cooldown_ms * 1000LL) {
+                state_ = kStateIdle;
+                return kEventReleased;
+            }
+            break;
+    }
+    return kEventNone;
+}
+
+void DetectionFilter::RestartCooldown(int64_t now_us) {
+    if (state_ == kStateCooldown) {
+        cooldown_start_us_ = now_us;
+    }
+}
+
+void DetectionFilter::Reset() {
+    state_ = kStateIdle;
+    first_seen_us_ = 0;
+    last_seen_us_ = 0;
+}
@@ -0,0 +1,60 @@
+#ifndef DETECTION_FILTER_H
+#define DETECTION_FILTER_H
+
+#include <cstdint>
+
+/**
+ * Turns per-frame detection scores into presence events.
+ *
+ * A target must be seen for `confirm_ms` before it is confirmed, and short dropouts
+ * (up to `release_ms`) do not reset the validation. Scores have hysteresis: a target is
+ * picked up above `threshold` and kept down to `threshold - hysteresis`. After a
+ * confirmation, the target has to leave and `cooldown_ms` to elapse before it can be
+ * confirmed again.
+ * Timestamps are passed in, so the filter has no dependency on the platform.
+ */
+class DetectionFilter {
+public:
+    enum Event {
+        kEventNone,
+        kEventConfirmed,    // Target present long enough
+        kEventReleased,     // Target gone, the filter is ready for the next appearance
+    };
+
+    struct Config {
+        int threshold = 75;
+        int hysteresis = 10;
+        int confirm_ms = 2000;
+        int release_ms = 1000;
+        int cooldown_ms = 8000;
+    };
+
+    void SetConfig(const Config& config) { config_ = config; }
+    const Config& config() const { return config_; }
+
+    // score: best score of the target in the frame, negative if it was not detected
+    Event Update(int score, int64_t now_us);
+    // Start the cooldown over, e.g. when the interaction triggered by the confirmation ended
+    void RestartCooldown(int64_t now_us);
+    void Reset();
+
+    bool present() const { return state_ != kStateIdle; }
+    bool confirmed() const { return state_ == kStateCooldown; }
+    // When the target currently tracked was first seen
+    int64_t first_seen_us() const { return first_seen_us_; }
+
+private:
+    enum State {
+        kStateIdle,
+        kStateValidating,
+        kStateCooldown,
+    };
+
+    Config config_;
+    State state_ = kStateIdle;
+    int64_t first_seen_us_ = 0;
+    int64_t last_seen_us_ = 0;
+    int64_t cooldown_start_us_ = 0;
+};
+
+#endif // DETECTION_FILTER_H
@@ -4,20 +4,38 @@
 #include "assets/lang_config.h"
 #include "settings.h"
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <wifi_manager.h>
+#include <ssid_manager.h>
 
 static const char *TAG = "DualNetworkBoard";
 
-DualNetworkBoard::DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, gpio_num_t ml307_dtr_pin, int32_t default_net_type) 
-    : Board(), 
-      ml307_tx_pin_(ml307_tx_pin), 
-      ml307_rx_pin_(ml307_rx_pin), 
+// 热备模式下链路质量的采样间隔
+#define LINK_MONITOR_INTERVAL_MS 2000
+
+static const char* GetNetworkName(NetworkType type) {
+    return type == NetworkType::ML307 ? "ML307" : "WiFi";
+}
+
+static LinkMonitor::Link ToLink(NetworkType type) {
+    return type == NetworkType::ML307 ? LinkMonitor::kLinkCellular : LinkMonitor::kLinkWifi;
+}
+
+DualNetworkBoard::DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, gpio_num_t ml307_dtr_pin, int32_t default_net_type)
+    : Board(),
+      ml307_tx_pin_(ml307_tx_pin),
+      ml307_rx_pin_(ml307_rx_pin),
       ml307_dtr_pin_(ml307_dtr_pin) {
-    
+
     // 从Settings加载网络类型
     network_type_ = LoadNetworkTypeFromSettings(default_net_type);
-    
+
+#if CONFIG_DUAL_NETWORK_HOT_FAILOVER
+    InitializeBothBoards();
+#else
     // 只初始化当前网络类型对应的板卡
     InitializeCurrentBoard();
+#endif
 }
 
 NetworkType DualNetworkBoard::LoadNetworkTypeFromSettings(int32_t default_net_type) {
@@ -35,64 +53,273 @@ void DualNetworkBoard::SaveNetworkTypeToSettings(NetworkType type) {
 void DualNetworkBoard::InitializeCurrentBoard() {
     if (network_type_ == NetworkType::ML307) {
         ESP_LOGI(TAG, "Initialize ML307 board");
-        current_board_ = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_dtr_pin_);
+        ml307_board_ = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_dtr_pin_);
     } else {
         ESP_LOGI(TAG, "Initialize WiFi board");
-        current_board_ = std::make_unique<WifiBoard>();
+        wifi_board_ = std::make_unique<WifiBoard>();
     }
+    current_board_ = GetBoard(network_type_);
+}
+
+void DualNetworkBoard::InitializeBothBoards() {
+    ESP_LOGI(TAG, "Initialize WiFi and ML307 boards, preferred network: %s", GetNetworkName(network_type_));
+    wifi_board_ = std::make_unique<WifiBoard>();
+    // WiFi连不上时由4G接管，不自动进入配网模式；没有配置WiFi且4G不可用时由StartWifiConfigFallback进入配网模式
+    wifi_board_->SetConfigModeFallback(false);
+    ml307_board_ = std::make_unique<Ml307Board>(ml307_tx_pin_, ml307_rx_pin_, ml307_dtr_pin_);
+
+    // 首选网络先作为活动网络，哪个网络先连上就先用哪个
+    link_monitor_.SetPreferred(ToLink(network_type_));
+    current_board_ = GetBoard(network_type_);
+}
+
+Board* DualNetworkBoard::GetBoard(NetworkType type) const {
+    if (type == NetworkType::ML307) {
+        return ml307_board_.get();
+    }
+    return wifi_board_.get();
 }
 
 void DualNetworkBoard::SwitchNetworkType() {
     auto display = GetDisplay();
-    if (network_type_ == NetworkType::WIFI) {    
-        SaveNetworkTypeToSettings(NetworkType::ML307);
+    NetworkType target = network_type_ == NetworkType::WIFI ? NetworkType::ML307 : NetworkType::WIFI;
+    SaveNetworkTypeToSettings(target);
+    if (target == NetworkType::ML307) {
         display->ShowNotification(Lang::Strings::SWITCH_TO_4G_NETWORK);
     } else {
-        SaveNetworkTypeToSettings(NetworkType::WIFI);
         display->ShowNotification(Lang::Strings::SWITCH_TO_WIFI_NETWORK);
     }
+
+#if CONFIG_DUAL_NETWORK_HOT_FAILOVER
+    // 热备模式：更换首选网络，目标网络已连接则立即切换，否则等它连上后由链路监测切换
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        link_monitor_.SetPreferred(ToLink(target));
+    }
+    if (IsNetworkReady(target)) {
+        SwitchActiveNetwork(target);
+    } else {
+        ESP_LOGI(TAG, "%s is not ready, switch when it is connected", GetNetworkName(target));
+    }
+#else
     vTaskDelay(pdMS_TO_TICKS(1000));
     auto& app = Application::GetInstance();
     app.Reboot();
+#endif
 }
 
- 
+bool DualNetworkBoard::IsNetworkReady(NetworkType type) {
+    if (type == NetworkType::WIFI) {
+        return wifi_board_ != nullptr && WifiManager::GetInstance().IsConnected();
+    }
+    auto modem = ml307_board_ != nullptr ? ml307_board_->GetModem() : nullptr;
+    return modem != nullptr && modem->network_ready();
+}
+
+void DualNetworkBoard::SwitchActiveNetwork(NetworkType type) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (network_type_ == type) {
+            return;
+        }
+        network_type_ = type;
+        current_board_ = GetBoard(type);
+        link_monitor_.OnSwitched();
+    }
+
+    ESP_LOGI(TAG, "Active network switched to %s", GetNetworkName(type));
+    auto display = GetDisplay();
+    if (type == NetworkType::ML307) {
+        display->ShowNotification(Lang::Strings::SWITCH_TO_4G_NETWORK);
+    } else {
+        display->ShowNotification(Lang::Strings::SWITCH_TO_WIFI_NETWORK);
+    }
+    // 由应用在新网络上重建协议连接
+    if (network_event_callback_) {
+        network_event_callback_(NetworkEvent::Switched, GetNetworkName(type));
+    }
+}
+
+void DualNetworkBoard::StartWifiConfigFallback() {
+    if (!SsidManager::GetInstance().GetSsidList().empty() || IsNetworkReady(NetworkType::ML307)) {
+        return;
+    }
+    // 4G的注册错误会随重试重复上报，只进入一次配网模式
+    if (wifi_config_fallback_.exchange(true)) {
+        return;
+    }
+
+    ESP_LOGW(TAG, "No WiFi configured and ML307 is unavailable, enter WiFi config mode");
+    {
+        // 配网期间WiFi作为活动网络，由WiFi板卡显示配网状态和图标
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (network_type_ != NetworkType::WIFI) {
+            network_type_ = NetworkType::WIFI;
+            current_board_ = wifi_board_.get();
+            link_monitor_.OnSwitched();
+        }
+    }
+    wifi_board_->EnterWifiConfigMode();
+}
+
+void DualNetworkBoard::OnNetworkEvent(NetworkType type, NetworkEvent event, const std::string& data) {
+    NetworkType other = type == NetworkType::WIFI ? NetworkType::ML307 : NetworkType::WIFI;
+    bool active = type == network_type_;
+
+    switch (event) {
+        case NetworkEvent::ModemErrorNoSim:
+        case NetworkEvent::ModemErrorRegDenied:
+        case NetworkEvent::ModemErrorInitFailed:
+        case NetworkEvent::ModemErrorTimeout:
+            // 先把错误交给应用提示，再视情况进入配网模式
+            if (active && network_event_callback_) {
+                network_event_callback_(event, data);
+            } else if (!active) {
+                ESP_LOGI(TAG, "Standby network %s event %d", GetNetworkName(type), (int)event);
+            }
+            StartWifiConfigFallback();
+            return;
+        case NetworkEvent::Connected:
+            if (!active) {
+                if (IsNetworkReady(other)) {
+                    ESP_LOGI(TAG, "Standby network %s connected", GetNetworkName(type));
+                    return;
+                }
+                // 活动网络未连接，直接使用先连上的备用网络
+                SwitchActiveNetwork(type);
+            }
+            break;
+        case NetworkEvent::Disconnected:
+            if (!active) {
+                ESP_LOGW(TAG, "Standby network %s disconnected", GetNetworkName(type));
+                return;
+            }
+            if (IsNetworkReady(other)) {
+                // 备用网络可用，切换过去而不是断开对话
+                SwitchActiveNetwork(other);
+                return;
+            }
+            break;
+        default:
+            if (!active) {
+                ESP_LOGI(TAG, "Standby network %s event %d", GetNetworkName(type), (int)event);
+                return;
+            }
+            break;
+    }
+
+    if (network_event_callback_) {
+        network_event_callback_(event, data);
+    }
+}
+
+void DualNetworkBoard::LinkMonitorTask() {
+    auto& app = Application::GetInstance();
+    while (true) {
+        vTaskDelay(pdMS_TO_TICKS(LINK_MONITOR_INTERVAL_MS));
+
+        auto& wifi = WifiManager::GetInstance();
+        int wifi_signal = wifi.IsConnected() ? LinkMonitor::RssiToSignal(wifi.GetRssi()) : -1;
+        auto modem = ml307_board_->GetModem();
+        int cellular_signal = modem != nullptr && modem->network_ready() ? LinkMonitor::CsqToSignal(modem->GetCsq()) : -1;
+
+        NetworkType active;
+        LinkMonitor::Decision decision;
+        int wifi_score, ml307_score;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            link_monitor_.UpdateSignal(LinkMonitor::kLinkWifi, wifi_signal);
+            link_monitor_.UpdateSignal(LinkMonitor::kLinkCellular, cellular_signal);
+            active = network_type_;
+            decision = link_monitor_.Evaluate(ToLink(active), esp_timer_get_time());
+            wifi_score = link_monitor_.score(LinkMonitor::kLinkWifi);
+            ml307_score = link_monitor_.score(LinkMonitor::kLinkCellular);
+        }
+        if (decision == LinkMonitor::kDecisionStay) {
+            continue;
+        }
+        // 对话中只在当前网络失效时切换，否则等到空闲再切换
+        if (decision == LinkMonitor::kDecisionSwitch && !app.CanEnterSleepMode()) {
+            continue;
+        }
+
+        NetworkType target = active == NetworkType::WIFI ? NetworkType::ML307 : NetworkType::WIFI;
+        ESP_LOGI(TAG, "%s link %s, wifi score=%d, ml307 score=%d", GetNetworkName(active),
+            decision == LinkMonitor::kDecisionSwitchNow ? "failing" : "degraded", wifi_score, ml307_score);
+        SwitchActiveNetwork(target);
+    }
+}
+
+
 std::string DualNetworkBoard::GetBoardType() {
-    return current_board_->GetBoardType();
+    return current_board_.load()->GetBoardType();
 }
 
 void DualNetworkBoard::StartNetwork() {
     auto display = Board::GetInstance().GetDisplay();
-    
+
     if (network_type_ == NetworkType::WIFI) {
         display->SetStatus(Lang::Strings::CONNECTING);
     } else {
         display->SetStatus(Lang::Strings::DETECTING_MODULE);
     }
-    current_board_->StartNetwork();
+#if CONFIG_DUAL_NETWORK_HOT_FAILOVER
+    wifi_board_->StartNetwork();
+    ml307_board_->StartNetwork();
+    xTaskCreate([](void* arg) {
+        DualNetworkBoard* board = static_cast<DualNetworkBoard*>(arg);
+        board->LinkMonitorTask();
+        vTaskDelete(NULL);
+    }, "link_monitor", 4096, this, 2, NULL);
+#else
+    current_board_.load()->StartNetwork();
+#endif
 }
 
 void DualNetworkBoard::SetNetworkEventCallback(NetworkEventCallback callback) {
+#if CONFIG_DUAL_NETWORK_HOT_FAILOVER
+    // Filter the events of both boards, only the active network is visible to the application
+    network_event_callback_ = std::move(callback);
+    wifi_board_->SetNetworkEventCallback([this](NetworkEvent event, const std::string& data) {
+        OnNetworkEvent(NetworkType::WIFI, event, data);
+    });
+    ml307_board_->SetNetworkEventCallback([this](NetworkEvent event, const std::string& data) {
+        OnNetworkEvent(NetworkType::ML307, event, data);
+    });
+#else
     // Forward the callback to the current board
-    current_board_->SetNetworkEventCallback(std::move(callback));
+    current_board_.load()->SetNetworkEventCallback(std::move(callback));
+#endif
 }
 
 NetworkInterface* DualNetworkBoard::GetNetwork() {
-    return current_board_->GetNetwork();
+    return current_board_.load()->GetNetwork();
 }
 
 const char* DualNetworkBoard::GetNetworkStateIcon() {
-    return current_board_->GetNetworkStateIcon();
+    return current_board_.load()->GetNetworkStateIcon();
+}
+
+void DualNetworkBoard::ReportLinkStats(const LinkStats& stats) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    link_monitor_.UpdateTraffic(ToLink(network_type_), stats.open_latency_ms, stats.open_failures,
+        stats.packets_sent, stats.packets_failed);
 }
 
 void DualNetworkBoard::SetPowerSaveLevel(PowerSaveLevel level) {
-    current_board_->SetPowerSaveLevel(level);
+    // 热备模式下备用的WiFi也跟随省电设置
+    if (wifi_board_) {
+        wifi_board_->SetPowerSaveLevel(level);
+    }
+    if (ml307_board_) {
+        ml307_board_->SetPowerSaveLevel(level);
+    }
 }
 
-std::string DualNetworkBoard::GetBoardJson() {   
-    return current_board_->GetBoardJson();
+std::string DualNetworkBoard::GetBoardJson() {
+    return current_board_.load()->GetBoardJson();
 }
 
 std::string DualNetworkBoard::GetDeviceStatusJson() {
-    return current_board_->GetDeviceStatusJson();
+    return current_board_.load()->GetDeviceStatusJson();
 }
@@ -4,7 +4,10 @@
 #include "board.h"
 #include "wifi_board.h"
 #include "ml307_board.h"
+#include "link_monitor.h"
 #include <memory>
+#include <atomic>
+#include <mutex>
 
 //enum NetworkType
 enum class NetworkType {
@@ -13,48 +16,72 @@ enum class NetworkType {
 };
 
 // 双网络板卡类，可以在WiFi和ML307之间切换
+// 启用CONFIG_DUAL_NETWORK_HOT_FAILOVER时两个网络同时在线，根据链路质量自动切换，无需重启
 class DualNetworkBoard : public Board {
 private:
-    // 使用基类指针存储当前活动的板卡
-    std::unique_ptr<Board> current_board_;
-    NetworkType network_type_ = NetworkType::ML307;  // Default to ML307
+    // 普通模式只创建当前网络类型的板卡，热备模式两个都创建
+    std::unique_ptr<WifiBoard> wifi_board_;
+    std::unique_ptr<Ml307Board> ml307_board_;
+    // 当前活动的板卡
+    std::atomic<Board*> current_board_ = nullptr;
+    std::atomic<NetworkType> network_type_ = NetworkType::ML307;  // Default to ML307
 
     // ML307的引脚配置
     gpio_num_t ml307_tx_pin_;
     gpio_num_t ml307_rx_pin_;
     gpio_num_t ml307_dtr_pin_;
-    
+
+    // 热备模式的状态，mutex_保护链路监测和活动网络的切换
+    std::mutex mutex_;
+    LinkMonitor link_monitor_;
+    NetworkEventCallback network_event_callback_;
+    // 没有配置WiFi且4G不可用时已让WiFi进入配网模式
+    std::atomic<bool> wifi_config_fallback_ = false;
+
     // 从Settings加载网络类型
     NetworkType LoadNetworkTypeFromSettings(int32_t default_net_type);
-    
+
     // 保存网络类型到Settings
     void SaveNetworkTypeToSettings(NetworkType type);
 
     // 初始化当前网络类型对应的板卡
     void InitializeCurrentBoard();
- 
+
+    // 热备模式：初始化两个板卡，当前网络类型作为首选网络
+    void InitializeBothBoards();
+    // 热备模式：处理两个板卡的网络事件，备用网络的事件不转发给应用
+    void OnNetworkEvent(NetworkType type, NetworkEvent event, const std::string& data);
+    // 热备模式：定期采样信号强度并决定是否切换
+    void LinkMonitorTask();
+    void SwitchActiveNetwork(NetworkType type);
+    bool IsNetworkReady(NetworkType type);
+    // 热备模式：4G出错时，如果没有配置WiFi，进入配网模式，否则设备无法联网也无法配网
+    void StartWifiConfigFallback();
+    Board* GetBoard(NetworkType type) const;
+
 public:
     DualNetworkBoard(gpio_num_t ml307_tx_pin, gpio_num_t ml307_rx_pin, gpio_num_t ml307_dtr_pin = GPIO_NUM_NC, int32_t default_net_type = 1);
     virtual ~DualNetworkBoard() = default;
- 
-    // 切换网络类型
+
+    // 切换网络类型，热备模式下切换首选网络
     void SwitchNetworkType();
-    
+
     // 获取当前网络类型
     NetworkType GetNetworkType() const { return network_type_; }
-    
+
     // 获取当前活动的板卡引用
-    Board& GetCurrentBoard() const { return *current_board_; }
-    
+    Board& GetCurrentBoard() const { return *current_board_.load(); }
+
     // 重写Board接口
     virtual std::string GetBoardType() override;
     virtual void StartNetwork() override;
     virtual void SetNetworkEventCallback(NetworkEventCallback callback) override;
     virtual NetworkInterface* GetNetwork() override;
     virtual const char* GetNetworkStateIcon() override;
+    virtual void ReportLinkStats(const LinkStats& stats) override;
     virtual void SetPowerSaveLevel(PowerSaveLevel level) override;
     virtual std::string GetBoardJson() override;
     virtual std::string GetDeviceStatusJson() override;
 };
 
-#endif // DUAL_NETWORK_BOARD_H 
\ No newline at end of file
+#endif // DUAL_NETWORK_BOARD_H
@@ -12,6 +12,7 @@
 #include "lvgl_display.h"
 #include "mcp_server.h"
 #include "system_info.h"
+#include "sample_format.h"
 #include "jpg/image_to_jpeg.h"
 #include "esp_timer.h"
 
@@ -85,10 +86,8 @@ bool Esp32Camera::Capture() {
 
         uint16_t *src = (uint16_t *)current_fb_->buf;
         uint16_t *dst = (uint16_t *)preview_data;
-        for (size_t i = 0; i < pixel_count; i++) {
-            // Copy data from driver buffer to preview buffer with byte swapping
-            dst[i] = __builtin_bswap16(src[i]);
-        }
+        // Copy data from driver buffer to preview buffer with byte swapping
+        sample_format::ByteSwap16(src, dst, pixel_count);
 
         // Display preview image
         auto display = dynamic_cast<LvglDisplay *>(Board::GetInstance().GetDisplay());
@@ -135,6 +134,30 @@ std::string Esp32Camera::Explain(const std::string &question) {
         throw std::runtime_error("No camera frame captured");
     }
 
+    // Reuse the last answer if the same question is asked about an unchanged scene
+    switch (current_fb_->format) {
+        case PIXFORMAT_RGB565:
+            scene_detector_.Update(current_fb_->buf, current_fb_->len, current_fb_->width, current_fb_->height, kSceneFrameRgb565Be);
+            break;
+        case PIXFORMAT_YUV422:
+            scene_detector_.Update(current_fb_->buf, current_fb_->len, current_fb_->width, current_fb_->height, kSceneFrameYuyv);
+            break;
+        case PIXFORMAT_GRAYSCALE:
+            scene_detector_.Update(current_fb_->buf, current_fb_->len, current_fb_->width, current_fb_->height, kSceneFrameGrey);
+            break;
+        case PIXFORMAT_RGB888:
+            scene_detector_.Update(current_fb_->buf, current_fb_->len, current_fb_->width, current_fb_->height, kSceneFrameRgb888);
+            break;
+        default:
+            scene_detector_.Reset();
+            break;
+    }
+    std::string cached_answer;
+    if (scene_detector_.GetCachedAnswer(question, cached_answer)) {
+        ESP_LOGI(TAG, "Scene unchanged (score=%d), reuse the last answer", scene_detector_.score());
+        return cached_answer;
+    }
+
     // Create local JPEG queue
     QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
     if (jpeg_queue == nullptr) {
@@ -172,7 +195,7 @@ std::string Esp32Camera::Explain(const std::string &question) {
                 return;
         }
 
-        bool ok = image_to_jpeg_cb(current_fb_->buf, current_fb_->len, w, h, enc_fmt, 80,
+        bool ok = image_to_jpeg_scaled_cb(current_fb_->buf, current_fb_->len, w, h, enc_fmt, CONFIG_XIAOZHI_CAMERA_UPLOAD_MAX_SIZE, 80,
             [](void* arg, size_t index, const void* data, size_t len) -> size_t {
                 auto jpeg_queue = static_cast<QueueHandle_t>(arg);
                 JpegChunk chunk = {.data = nullptr, .len = len};
@@ -284,5 +307,6 @@ std::string Esp32Camera::Explain(const std::string &question) {
     size_t remain_stack_size = uxTaskGetStackHighWaterMark(nullptr);
     ESP_LOGI(TAG, "Explain image size=%dx%d, compressed size=%d, remain stack size=%d, question=%s\n%s",
              current_fb_->width, current_fb_->height, (int)total_sent, (int)remain_stack_size, question.c_str(), result.c_str());
+    scene_detector_.CacheAnswer(question, result);
     return result;
 }
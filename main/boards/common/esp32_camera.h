@@ -10,6 +10,7 @@
 #include <freertos/queue.h>
 
 #include "camera.h"
+#include "scene_change_detector.h"
 #include "esp_camera.h"
 #include "jpg/image_to_jpeg.h"
 
@@ -27,6 +28,7 @@ private:
     std::string explain_token_;
     std::thread encoder_thread_;
     camera_fb_t *current_fb_ = nullptr;
+    SceneChangeDetector scene_detector_{CONFIG_XIAOZHI_CAMERA_SCENE_CHANGE_THRESHOLD};
 
 public:
     Esp32Camera(const camera_config_t &config);
@@ -7,8 +7,12 @@
 #include <unistd.h>
 #include <errno.h>
 #include <esp_heap_caps.h>
+#include <esp_cache.h>
+#include <esp_timer.h>
+#include <freertos/semphr.h>
 #include <cstdio>
 #include <cstring>
+#include <algorithm>
 
 #include "esp_imgfx_color_convert.h"
 #include "esp_video_device.h"
@@ -24,6 +28,7 @@
 #include "lvgl_display.h"
 #include "mcp_server.h"
 #include "system_info.h"
+#include "sample_format.h"
 
 #ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_DEBUG_MODE
 #undef LOG_LOCAL_LEVEL
@@ -55,6 +60,7 @@
 
 
 #define TAG "EspVideo"
+#define LIVE_PREVIEW_FPS 5
 
 #if defined(CONFIG_CAMERA_SENSOR_SWAP_PIXEL_BYTE_ORDER) || defined(CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP)
 #warning \
@@ -363,6 +369,13 @@ EspVideo::EspVideo(const esp_video_init_config_t& config) {
 }
 
 EspVideo::~EspVideo() {
+    SetLivePreview(false);
+    StopStreaming();
+    {
+        // Frames released from now on must not queue their buffer on the closed device
+        std::lock_guard<std::mutex> lock(stream_state_->mutex);
+        stream_state_->fd = -1;
+    }
     if (streaming_on_ && video_fd_ >= 0) {
         int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
         ioctl(video_fd_, VIDIOC_STREAMOFF, &type);
@@ -394,6 +407,14 @@ bool EspVideo::Capture() {
         return false;
     }
 
+    // The stream task owns the V4L2 queue while streaming, take the next streamed frame instead
+    if (stream_running_) {
+        if (!CaptureStreamFrame()) {
+            return false;
+        }
+        return ShowPreview({frame_.data, frame_.len, frame_.width, frame_.height, frame_.format});
+    }
+
     for (int i = 0; i < 3; i++) {
         struct v4l2_buffer buf = {};
         buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -443,9 +464,7 @@ bool EspVideo::Capture() {
                     auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
                     auto dst16 = (uint16_t*)frame_.data;
                     size_t count = (size_t)mmap_buffers_[buf.index].length / 2;
-                    for (size_t i = 0; i < count; i++) {
-                        dst16[i] = __builtin_bswap16(src16[i]);
-                    }
+                    sample_format::ByteSwap16(src16, dst16, count);
                 }
 #else
                     memcpy(frame_.data, mmap_buffers_[buf.index].start,
@@ -461,9 +480,7 @@ bool EspVideo::Capture() {
                         auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
                         auto dst16 = (uint16_t*)frame_.data;
                         size_t count = (size_t)mmap_buffers_[buf.index].length / 2;
-                        for (size_t i = 0; i < count; i++) {
-                            dst16[i] = __builtin_bswap16(src16[i]);
-                        }
+                        sample_format::ByteSwap16(src16, dst16, count);
                     }
 #else
                     memcpy(frame_.data, mmap_buffers_[buf.index].start,
@@ -477,9 +494,7 @@ bool EspVideo::Capture() {
                     auto src16 = (uint16_t*)mmap_buffers_[buf.index].start;
                     auto dst16 = (uint16_t*)frame_.data;
                     size_t pixel_count = (size_t)frame_.width * (size_t)frame_.height;
-                    for (size_t i = 0; i < pixel_count; i++) {
-                        dst16[i] = __builtin_bswap16(src16[i]);
-                    }
+                    sample_format::ByteSwap16(src16, dst16, pixel_count);
                     frame_.format = V4L2_PIX_FMT_RGB565;
                     break;
                 }
@@ -729,21 +744,25 @@ bool EspVideo::Capture() {
         }
     }
 
+    return ShowPreview({frame_.data, frame_.len, frame_.width, frame_.height, frame_.format});
+}
+
+bool EspVideo::ShowPreview(const VideoFrame& frame) {
     // 显示预览图片
     auto display = dynamic_cast<LvglDisplay*>(Board::GetInstance().GetDisplay());
     if (display != nullptr) {
-        if (!frame_.data) {
+        if (!frame.data) {
             ESP_LOGE(TAG, "frame.data is null");
             return false;
         }
-        uint16_t w = frame_.width;
-        uint16_t h = frame_.height;
-        size_t lvgl_image_size = frame_.len;
+        uint16_t w = frame.width;
+        uint16_t h = frame.height;
+        size_t lvgl_image_size = frame.len;
         size_t stride = ((w * 2) + 3) & ~3;  // 4字节对齐
         lv_color_format_t color_format = LV_COLOR_FORMAT_RGB565;
         uint8_t* data = nullptr;
 
-        switch (frame_.format) {
+        switch (frame.format) {
             // LVGL 显示 YUV 系的图像似乎都有问题，暂时转换为 RGB565 显示
             case V4L2_PIX_FMT_YUYV:
             case V4L2_PIX_FMT_YUV420:
@@ -755,9 +774,9 @@ bool EspVideo::Capture() {
                     return false;
                 }
                 esp_imgfx_color_convert_cfg_t convert_cfg = {
-                    .in_res = {.width = static_cast<int16_t>(frame_.width),
-                               .height = static_cast<int16_t>(frame_.height)},
-                    .in_pixel_fmt = static_cast<esp_imgfx_pixel_fmt_t>(frame_.format),
+                    .in_res = {.width = static_cast<int16_t>(frame.width),
+                               .height = static_cast<int16_t>(frame.height)},
+                    .in_pixel_fmt = static_cast<esp_imgfx_pixel_fmt_t>(frame.format),
                     .out_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE,
                     .color_space_std = ESP_IMGFX_COLOR_SPACE_STD_BT601,
                 };
@@ -770,8 +789,8 @@ bool EspVideo::Capture() {
                     return false;
                 }
                 esp_imgfx_data_t convert_input_data = {
-                    .data = frame_.data,
-                    .data_len = frame_.len,
+                    .data = (uint8_t*)frame.data,
+                    .data_len = frame.len,
                 };
                 esp_imgfx_data_t convert_output_data = {
                     .data = data,
@@ -798,8 +817,8 @@ bool EspVideo::Capture() {
                     ESP_LOGE(TAG, "Failed to allocate memory for preview image");
                     return false;
                 }
-                memcpy(data, frame_.data, frame_.len);
-                lvgl_image_size = frame_.len;  // fallthrough 时兼顾 YUYV 与 RGB565
+                memcpy(data, frame.data, frame.len);
+                lvgl_image_size = frame.len;  // fallthrough 时兼顾 YUYV 与 RGB565
                 break;
 
 #ifdef CONFIG_XIAOZHI_CAMERA_ALLOW_JPEG_INPUT
@@ -811,7 +830,7 @@ bool EspVideo::Capture() {
                 size_t out_stride = 0;
 
                 esp_err_t ret =
-                    jpeg_to_image(frame_.data, frame_.len, &out_data, &out_len, &out_width, &out_height, &out_stride);
+                    jpeg_to_image(frame.data, frame.len, &out_data, &out_len, &out_width, &out_height, &out_stride);
                 if (ret != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to decode JPEG image: %d (%s)", (int)ret, esp_err_to_name(ret));
                     if (out_data) {
@@ -830,7 +849,7 @@ bool EspVideo::Capture() {
             }
 #endif
             default:
-                ESP_LOGE(TAG, "unsupported frame format: 0x%08lx", frame_.format);
+                ESP_LOGE(TAG, "unsupported frame format: 0x%08lx", frame.format);
                 return false;
         }
 
@@ -840,6 +859,460 @@ bool EspVideo::Capture() {
     return true;
 }
 
+bool EspVideo::StartStreaming(int fps) {
+    if (!streaming_on_ || video_fd_ < 0 || fps <= 0) {
+        return false;
+    }
+    stream_interval_us_ = 1000000 / fps;
+    if (stream_running_) {
+        ESP_LOGI(TAG, "Stream frame rate changed to %d fps", fps);
+        return true;
+    }
+    {
+        std::lock_guard<std::mutex> lock(stream_state_->mutex);
+        if (stream_state_->outstanding > 0) {
+            ESP_LOGE(TAG, "%d frames of the previous stream are still held", stream_state_->outstanding);
+            return false;
+        }
+        stream_state_->fd = video_fd_;
+    }
+
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+    // Rotated frames are written into a small pool allocated once, instead of per capture
+#ifdef CONFIG_SOC_PPA_SUPPORTED
+    if (sensor_format_ != V4L2_PIX_FMT_RGB565 && sensor_format_ != V4L2_PIX_FMT_RGB24) {
+        ESP_LOGE(TAG, "unsupported sensor format for streaming with PPA rotation: 0x%08lx", sensor_format_);
+        return false;
+    }
+    size_t buffer_size = frame_.width * frame_.height * 2;
+    ppa_client_config_t client_cfg = {
+        .oper_type = PPA_OPERATION_SRM,
+        .max_pending_trans_num = 1,
+    };
+    ppa_client_handle_t ppa_client = nullptr;
+    if (ppa_register_client(&client_cfg, &ppa_client) != ESP_OK || ppa_client == nullptr) {
+        ESP_LOGE(TAG, "ppa_register_client failed");
+        return false;
+    }
+    ppa_client_ = ppa_client;
+#else
+    esp_imgfx_rotate_cfg_t rotate_cfg = {
+        .in_res =
+            {
+                .width = static_cast<int16_t>(sensor_width_),
+                .height = static_cast<int16_t>(sensor_height_),
+            },
+        .degree = IMAGE_ROTATION_ANGLE,
+    };
+    switch (sensor_format_) {
+        case V4L2_PIX_FMT_RGB565:
+        case V4L2_PIX_FMT_RGB565X:
+        case V4L2_PIX_FMT_YUV422P:
+        case V4L2_PIX_FMT_YUYV:
+            rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB565_LE;
+            break;
+        case V4L2_PIX_FMT_GREY:
+            rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_Y;
+            break;
+        case V4L2_PIX_FMT_RGB24:
+            rotate_cfg.in_pixel_fmt = ESP_IMGFX_PIXEL_FMT_RGB888;
+            break;
+        default:
+            ESP_LOGE(TAG, "unsupported sensor format for streaming with rotation: 0x%08lx", sensor_format_);
+            return false;
+    }
+    size_t buffer_size = mmap_buffers_[0].length;
+    esp_imgfx_rotate_handle_t rotate_handle = nullptr;
+    if (esp_imgfx_rotate_open(&rotate_cfg, &rotate_handle) != ESP_IMGFX_ERR_OK || rotate_handle == nullptr) {
+        ESP_LOGE(TAG, "esp_imgfx_rotate_open failed");
+        return false;
+    }
+    rotate_handle_ = rotate_handle;
+#endif  // CONFIG_SOC_PPA_SUPPORTED
+    for (auto& buffer : stream_state_->buffers) {
+        buffer.data = (uint8_t*)heap_caps_malloc(buffer_size,
+                                                 MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT | MALLOC_CAP_CACHE_ALIGNED);
+        if (buffer.data == nullptr) {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes for stream buffer", buffer_size);
+            ReleaseStreamBuffers();
+            return false;
+        }
+        buffer.size = buffer_size;
+        buffer.in_use = false;
+    }
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+
+    stream_state_->stopped = false;
+    stream_running_ = true;
+    if (xTaskCreate(
+            [](void* arg) {
+                EspVideo* self = static_cast<EspVideo*>(arg);
+                self->StreamTask();
+                vTaskDelete(NULL);
+            },
+            "camera_stream", 6144, this, 2, &stream_task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create camera stream task");
+        stream_running_ = false;
+        ReleaseStreamBuffers();
+        return false;
+    }
+    ESP_LOGI(TAG, "Camera streaming started at %d fps", fps);
+    return true;
+}
+
+void EspVideo::StopStreaming() {
+    if (!stream_running_) {
+        return;
+    }
+    stream_running_ = false;
+    // The stream task exits after its current DQBUF returns, it only dequeues while the driver holds a buffer
+    while (stream_task_ != nullptr) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    ReleaseStreamBuffers();
+    ESP_LOGI(TAG, "Camera streaming stopped");
+}
+
+void EspVideo::ReleaseStreamBuffers() {
+    auto state = stream_state_;
+    std::unique_lock<std::mutex> lock(state->mutex);
+    // Give the listeners a moment to release their frames, so the buffers are back in the driver for Capture()
+    if (!state->released.wait_for(lock, std::chrono::seconds(1), [&state] { return state->outstanding == 0; })) {
+        ESP_LOGW(TAG, "%d stream frames are still held after stop", state->outstanding);
+    }
+    state->stopped = true;
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+    for (auto& buffer : state->buffers) {
+        // A buffer still referenced by a frame is freed when that frame is released
+        if (!buffer.in_use && buffer.data != nullptr) {
+            heap_caps_free(buffer.data);
+            buffer.data = nullptr;
+            buffer.size = 0;
+        }
+    }
+#ifdef CONFIG_SOC_PPA_SUPPORTED
+    if (ppa_client_ != nullptr) {
+        (void)ppa_unregister_client(static_cast<ppa_client_handle_t>(ppa_client_));
+        ppa_client_ = nullptr;
+    }
+#else
+    if (rotate_handle_ != nullptr) {
+        esp_imgfx_rotate_close(static_cast<esp_imgfx_rotate_handle_t>(rotate_handle_));
+        rotate_handle_ = nullptr;
+    }
+#endif  // CONFIG_SOC_PPA_SUPPORTED
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+}
+
+int EspVideo::AddFrameListener(VideoFrameCallback callback) {
+    std::lock_guard<std::mutex> lock(listeners_mutex_);
+    int id = next_listener_id_++;
+    frame_listeners_.emplace_back(id, std::move(callback));
+    return id;
+}
+
+void EspVideo::RemoveFrameListener(int id) {
+    {
+        std::lock_guard<std::mutex> lock(listeners_mutex_);
+        frame_listeners_.erase(std::remove_if(frame_listeners_.begin(), frame_listeners_.end(),
+                                              [id](const auto& listener) { return listener.first == id; }),
+                               frame_listeners_.end());
+    }
+    // Wait for a frame that is being delivered, the stream task takes its listener snapshot under
+    // dispatch_mutex_, so the callback is not running after this returns.
+    // A listener removing itself from the stream task must not wait for its own dispatch.
+    if (xTaskGetCurrentTaskHandle() != stream_task_) {
+        std::lock_guard<std::mutex> lock(dispatch_mutex_);
+    }
+}
+
+void EspVideo::StreamTask() {
+    auto state = stream_state_;
+    int64_t next_frame_time = 0;
+    while (stream_running_) {
+#ifndef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+        {
+            // Every buffer is held by a frame handle, DQBUF would block until one is released
+            std::unique_lock<std::mutex> lock(state->mutex);
+            if (state->outstanding >= (int)mmap_buffers_.size()) {
+                state->released.wait_for(lock, std::chrono::milliseconds(100));
+                continue;
+            }
+        }
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+        struct v4l2_buffer buf = {};
+        buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+        buf.memory = V4L2_MEMORY_MMAP;
+        if (ioctl(video_fd_, VIDIOC_DQBUF, &buf) != 0) {
+            ESP_LOGE(TAG, "VIDIOC_DQBUF failed in stream");
+            vTaskDelay(pdMS_TO_TICKS(10));
+            continue;
+        }
+
+        int64_t now = esp_timer_get_time();
+        // Held from the snapshot to the end of the dispatch, so a listener removed after the snapshot is
+        // not called once RemoveFrameListener returns
+        std::lock_guard<std::mutex> dispatch_lock(dispatch_mutex_);
+        std::vector<std::pair<int, VideoFrameCallback>> listeners;
+        {
+            std::lock_guard<std::mutex> lock(listeners_mutex_);
+            listeners = frame_listeners_;
+        }
+        // Frame rate control: hand the buffer straight back if nobody listens or it is too early
+        if (listeners.empty() || now < next_frame_time) {
+            if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
+                ESP_LOGE(TAG, "VIDIOC_QBUF failed in stream");
+            }
+            continue;
+        }
+        int64_t interval = stream_interval_us_;
+        next_frame_time = (now - next_frame_time > interval) ? now + interval : next_frame_time + interval;
+
+        auto frame = WrapStreamBuffer(buf, now);
+        if (!frame) {
+            continue;
+        }
+        // The listeners run on a copy of the list without listeners_mutex_, so they can add or remove listeners
+        for (auto& listener : listeners) {
+            listener.second(frame);
+        }
+    }
+    stream_task_ = nullptr;
+}
+
+VideoFrameHandle EspVideo::WrapStreamBuffer(struct v4l2_buffer& buf, int64_t timestamp_us) {
+    auto& mmap_buffer = mmap_buffers_[buf.index];
+    uint8_t* data = (uint8_t*)mmap_buffer.start;
+    size_t len = MIN((size_t)buf.bytesused, mmap_buffer.length);
+
+    v4l2_pix_fmt_t format = sensor_format_;
+    bool swap_bytes = false;
+#ifdef CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
+    swap_bytes = true;
+#endif  // CONFIG_XIAOZHI_ENABLE_CAMERA_ENDIANNESS_SWAP
+    if (format == V4L2_PIX_FMT_RGB565X) {
+        swap_bytes = true;
+        format = V4L2_PIX_FMT_RGB565;
+    } else if (format == V4L2_PIX_FMT_YUV422P) {
+        // 这个格式是 422 YUYV，不是 planer
+        format = V4L2_PIX_FMT_YUYV;
+    }
+
+    bool swap_in_place = swap_bytes;
+#if defined(CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE) && defined(CONFIG_SOC_PPA_SUPPORTED)
+    // The PPA swaps RGB565 in the same pass as the rotation and reads the mmap buffer as is
+    swap_in_place = swap_bytes && format != V4L2_PIX_FMT_RGB565;
+#endif
+    if (swap_in_place) {
+        // Swap in place instead of copying the frame, and write it back before the driver reuses the buffer
+        auto data16 = (uint16_t*)data;
+        sample_format::ByteSwap16(data16, data16, len / 2);
+        esp_cache_msync(data, mmap_buffer.length, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+    }
+
+    auto frame = new VideoFrame();
+    frame->timestamp_us = timestamp_us;
+
+    auto state = stream_state_;
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+    // Rotate into a stream buffer so the mmap buffer can go back to the driver right away
+    StreamBuffer* dst = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        for (auto& buffer : state->buffers) {
+            if (!buffer.in_use && buffer.data != nullptr) {
+                buffer.in_use = true;
+                dst = &buffer;
+                break;
+            }
+        }
+    }
+    bool rotated = dst != nullptr && RotateStreamFrame(data, len, format, swap_bytes, *frame, *dst);
+    if (ioctl(video_fd_, VIDIOC_QBUF, &buf) != 0) {
+        ESP_LOGE(TAG, "VIDIOC_QBUF failed in stream");
+    }
+    if (!rotated) {
+        // All rotated frames are still held by listeners, or the rotation failed, drop this frame
+        if (dst != nullptr) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            dst->in_use = false;
+        }
+        delete frame;
+        return nullptr;
+    }
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->outstanding++;
+    }
+    return VideoFrameHandle(frame, [state, dst](const VideoFrame* frame) {
+        delete frame;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        dst->in_use = false;
+        if (state->stopped) {
+            heap_caps_free(dst->data);
+            dst->data = nullptr;
+            dst->size = 0;
+        }
+        state->outstanding--;
+        state->released.notify_all();
+    });
+#else
+    frame->data = data;
+    frame->len = len;
+    frame->width = frame_.width;
+    frame->height = frame_.height;
+    frame->format = format;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->outstanding++;
+    }
+    uint32_t index = buf.index;
+    return VideoFrameHandle(frame, [state, index](const VideoFrame* frame) {
+        delete frame;
+        std::lock_guard<std::mutex> lock(state->mutex);
+        // The device is closed when the camera is destroyed, the buffer is gone with it
+        if (state->fd >= 0) {
+            struct v4l2_buffer buf = {};
+            buf.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            buf.memory = V4L2_MEMORY_MMAP;
+            buf.index = index;
+            if (ioctl(state->fd, VIDIOC_QBUF, &buf) != 0) {
+                ESP_LOGE(TAG, "VIDIOC_QBUF failed on frame release");
+            }
+        }
+        state->outstanding--;
+        state->released.notify_all();
+    });
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+}
+
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+bool EspVideo::RotateStreamFrame(const uint8_t* src, size_t len, v4l2_pix_fmt_t format, bool swap_bytes,
+                                 VideoFrame& frame, StreamBuffer& dst) {
+#ifdef CONFIG_SOC_PPA_SUPPORTED
+    ppa_srm_oper_config_t srm_cfg = {};
+    srm_cfg.in.buffer = (void*)src;
+    srm_cfg.in.pic_w = sensor_width_;
+    srm_cfg.in.pic_h = sensor_height_;
+    srm_cfg.in.block_w = sensor_width_;
+    srm_cfg.in.block_h = sensor_height_;
+    srm_cfg.in.srm_cm = format == V4L2_PIX_FMT_RGB24 ? PPA_SRM_COLOR_MODE_RGB888 : PPA_SRM_COLOR_MODE_RGB565;
+
+    srm_cfg.out.buffer = (void*)dst.data;
+    srm_cfg.out.buffer_size = dst.size;
+    srm_cfg.out.pic_w = frame_.width;
+    srm_cfg.out.pic_h = frame_.height;
+    srm_cfg.out.srm_cm = PPA_SRM_COLOR_MODE_RGB565;
+
+    srm_cfg.scale_x = 1.0f;
+    srm_cfg.scale_y = 1.0f;
+    srm_cfg.rotation_angle = IMAGE_ROTATION_ANGLE;
+    srm_cfg.byte_swap = swap_bytes && format == V4L2_PIX_FMT_RGB565;
+    srm_cfg.mode = PPA_TRANS_MODE_BLOCKING;
+
+    esp_err_t err = ppa_do_scale_rotate_mirror(static_cast<ppa_client_handle_t>(ppa_client_), &srm_cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ppa_do_scale_rotate_mirror failed: %d", (int)err);
+        return false;
+    }
+    frame.len = frame_.width * frame_.height * 2;
+    frame.format = V4L2_PIX_FMT_RGB565;
+#else
+    esp_imgfx_data_t input_data = {
+        .data = (uint8_t*)src,
+        .data_len = len,
+    };
+    esp_imgfx_data_t output_data = {
+        .data = dst.data,
+        .data_len = dst.size,
+    };
+    esp_imgfx_err_t err = esp_imgfx_rotate_process(static_cast<esp_imgfx_rotate_handle_t>(rotate_handle_),
+                                                   &input_data, &output_data);
+    if (err != ESP_IMGFX_ERR_OK) {
+        ESP_LOGE(TAG, "esp_imgfx_rotate_process failed");
+        return false;
+    }
+    frame.len = len;
+    frame.format = format;
+#endif  // CONFIG_SOC_PPA_SUPPORTED
+    frame.data = dst.data;
+    frame.width = frame_.width;
+    frame.height = frame_.height;
+    return true;
+}
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+
+bool EspVideo::CaptureStreamFrame() {
+    SemaphoreHandle_t done = xSemaphoreCreateBinary();
+    if (done == nullptr) {
+        return false;
+    }
+    bool copied = false;
+    bool success = false;
+    int id = AddFrameListener([this, done, &copied, &success](const VideoFrameHandle& frame) {
+        if (copied) {
+            return;
+        }
+        copied = true;
+        if (frame_.data == nullptr || frame_.len != frame->len) {
+            if (frame_.data) {
+                heap_caps_free(frame_.data);
+            }
+            frame_.len = frame->len;
+            frame_.data = (uint8_t*)heap_caps_malloc(frame_.len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        }
+        if (frame_.data != nullptr) {
+            memcpy(frame_.data, frame->data, frame->len);
+            frame_.format = frame->format;
+            success = true;
+        } else {
+            ESP_LOGE(TAG, "alloc frame copy failed: need allocate %u bytes", frame->len);
+            frame_.len = 0;
+        }
+        xSemaphoreGive(done);
+    });
+    if (xSemaphoreTake(done, pdMS_TO_TICKS(3000)) != pdTRUE) {
+        ESP_LOGE(TAG, "Timeout waiting for stream frame");
+    }
+    RemoveFrameListener(id);
+    vSemaphoreDelete(done);
+    return success;
+}
+
+bool EspVideo::HasLivePreview() {
+#if CONFIG_USE_WECHAT_MESSAGE_STYLE
+    // Every preview image becomes a chat bubble in this style
+    return false;
+#else
+    return dynamic_cast<LvglDisplay*>(Board::GetInstance().GetDisplay()) != nullptr;
+#endif
+}
+
+bool EspVideo::SetLivePreview(bool enabled) {
+    if (!enabled) {
+        if (preview_listener_id_ != 0) {
+            RemoveFrameListener(preview_listener_id_);
+            preview_listener_id_ = 0;
+            StopStreaming();
+        }
+        return true;
+    }
+    if (!HasLivePreview()) {
+        return false;
+    }
+    if (preview_listener_id_ != 0) {
+        return true;
+    }
+    if (!StartStreaming(LIVE_PREVIEW_FPS)) {
+        return false;
+    }
+    // ShowPreview() copies the frame into the LVGL image, so the buffer is released right away
+    preview_listener_id_ = AddFrameListener([this](const VideoFrameHandle& frame) {
+        ShowPreview(*frame);
+    });
+    return true;
+}
+
 bool EspVideo::SetHMirror(bool enabled) {
     if (video_fd_ < 0)
         return false;
@@ -902,6 +1375,30 @@ std::string EspVideo::Explain(const std::string& question) {
         throw std::runtime_error("Image explain URL or token is not set");
     }
 
+    // Reuse the last answer if the same question is asked about an unchanged scene
+    switch (frame_.format) {
+        case V4L2_PIX_FMT_RGB565:
+            scene_detector_.Update(frame_.data, frame_.len, frame_.width, frame_.height, kSceneFrameRgb565);
+            break;
+        case V4L2_PIX_FMT_RGB24:
+            scene_detector_.Update(frame_.data, frame_.len, frame_.width, frame_.height, kSceneFrameRgb888);
+            break;
+        case V4L2_PIX_FMT_YUYV:
+            scene_detector_.Update(frame_.data, frame_.len, frame_.width, frame_.height, kSceneFrameYuyv);
+            break;
+        case V4L2_PIX_FMT_GREY:
+            scene_detector_.Update(frame_.data, frame_.len, frame_.width, frame_.height, kSceneFrameGrey);
+            break;
+        default:
+            scene_detector_.Reset();
+            break;
+    }
+    std::string cached_answer;
+    if (scene_detector_.GetCachedAnswer(question, cached_answer)) {
+        ESP_LOGI(TAG, "Scene unchanged (score=%d), reuse the last answer", scene_detector_.score());
+        return cached_answer;
+    }
+
     // 创建局部的 JPEG 队列, 40 entries is about to store 512 * 40 = 20480 bytes of JPEG data
     QueueHandle_t jpeg_queue = xQueueCreate(40, sizeof(JpegChunk));
     if (jpeg_queue == nullptr) {
@@ -914,8 +1411,8 @@ std::string EspVideo::Explain(const std::string& question) {
         uint16_t w = frame_.width ? frame_.width : 320;
         uint16_t h = frame_.height ? frame_.height : 240;
         v4l2_pix_fmt_t enc_fmt = frame_.format;
-        bool ok = image_to_jpeg_cb(
-            frame_.data, frame_.len, w, h, enc_fmt, 80,
+        bool ok = image_to_jpeg_scaled_cb(
+            frame_.data, frame_.len, w, h, enc_fmt, CONFIG_XIAOZHI_CAMERA_UPLOAD_MAX_SIZE, 80,
             [](void* arg, size_t index, const void* data, size_t len) -> size_t {
                 auto jpeg_queue = static_cast<QueueHandle_t>(arg);
                 JpegChunk chunk = {.data = nullptr, .len = len};
@@ -1037,5 +1534,6 @@ std::string EspVideo::Explain(const std::string& question) {
     size_t remain_stack_size = uxTaskGetStackHighWaterMark(nullptr);
     ESP_LOGI(TAG, "Explain image size=%d bytes, compressed size=%d, remain stack size=%d, question=%s\n%s",
              (int)frame_.len, (int)total_sent, (int)remain_stack_size, question.c_str(), result.c_str());
+    scene_detector_.CacheAnswer(question, result);
     return result;
 }
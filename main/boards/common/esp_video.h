@@ -5,11 +5,18 @@
 #include <thread>
 #include <memory>
 #include <vector>
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/task.h>
 
 #include "camera.h"
+#include "scene_change_detector.h"
 #include "jpg/image_to_jpeg.h"
 #include "esp_video_init.h"
 
@@ -18,6 +25,21 @@ struct JpegChunk {
     size_t len;
 };
 
+// A frame delivered by the streaming mode. It references the V4L2 mmap buffer (or a rotated
+// stream buffer) directly, the buffer goes back to the driver when the last handle is released.
+// Subscribers should release the handle quickly or copy the data, the driver only has 1-2 buffers,
+// and release it before the camera is destroyed.
+struct VideoFrame {
+    const uint8_t* data = nullptr;
+    size_t len = 0;
+    uint16_t width = 0;
+    uint16_t height = 0;
+    v4l2_pix_fmt_t format = 0;
+    int64_t timestamp_us = 0;
+};
+using VideoFrameHandle = std::shared_ptr<const VideoFrame>;
+using VideoFrameCallback = std::function<void(const VideoFrameHandle& frame)>;
+
 class EspVideo : public Camera {
 private:
     struct FrameBuffer {
@@ -39,6 +61,50 @@ private:
     std::string explain_url_;
     std::string explain_token_;
     std::thread encoder_thread_;
+    SceneChangeDetector scene_detector_{CONFIG_XIAOZHI_CAMERA_SCENE_CHANGE_THRESHOLD};
+
+    // Streaming mode
+    struct StreamBuffer {
+        uint8_t* data = nullptr;
+        size_t size = 0;
+        bool in_use = false;
+    };
+    // Shared with the frame handles, which may be released after the stream stopped or the device was closed
+    struct StreamState {
+        std::mutex mutex;
+        std::condition_variable released;
+        int fd = -1;
+        bool stopped = true;
+        int outstanding = 0;
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+        std::array<StreamBuffer, 2> buffers;
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+    };
+    std::shared_ptr<StreamState> stream_state_ = std::make_shared<StreamState>();
+    TaskHandle_t stream_task_ = nullptr;
+    std::atomic<bool> stream_running_{false};
+    std::atomic<int64_t> stream_interval_us_{0};
+    std::mutex listeners_mutex_;
+    // Held by the stream task while it calls the listeners
+    std::mutex dispatch_mutex_;
+    std::vector<std::pair<int, VideoFrameCallback>> frame_listeners_;
+    int next_listener_id_ = 1;
+    int preview_listener_id_ = 0;
+#ifdef CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+#ifdef CONFIG_SOC_PPA_SUPPORTED
+    void* ppa_client_ = nullptr;
+#else
+    void* rotate_handle_ = nullptr;
+#endif
+    bool RotateStreamFrame(const uint8_t* src, size_t len, v4l2_pix_fmt_t format, bool swap_bytes, VideoFrame& frame,
+                           StreamBuffer& dst);
+#endif  // CONFIG_XIAOZHI_ENABLE_ROTATE_CAMERA_IMAGE
+
+    void StreamTask();
+    VideoFrameHandle WrapStreamBuffer(struct v4l2_buffer& buf, int64_t timestamp_us);
+    void ReleaseStreamBuffers();
+    bool CaptureStreamFrame();
+    bool ShowPreview(const VideoFrame& frame);
 
 public:
     EspVideo(const esp_video_init_config_t& config);
@@ -50,4 +116,19 @@ public:
     virtual bool SetHMirror(bool enabled) override;
     virtual bool SetVFlip(bool enabled) override;
     virtual std::string Explain(const std::string& question);
+    virtual bool HasLivePreview() override;
+    virtual bool SetLivePreview(bool enabled) override;
+
+    /**
+     * Start continuous capture at the given frame rate and deliver frames to the listeners.
+     * Calling it again while streaming only changes the frame rate.
+     */
+    bool StartStreaming(int fps);
+    // Must not be called from a listener
+    void StopStreaming();
+    bool IsStreaming() const { return stream_running_; }
+    // Listeners are called in the stream task, returns an id for RemoveFrameListener
+    int AddFrameListener(VideoFrameCallback callback);
+    // The callback is not running any more when this returns, unless it is called from a listener
+    void RemoveFrameListener(int id);
 };
@@ -0,0 +1,93 @@
+#include "link_monitor.h"
+
+#include <algorithm>
+
+int LinkMonitor::RssiToSignal(int rssi) {
+    // -90 dBm is barely usable, -50 dBm and above is as good as it gets
+    return std::clamp((rssi + 90) * 100 / 40, 0, 100);
+}
+
+int LinkMonitor::CsqToSignal(int csq) {
+    // 99 means unknown
+    if (csq < 0 || csq > 31) {
+        return 0;
+    }
+    return csq * 100 / 31;
+}
+
+void LinkMonitor::UpdateSignal(Link link, int signal) {
+    links_[link].signal = signal < 0 ? -1 : std::min(signal, 100);
+}
+
+void LinkMonitor::UpdateTraffic(Link link, int open_latency_ms, int open_failures, int packets_sent, int packets_failed) {
+    auto& state = links_[link];
+    if (open_failures > 0) {
+        // A channel that cannot be opened is as bad as losing everything
+        open_latency_ms = config_.max_rtt_ms;
+        packets_failed += open_failures;
+    }
+    if (open_latency_ms >= 0) {
+        state.rtt_ms = state.rtt_ms < 0 ? open_latency_ms : (state.rtt_ms * 3 + open_latency_ms) / 4;
+    }
+    int total = packets_sent + packets_failed;
+    if (total > 0) {
+        state.loss_percent = (state.loss_percent * 3 + packets_failed * 100 / total) / 4;
+    }
+}
+
+int LinkMonitor::score(Link link) const {
+    auto& state = links_[link];
+    if (state.signal < 0) {
+        return -1;
+    }
+    int score = state.signal;
+    if (state.rtt_ms >= 0) {
+        score -= std::min(state.rtt_ms, config_.max_rtt_ms) * 30 / config_.max_rtt_ms;
+    }
+    score -= std::min(state.loss_percent, 50);
+    if (link == preferred_) {
+        score += config_.preferred_bonus;
+    }
+    return std::max(score, 0);
+}
+
+LinkMonitor::Decision LinkMonitor::Evaluate(Link active, int64_t now_us) {
+    Link standby = active == kLinkWifi ? kLinkCellular : kLinkWifi;
+
+    // Nothing is measured on the standby link, let its old losses fade out
+    links_[standby].loss_percent = links_[standby].loss_percent * 7 / 8;
+
+    if (!up(standby)) {
+        better_since_us_ = -1;
+        failing_since_us_ = -1;
+        return kDecisionStay;
+    }
+
+    if (!up(active) || links_[active].loss_percent >= config_.fail_loss_percent) {
+        if (failing_since_us_ < 0) {
+            failing_since_us_ = now_us;
+        }
+        if (now_us - failing_since_us_ >= config_.fail_ms * 1000LL) {
+            return kDecisionSwitchNow;
+        }
+    } else {
+        failing_since_us_ = -1;
+    }
+
+    if (score(standby) >= score(active) + config_.switch_margin) {
+        if (better_since_us_ < 0) {
+            better_since_us_ = now_us;
+        }
+        if (now_us - better_since_us_ >= config_.switch_hold_ms * 1000LL) {
+            return kDecisionSwitch;
+        }
+    } else {
+        better_since_us_ = -1;
+    }
+    return kDecisionStay;
+}
+
+void LinkMonitor::OnSwitched() {
+    better_since_us_ = -1;
+    failing_since_us_ = -1;
+}
@@ -0,0 +1,77 @@
+#ifndef LINK_MONITOR_H
+#define LINK_MONITOR_H
+
+#include <cstdint>
+
+/**
+ * Rates the Wi-Fi and cellular links of a dual network board and decides when to move to
+ * the other one.
+ *
+ * Each link gets a 0-100 signal score from RSSI/CSQ, lowered by the audio channel open latency
+ * and the audio packet loss measured while the link was active. The preferred link gets a bonus,
+ * so cellular data is only used when Wi-Fi is clearly worse. A better standby link has to stay
+ * better for `switch_hold_ms` before a switch is proposed, while an active link that is down or
+ * losing most packets for `fail_ms` asks for an immediate switch.
+ * Timestamps are passed in, so the monitor has no dependency on the platform.
+ */
+class LinkMonitor {
+public:
+    enum Link {
+        kLinkWifi,
+        kLinkCellular,
+        kLinkCount,
+    };
+
+    enum Decision {
+        kDecisionStay,
+        kDecisionSwitch,        // The standby link is better, switch when convenient
+        kDecisionSwitchNow,     // The active link is failing, switch even during a conversation
+    };
+
+    struct Config {
+        int preferred_bonus = 30;
+        int switch_margin = 10;
+        int switch_hold_ms = 15000;
+        int fail_ms = 3000;
+        int fail_loss_percent = 50;
+        int max_rtt_ms = 2000;      // Open latency rated as worst
+    };
+
+    static int RssiToSignal(int rssi);
+    static int CsqToSignal(int csq);
+
+    void SetConfig(const Config& config) { config_ = config; }
+    const Config& config() const { return config_; }
+    void SetPreferred(Link link) { preferred_ = link; }
+    Link preferred() const { return preferred_; }
+
+    // signal: 0-100, negative if the link is down
+    void UpdateSignal(Link link, int signal);
+    // Audio channel statistics of the link, open_latency_ms is negative if not measured
+    // and open_failures counts audio channels that could not be opened
+    void UpdateTraffic(Link link, int open_latency_ms, int open_failures, int packets_sent, int packets_failed);
+    Decision Evaluate(Link active, int64_t now_us);
+    // Start the timers over after the active link changed
+    void OnSwitched();
+
+    bool up(Link link) const { return links_[link].signal >= 0; }
+    // Negative if the link is down
+    int score(Link link) const;
+    int rtt_ms(Link link) const { return links_[link].rtt_ms; }
+    int loss_percent(Link link) const { return links_[link].loss_percent; }
+
+private:
+    struct LinkState {
+        int signal = -1;
+        int rtt_ms = -1;
+        int loss_percent = 0;
+    };
+
+    Config config_;
+    LinkState links_[kLinkCount];
+    Link preferred_ = kLinkWifi;
+    int64_t better_since_us_ = -1;
+    int64_t failing_since_us_ = -1;
+};
+
+#endif // LINK_MONITOR_H
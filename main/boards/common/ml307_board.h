@@ -33,6 +33,9 @@ public:
     virtual void SetPowerSaveLevel(PowerSaveLevel level) override;
     virtual AudioCodec* GetAudioCodec() override { return nullptr; }
     virtual std::string GetDeviceStatusJson() override;
+
+    // Null until the modem is detected
+    AtModem* GetModem() const { return modem_.get(); }
 };
 
 #endif // ML307_BOARD_H
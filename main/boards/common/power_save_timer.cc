@@ -25,6 +25,9 @@ PowerSaveTimer::PowerSaveTimer(int cpu_max_freq, int seconds_to_sleep, int secon
 PowerSaveTimer::~PowerSaveTimer() {
     esp_timer_stop(power_save_timer_);
     esp_timer_delete(power_save_timer_);
+    if (state_listener_id_ >= 0) {
+        Application::GetInstance().RemoveStateChangeListener(state_listener_id_);
+    }
 }
 
 void PowerSaveTimer::SetEnabled(bool enabled) {
@@ -76,17 +79,35 @@ void PowerSaveTimer::PowerSaveCheck() {
             }
 
             if (cpu_max_freq_ != -1) {
-                // Disable wake word detection
                 auto& audio_service = app.GetAudioService();
                 is_wake_word_running_ = audio_service.IsWakeWordRunning();
-                if (is_wake_word_running_) {
-                    audio_service.EnableWakeWordDetection(false);
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                }
-                // Disable audio input
-                auto codec = Board::GetInstance().GetAudioCodec();
-                if (codec) {
-                    codec->EnableInput(false);
+#if CONFIG_USE_LOW_POWER_WAKE_WORD
+                low_power_listening_ = is_wake_word_running_;
+#endif
+                if (low_power_listening_) {
+                    // Keep listening, the wake word engine only runs when the gate hears something
+                    audio_service.EnableLowPowerListening(true);
+                    if (state_listener_id_ < 0) {
+                        // A wake word starts a conversation, leave power save mode right away
+                        state_listener_id_ = app.AddStateChangeListener([this](DeviceState old_state, DeviceState new_state) {
+                            if (low_power_listening_ && in_sleep_mode_ && new_state != kDeviceStateIdle) {
+                                Application::GetInstance().Schedule([this]() {
+                                    WakeUp();
+                                });
+                            }
+                        });
+                    }
+                } else {
+                    // Disable wake word detection
+                    if (is_wake_word_running_) {
+                        audio_service.EnableWakeWordDetection(false);
+                        vTaskDelay(pdMS_TO_TICKS(100));
+                    }
+                    // Disable audio input
+                    auto codec = Board::GetInstance().GetAudioCodec();
+                    if (codec) {
+                        codec->EnableInput(false);
+                    }
                 }
 
                 esp_pm_config_t pm_config = {
@@ -99,6 +120,8 @@ void PowerSaveTimer::PowerSaveCheck() {
         }
     }
     if (seconds_to_shutdown_ != -1 && ticks_ >= seconds_to_shutdown_ && on_shutdown_request_) {
+        // 关机不会经过 esp_restart，先写入延迟提交的设置
+        Settings::Flush();
         on_shutdown_request_();
     }
 }
@@ -117,10 +140,14 @@ void PowerSaveTimer::WakeUp() {
             };
             esp_pm_configure(&pm_config);
 
-            // Enable wake word detection
             auto& app = Application::GetInstance();
             auto& audio_service = app.GetAudioService();
-            if (is_wake_word_running_) {
+            if (low_power_listening_) {
+                // The wake word kept running, it may have started the conversation
+                low_power_listening_ = false;
+                audio_service.EnableLowPowerListening(false);
+            } else if (is_wake_word_running_) {
+                // Enable wake word detection
                 audio_service.EnableWakeWordDetection(true);
             }
         }
@@ -23,6 +23,8 @@ private:
     bool enabled_ = false;
     bool in_sleep_mode_ = false;
     bool is_wake_word_running_ = false;
+    bool low_power_listening_ = false;
+    int state_listener_id_ = -1;
     int ticks_ = 0;
     int cpu_max_freq_;
     int seconds_to_sleep_;
@@ -0,0 +1,155 @@
+#include "scene_change_detector.h"
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <cstdlib>
+
+#define TAG "SceneChange"
+
+// Maximum differing bits of the 64-bit hash for the same scene
+#define SCENE_HASH_MAX_DISTANCE 8
+
+SceneChangeDetector::SceneChangeDetector(int threshold, int answer_ttl_seconds)
+    : threshold_(threshold), answer_ttl_us_((int64_t)answer_ttl_seconds * 1000000) {
+}
+
+static inline uint8_t Rgb565ToLuma(uint16_t pixel) {
+    int r = (pixel >> 8) & 0xF8;
+    int g = (pixel >> 3) & 0xFC;
+    int b = (pixel << 3) & 0xF8;
+    return (r * 77 + g * 150 + b * 29) >> 8;
+}
+
+bool SceneChangeDetector::Update(const uint8_t* data, size_t len, int width, int height, SceneFrameFormat format) {
+    valid_ = false;
+    score_ = -1;
+    if (data == nullptr || width < kGridWidth || height < kGridHeight) {
+        return false;
+    }
+
+    size_t bytes_per_pixel = (format == kSceneFrameGrey) ? 1 : (format == kSceneFrameRgb888) ? 3 : 2;
+    if (len < (size_t)width * height * bytes_per_pixel) {
+        ESP_LOGW(TAG, "Frame too short: %u bytes for %dx%d", len, width, height);
+        return false;
+    }
+
+    // Average 2x2 sample points per cell, only 4 pixels are read for each cell
+    for (int gy = 0; gy < kGridHeight; gy++) {
+        for (int gx = 0; gx < kGridWidth; gx++) {
+            int sum = 0;
+            for (int sy = 0; sy < 2; sy++) {
+                int y = (gy * 4 + sy * 2 + 1) * height / (kGridHeight * 4);
+                for (int sx = 0; sx < 2; sx++) {
+                    int x = (gx * 4 + sx * 2 + 1) * width / (kGridWidth * 4);
+                    const uint8_t* p = data + ((size_t)y * width + x) * bytes_per_pixel;
+                    switch (format) {
+                        case kSceneFrameRgb565:
+                            sum += Rgb565ToLuma(p[0] | (p[1] << 8));
+                            break;
+                        case kSceneFrameRgb565Be:
+                            sum += Rgb565ToLuma((p[0] << 8) | p[1]);
+                            break;
+                        case kSceneFrameRgb888:
+                            sum += (p[0] * 77 + p[1] * 150 + p[2] * 29) >> 8;
+                            break;
+                        case kSceneFrameYuyv:
+                        case kSceneFrameGrey:
+                            sum += p[0];
+                            break;
+                    }
+                }
+            }
+            grid_[gy * kGridWidth + gx] = sum / 4;
+        }
+    }
+
+    hash_ = ComputeHash(grid_);
+    valid_ = true;
+    if (has_reference_) {
+        score_ = ComputeScore(grid_, reference_grid_);
+        ESP_LOGI(TAG, "Scene change score: %d, hash distance: %d", score_,
+                 __builtin_popcountll(hash_ ^ reference_hash_));
+    }
+    return true;
+}
+
+uint64_t SceneChangeDetector::ComputeHash(const Grid& grid) {
+    // Difference hash: reduce to 9x8 and compare horizontally adjacent cells
+    uint8_t small[8][9];
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 9; x++) {
+            int x0 = x * kGridWidth / 9, x1 = (x + 1) * kGridWidth / 9;
+            int y0 = y * kGridHeight / 8, y1 = (y + 1) * kGridHeight / 8;
+            int sum = 0;
+            for (int gy = y0; gy < y1; gy++) {
+                for (int gx = x0; gx < x1; gx++) {
+                    sum += grid[gy * kGridWidth + gx];
+                }
+            }
+            small[y][x] = sum / ((x1 - x0) * (y1 - y0));
+        }
+    }
+
+    uint64_t hash = 0;
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            hash = (hash << 1) | (small[y][x] < small[y][x + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+int SceneChangeDetector::ComputeScore(const Grid& a, const Grid& b) {
+    // Remove the global brightness shift first, so auto exposure alone is not a scene change
+    int sum_a = 0, sum_b = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        sum_a += a[i];
+        sum_b += b[i];
+    }
+    int offset = (sum_a - sum_b) / (int)a.size();
+
+    int diff = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        diff += std::abs(a[i] - b[i] - offset);
+    }
+    return diff / (int)a.size();
+}
+
+bool SceneChangeDetector::IsSameScene() const {
+    if (threshold_ <= 0 || !valid_ || !has_reference_) {
+        return false;
+    }
+    return score_ <= threshold_ && __builtin_popcountll(hash_ ^ reference_hash_) <= SCENE_HASH_MAX_DISTANCE;
+}
+
+bool SceneChangeDetector::GetCachedAnswer(const std::string& question, std::string& answer) const {
+    if (!IsSameScene() || question != cached_question_) {
+        return false;
+    }
+    if (esp_timer_get_time() - cached_time_us_ > answer_ttl_us_) {
+        return false;
+    }
+    answer = cached_answer_;
+    return true;
+}
+
+void SceneChangeDetector::CacheAnswer(const std::string& question, const std::string& answer) {
+    if (threshold_ <= 0 || !valid_) {
+        return;
+    }
+    has_reference_ = true;
+    reference_grid_ = grid_;
+    reference_hash_ = hash_;
+    score_ = 0;
+    cached_question_ = question;
+    cached_answer_ = answer;
+    cached_time_us_ = esp_timer_get_time();
+}
+
+void SceneChangeDetector::Reset() {
+    valid_ = false;
+    has_reference_ = false;
+    score_ = -1;
+    cached_question_.clear();
+    cached_answer_.clear();
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <array>
+
+enum SceneFrameFormat {
+    kSceneFrameRgb565,      // little endian
+    kSceneFrameRgb565Be,    // big endian, as delivered by esp32-camera
+    kSceneFrameRgb888,
+    kSceneFrameYuyv,
+    kSceneFrameGrey,
+};
+
+/**
+ * Cheap scene change gate for camera explain uploads.
+ *
+ * Each frame is reduced to a 32x24 luma grid (sampled, no full-frame buffer) from which a
+ * change score against the reference frame and a 64-bit difference hash are computed.
+ * The reference is the frame of the last answered question, so repeated questions about
+ * an unchanged view can reuse the server answer instead of uploading a new JPEG.
+ */
+class SceneChangeDetector {
+public:
+    static constexpr int kGridWidth = 32;
+    static constexpr int kGridHeight = 24;
+
+    // threshold: maximum mean absolute luma difference (0-255) considered the same scene, 0 disables the cache
+    SceneChangeDetector(int threshold, int answer_ttl_seconds = 300);
+
+    // Returns false if the format is not supported, the frame is then always treated as changed
+    bool Update(const uint8_t* data, size_t len, int width, int height, SceneFrameFormat format);
+
+    // Change score of the last frame against the reference frame, -1 if unknown
+    int score() const { return score_; }
+    uint64_t hash() const { return hash_; }
+    bool IsSameScene() const;
+
+    bool GetCachedAnswer(const std::string& question, std::string& answer) const;
+    void CacheAnswer(const std::string& question, const std::string& answer);
+    void Reset();
+
+private:
+    using Grid = std::array<uint8_t, kGridWidth * kGridHeight>;
+
+    int threshold_;
+    int64_t answer_ttl_us_;
+    bool valid_ = false;
+    int score_ = -1;
+    uint64_t hash_ = 0;
+    Grid grid_ = {};
+
+    bool has_reference_ = false;
+    uint64_t reference_hash_ = 0;
+    Grid reference_grid_ = {};
+    std::string cached_question_;
+    std::string cached_answer_;
+    int64_t cached_time_us_ = 0;
+
+    static uint64_t ComputeHash(const Grid& grid);
+    static int ComputeScore(const Grid& a, const Grid& b);
+};
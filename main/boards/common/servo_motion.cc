@@ -0,0 +1,95 @@
+#include "servo_motion.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Oscillations fade in from the current positions over a quarter period, at most this long
+#define SERVO_MOTION_MAX_BLEND_MS 200
+
+ServoMotion::ServoMotion(int servo_count) : servo_count_(std::min(servo_count, SERVO_MOTION_MAX_SERVOS)) {
+}
+
+void ServoMotion::Move(int duration_ms, const int target[]) {
+    Segment segment = {};
+    segment.type = kSegmentMove;
+    segment.duration_ms = std::max(duration_ms, 0);
+    for (int i = 0; i < servo_count_; i++) {
+        segment.target[i] = target[i];
+    }
+    segments_.push_back(segment);
+    duration_ms_ += segment.duration_ms;
+}
+
+void ServoMotion::Oscillate(int period_ms, float cycles, const int amplitude[], const int center[], const double phase[]) {
+    if (period_ms <= 0 || cycles <= 0) {
+        return;
+    }
+    Segment segment = {};
+    segment.type = kSegmentOscillate;
+    segment.period_ms = std::min(period_ms, UINT16_MAX);
+    segment.duration_ms = std::lround(segment.period_ms * cycles);
+    for (int i = 0; i < servo_count_; i++) {
+        segment.target[i] = center[i];
+        segment.amplitude[i] = amplitude[i];
+        segment.phase[i] = phase[i];
+    }
+    segments_.push_back(segment);
+    duration_ms_ += segment.duration_ms;
+}
+
+void ServoMotion::Hold(int duration_ms) {
+    if (duration_ms <= 0) {
+        return;
+    }
+    Segment segment = {};
+    segment.type = kSegmentHold;
+    segment.duration_ms = duration_ms;
+    segments_.push_back(segment);
+    duration_ms_ += segment.duration_ms;
+}
+
+void ServoMotion::Evaluate(const Segment& segment, uint32_t elapsed_ms, const int start[], int positions[]) const {
+    elapsed_ms = std::min(elapsed_ms, segment.duration_ms);
+    switch (segment.type) {
+        case kSegmentMove:
+            for (int i = 0; i < servo_count_; i++) {
+                if (elapsed_ms >= segment.duration_ms) {
+                    positions[i] = segment.target[i];
+                } else {
+                    positions[i] = start[i] + (segment.target[i] - start[i]) * (int)elapsed_ms / (int)segment.duration_ms;
+                }
+            }
+            break;
+        case kSegmentOscillate: {
+            float angle = 2 * (float)M_PI * elapsed_ms / segment.period_ms;
+            uint32_t blend_ms = std::min<uint32_t>(segment.period_ms / 4, SERVO_MOTION_MAX_BLEND_MS);
+            for (int i = 0; i < servo_count_; i++) {
+                int position = std::lround(segment.amplitude[i] * sinf(angle + segment.phase[i])) + segment.target[i];
+                if (elapsed_ms < blend_ms) {
+                    position = start[i] + (position - start[i]) * (int)elapsed_ms / (int)blend_ms;
+                }
+                positions[i] = position;
+            }
+            break;
+        }
+        case kSegmentHold:
+            if (positions != start) {
+                std::copy(start, start + servo_count_, positions);
+            }
+            break;
+    }
+}
+
+void ServoMotion::Sample(uint32_t time_ms, const int initial[], int positions[]) const {
+    int start[SERVO_MOTION_MAX_SERVOS];
+    std::copy(initial, initial + servo_count_, start);
+    for (auto& segment : segments_) {
+        if (time_ms < segment.duration_ms) {
+            Evaluate(segment, time_ms, start, positions);
+            return;
+        }
+        Evaluate(segment, segment.duration_ms, start, start);
+        time_ms -= segment.duration_ms;
+    }
+    std::copy(start, start + servo_count_, positions);
+}
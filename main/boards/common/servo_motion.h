@@ -0,0 +1,55 @@
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include <cstdint>
+#include <vector>
+
+#define SERVO_MOTION_MAX_SERVOS 8
+
+/**
+ * A servo trajectory compiled into a table of segments.
+ *
+ * Gaits and servo sequences are compiled once, the table is then sampled by ServoMotionPlayer
+ * at any time offset. Sampling only depends on the table and the positions the motion started
+ * from, so the same code renders the angle timeline of a motion off the device.
+ */
+class ServoMotion {
+public:
+    enum SegmentType : uint8_t {
+        kSegmentMove,       // Linear interpolation from the current positions to `target`
+        kSegmentOscillate,  // target + amplitude * sin(2 * PI * t / period + phase)
+        kSegmentHold,       // Keep the current positions
+    };
+
+    struct Segment {
+        SegmentType type;
+        uint16_t period_ms;
+        uint32_t duration_ms;
+        int16_t target[SERVO_MOTION_MAX_SERVOS];     // Move: end position, Oscillate: center
+        int16_t amplitude[SERVO_MOTION_MAX_SERVOS];
+        float phase[SERVO_MOTION_MAX_SERVOS];        // Radians
+    };
+
+    explicit ServoMotion(int servo_count);
+
+    void Move(int duration_ms, const int target[]);
+    void Oscillate(int period_ms, float cycles, const int amplitude[], const int center[], const double phase[]);
+    void Hold(int duration_ms);
+
+    int servo_count() const { return servo_count_; }
+    uint32_t duration_ms() const { return duration_ms_; }
+    bool empty() const { return segments_.empty(); }
+    const std::vector<Segment>& segments() const { return segments_; }
+
+    // Positions `elapsed_ms` into the segment, `start` holds the positions when the segment began
+    void Evaluate(const Segment& segment, uint32_t elapsed_ms, const int start[], int positions[]) const;
+    // Positions `time_ms` into the motion, for a motion started from `initial`
+    void Sample(uint32_t time_ms, const int initial[], int positions[]) const;
+
+private:
+    int servo_count_;
+    uint32_t duration_ms_ = 0;
+    std::vector<Segment> segments_;
+};
+
+#endif // SERVO_MOTION_H
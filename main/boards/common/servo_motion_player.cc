@@ -0,0 +1,127 @@
+#include "servo_motion_player.h"
+
+#include <esp_log.h>
+
+#define TAG "ServoMotionPlayer"
+
+// Servo PWM runs at 50 Hz, refreshing twice per frame keeps the pulse current
+#define SERVO_MOTION_TICK_MS 10
+
+#define SERVO_MOTION_EVENT_DONE      (1 << 0)
+#define SERVO_MOTION_EVENT_CANCELLED (1 << 1)
+
+ServoMotionPlayer::ServoMotionPlayer(int servo_count, std::function<int(int servo)> get_position,
+                                     std::function<void(int servo, int position)> set_position)
+    : servo_count_(servo_count), get_position_(get_position), set_position_(set_position), motion_(servo_count) {
+    event_group_ = xEventGroupCreate();
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            auto self = static_cast<ServoMotionPlayer*>(arg);
+            self->OnTimer();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "servo_motion",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_));
+}
+
+ServoMotionPlayer::~ServoMotionPlayer() {
+    esp_timer_stop(timer_);
+    esp_timer_delete(timer_);
+    vEventGroupDelete(event_group_);
+}
+
+bool ServoMotionPlayer::Play(ServoMotion&& motion) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // Checked under the lock so a concurrent Cancel() cannot be missed
+        if (IsCancelled()) {
+            return false;
+        }
+        if (motion.empty()) {
+            return true;
+        }
+        motion_ = std::move(motion);
+        segment_index_ = 0;
+        segment_start_us_ = esp_timer_get_time();
+        for (int i = 0; i < servo_count_; i++) {
+            segment_start_positions_[i] = get_position_(i);
+        }
+        playing_ = true;
+        xEventGroupClearBits(event_group_, SERVO_MOTION_EVENT_DONE);
+        esp_timer_start_periodic(timer_, SERVO_MOTION_TICK_MS * 1000);
+    }
+    // Write the first positions now rather than one tick later
+    OnTimer();
+
+    auto bits = xEventGroupWaitBits(event_group_, SERVO_MOTION_EVENT_DONE | SERVO_MOTION_EVENT_CANCELLED,
+                                    pdFALSE, pdFALSE, portMAX_DELAY);
+    return !(bits & SERVO_MOTION_EVENT_CANCELLED);
+}
+
+bool ServoMotionPlayer::Pause(int duration_ms) {
+    if (duration_ms <= 0) {
+        return !IsCancelled();
+    }
+    auto bits = xEventGroupWaitBits(event_group_, SERVO_MOTION_EVENT_CANCELLED, pdFALSE, pdFALSE,
+                                    pdMS_TO_TICKS(duration_ms));
+    return !(bits & SERVO_MOTION_EVENT_CANCELLED);
+}
+
+void ServoMotionPlayer::Cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (playing_) {
+        ESP_LOGI(TAG, "Motion cancelled at segment %u/%u", segment_index_, motion_.segments().size());
+        playing_ = false;
+        esp_timer_stop(timer_);
+    }
+    xEventGroupSetBits(event_group_, SERVO_MOTION_EVENT_CANCELLED);
+}
+
+void ServoMotionPlayer::Resume() {
+    xEventGroupClearBits(event_group_, SERVO_MOTION_EVENT_CANCELLED);
+}
+
+bool ServoMotionPlayer::IsCancelled() {
+    return xEventGroupGetBits(event_group_) & SERVO_MOTION_EVENT_CANCELLED;
+}
+
+void ServoMotionPlayer::OnTimer() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!playing_) {
+        return;
+    }
+
+    auto& segments = motion_.segments();
+    uint32_t elapsed_ms = (esp_timer_get_time() - segment_start_us_) / 1000;
+    while (segment_index_ < segments.size() && elapsed_ms >= segments[segment_index_].duration_ms) {
+        auto& segment = segments[segment_index_];
+        motion_.Evaluate(segment, segment.duration_ms, segment_start_positions_, segment_start_positions_);
+        segment_start_us_ += segment.duration_ms * 1000;
+        elapsed_ms -= segment.duration_ms;
+        segment_index_++;
+    }
+
+    if (segment_index_ == segments.size()) {
+        Write(segment_start_positions_);
+        playing_ = false;
+        esp_timer_stop(timer_);
+        xEventGroupSetBits(event_group_, SERVO_MOTION_EVENT_DONE);
+        return;
+    }
+
+    int positions[SERVO_MOTION_MAX_SERVOS];
+    motion_.Evaluate(segments[segment_index_], elapsed_ms, segment_start_positions_, positions);
+    Write(positions);
+}
+
+void ServoMotionPlayer::Write(const int positions[]) {
+    for (int i = 0; i < servo_count_; i++) {
+        // Skip unchanged servos, most of a gait holds some joints still
+        if (positions[i] != get_position_(i)) {
+            set_position_(i, positions[i]);
+        }
+    }
+}
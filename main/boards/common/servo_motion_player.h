@@ -0,0 +1,53 @@
+#ifndef SERVO_MOTION_PLAYER_H
+#define SERVO_MOTION_PLAYER_H
+
+#include "servo_motion.h"
+
+#include <functional>
+#include <mutex>
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+
+/**
+ * Plays ServoMotion tables from a periodic esp_timer.
+ *
+ * Positions are computed from the time elapsed since the segment started, so timing does not
+ * drift when the calling task is preempted. A motion starts from the current servo positions and
+ * each segment starts where the previous one ended.
+ */
+class ServoMotionPlayer {
+public:
+    ServoMotionPlayer(int servo_count, std::function<int(int servo)> get_position,
+                      std::function<void(int servo, int position)> set_position);
+    ~ServoMotionPlayer();
+
+    // Blocks until the motion is finished, returns false if it was cancelled
+    bool Play(ServoMotion&& motion);
+    // Cancellable delay between motions, returns false if cancelled
+    bool Pause(int duration_ms);
+    // Stop the running motion where it is, motions are skipped until Resume()
+    void Cancel();
+    void Resume();
+    bool IsCancelled();
+
+private:
+    std::mutex mutex_;
+    esp_timer_handle_t timer_ = nullptr;
+    EventGroupHandle_t event_group_ = nullptr;
+    int servo_count_;
+    std::function<int(int servo)> get_position_;
+    std::function<void(int servo, int position)> set_position_;
+
+    ServoMotion motion_;
+    bool playing_ = false;
+    size_t segment_index_ = 0;
+    int64_t segment_start_us_ = 0;
+    int segment_start_positions_[SERVO_MOTION_MAX_SERVOS];
+
+    void OnTimer();
+    void Write(const int positions[]);
+};
+
+#endif // SERVO_MOTION_PLAYER_H
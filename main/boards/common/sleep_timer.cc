@@ -118,6 +118,8 @@ void SleepTimer::CheckTimer() {
             on_enter_deep_sleep_mode_();
         }
 
+        // Pending settings are only committed automatically on restart
+        Settings::Flush();
         esp_deep_sleep_start();
     }
 }
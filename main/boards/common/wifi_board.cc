@@ -96,6 +96,8 @@ void WifiBoard::TryWifiConnect() {
         ESP_LOGI(TAG, "Starting WiFi connection attempt");
         esp_timer_start_once(connect_timer_, CONNECT_TIMEOUT_SEC * 1000000ULL);
         WifiManager::GetInstance().StartStation();
+    } else if (!config_mode_fallback_) {
+        ESP_LOGI(TAG, "No SSID configured, WiFi stays down");
     } else {
         // No SSID configured, enter config mode
         // Wait for the board version to be shown
@@ -151,6 +153,10 @@ void WifiBoard::SetNetworkEventCallback(NetworkEventCallback callback) {
 
 void WifiBoard::OnWifiConnectTimeout(void* arg) {
     auto* board = static_cast<WifiBoard*>(arg);
+    if (!board->config_mode_fallback_) {
+        ESP_LOGW(TAG, "WiFi connection timeout, keep retrying");
+        return;
+    }
     ESP_LOGW(TAG, "WiFi connection timeout, entering config mode");
 
     WifiManager::GetInstance().StopStation();
@@ -10,6 +10,7 @@ class WifiBoard : public Board {
 protected:
     esp_timer_handle_t connect_timer_ = nullptr;
     bool in_config_mode_ = false;
+    bool config_mode_fallback_ = true;
     NetworkEventCallback network_event_callback_ = nullptr;
 
     virtual std::string GetBoardJson() override;
@@ -64,6 +65,13 @@ public:
      * Check if in WiFi config mode
      */
     bool IsInWifiConfigMode() const;
+
+    /**
+     * Whether a missing SSID or a connection timeout enters WiFi config mode (default true).
+     * Disabled when WiFi is a backup network, the station then keeps retrying in the background.
+     * EnterWifiConfigMode() still works.
+     */
+    void SetConfigModeFallback(bool enable) { config_mode_fallback_ = enable; }
 };
 
 #endif // WIFI_BOARD_H
@@ -6,6 +6,7 @@
 #include <esp_log.h>
 
 #include <cstring>
+#include <mutex>
 
 #include "application.h"
 #include "board.h"
@@ -23,6 +24,7 @@ struct ElectronBotActionParams {
     int speed;
     int direction;
     int amount;
+    uint32_t stop_generation;  // 入队时的停止代数
 };
 
 class ElectronBotController {
@@ -31,6 +33,9 @@ private:
     TaskHandle_t action_task_handle_ = nullptr;
     QueueHandle_t action_queue_;
     bool is_action_in_progress_ = false;
+    // 每次 self.electron.stop 递增，之前入队的动作随之作废
+    std::mutex stop_mutex_;
+    uint32_t stop_generation_ = 0;
 
     enum ActionType {
         // 手部动作 1-12
@@ -70,6 +75,15 @@ private:
 
         while (true) {
             if (xQueueReceive(controller->action_queue_, &params, pdMS_TO_TICKS(1000)) == pdTRUE) {
+                {
+                    // 与停止互斥，避免出队后才发生的停止被 Resume() 撤销
+                    std::lock_guard<std::mutex> lock(controller->stop_mutex_);
+                    if (params.stop_generation != controller->stop_generation_) {
+                        ESP_LOGI(TAG, "跳过停止前入队的动作: %d", params.action_type);
+                        continue;
+                    }
+                    controller->electron_bot_.Resume();  // 清除之前的停止请求
+                }
                 ESP_LOGI(TAG, "执行动作: %d", params.action_type);
                 controller->is_action_in_progress_ = true;  // 开始执行动作
 
@@ -101,11 +115,16 @@ private:
         }
     }
 
+    uint32_t GetStopGeneration() {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        return stop_generation_;
+    }
+
     void QueueAction(int action_type, int steps, int speed, int direction, int amount) {
         ESP_LOGI(TAG, "动作控制: 类型=%d, 步数=%d, 速度=%d, 方向=%d, 幅度=%d", action_type, steps,
                  speed, direction, amount);
 
-        ElectronBotActionParams params = {action_type, steps, speed, direction, amount};
+        ElectronBotActionParams params = {action_type, steps, speed, direction, amount, GetStopGeneration()};
         xQueueSend(action_queue_, &params, portMAX_DELAY);
         StartActionTaskIfNeeded();
     }
@@ -249,7 +268,13 @@ public:
         // 系统工具
         mcp_server.AddTool("self.electron.stop", "立即停止", PropertyList(),
                            [this](const PropertyList& properties) -> ReturnValue {
-                               // 清空队列但保持任务常驻
+                               // 中断正在播放的动作，清空队列但保持任务常驻；
+                               // 已出队但尚未开始的动作因停止代数变化而被跳过
+                               {
+                                   std::lock_guard<std::mutex> lock(stop_mutex_);
+                                   stop_generation_++;
+                                   electron_bot_.Stop();
+                               }
                                xQueueReset(action_queue_);
                                is_action_in_progress_ = false;
                                QueueAction(ACTION_HOME, 1, 1000, 0, 0);
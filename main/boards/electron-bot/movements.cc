@@ -5,7 +5,13 @@
 
 #include "oscillator.h"
 
-Otto::Otto() {
+Otto::Otto()
+    : player_(SERVO_COUNT, [this](int servo) { return servo_[servo].GetPosition(); },
+              [this](int servo, int position) {
+                  if (servo_pins_[servo] != -1) {
+                      servo_[servo].SetPosition(position);
+                  }
+              }) {
     is_otto_resting_ = false;
     for (int i = 0; i < SERVO_COUNT; i++) {
         servo_pins_[i] = -1;
@@ -80,53 +86,9 @@ void Otto::MoveServos(int time, int servo_target[]) {
         SetRestState(false);
     }
 
-    final_time_ = millis() + time;
-    if (time > 10) {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                increment_[i] = (servo_target[i] - servo_[i].GetPosition()) / (time / 10.0);
-            }
-        }
-
-        for (int iteration = 1; millis() < final_time_; iteration++) {
-            partial_time_ = millis() + 10;
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_[i].GetPosition() + increment_[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-    } else {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                servo_[i].SetPosition(servo_target[i]);
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(time));
-    }
-
-    // final adjustment to the target.
-    bool f = true;
-    int adjustment_count = 0;
-    while (f && adjustment_count < 10) {
-        f = false;
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1 && servo_target[i] != servo_[i].GetPosition()) {
-                f = true;
-                break;
-            }
-        }
-        if (f) {
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_target[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-            adjustment_count++;
-        }
-    };
+    ServoMotion motion(SERVO_COUNT);
+    motion.Move(time, servo_target);
+    player_.Play(std::move(motion));
 }
 
 void Otto::MoveSingle(int position, int servo_number) {
@@ -146,27 +108,14 @@ void Otto::MoveSingle(int position, int servo_number) {
 
 void Otto::OscillateServos(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
                            double phase_diff[SERVO_COUNT], float cycle = 1) {
+    int center[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        if (servo_pins_[i] != -1) {
-            servo_[i].SetO(offset[i]);
-            servo_[i].SetA(amplitude[i]);
-            servo_[i].SetT(period);
-            servo_[i].SetPh(phase_diff[i]);
-        }
+        center[i] = offset[i] + 90;
     }
 
-    double ref = millis();
-    double end_time = period * cycle + ref;
-
-    while (millis() < end_time) {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                servo_[i].Refresh();
-            }
-        }
-        vTaskDelay(5);
-    }
-    vTaskDelay(pdMS_TO_TICKS(10));
+    ServoMotion motion(SERVO_COUNT);
+    motion.Oscillate(period, cycle, amplitude, center, phase_diff);
+    player_.Play(std::move(motion));
 }
 
 void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
@@ -175,16 +124,16 @@ void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int peri
         SetRestState(false);
     }
 
-    int cycles = (int)steps;
+    //-- All the cycles, including the final not complete one, are a single oscillation
+    OscillateServos(amplitude, offset, period, phase_diff, steps);
+}
 
-    //-- Execute complete cycles
-    if (cycles >= 1)
-        for (int i = 0; i < cycles; i++)
-            OscillateServos(amplitude, offset, period, phase_diff);
+void Otto::Stop() {
+    player_.Cancel();
+}
 
-    //-- Execute the final not complete cycle
-    OscillateServos(amplitude, offset, period, phase_diff, (float)steps - cycles);
-    vTaskDelay(pdMS_TO_TICKS(10));
+void Otto::Resume() {
+    player_.Resume();
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -193,10 +142,10 @@ void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int peri
 void Otto::Home(bool hands_down) {
     if (is_otto_resting_ == false) {  // Go to rest position only if necessary
         MoveServos(1000, servo_initial_);
-        is_otto_resting_ = true;
+        is_otto_resting_ = !player_.IsCancelled();
     }
 
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    player_.Pause(1000);
 }
 
 bool Otto::GetRestState() {
@@ -262,7 +211,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
             for (int i = 0; i < times; i++) {
                 current_positions[LEFT_PITCH] = 150 + (i % 2 == 0 ? -30 : 30);
                 MoveServos(period / 10, current_positions);
-                vTaskDelay(pdMS_TO_TICKS(period / 10));
+                player_.Pause(period / 10);
             }
             memcpy(current_positions, servo_initial_, sizeof(current_positions));
             MoveServos(period, current_positions);
@@ -274,7 +223,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
             for (int i = 0; i < times; i++) {
                 current_positions[RIGHT_PITCH] = 30 + (i % 2 == 0 ? 30 : -30);
                 MoveServos(period / 10, current_positions);
-                vTaskDelay(pdMS_TO_TICKS(period / 10));
+                player_.Pause(period / 10);
             }
             memcpy(current_positions, servo_initial_, sizeof(current_positions));
             MoveServos(period, current_positions);
@@ -288,7 +237,7 @@ void Otto::HandAction(int action, int times, int amount, int period) {
                 current_positions[LEFT_PITCH] = 150 + (i % 2 == 0 ? -30 : 30);
                 current_positions[RIGHT_PITCH] = 30 + (i % 2 == 0 ? 30 : -30);
                 MoveServos(period / 10, current_positions);
-                vTaskDelay(pdMS_TO_TICKS(period / 10));
+                player_.Pause(period / 10);
             }
             memcpy(current_positions, servo_initial_, sizeof(current_positions));
             MoveServos(period, current_positions);
@@ -383,7 +332,7 @@ void Otto::BodyAction(int action, int times, int amount, int period) {
 
     current_positions[BODY] = target_angle;
     MoveServos(period, current_positions);
-    vTaskDelay(pdMS_TO_TICKS(100));
+    player_.Pause(100);
 }
 
 //---------------------------------------------------------
@@ -426,12 +375,12 @@ void Otto::HeadAction(int action, int times, int amount, int period) {
             // 先抬头
             current_positions[HEAD] = head_center + amount;
             MoveServos(period / 3, current_positions);
-            vTaskDelay(pdMS_TO_TICKS(period / 6));
+            player_.Pause(period / 6);
 
             // 再低头
             current_positions[HEAD] = head_center - amount;
             MoveServos(period / 3, current_positions);
-            vTaskDelay(pdMS_TO_TICKS(period / 6));
+            player_.Pause(period / 6);
 
             // 回到中心
             current_positions[HEAD] = head_center;
@@ -453,7 +402,7 @@ void Otto::HeadAction(int action, int times, int amount, int period) {
                 current_positions[HEAD] = head_center - amount;
                 MoveServos(period / 2, current_positions);
 
-                vTaskDelay(pdMS_TO_TICKS(50));  // 短暂停顿
+                player_.Pause(50);  // 短暂停顿
             }
 
             // 回到中心
@@ -7,6 +7,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "oscillator.h"
+#include "servo_motion_player.h"
 
 //-- Constants
 #define FORWARD 1
@@ -51,6 +52,10 @@ public:
     void OscillateServos(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
                          double phase_diff[SERVO_COUNT], float cycle);
 
+    //-- Motion playback, Stop() aborts the running motion and skips motions until Resume()
+    void Stop();
+    void Resume();
+
     //-- HOME = Otto at rest position
     void Home(bool hands_down = true);
     bool GetRestState();
@@ -76,9 +81,7 @@ private:
     int servo_trim_[SERVO_COUNT];
     int servo_initial_[SERVO_COUNT] = {180, 180, 0, 0, 90, 90};
 
-    unsigned long final_time_;
-    unsigned long partial_time_;
-    float increment_[SERVO_COUNT];
+    ServoMotionPlayer player_;
 
     bool is_otto_resting_;
 
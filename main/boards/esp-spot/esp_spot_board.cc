@@ -23,6 +23,7 @@
 
 #include "bmi270_api.h"
 #include "i2c_bus.h"
+#include "settings.h"
 #endif  // IMU_INT_GPIO
 
 #ifdef CONFIG_IDF_TARGET_ESP32S3
@@ -340,6 +341,7 @@ private:
         const uint64_t wakeup_mask = (1ULL << KEY_BUTTON_GPIO) | (1ULL << IMU_INT_GPIO);
         ESP_ERROR_CHECK(esp_sleep_enable_ext1_wakeup(wakeup_mask, ESP_EXT1_WAKEUP_ANY_HIGH));
         ESP_LOGI(TAG, "Entering deep sleep, waiting for key or wrist gesture");
+        Settings::Flush();
         esp_deep_sleep_start();
     }
 #endif  // IMU_INT_GPIO
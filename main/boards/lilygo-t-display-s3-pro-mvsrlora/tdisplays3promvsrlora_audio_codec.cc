@@ -1,4 +1,5 @@
 #include "tdisplays3promvsrlora_audio_codec.h"
+#include "sample_format.h"
 
 #include <esp_log.h>
 #include <driver/i2c_master.h>
@@ -140,9 +141,7 @@ int Tdisplays3promvsrloraAudioCodec::Write(const int16_t *data, int samples){
     if (output_enabled_){
         size_t bytes_read;
         auto output_data = (int16_t *)malloc(samples * sizeof(int16_t));
-        for (size_t i = 0; i < samples; i++){
-            output_data[i] = (float)data[i] * (float)(volume_ / 100.0);
-        }
+        sample_format::ScalePcm(data, output_data, samples, volume_ * 65536 / 100);
         i2s_channel_write(tx_handle_, output_data, samples * sizeof(int16_t), &bytes_read, portMAX_DELAY);
         free(output_data);
     }
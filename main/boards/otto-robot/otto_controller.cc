@@ -5,8 +5,10 @@
 #include <cJSON.h>
 #include <esp_log.h>
 
+#include <algorithm>
 #include <cstdlib> 
 #include <cstring>
+#include <mutex>
 
 #include "application.h"
 #include "board.h"
@@ -27,6 +29,9 @@ private:
     QueueHandle_t action_queue_;
     bool has_hands_ = false;
     bool is_action_in_progress_ = false;
+    // 每次 self.otto.stop 递增，之前入队的动作随之作废
+    std::mutex stop_mutex_;
+    uint32_t stop_generation_ = 0;
 
     struct OttoActionParams {
         int action_type;
@@ -34,7 +39,9 @@ private:
         int speed;
         int direction;
         int amount;
-        char servo_sequence_json[512];  // 用于存储舵机序列的JSON字符串
+        ServoMotion* motion;  // 入队时编译好的舵机序列，由动作任务释放
+        int sequence_delay;   // 序列执行完成后的延迟
+        uint32_t stop_generation;  // 入队时的停止代数
     };
 
     enum ActionType {
@@ -75,224 +82,35 @@ private:
 
         while (true) {
             if (xQueueReceive(controller->action_queue_, &params, pdMS_TO_TICKS(1000)) == pdTRUE) {
+                {
+                    // 与停止互斥，避免出队后才发生的停止被 Resume() 撤销
+                    std::lock_guard<std::mutex> lock(controller->stop_mutex_);
+                    if (params.stop_generation != controller->stop_generation_) {
+                        ESP_LOGI(TAG, "跳过停止前入队的动作: %d", params.action_type);
+                        delete params.motion;
+                        continue;
+                    }
+                    controller->otto_.Resume();  // 清除之前的停止请求
+                }
                 ESP_LOGI(TAG, "执行动作: %d", params.action_type);
                 PowerManager::PauseBatteryUpdate();  // 动作开始时暂停电量更新
                 controller->is_action_in_progress_ = true;
                 if (params.action_type == ACTION_SERVO_SEQUENCE) {
-                    // 执行舵机序列（自编程）- 仅支持短键名格式
-                    cJSON* json = cJSON_Parse(params.servo_sequence_json);
-                    if (json != nullptr) {
-                        ESP_LOGD(TAG, "JSON解析成功，长度=%d", strlen(params.servo_sequence_json));
-                        // 使用短键名 "a" 表示动作数组
-                        cJSON* actions = cJSON_GetObjectItem(json, "a");
-                        if (cJSON_IsArray(actions)) {
-                            int array_size = cJSON_GetArraySize(actions);
-                            ESP_LOGI(TAG, "执行舵机序列，共%d个动作", array_size);
-                            
-                            // 获取序列执行完成后的延迟（短键名 "d"，顶层参数）
-                            int sequence_delay = 0;
-                            cJSON* delay_item = cJSON_GetObjectItem(json, "d");
-                            if (cJSON_IsNumber(delay_item)) {
-                                sequence_delay = delay_item->valueint;
-                                if (sequence_delay < 0) sequence_delay = 0;
-                            }
-                            
-                            // 初始化当前舵机位置（用于保持未指定的舵机位置）
-                            int current_positions[SERVO_COUNT];
-                            for (int j = 0; j < SERVO_COUNT; j++) {
-                                current_positions[j] = 90;  // 默认中间位置
-                            }
-                            // 手部舵机默认位置
-                            current_positions[LEFT_HAND] = 45;
-                            current_positions[RIGHT_HAND] = 180 - 45;
-                            
-                            for (int i = 0; i < array_size; i++) {
-                                cJSON* action_item = cJSON_GetArrayItem(actions, i);
-                                if (cJSON_IsObject(action_item)) {
-                                    // 检查是否为振荡器模式（短键名 "osc"）
-                                    cJSON* osc_item = cJSON_GetObjectItem(action_item, "osc");
-                                    if (cJSON_IsObject(osc_item)) {
-                                        // 振荡器模式 - 使用Execute2，以绝对角度为中心振荡
-                                        int amplitude[SERVO_COUNT] = {0};
-                                        int center_angle[SERVO_COUNT] = {0};
-                                        double phase_diff[SERVO_COUNT] = {0};
-                                        int period = 300;  // 默认周期300毫秒
-                                        float steps = 8.0;  // 默认步数8.0
-                                        
-                                        const char* servo_names[] = {"ll", "rl", "lf", "rf", "lh", "rh"};
-                                        
-                                        // 读取振幅（短键名 "a"），默认0度
-                                        for (int j = 0; j < SERVO_COUNT; j++) {
-                                            amplitude[j] = 0;  // 默认振幅0度
-                                        }
-                                        cJSON* amp_item = cJSON_GetObjectItem(osc_item, "a");
-                                        if (cJSON_IsObject(amp_item)) {
-                                            for (int j = 0; j < SERVO_COUNT; j++) {
-                                                cJSON* amp_value = cJSON_GetObjectItem(amp_item, servo_names[j]);
-                                                if (cJSON_IsNumber(amp_value)) {
-                                                    int amp = amp_value->valueint;
-                                                    if (amp >= 10 && amp <= 90) {
-                                                        amplitude[j] = amp;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        
-                                        // 读取中心角度（短键名 "o"），默认90度（绝对角度0-180度）
-                                        for (int j = 0; j < SERVO_COUNT; j++) {
-                                            center_angle[j] = 90;  // 默认中心角度90度（中间位置）
-                                        }
-                                        cJSON* center_item = cJSON_GetObjectItem(osc_item, "o");
-                                        if (cJSON_IsObject(center_item)) {
-                                            for (int j = 0; j < SERVO_COUNT; j++) {
-                                                cJSON* center_value = cJSON_GetObjectItem(center_item, servo_names[j]);
-                                                if (cJSON_IsNumber(center_value)) {
-                                                    int center = center_value->valueint;
-                                                    if (center >= 0 && center <= 180) {
-                                                        center_angle[j] = center;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                        
-                                        // 安全检查：防止左右腿脚同时做大幅度振荡（振幅检查）
-                                        const int LARGE_AMPLITUDE_THRESHOLD = 40;  // 大幅度振幅阈值：40度
-                                        bool left_leg_large = amplitude[LEFT_LEG] >= LARGE_AMPLITUDE_THRESHOLD;
-                                        bool right_leg_large = amplitude[RIGHT_LEG] >= LARGE_AMPLITUDE_THRESHOLD;
-                                        bool left_foot_large = amplitude[LEFT_FOOT] >= LARGE_AMPLITUDE_THRESHOLD;
-                                        bool right_foot_large = amplitude[RIGHT_FOOT] >= LARGE_AMPLITUDE_THRESHOLD;
-                                        
-                                        if (left_leg_large && right_leg_large) {
-                                            ESP_LOGW(TAG, "检测到左右腿同时大幅度振荡，限制右腿振幅");
-                                            amplitude[RIGHT_LEG] = 0;  // 禁止右腿振荡
-                                        }
-                                        if (left_foot_large && right_foot_large) {
-                                            ESP_LOGW(TAG, "检测到左右脚同时大幅度振荡，限制右脚振幅");
-                                            amplitude[RIGHT_FOOT] = 0;  // 禁止右脚振荡
-                                        }
-                                        
-                                        // 读取相位差（短键名 "ph"，单位为度，转换为弧度）
-                                        cJSON* phase_item = cJSON_GetObjectItem(osc_item, "ph");
-                                        if (cJSON_IsObject(phase_item)) {
-                                            for (int j = 0; j < SERVO_COUNT; j++) {
-                                                cJSON* phase_value = cJSON_GetObjectItem(phase_item, servo_names[j]);
-                                                if (cJSON_IsNumber(phase_value)) {
-                                                    // 将度数转换为弧度
-                                                    phase_diff[j] = phase_value->valuedouble * 3.141592653589793 / 180.0;
-                                                }
-                                            }
-                                        }
-                                        
-                                        // 读取周期（短键名 "p"），范围100-3000毫秒
-                                        cJSON* period_item = cJSON_GetObjectItem(osc_item, "p");
-                                        if (cJSON_IsNumber(period_item)) {
-                                            period = period_item->valueint;
-                                            if (period < 100) period = 100;
-                                            if (period > 3000) period = 3000;  // 与描述一致，限制3000毫秒
-                                        }
-                                        
-                                        // 读取周期数（短键名 "c"），范围0.1-20.0
-                                        cJSON* steps_item = cJSON_GetObjectItem(osc_item, "c");
-                                        if (cJSON_IsNumber(steps_item)) {
-                                            steps = (float)steps_item->valuedouble;
-                                            if (steps < 0.1) steps = 0.1;
-                                            if (steps > 20.0) steps = 20.0;  // 与描述一致，限制20.0
-                                        }
-                                        
-                                        // 执行振荡 - 使用Execute2，以绝对角度为中心
-                                        ESP_LOGI(TAG, "执行振荡动作%d: period=%d, steps=%.1f", i, period, steps);
-                                        controller->otto_.Execute2(amplitude, center_angle, period, phase_diff, steps);
-                                        
-                                        // 振荡后更新位置（使用center_angle作为最终位置）
-                                        for (int j = 0; j < SERVO_COUNT; j++) {
-                                            current_positions[j] = center_angle[j];
-                                        }
-                                    } else {
-                                        // 普通移动模式
-                                        // 从当前位置数组复制，保持未指定的舵机位置
-                                        int servo_target[SERVO_COUNT];
-                                        for (int j = 0; j < SERVO_COUNT; j++) {
-                                            servo_target[j] = current_positions[j];
-                                        }
-                                        
-                                        // 从JSON中读取舵机位置（短键名 "s"）
-                                        cJSON* servos_item = cJSON_GetObjectItem(action_item, "s");
-                                        if (cJSON_IsObject(servos_item)) {
-                                            // 短键名：ll/rl/lf/rf/lh/rh
-                                            const char* servo_names[] = {"ll", "rl", "lf", "rf", "lh", "rh"};
-                                            
-                                            for (int j = 0; j < SERVO_COUNT; j++) {
-                                                cJSON* servo_value = cJSON_GetObjectItem(servos_item, servo_names[j]);
-                                                if (cJSON_IsNumber(servo_value)) {
-                                                    int position = servo_value->valueint;
-                                                    // 限制位置范围在0-180度
-                                                    if (position >= 0 && position <= 180) {
-                                                        servo_target[j] = position;
-                                                    }
-                                                }
-                                            }
-                                        }
-                                                                                                                    
-                                        // 获取移动速度（短键名 "v"，默认1000毫秒）
-                                        int speed = 1000;
-                                        cJSON* speed_item = cJSON_GetObjectItem(action_item, "v");
-                                        if (cJSON_IsNumber(speed_item)) {
-                                            speed = speed_item->valueint;
-                                            if (speed < 100) speed = 100;  // 最小100毫秒
-                                            if (speed > 3000) speed = 3000;  // 最大3000毫秒
-                                        }
-                                        
-                                        // 执行舵机移动
-                                        ESP_LOGI(TAG, "执行动作%d: ll=%d, rl=%d, lf=%d, rf=%d, v=%d",
-                                                 i, servo_target[LEFT_LEG], servo_target[RIGHT_LEG],
-                                                 servo_target[LEFT_FOOT], servo_target[RIGHT_FOOT], speed);
-                                        controller->otto_.MoveServos(speed, servo_target);
-                                        
-                                        // 更新当前位置数组，用于下一个动作
-                                        for (int j = 0; j < SERVO_COUNT; j++) {
-                                            current_positions[j] = servo_target[j];
-                                        }
-                                    }
-                                    
-                                    // 获取动作后的延迟时间（短键名 "d"）
-                                    int delay_after = 0;
-                                    cJSON* delay_item = cJSON_GetObjectItem(action_item, "d");
-                                    if (cJSON_IsNumber(delay_item)) {
-                                        delay_after = delay_item->valueint;
-                                        if (delay_after < 0) delay_after = 0;
-                                    }
-                                    
-                                    // 动作后的延迟（最后一个动作后不延迟）
-                                    if (delay_after > 0 && i < array_size - 1) {
-                                        ESP_LOGI(TAG, "动作%d执行完成，延迟%d毫秒", i, delay_after);
-                                        vTaskDelay(pdMS_TO_TICKS(delay_after));
-                                    }
-                                }
-                            }
-                            
-                            // 序列执行完成后的延迟（用于序列之间的停顿）
-                            if (sequence_delay > 0) {
-                                // 检查队列中是否还有待执行的序列
-                                UBaseType_t queue_count = uxQueueMessagesWaiting(controller->action_queue_);
-                                if (queue_count > 0) {
-                                    ESP_LOGI(TAG, "序列执行完成，延迟%d毫秒后执行下一个序列（队列中还有%d个序列）", 
-                                             sequence_delay, queue_count);
-                                    vTaskDelay(pdMS_TO_TICKS(sequence_delay));
-                                }
-                            }
-                            // 释放JSON内存
-                            cJSON_Delete(json);
-                        } else {
-                            ESP_LOGE(TAG, "舵机序列格式错误: 'a'不是数组");
-                            cJSON_Delete(json);
+                    // 播放入队时已编译好的舵机序列
+                    ESP_LOGI(TAG, "执行舵机序列，共%u段，时长%lu毫秒", params.motion->segments().size(),
+                             params.motion->duration_ms());
+                    bool completed = controller->otto_.PlayMotion(std::move(*params.motion));
+                    delete params.motion;
+
+                    // 序列执行完成后的延迟（用于序列之间的停顿）
+                    if (completed && params.sequence_delay > 0) {
+                        // 检查队列中是否还有待执行的序列
+                        UBaseType_t queue_count = uxQueueMessagesWaiting(controller->action_queue_);
+                        if (queue_count > 0) {
+                            ESP_LOGI(TAG, "序列执行完成，延迟%d毫秒后执行下一个序列（队列中还有%d个序列）",
+                                     params.sequence_delay, queue_count);
+                            controller->otto_.Pause(params.sequence_delay);
                         }
-                    } else {
-                        // 获取cJSON的错误信息
-                        const char* error_ptr = cJSON_GetErrorPtr();
-                        int json_len = strlen(params.servo_sequence_json);
-                        ESP_LOGE(TAG, "解析舵机序列JSON失败，长度=%d，错误位置: %s", json_len, 
-                                 error_ptr ? error_ptr : "未知");
-                        ESP_LOGE(TAG, "JSON内容: %s", params.servo_sequence_json);
                     }
                 } else {
                     // 执行预定义动作
@@ -440,42 +258,198 @@ private:
         ESP_LOGI(TAG, "动作控制: 类型=%d, 步数=%d, 速度=%d, 方向=%d, 幅度=%d", action_type, steps,
                  speed, direction, amount);
 
-        OttoActionParams params = {action_type, steps, speed, direction, amount, ""};
+        OttoActionParams params = {action_type, steps, speed, direction, amount, nullptr, 0, GetStopGeneration()};
         xQueueSend(action_queue_, &params, portMAX_DELAY);
         StartActionTaskIfNeeded();
     }
 
+    // 将舵机序列JSON编译为运动表，动作任务只需播放，无需再解析JSON
+    static ServoMotion* CompileServoSequence(cJSON* json, int& sequence_delay) {
+        // 使用短键名 "a" 表示动作数组
+        cJSON* actions = cJSON_GetObjectItem(json, "a");
+        if (!cJSON_IsArray(actions)) {
+            ESP_LOGE(TAG, "舵机序列格式错误: 'a'不是数组");
+            return nullptr;
+        }
+
+        // 获取序列执行完成后的延迟（短键名 "d"，顶层参数）
+        sequence_delay = 0;
+        cJSON* delay_item = cJSON_GetObjectItem(json, "d");
+        if (cJSON_IsNumber(delay_item)) {
+            sequence_delay = std::max(delay_item->valueint, 0);
+        }
+
+        // 短键名：ll/rl/lf/rf/lh/rh
+        const char* servo_names[] = {"ll", "rl", "lf", "rf", "lh", "rh"};
+
+        // 当前舵机位置（用于保持未指定的舵机位置）
+        int current_positions[SERVO_COUNT];
+        for (int j = 0; j < SERVO_COUNT; j++) {
+            current_positions[j] = 90;  // 默认中间位置
+        }
+        // 手部舵机默认位置
+        current_positions[LEFT_HAND] = 45;
+        current_positions[RIGHT_HAND] = 180 - 45;
+
+        auto motion = new ServoMotion(SERVO_COUNT);
+        int array_size = cJSON_GetArraySize(actions);
+        for (int i = 0; i < array_size; i++) {
+            cJSON* action_item = cJSON_GetArrayItem(actions, i);
+            if (!cJSON_IsObject(action_item)) {
+                continue;
+            }
+
+            // 检查是否为振荡器模式（短键名 "osc"）
+            cJSON* osc_item = cJSON_GetObjectItem(action_item, "osc");
+            if (cJSON_IsObject(osc_item)) {
+                // 振荡器模式，以绝对角度为中心振荡
+                int amplitude[SERVO_COUNT] = {0};  // 默认振幅0度
+                int center_angle[SERVO_COUNT];
+                double phase_diff[SERVO_COUNT] = {0};
+                int period = 300;   // 默认周期300毫秒
+                float steps = 8.0;  // 默认步数8.0
+
+                // 读取振幅（短键名 "a"）
+                cJSON* amp_item = cJSON_GetObjectItem(osc_item, "a");
+                if (cJSON_IsObject(amp_item)) {
+                    for (int j = 0; j < SERVO_COUNT; j++) {
+                        cJSON* amp_value = cJSON_GetObjectItem(amp_item, servo_names[j]);
+                        if (cJSON_IsNumber(amp_value) && amp_value->valueint >= 10 && amp_value->valueint <= 90) {
+                            amplitude[j] = amp_value->valueint;
+                        }
+                    }
+                }
+
+                // 读取中心角度（短键名 "o"），默认90度（绝对角度0-180度）
+                for (int j = 0; j < SERVO_COUNT; j++) {
+                    center_angle[j] = 90;
+                }
+                cJSON* center_item = cJSON_GetObjectItem(osc_item, "o");
+                if (cJSON_IsObject(center_item)) {
+                    for (int j = 0; j < SERVO_COUNT; j++) {
+                        cJSON* center_value = cJSON_GetObjectItem(center_item, servo_names[j]);
+                        if (cJSON_IsNumber(center_value) && center_value->valueint >= 0 && center_value->valueint <= 180) {
+                            center_angle[j] = center_value->valueint;
+                        }
+                    }
+                }
+
+                // 安全检查：防止左右腿脚同时做大幅度振荡（振幅检查）
+                const int LARGE_AMPLITUDE_THRESHOLD = 40;  // 大幅度振幅阈值：40度
+                if (amplitude[LEFT_LEG] >= LARGE_AMPLITUDE_THRESHOLD && amplitude[RIGHT_LEG] >= LARGE_AMPLITUDE_THRESHOLD) {
+                    ESP_LOGW(TAG, "检测到左右腿同时大幅度振荡，限制右腿振幅");
+                    amplitude[RIGHT_LEG] = 0;  // 禁止右腿振荡
+                }
+                if (amplitude[LEFT_FOOT] >= LARGE_AMPLITUDE_THRESHOLD && amplitude[RIGHT_FOOT] >= LARGE_AMPLITUDE_THRESHOLD) {
+                    ESP_LOGW(TAG, "检测到左右脚同时大幅度振荡，限制右脚振幅");
+                    amplitude[RIGHT_FOOT] = 0;  // 禁止右脚振荡
+                }
+
+                // 读取相位差（短键名 "ph"，单位为度，转换为弧度）
+                cJSON* phase_item = cJSON_GetObjectItem(osc_item, "ph");
+                if (cJSON_IsObject(phase_item)) {
+                    for (int j = 0; j < SERVO_COUNT; j++) {
+                        cJSON* phase_value = cJSON_GetObjectItem(phase_item, servo_names[j]);
+                        if (cJSON_IsNumber(phase_value)) {
+                            phase_diff[j] = phase_value->valuedouble * 3.141592653589793 / 180.0;
+                        }
+                    }
+                }
+
+                // 读取周期（短键名 "p"），范围100-3000毫秒
+                cJSON* period_item = cJSON_GetObjectItem(osc_item, "p");
+                if (cJSON_IsNumber(period_item)) {
+                    period = std::min(std::max(period_item->valueint, 100), 3000);
+                }
+
+                // 读取周期数（短键名 "c"），范围0.1-20.0
+                cJSON* steps_item = cJSON_GetObjectItem(osc_item, "c");
+                if (cJSON_IsNumber(steps_item)) {
+                    steps = std::min(std::max((float)steps_item->valuedouble, 0.1f), 20.0f);
+                }
+
+                ESP_LOGD(TAG, "振荡动作%d: period=%d, steps=%.1f", i, period, steps);
+                motion->Oscillate(period, steps, amplitude, center_angle, phase_diff);
+
+                // 振荡后以中心角度作为后续动作的位置
+                for (int j = 0; j < SERVO_COUNT; j++) {
+                    current_positions[j] = center_angle[j];
+                }
+            } else {
+                // 普通移动模式，未指定的舵机保持当前位置（短键名 "s"）
+                cJSON* servos_item = cJSON_GetObjectItem(action_item, "s");
+                if (cJSON_IsObject(servos_item)) {
+                    for (int j = 0; j < SERVO_COUNT; j++) {
+                        cJSON* servo_value = cJSON_GetObjectItem(servos_item, servo_names[j]);
+                        // 限制位置范围在0-180度
+                        if (cJSON_IsNumber(servo_value) && servo_value->valueint >= 0 && servo_value->valueint <= 180) {
+                            current_positions[j] = servo_value->valueint;
+                        }
+                    }
+                }
+
+                // 获取移动速度（短键名 "v"，默认1000毫秒，范围100-3000毫秒）
+                int speed = 1000;
+                cJSON* speed_item = cJSON_GetObjectItem(action_item, "v");
+                if (cJSON_IsNumber(speed_item)) {
+                    speed = std::min(std::max(speed_item->valueint, 100), 3000);
+                }
+
+                ESP_LOGD(TAG, "移动动作%d: ll=%d, rl=%d, lf=%d, rf=%d, v=%d", i, current_positions[LEFT_LEG],
+                         current_positions[RIGHT_LEG], current_positions[LEFT_FOOT], current_positions[RIGHT_FOOT], speed);
+                motion->Move(speed, current_positions);
+            }
+
+            // 动作后的延迟（短键名 "d"，最后一个动作后不延迟）
+            cJSON* action_delay_item = cJSON_GetObjectItem(action_item, "d");
+            if (cJSON_IsNumber(action_delay_item) && i < array_size - 1) {
+                motion->Hold(action_delay_item->valueint);
+            }
+        }
+        return motion;
+    }
+
     void QueueServoSequence(const char* servo_sequence_json) {
-        if (servo_sequence_json == nullptr) {
-            ESP_LOGE(TAG, "序列JSON为空");
+        if (servo_sequence_json == nullptr || servo_sequence_json[0] == '\0') {
+            ESP_LOGW(TAG, "序列JSON为空");
             return;
         }
-        
-        int input_len = strlen(servo_sequence_json);
-        const int buffer_size = 512;  // servo_sequence_json数组大小
-        ESP_LOGI(TAG, "队列舵机序列，输入长度=%d，缓冲区大小=%d", input_len, buffer_size);
-        
-        if (input_len >= buffer_size) {
-            ESP_LOGE(TAG, "JSON字符串太长！输入长度=%d，最大允许=%d", input_len, buffer_size - 1);
+
+        cJSON* json = cJSON_Parse(servo_sequence_json);
+        if (json == nullptr) {
+            // 获取cJSON的错误信息
+            const char* error_ptr = cJSON_GetErrorPtr();
+            ESP_LOGE(TAG, "解析舵机序列JSON失败，长度=%d，错误位置: %s", (int)strlen(servo_sequence_json),
+                     error_ptr ? error_ptr : "未知");
+            ESP_LOGE(TAG, "JSON内容: %s", servo_sequence_json);
             return;
         }
-        
-        if (input_len == 0) {
-            ESP_LOGW(TAG, "序列JSON为空字符串");
+        int sequence_delay = 0;
+        ServoMotion* motion = CompileServoSequence(json, sequence_delay);
+        cJSON_Delete(json);
+        if (motion == nullptr) {
             return;
         }
-        
-        OttoActionParams params = {ACTION_SERVO_SEQUENCE, 0, 0, 0, 0, ""};
-        // 复制JSON字符串到结构体中（限制长度）
-        strncpy(params.servo_sequence_json, servo_sequence_json, sizeof(params.servo_sequence_json) - 1);
-        params.servo_sequence_json[sizeof(params.servo_sequence_json) - 1] = '\0';
-        
-        ESP_LOGD(TAG, "序列已加入队列: %s", params.servo_sequence_json);
-        
+
+        ESP_LOGI(TAG, "舵机序列已编译: %u段，时长%lu毫秒", motion->segments().size(), motion->duration_ms());
+        OttoActionParams params = {ACTION_SERVO_SEQUENCE, 0, 0, 0, 0, motion, sequence_delay, GetStopGeneration()};
         xQueueSend(action_queue_, &params, portMAX_DELAY);
         StartActionTaskIfNeeded();
     }
 
+    // 清空动作队列，并释放其中尚未播放的舵机序列
+    uint32_t GetStopGeneration() {
+        std::lock_guard<std::mutex> lock(stop_mutex_);
+        return stop_generation_;
+    }
+
+    void ClearActionQueue() {
+        OttoActionParams params;
+        while (xQueueReceive(action_queue_, &params, 0) == pdTRUE) {
+            delete params.motion;
+        }
+    }
+
     void LoadTrimsFromNVS() {
         Settings settings("otto_trims", false);
 
@@ -702,13 +676,14 @@ public:
 
         mcp_server.AddTool("self.otto.stop", "立即停止所有动作并复位", PropertyList(),
                            [this](const PropertyList& properties) -> ReturnValue {
-                               if (action_task_handle_ != nullptr) {
-                                   vTaskDelete(action_task_handle_);
-                                   action_task_handle_ = nullptr;
+                               // 中断正在播放的动作，动作任务随即结束当前动作并恢复电量更新；
+                               // 已出队但尚未开始的动作因停止代数变化而被跳过
+                               {
+                                   std::lock_guard<std::mutex> lock(stop_mutex_);
+                                   stop_generation_++;
+                                   otto_.Stop();
                                }
-                               is_action_in_progress_ = false;
-                               PowerManager::ResumeBatteryUpdate();  // 停止动作时恢复电量更新
-                               xQueueReset(action_queue_);
+                               ClearActionQueue();
 
                                QueueAction(ACTION_HOME, 1, 1000, 1, 0);
                                return true;
@@ -835,6 +810,7 @@ public:
             vTaskDelete(action_task_handle_);
             action_task_handle_ = nullptr;
         }
+        ClearActionQueue();
         vQueueDelete(action_queue_);
     }
 };
@@ -9,7 +9,13 @@ static const char* TAG = "OttoMovements";
 
 #define HAND_HOME_POSITION 45
 
-Otto::Otto() {
+Otto::Otto()
+    : player_(SERVO_COUNT, [this](int servo) { return servo_[servo].GetPosition(); },
+              [this](int servo, int position) {
+                  if (servo_pins_[servo] != -1) {
+                      servo_[servo].SetPosition(position);
+                  }
+              }) {
     is_otto_resting_ = false;
     has_hands_ = false;
     // 初始化所有舵机管脚为-1（未连接）
@@ -92,53 +98,9 @@ void Otto::MoveServos(int time, int servo_target[]) {
         SetRestState(false);
     }
 
-    final_time_ = millis() + time;
-    if (time > 10) {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                increment_[i] = (servo_target[i] - servo_[i].GetPosition()) / (time / 10.0);
-            }
-        }
-
-        for (int iteration = 1; millis() < final_time_; iteration++) {
-            partial_time_ = millis() + 10;
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_[i].GetPosition() + increment_[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-        }
-    } else {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                servo_[i].SetPosition(servo_target[i]);
-            }
-        }
-        vTaskDelay(pdMS_TO_TICKS(time));
-    }
-
-    // final adjustment to the target.
-    bool f = true;
-    int adjustment_count = 0;
-    while (f && adjustment_count < 10) {
-        f = false;
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1 && servo_target[i] != servo_[i].GetPosition()) {
-                f = true;
-                break;
-            }
-        }
-        if (f) {
-            for (int i = 0; i < SERVO_COUNT; i++) {
-                if (servo_pins_[i] != -1) {
-                    servo_[i].SetPosition(servo_target[i]);
-                }
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-            adjustment_count++;
-        }
-    };
+    ServoMotion motion(SERVO_COUNT);
+    motion.Move(time, servo_target);
+    player_.Play(std::move(motion));
 }
 
 void Otto::MoveSingle(int position, int servo_number) {
@@ -158,27 +120,14 @@ void Otto::MoveSingle(int position, int servo_number) {
 
 void Otto::OscillateServos(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
                            double phase_diff[SERVO_COUNT], float cycle = 1) {
+    int center[SERVO_COUNT];
     for (int i = 0; i < SERVO_COUNT; i++) {
-        if (servo_pins_[i] != -1) {
-            servo_[i].SetO(offset[i]);
-            servo_[i].SetA(amplitude[i]);
-            servo_[i].SetT(period);
-            servo_[i].SetPh(phase_diff[i]);
-        }
+        center[i] = offset[i] + 90;
     }
 
-    double ref = millis();
-    double end_time = period * cycle + ref;
-
-    while (millis() < end_time) {
-        for (int i = 0; i < SERVO_COUNT; i++) {
-            if (servo_pins_[i] != -1) {
-                servo_[i].Refresh();
-            }
-        }
-        vTaskDelay(5);
-    }
-    vTaskDelay(pdMS_TO_TICKS(10));
+    ServoMotion motion(SERVO_COUNT);
+    motion.Oscillate(period, cycle, amplitude, center, phase_diff);
+    player_.Play(std::move(motion));
 }
 
 void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int period,
@@ -187,16 +136,8 @@ void Otto::Execute(int amplitude[SERVO_COUNT], int offset[SERVO_COUNT], int peri
         SetRestState(false);
     }
 
-    int cycles = (int)steps;
-
-    //-- Execute complete cycles
-    if (cycles >= 1)
-        for (int i = 0; i < cycles; i++)
-            OscillateServos(amplitude, offset, period, phase_diff);
-
-    //-- Execute the final not complete cycle
-    OscillateServos(amplitude, offset, period, phase_diff, (float)steps - cycles);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    //-- All the cycles, including the final not complete one, are a single oscillation
+    OscillateServos(amplitude, offset, period, phase_diff, steps);
 }
 
 //---------------------------------------------------------
@@ -214,22 +155,9 @@ void Otto::Execute2(int amplitude[SERVO_COUNT], int center_angle[SERVO_COUNT], i
         SetRestState(false);
     }
 
-    // 将绝对角度转换为offset（offset = center_angle - 90）
-    int offset[SERVO_COUNT];
-    for (int i = 0; i < SERVO_COUNT; i++) {
-        offset[i] = center_angle[i] - 90;
-    }
-
-    int cycles = (int)steps;
-
-    //-- Execute complete cycles
-    if (cycles >= 1)
-        for (int i = 0; i < cycles; i++)
-            OscillateServos(amplitude, offset, period, phase_diff);
-
-    //-- Execute the final not complete cycle
-    OscillateServos(amplitude, offset, period, phase_diff, (float)steps - cycles);
-    vTaskDelay(pdMS_TO_TICKS(10));
+    ServoMotion motion(SERVO_COUNT);
+    motion.Oscillate(period, steps, amplitude, center_angle, phase_diff);
+    player_.Play(std::move(motion));
 }
 
 ///////////////////////////////////////////////////////////////////
@@ -259,10 +187,10 @@ void Otto::Home(bool hands_down) {
         }
 
         MoveServos(700, homes);
-        is_otto_resting_ = true;
+        is_otto_resting_ = !player_.IsCancelled();
     }
 
-    vTaskDelay(pdMS_TO_TICKS(200));
+    player_.Pause(200);
 }
 
 bool Otto::GetRestState() {
@@ -400,7 +328,7 @@ void Otto::Bend(int steps, int period, int dir) {
     for (int i = 0; i < steps; i++) {
         MoveServos(T2 / 2, bend1);
         MoveServos(T2 / 2, bend2);
-        vTaskDelay(pdMS_TO_TICKS(period * 0.8));
+        player_.Pause(period * 0.8);
         MoveServos(500, homes);
     }
 }
@@ -451,7 +379,7 @@ void Otto::ShakeLeg(int steps, int period, int dir) {
         MoveServos(500, homes);  // Return to home position
     }
 
-    vTaskDelay(pdMS_TO_TICKS(period));
+    player_.Pause(period);
 }
 
 //---------------------------------------------------------
@@ -644,7 +572,7 @@ void Otto::WhirlwindLeg(float steps, int period, int amplitude) {
     MoveServos(100, target);
     target[RIGHT_FOOT] = 160;
     MoveServos(500, target);
-    vTaskDelay(pdMS_TO_TICKS(1000));
+    player_.Pause(1000);
 
     int C[SERVO_COUNT] = {90, 90, 180, 160, 45, 20};
     int A[SERVO_COUNT] = {amplitude, 0, 0, 0, amplitude, 0};
@@ -785,7 +713,7 @@ void Otto::Fitness(float steps, int period, int amplitude) {
     MoveServos(100, target);
     target[LEFT_FOOT] = 20;
     MoveServos(400, target);
-    vTaskDelay(pdMS_TO_TICKS(2000));
+    player_.Pause(2000);
 
     int C[SERVO_COUNT] = {90, 90, 20, 90, 160, 135};
     int A[SERVO_COUNT] = {0, 0, 0, 0, 0, amplitude};
@@ -909,44 +837,63 @@ void Otto::Showcase() {
 
     // 1. 往前走3步
     Walk(3, 1000, FORWARD, 50);
-    vTaskDelay(pdMS_TO_TICKS(500));
+    player_.Pause(500);
 
     // 2. 挥挥手
     if (has_hands_) {
         HandWave(LEFT);
-        vTaskDelay(pdMS_TO_TICKS(500));
+        player_.Pause(500);
     }
 
     // 3. 跳舞（使用广播体操）
     if (has_hands_) {
         RadioCalisthenics();
-        vTaskDelay(pdMS_TO_TICKS(500));
+        player_.Pause(500);
     }
 
     // 4. 太空步
     Moonwalker(3, 900, 25, LEFT);
-    vTaskDelay(pdMS_TO_TICKS(500));
+    player_.Pause(500);
 
     // 5. 摇摆
     Swing(3, 1000, 30);
-    vTaskDelay(pdMS_TO_TICKS(500));
+    player_.Pause(500);
 
     // 6. 起飞
     if (has_hands_) {
         Takeoff(5, 300, 40);
-        vTaskDelay(pdMS_TO_TICKS(500));
+        player_.Pause(500);
     }
 
     // 7. 健身
     if (has_hands_) {
         Fitness(5, 1000, 25);
-        vTaskDelay(pdMS_TO_TICKS(500));
+        player_.Pause(500);
     }
 
     // 8. 往后走3步
     Walk(3, 1000, BACKWARD, 50);
 }
 
+bool Otto::PlayMotion(ServoMotion&& motion) {
+    if (GetRestState() == true) {
+        SetRestState(false);
+    }
+    return player_.Play(std::move(motion));
+}
+
+bool Otto::Pause(int duration_ms) {
+    return player_.Pause(duration_ms);
+}
+
+void Otto::Stop() {
+    player_.Cancel();
+}
+
+void Otto::Resume() {
+    player_.Resume();
+}
+
 void Otto::EnableServoLimit(int diff_limit) {
     for (int i = 0; i < SERVO_COUNT; i++) {
         if (servo_pins_[i] != -1) {
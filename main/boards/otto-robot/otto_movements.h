@@ -7,6 +7,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "oscillator.h"
+#include "servo_motion_player.h"
 
 //-- Constants
 #define FORWARD 1
@@ -54,6 +55,12 @@ public:
     void Execute2(int amplitude[SERVO_COUNT], int center_angle[SERVO_COUNT], int period,
                   double phase_diff[SERVO_COUNT], float steps);
 
+    //-- Motion playback, Stop() aborts the running motion and skips motions until Resume()
+    bool PlayMotion(ServoMotion&& motion);
+    bool Pause(int duration_ms);
+    void Stop();
+    void Resume();
+
     //-- HOME = Otto at rest position
     void Home(bool hands_down = true);
     bool GetRestState();
@@ -102,9 +109,7 @@ private:
     int servo_pins_[SERVO_COUNT];
     int servo_trim_[SERVO_COUNT];
 
-    unsigned long final_time_;
-    unsigned long partial_time_;
-    float increment_[SERVO_COUNT];
+    ServoMotionPlayer player_;
 
     bool is_otto_resting_;
     bool has_hands_;  // 是否有手部舵机
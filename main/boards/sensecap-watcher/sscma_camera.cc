@@ -9,6 +9,7 @@
 
 #include <esp_log.h>
 #include <esp_heap_caps.h>
+#include <algorithm>
 #include <cstring>
 #include "application.h"
 #include "sscma_client_commands.h"
@@ -17,6 +18,18 @@
 
 #define IMG_JPEG_BUF_SIZE   48 * 1024
 
+// 检测结果队列长度，队列满时丢弃最旧的结果
+#define SSCMA_DETECTION_QUEUE_SIZE  8
+// Himax超过该时间没有任何消息时进行保活检查
+#define SSCMA_KEEPALIVE_INTERVAL_MS 10000
+// 分数滞回：已检测到的目标在分数低于阈值该值以内时仍视为存在
+#define SSCMA_DETECT_HYSTERESIS     10
+
+#define SSCMA_EVENT_DETECTION       (1 << 0)
+#define SSCMA_EVENT_STATE_CHANGED   (1 << 1)
+#define SSCMA_EVENT_CONFIG_CHANGED  (1 << 2)
+#define SSCMA_EVENT_RESTARTED       (1 << 3)
+
 static bool __himax_keepalive_check(sscma_client_handle_t client)
 {
     esp_err_t ret = ESP_OK;
@@ -67,12 +80,11 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
     sscma_client_new(sscma_client_io_handle_, &sscma_client_config, &sscma_client_handle_);
 
     sscma_data_queue_ = xQueueCreate(1, sizeof(SscmaData));
+    detection_queue_ = xQueueCreate(SSCMA_DETECTION_QUEUE_SIZE, sizeof(DetectionResult));
+    event_group_ = xEventGroupCreate();
 
     sscma_client_callback_t callback = {0};
 
-    detection_state = SscmaCamera::IDLE;
-    state_start_time = 0;
-    need_start_cooldown = false;
     callback.on_event = [](sscma_client_handle_t client, const sscma_client_reply_t *reply, void *user_ctx) {
         SscmaCamera* self = static_cast<SscmaCamera*>(user_ctx);
         if (!self) return;
@@ -85,8 +97,9 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
         sscma_client_class_t *classes = NULL;
         int point_count = 0;
         sscma_client_point_t  *points = NULL;
-        int model_type = 0;
-        int obj_cnt = 0;
+
+        int64_t now = esp_timer_get_time();
+        self->last_reply_us_ = now;
 
         int width = 0, height = 0;
         cJSON *data = cJSON_GetObjectItem(reply->payload, "data");
@@ -101,135 +114,46 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
         switch ((width+height)) {
             case (416+416): 
             {
-                bool is_object_detected = false;
-                bool is_need_wake = false;
-                
-                // 定期更新检测配置参数，避免频繁NVS访问
-                int64_t cur_tm = esp_timer_get_time();
+                // 只提取检测目标的分数，状态判断由检测任务完成，不阻塞SSCMA处理任务
+                DetectionResult result = {now, -1, 0};
+                auto match = [self, &result](int target, int score) {
+                    if (target != self->detect_target) {
+                        return;
+                    }
+                    if (score > result.score) {
+                        result.score = score;
+                    }
+                    if (score > self->detect_threshold && result.count < UINT8_MAX) {
+                        result.count++;
+                    }
+                };
 
-                // 尝试获取检测框数据（目标检测模型）
                 if (sscma_utils_fetch_boxes_from_reply(reply, &boxes, &box_count) == ESP_OK && box_count > 0) {
+                    // 目标检测模型
                     for (int i = 0; i < box_count; i++) {
-                        ESP_LOGI(TAG, "[box %d]: x=%d, y=%d, w=%d, h=%d, score=%d, target=%d", i,  \
+                        ESP_LOGD(TAG, "[box %d]: x=%d, y=%d, w=%d, h=%d, score=%d, target=%d", i,  \
                                 boxes[i].x, boxes[i].y, boxes[i].w, boxes[i].h, boxes[i].score, boxes[i].target);
-                        if (boxes[i].target == self->detect_target && boxes[i].score > self->detect_threshold) {
-                           is_object_detected = true;
-                           model_type = 0;
-                           obj_cnt++;
-                           break;
-                        }
+                        match(boxes[i].target, boxes[i].score);
                     }
                     free(boxes);
                 } else if (sscma_utils_fetch_classes_from_reply(reply, &classes, &class_count) == ESP_OK && class_count > 0) {
-                    // 尝试获取分类数据（分类模型）
+                    // 分类模型
                     for (int i = 0; i < class_count; i++) {
-                        ESP_LOGI(TAG, "[class %d]: target=%d, score=%d", i,
+                        ESP_LOGD(TAG, "[class %d]: target=%d, score=%d", i,
                                 classes[i].target, classes[i].score);
-                        if (classes[i].target == self->detect_target && classes[i].score > self->detect_threshold) {
-                           is_object_detected = true;
-                           model_type = 1;
-                           obj_cnt++;
-                        }
+                        match(classes[i].target, classes[i].score);
                     }
                     free(classes);
                 } else if (sscma_utils_fetch_points_from_reply(reply, &points, &point_count) == ESP_OK && point_count > 0) {
-                     // 尝试获取关键点数据（姿态估计模型）
+                    // 关键点模型（姿态估计）
                     for (int i = 0; i < point_count; i++) {
-                        ESP_LOGI(TAG, "[point %d]: x=%d, y=%d, z=%d, score=%d, target=%d", i, 
+                        ESP_LOGD(TAG, "[point %d]: x=%d, y=%d, z=%d, score=%d, target=%d", i, 
                                 points[i].x, points[i].y, points[i].z, points[i].score, points[i].target);
-                        if (points[i].target == self->detect_target && points[i].score > self->detect_threshold) {
-                           is_object_detected = true;
-                           model_type = 2;
-                           obj_cnt++;
-                        }
+                        match(points[i].target, points[i].score);
                     }
                     free(points);
                 }
-
-                // 如果需要开始冷却期，现在开始计时
-                if (self->need_start_cooldown) { // 回调暂停，标志保持，等待回调恢复后开始计时
-                    self->state_start_time = cur_tm;
-                    self->need_start_cooldown = false;
-                    ESP_LOGI(TAG, "Starting cooldown timer");
-                }
-                
-                // 状态机驱动的检测逻辑 - 只在人员出现时触发
-                switch (self->detection_state) {
-                    case SscmaCamera::IDLE:
-                        if (is_object_detected) {
-                            // 人员出现，开始验证（这是从无到有的转换）
-                            self->detection_state = SscmaCamera::VALIDATING;
-                            self->state_start_time = cur_tm; // 记录物体出现时间
-                            self->last_detected_time = cur_tm; // 初始化最后检测时间
-                            ESP_LOGI(TAG, "object appeared, starting validation");
-                        }
-                        break;
-                        
-                    case SscmaCamera::VALIDATING:
-                        if (is_object_detected) {
-                            // 更新最后检测到的时间
-                            self->last_detected_time = cur_tm;
-                            // 检查是否验证足够时间
-                            if ((cur_tm - self->state_start_time) >= (self->detect_duration_sec * 1000000)) {
-                                is_need_wake = true;
-                            }
-                        } else {
-                            // 验证期间人员离开，检查去抖动时间
-                            if (self->last_detected_time > 0 && 
-                                (cur_tm - self->last_detected_time) >= self->detect_debounce_sec * 1000000LL) {
-                                // 去抖动时间已过，确认人员已离开，回到空闲
-                                self->detection_state = SscmaCamera::IDLE;
-                                self->last_detected_time = 0;
-                                ESP_LOGI(TAG, "object left during validation (debounced), back to idle");
-                            }
-                        }
-                        break;
-                        
-                    case SscmaCamera::COOLDOWN:
-                        // 冷却期，需要满足两个条件：1)object离开 2)过了15秒
-                        if (!is_object_detected && 
-                            (cur_tm - self->state_start_time) >= (self->detect_invoke_interval_sec * 1000000LL)) {
-                            // object离开且冷却时间到，回到空闲状态
-                            self->detection_state = SscmaCamera::IDLE;
-                            ESP_LOGI(TAG, "Cooldown complete and object left, back to idle - ready for next appearance");
-                        }
-                        // 其他情况继续保持冷却状态
-                        break;
-                }
-
-
-                if( is_need_wake ) {
-                    ESP_LOGI(TAG, "Validation complete, triggering conversation (type=%d, res=%dx%d)", 
-                             self->detect_target, width, height);
-                    
-                    // 触发对话
-                    std::string wake_word;
-                    if ( model_type  == 0 ) {
-                        std::string cached_target_name = "object";
-                        if( self->model != NULL && self->model->classes[self->detect_target] != NULL ) {
-                            cached_target_name = self->model->classes[self->detect_target];
-                        }
-                        wake_word = "<detect>" + std::to_string(obj_cnt) + " " + cached_target_name + " detected </detect>";
-                    } else if ( model_type  == 1 ) {
-                        std::string cached_target_name = "object";
-                        if( self->model != NULL && self->model->classes[self->detect_target] != NULL ) {
-                            cached_target_name = self->model->classes[self->detect_target];
-                        }
-                        wake_word = "<detect>" + std::to_string(obj_cnt) + " " + cached_target_name + " detected </detect>";
-                    } else if ( model_type  == 2 ) {
-                        std::string cached_target_name = "object";
-                        if( self->model != NULL && self->model->classes[self->detect_target] != NULL ) {
-                            cached_target_name = self->model->classes[self->detect_target];
-                        }
-                        wake_word = "<detect>" + std::to_string(obj_cnt) + " " + cached_target_name + " detected </detect>";
-                    }
-                    printf("wake_word:%s\n", wake_word.c_str());
-                    Application::GetInstance().WakeWordInvoke(wake_word);
-                    
-                    // 进入冷却状态，标记需要开始冷却期；如下变量将在会话结束后被使用，等待回调恢复后开始计时
-                    self->detection_state = SscmaCamera::COOLDOWN;
-                    self->need_start_cooldown = true;
-                }
+                self->PushDetection(result);
             }
                 break;
             case (640+480):
@@ -262,7 +186,7 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
         ESP_LOGI(TAG, "SSCMA client connected");
         SscmaCamera* self = static_cast<SscmaCamera*>(user_ctx);
         if (self) {
-            self->sscma_restarted_ = true;
+            xEventGroupSetBits(self->event_group_, SSCMA_EVENT_RESTARTED);
         }
     };
 
@@ -367,48 +291,30 @@ SscmaCamera::SscmaCamera(esp_io_expander_handle_t io_exp_handle) {
     ESP_LOGI(TAG, "initialize mcp tools");
     InitializeMcpTools();
 
-    xTaskCreate([](void* arg) {
-        auto this_ = (SscmaCamera*)arg;
-        bool is_inference = false;
-        int64_t last_keepalive_time = esp_timer_get_time();
-        while (true)
-        {
-            if (this_->sscma_restarted_) {
-                ESP_LOGI(TAG, "SSCMA restarted detected");
-                this_->sscma_restarted_ = false;
-                is_inference = false;
-            }
+    ApplyDetectionConfig();
 
-            if (esp_timer_get_time() - last_keepalive_time > 10 * 1000000) {
-                last_keepalive_time = esp_timer_get_time();
-                if (!__himax_keepalive_check(this_->sscma_client_handle_)) {
-                    ESP_LOGE(TAG, "restart himax");
-                    sscma_client_reset(this_->sscma_client_handle_);
-                    vTaskDelay(pdMS_TO_TICKS(100));
-                }
-            }
+    // 由状态变化驱动推理的开启与停止，无需轮询设备状态
+    auto& app = Application::GetInstance();
+    device_state_ = app.GetDeviceState();
+    state_listener_id_ = app.AddStateChangeListener([this](DeviceState old_state, DeviceState new_state) {
+        device_state_ = new_state;
+        xEventGroupSetBits(event_group_, SSCMA_EVENT_STATE_CHANGED);
+    });
+    if (state_listener_id_ < 0) {
+        ESP_LOGE(TAG, "Failed to add state change listener");
+    }
 
-            if (this_->inference_en && Application::GetInstance().GetDeviceState() == kDeviceStateIdle ) {
-                if (!is_inference) {
-                    ESP_LOGI(TAG, "Start inference (enable=1)");
-                    sscma_client_break(this_->sscma_client_handle_);
-                    sscma_client_set_model(this_->sscma_client_handle_, 4);
-                    sscma_client_set_sensor(this_->sscma_client_handle_, 1, 1, true); // 设置分辨率 416X416
-                    sscma_client_invoke(this_->sscma_client_handle_, -1, false, true);
-                    is_inference = true;
-                }
-            } else if (is_inference && (!this_->inference_en || Application::GetInstance().GetDeviceState() != kDeviceStateIdle))  {
-                ESP_LOGI(TAG, "Stop inference (enable=%d state=%d)", this_->inference_en, Application::GetInstance().GetDeviceState());
-                is_inference = false;
-                sscma_client_break(this_->sscma_client_handle_);
-            }
-            vTaskDelay(pdMS_TO_TICKS(200));
-        }
+    xTaskCreate([](void* arg) {
+        auto this_ = (SscmaCamera*)arg;
+        this_->DetectionTask();
     }, "sscma_camera", 4096, this, 1, nullptr);
 
 }
 
 SscmaCamera::~SscmaCamera() {
+    if (state_listener_id_ >= 0) {
+        Application::GetInstance().RemoveStateChangeListener(state_listener_id_);
+    }
     if (preview_image_.data) {
         heap_caps_free((void*)preview_image_.data);
         preview_image_.data = nullptr;
@@ -419,6 +325,12 @@ SscmaCamera::~SscmaCamera() {
     if (sscma_data_queue_) {
         vQueueDelete(sscma_data_queue_);
     }
+    if (detection_queue_) {
+        vQueueDelete(detection_queue_);
+    }
+    if (event_group_) {
+        vEventGroupDelete(event_group_);
+    }
     if (jpeg_data_.buf) {
         heap_caps_free(jpeg_data_.buf);
         jpeg_data_.buf = nullptr;
@@ -437,6 +349,151 @@ SscmaCamera::~SscmaCamera() {
     }
 }
 
+void SscmaCamera::PushDetection(const DetectionResult& result) {
+    frames_++;
+    if (xQueueSend(detection_queue_, &result, 0) != pdPASS) {
+        // 检测任务跟不上时丢弃最旧的结果，保证处理的是最新画面
+        DetectionResult oldest;
+        if (xQueueReceive(detection_queue_, &oldest, 0) == pdPASS) {
+            dropped_frames_++;
+        }
+        xQueueSend(detection_queue_, &result, 0);
+    }
+    xEventGroupSetBits(event_group_, SSCMA_EVENT_DETECTION);
+}
+
+void SscmaCamera::ApplyDetectionConfig() {
+    DetectionFilter::Config config;
+    config.threshold = detect_threshold;
+    config.hysteresis = SSCMA_DETECT_HYSTERESIS;
+    config.confirm_ms = detect_duration_sec * 1000;
+    config.release_ms = detect_debounce_sec * 1000;
+    config.cooldown_ms = detect_invoke_interval_sec * 1000;
+    detection_filter_.SetConfig(config);
+}
+
+void SscmaCamera::UpdateInference(bool& is_inference) {
+    DeviceState state = device_state_;
+    bool should_infer = inference_en && state == kDeviceStateIdle;
+    if (should_infer && !is_inference) {
+        ESP_LOGI(TAG, "Start inference (enable=1)");
+        // 推理暂停期间的验证已过期，冷却状态保留，直到目标离开
+        if (!detection_filter_.confirmed()) {
+            detection_filter_.Reset();
+        }
+        sscma_client_break(sscma_client_handle_);
+        sscma_client_set_model(sscma_client_handle_, 4);
+        sscma_client_set_sensor(sscma_client_handle_, 1, 1, true); // 设置分辨率 416X416
+        sscma_client_invoke(sscma_client_handle_, -1, false, true);
+        is_inference = true;
+    } else if (!should_infer && is_inference) {
+        ESP_LOGI(TAG, "Stop inference (enable=%d state=%d)", inference_en, state);
+        is_inference = false;
+        sscma_client_break(sscma_client_handle_);
+    }
+}
+
+void SscmaCamera::ProcessDetection(const DetectionResult& result) {
+    int64_t now = esp_timer_get_time();
+    int queue_delay_ms = (now - result.timestamp_us) / 1000;
+    if (queue_delay_ms > max_queue_delay_ms_) {
+        max_queue_delay_ms_ = queue_delay_ms;
+    }
+
+    switch (detection_filter_.Update(result.score, result.timestamp_us)) {
+        case DetectionFilter::kEventConfirmed: {
+            ESP_LOGI(TAG, "Validation complete after %d ms, triggering conversation (target=%d, count=%d)",
+                     (int)((result.timestamp_us - detection_filter_.first_seen_us()) / 1000), detect_target, result.count);
+            const char* target_name = "object";
+            if (model != NULL && detect_target >= 0 && detect_target < model_class_cnt) {
+                target_name = model->classes[detect_target];
+            }
+            std::string wake_word = "<detect>" + std::to_string(std::max<int>(result.count, 1)) + " " + target_name + " detected </detect>";
+            ESP_LOGI(TAG, "wake_word: %s", wake_word.c_str());
+            triggers_++;
+            trigger_frame_us_ = result.timestamp_us;
+            Application::GetInstance().WakeWordInvoke(wake_word);
+            break;
+        }
+        case DetectionFilter::kEventReleased:
+            ESP_LOGI(TAG, "Object left, ready for next appearance");
+            break;
+        default:
+            break;
+    }
+}
+
+void SscmaCamera::DetectionTask() {
+    bool is_inference = false;
+    last_reply_us_ = esp_timer_get_time();
+    UpdateInference(is_inference);
+
+    while (true) {
+        auto bits = xEventGroupWaitBits(event_group_,
+            SSCMA_EVENT_DETECTION | SSCMA_EVENT_STATE_CHANGED | SSCMA_EVENT_CONFIG_CHANGED | SSCMA_EVENT_RESTARTED,
+            pdTRUE, pdFALSE, pdMS_TO_TICKS(SSCMA_KEEPALIVE_INTERVAL_MS));
+
+        if (bits & SSCMA_EVENT_RESTARTED) {
+            ESP_LOGI(TAG, "SSCMA restarted detected");
+            is_inference = false;
+        }
+
+        if (bits & SSCMA_EVENT_CONFIG_CHANGED) {
+            ApplyDetectionConfig();
+        }
+
+        if (bits & SSCMA_EVENT_DETECTION) {
+            DetectionResult result;
+            while (xQueueReceive(detection_queue_, &result, 0) == pdPASS) {
+                ProcessDetection(result);
+            }
+        }
+
+        if (bits & SSCMA_EVENT_STATE_CHANGED) {
+            DeviceState state = device_state_;
+            if (trigger_frame_us_ != 0 && state == kDeviceStateListening) {
+                // 从触发检测帧到开始聆听的延迟
+                int latency_ms = (esp_timer_get_time() - trigger_frame_us_) / 1000;
+                last_latency_ms_ = latency_ms;
+                if (latency_ms > max_latency_ms_) {
+                    max_latency_ms_ = latency_ms;
+                }
+                trigger_frame_us_ = 0;
+                ESP_LOGI(TAG, "Detection to conversation latency: %d ms", latency_ms);
+            } else if (state == kDeviceStateIdle) {
+                // 对话结束后重新开始冷却计时
+                trigger_frame_us_ = 0;
+                detection_filter_.RestartCooldown(esp_timer_get_time());
+            }
+        }
+
+        if (bits & (SSCMA_EVENT_STATE_CHANGED | SSCMA_EVENT_CONFIG_CHANGED | SSCMA_EVENT_RESTARTED)) {
+            UpdateInference(is_inference);
+        }
+
+        // Himax推理时持续上报结果，只有长时间没有消息才需要保活检查
+        if (esp_timer_get_time() - last_reply_us_ > SSCMA_KEEPALIVE_INTERVAL_MS * 1000LL) {
+            last_reply_us_ = esp_timer_get_time();
+            if (!__himax_keepalive_check(sscma_client_handle_)) {
+                ESP_LOGE(TAG, "restart himax");
+                sscma_client_reset(sscma_client_handle_);
+                vTaskDelay(pdMS_TO_TICKS(100));
+            }
+        }
+    }
+}
+
+cJSON* SscmaCamera::GetDetectionStatsJson() {
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "frames", frames_);
+    cJSON_AddNumberToObject(json, "dropped_frames", dropped_frames_);
+    cJSON_AddNumberToObject(json, "max_queue_delay_ms", max_queue_delay_ms_);
+    cJSON_AddNumberToObject(json, "triggers", triggers_);
+    cJSON_AddNumberToObject(json, "last_latency_ms", last_latency_ms_);
+    cJSON_AddNumberToObject(json, "max_latency_ms", max_latency_ms_);
+    return json;
+}
+
 void SscmaCamera::InitializeMcpTools() {
     
     Settings settings("model", false);
@@ -533,6 +590,7 @@ void SscmaCamera::InitializeMcpTools() {
             } catch (const std::runtime_error&) {
                 // target_type parameter not provided, skip
             }
+            xEventGroupSetBits(event_group_, SSCMA_EVENT_CONFIG_CHANGED);
 
             return "{\"status\": \"success\", \"message\": \"Detection configuration updated\"}";
         });
@@ -554,6 +612,7 @@ void SscmaCamera::InitializeMcpTools() {
                 settings.SetInt("enable", en);
                 this->inference_en = en;
                 ESP_LOGI(TAG, "Set inference enable to %d", en);
+                xEventGroupSetBits(event_group_, SSCMA_EVENT_CONFIG_CHANGED);
             } catch (const std::runtime_error&) {
                 // enable not provided -> treat as query
             }
@@ -561,6 +620,14 @@ void SscmaCamera::InitializeMcpTools() {
             int cur_en = settings.GetInt("enable", this->inference_en);
             return std::string("{\"enable\":") + std::to_string(cur_en) + "}";
         });
+
+    mcp_server.AddUserOnlyTool("self.model.get_detection_stats",
+        "Get detection pipeline statistics: frames received and dropped, queue delay, conversations triggered "
+        "and the latency from the triggering frame to listening.",
+        PropertyList(),
+        [this](const PropertyList& properties) -> ReturnValue {
+            return GetDetectionStatsJson();
+        });
 }
 
 void SscmaCamera::SetExplainUrl(const std::string& url, const std::string& token) {
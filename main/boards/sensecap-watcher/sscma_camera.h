@@ -1,6 +1,7 @@
 #ifndef SSCMA_CAMERA_H
 #define SSCMA_CAMERA_H
 
+#include <atomic>
 #include <cstdint>
 #include <lvgl.h>
 #include <thread>
@@ -8,12 +9,15 @@
 
 #include <freertos/FreeRTOS.h>
 #include <freertos/queue.h>
+#include <freertos/event_groups.h>
 #include <esp_io_expander_tca95xx_16bit.h>
 #include <esp_jpeg_dec.h>
 #include <mbedtls/base64.h>
 
 #include "sscma_client.h"
 #include "camera.h"
+#include "detection_filter.h"
+#include "device_state.h"
 
 struct SscmaData {
     uint8_t* img;
@@ -36,28 +40,43 @@ private:
     jpeg_dec_handle_t jpeg_dec_;
     jpeg_dec_io_t *jpeg_io_;
     jpeg_dec_header_info_t *jpeg_out_;
-    // 检测状态机
-    enum DetectionState {
-        IDLE,           // 空闲状态
-        VALIDATING,     // 验证中（连续检测3秒）
-        COOLDOWN        // 冷却期（等待重新检测）
+    // 推理结果，在SSCMA回调中解析后放入有界队列，由检测任务处理
+    struct DetectionResult {
+        int64_t timestamp_us;
+        int16_t score;      // 检测目标的最高分数，未检测到为-1
+        uint8_t count;      // 超过阈值的目标数量
     };
-    
-    DetectionState detection_state = IDLE;
-    int64_t state_start_time = 0;
-    bool need_start_cooldown = false; // 是否需要开始冷却期
-    int64_t last_detected_time = 0; // 验证期间最后一次检测到物体的时间
-    
+    QueueHandle_t detection_queue_ = nullptr;
+    EventGroupHandle_t event_group_ = nullptr;
+    int state_listener_id_ = -1;
+    std::atomic<DeviceState> device_state_{kDeviceStateUnknown};
+    std::atomic<int64_t> last_reply_us_{0};       // 最后一次收到Himax消息的时间，用于保活检查
+    DetectionFilter detection_filter_;
+    int64_t trigger_frame_us_ = 0;                // 触发对话的检测帧时间，等待进入聆听状态
+
+    // 检测统计（检测到对话的延迟）
+    std::atomic<uint32_t> frames_{0};
+    std::atomic<uint32_t> dropped_frames_{0};
+    std::atomic<uint32_t> triggers_{0};
+    std::atomic<int> max_queue_delay_ms_{0};
+    std::atomic<int> last_latency_ms_{-1};
+    std::atomic<int> max_latency_ms_{0};
+
     int detect_target = 0;
     int detect_threshold = 75;
     int detect_duration_sec = 2; // 检测持续时间2秒，确认人员持续存在
-    int detect_invoke_interval_sec = 8; // 默认15秒冷却期，避免频繁开始会话
+    int detect_invoke_interval_sec = 8; // 默认8秒冷却期，避免频繁开始会话
     int detect_debounce_sec = 1; // 验证期间人员离开的去抖动时间1秒
     int inference_en = 0; // 推理使能开关（0: 关闭, 1: 开启）
-    bool sscma_restarted_ = false;
     
     sscma_client_model_t *model;
     int model_class_cnt = 0;
+
+    void PushDetection(const DetectionResult& result);
+    void DetectionTask();
+    void ProcessDetection(const DetectionResult& result);
+    void UpdateInference(bool& is_inference);
+    void ApplyDetectionConfig();
 public:
     SscmaCamera(esp_io_expander_handle_t io_exp_handle);
     ~SscmaCamera();
@@ -70,6 +89,9 @@ public:
     virtual bool SetVFlip(bool enabled) override;
     virtual std::string Explain(const std::string& question);
 
+    // Caller takes ownership of the returned object
+    cJSON* GetDetectionStatsJson();
+
 };
 
 #endif // ESP32_CAMERA_H
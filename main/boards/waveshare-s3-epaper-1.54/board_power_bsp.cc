@@ -2,6 +2,7 @@
 #include <driver/gpio.h>
 #include <freertos/FreeRTOS.h>
 #include "board_power_bsp.h"
+#include "settings.h"
 
 void BoardPowerBsp::PowerLedTask(void *arg) {
     gpio_config_t gpio_conf = {};
@@ -55,5 +56,6 @@ void BoardPowerBsp::VbatPowerOn() {
 }
 
 void BoardPowerBsp::VbatPowerOff() {
+    Settings::Flush();
     gpio_set_level((gpio_num_t) vbatPowerPin_, 0);
 }
\ No newline at end of file
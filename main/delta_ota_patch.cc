@@ -0,0 +1,86 @@
+#include "delta_ota_patch.h"
+
+#include <esp_log.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <strings.h>
+
+#define TAG "DeltaOtaPatch"
+
+DeltaOtaPatch::DeltaOtaPatch(const uint8_t base_sha256[32], FeedFunction feed) : feed_(std::move(feed)) {
+    memcpy(base_sha256_, base_sha256, sizeof(base_sha256_));
+    mbedtls_sha256_init(&sha256_);
+    mbedtls_sha256_starts(&sha256_, 0);
+}
+
+DeltaOtaPatch::~DeltaOtaPatch() {
+    mbedtls_sha256_free(&sha256_);
+}
+
+bool DeltaOtaPatch::Feed(const uint8_t* data, size_t size) {
+    if (failed_) {
+        return false;
+    }
+
+    // The header may arrive split over several reads
+    if (!header_verified_) {
+        size_t count = std::min(size, sizeof(header_) - header_size_);
+        memcpy(header_ + header_size_, data, count);
+        header_size_ += count;
+        data += count;
+        size -= count;
+        if (header_size_ < sizeof(header_)) {
+            return true;
+        }
+
+        uint32_t magic;
+        memcpy(&magic, header_, sizeof(magic));
+        if (magic != DELTA_OTA_MAGIC) {
+            ESP_LOGE(TAG, "Invalid patch magic: 0x%lx", (unsigned long)magic);
+            failed_ = true;
+            return false;
+        }
+        if (memcmp(header_ + sizeof(magic), base_sha256_, sizeof(base_sha256_)) != 0) {
+            ESP_LOGE(TAG, "Patch is not built against the running firmware");
+            failed_ = true;
+            return false;
+        }
+        header_verified_ = true;
+    }
+
+    if (size == 0) {
+        return true;
+    }
+    if (!feed_(data, size)) {
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+void DeltaOtaPatch::OnImageData(const uint8_t* data, size_t size) {
+    mbedtls_sha256_update(&sha256_, data, size);
+    image_size_ += size;
+}
+
+bool DeltaOtaPatch::Verify(const std::string& sha256) {
+    if (failed_ || !header_verified_) {
+        ESP_LOGE(TAG, "Patch is incomplete");
+        return false;
+    }
+
+    uint8_t digest[32];
+    mbedtls_sha256_finish(&sha256_, digest);
+    failed_ = true;  // The hash is finished, nothing more can be fed
+    char digest_hex[65];
+    for (size_t i = 0; i < sizeof(digest); i++) {
+        snprintf(digest_hex + i * 2, 3, "%02x", digest[i]);
+    }
+    if (strcasecmp(digest_hex, sha256.c_str()) != 0) {
+        ESP_LOGE(TAG, "Patched image SHA-256 mismatch, expected %s, got %s", sha256.c_str(), digest_hex);
+        return false;
+    }
+    return true;
+}
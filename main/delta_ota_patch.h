@@ -0,0 +1,55 @@
+#ifndef DELTA_OTA_PATCH_H
+#define DELTA_OTA_PATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+#include <mbedtls/sha256.h>
+
+/*
+ * Delta OTA patch written by scripts/gen_delta_ota_patch.py
+ *
+ *   header (64 bytes) | detools patch (heatshrink compressed)
+ *
+ * The header holds the magic (little endian) and the SHA-256 of the base image the patch was built
+ * against, the rest is reserved. DeltaOtaPatch is the streaming side of Ota::UpgradeDelta: it takes
+ * the download in chunks of any size, checks the header before anything reaches the patch engine,
+ * passes the detools patch on, and hashes the new image as the engine writes it.
+ */
+#define DELTA_OTA_PATCH_HEADER_SIZE 64
+#define DELTA_OTA_MAGIC 0xfccdde10
+
+class DeltaOtaPatch {
+public:
+    // Feeds the next chunk of the detools patch to the patch engine
+    using FeedFunction = std::function<bool(const uint8_t* data, size_t size)>;
+
+    DeltaOtaPatch(const uint8_t base_sha256[32], FeedFunction feed);
+    ~DeltaOtaPatch();
+    DeltaOtaPatch(const DeltaOtaPatch&) = delete;
+    DeltaOtaPatch& operator=(const DeltaOtaPatch&) = delete;
+
+    // Consume the next chunk of the download, false if the header is wrong or the engine fails
+    bool Feed(const uint8_t* data, size_t size);
+    // Called by the patch engine's write callback for every block of the new image
+    void OnImageData(const uint8_t* data, size_t size);
+    // After the engine is finalized, check the new image against the SHA-256 given in hex
+    bool Verify(const std::string& sha256);
+
+    bool header_verified() const { return header_verified_; }
+    size_t image_size() const { return image_size_; }
+
+private:
+    uint8_t base_sha256_[32];
+    FeedFunction feed_;
+    uint8_t header_[DELTA_OTA_PATCH_HEADER_SIZE];
+    size_t header_size_ = 0;
+    bool header_verified_ = false;
+    bool failed_ = false;
+    mbedtls_sha256_context sha256_;
+    size_t image_size_ = 0;
+};
+
+#endif // DELTA_OTA_PATCH_H
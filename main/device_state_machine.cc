@@ -1,10 +1,15 @@
 #include "device_state_machine.h"
 
-#include <algorithm>
 #include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 
 static const char* TAG = "StateMachine";
 
+// Handling a state change slower than this is logged as a warning
+#define STATE_HANDLE_SLOW_US (500 * 1000)
+
 // State name strings for logging
 static const char* const STATE_STRINGS[] = {
     "unknown",
@@ -117,11 +122,14 @@ bool DeviceStateMachine::TransitionTo(DeviceState new_state) {
     if (!IsValidTransition(old_state, new_state)) {
         ESP_LOGW(TAG, "Invalid state transition: %s -> %s",
                  GetStateName(old_state), GetStateName(new_state));
+        RecordTransition(old_state, new_state, false);
         return false;
     }
 
     // Perform transition
+    uint32_t sequence = RecordTransition(old_state, new_state, true);
     current_state_.store(new_state);
+    last_accepted_sequence_.store(sequence + 1, std::memory_order_release);
     ESP_LOGI(TAG, "State: %s -> %s",
              GetStateName(old_state), GetStateName(new_state));
 
@@ -131,31 +139,143 @@ bool DeviceStateMachine::TransitionTo(DeviceState new_state) {
 }
 
 int DeviceStateMachine::AddStateChangeListener(StateCallback callback) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    int id = next_listener_id_++;
-    listeners_.emplace_back(id, std::move(callback));
-    return id;
+    for (int i = 0; i < kMaxListeners; i++) {
+        auto& slot = listeners_[i];
+        // A notification may be passing over the free slot, only take it without users
+        uint32_t state = slot.state.load(std::memory_order_relaxed);
+        if ((state & (kSlotStateMask | kSlotUserMask)) != kSlotFree) {
+            continue;
+        }
+        // The listener id is the new generation and the slot index
+        uint32_t generation = ((state >> kSlotGenerationShift) + 1) & (UINT32_MAX >> kSlotGenerationShift);
+        uint32_t busy = (generation << kSlotGenerationShift) | kSlotBusy;
+        if (slot.state.compare_exchange_strong(state, busy, std::memory_order_acquire)) {
+            slot.callback = std::move(callback);
+            slot.state.fetch_add(kSlotReady - kSlotBusy, std::memory_order_release);
+            return generation * kMaxListeners + i;
+        }
+    }
+    ESP_LOGE(TAG, "No free state change listener slot");
+    return -1;
 }
 
 void DeviceStateMachine::RemoveStateChangeListener(int listener_id) {
-    std::lock_guard<std::mutex> lock(mutex_);
-    listeners_.erase(
-        std::remove_if(listeners_.begin(), listeners_.end(),
-            [listener_id](const auto& p) { return p.first == listener_id; }),
-        listeners_.end());
+    if (listener_id < 0) {
+        return;
+    }
+    auto& slot = listeners_[listener_id % kMaxListeners];
+    uint32_t generation = listener_id / kMaxListeners;
+    uint32_t state = slot.state.load();
+    do {
+        // The generation is part of the compared value, a listener added since the id was
+        // handed out cannot be removed with it
+        if ((state & kSlotStateMask) != kSlotReady || (state >> kSlotGenerationShift) != generation) {
+            return;
+        }
+    } while (!slot.state.compare_exchange_weak(state, state - kSlotReady + kSlotBusy));
+
+    // Wait for running notifications to leave the callback before releasing it
+    while ((slot.state.load(std::memory_order_acquire) & kSlotUserMask) != 0) {
+        vTaskDelay(1);
+    }
+    slot.callback = nullptr;
+    uint32_t busy = (state & ~(kSlotStateMask | kSlotUserMask)) | kSlotBusy;
+    uint32_t expected = busy;
+    while (!slot.state.compare_exchange_weak(expected, busy - kSlotBusy + kSlotFree, std::memory_order_release)) {
+        expected = busy;
+        vTaskDelay(1);
+    }
 }
 
 void DeviceStateMachine::NotifyStateChange(DeviceState old_state, DeviceState new_state) {
-    std::vector<StateCallback> callbacks_copy;
-    {
-        std::lock_guard<std::mutex> lock(mutex_);
-        callbacks_copy.reserve(listeners_.size());
-        for (const auto& [id, cb] : listeners_) {
-            callbacks_copy.push_back(cb);
+    for (auto& slot : listeners_) {
+        if ((slot.state.load(std::memory_order_relaxed) & kSlotStateMask) != kSlotReady) {
+            continue;
         }
+        uint32_t state = slot.state.fetch_add(kSlotUserIncrement, std::memory_order_acquire);
+        if ((state & kSlotStateMask) == kSlotReady) {
+            slot.callback(old_state, new_state);
+        }
+        slot.state.fetch_sub(kSlotUserIncrement, std::memory_order_release);
     }
-    
-    for (const auto& cb : callbacks_copy) {
-        cb(old_state, new_state);
+}
+
+uint32_t DeviceStateMachine::RecordTransition(DeviceState from, DeviceState to, bool accepted) {
+    uint32_t sequence = next_sequence_.fetch_add(1);
+    auto& record = transition_log_[sequence % kTransitionLogSize];
+    record.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    record.time_us = esp_timer_get_time();
+    record.from = from;
+    record.to = to;
+    record.accepted = accepted;
+    record.handled_latency_us.store(0, std::memory_order_relaxed);
+    record.sequence.store(sequence + 1, std::memory_order_release);
+    return sequence;
+}
+
+void DeviceStateMachine::MarkStateHandled(DeviceState state) {
+    uint32_t sequence = last_accepted_sequence_.load(std::memory_order_acquire);
+    if (sequence == 0) {
+        return;
+    }
+    auto& record = transition_log_[(sequence - 1) % kTransitionLogSize];
+    if (record.sequence.load(std::memory_order_acquire) != sequence || record.to != state) {
+        return;
+    }
+    int64_t latency_us = esp_timer_get_time() - record.time_us;
+    uint32_t expected = 0;
+    if (!record.handled_latency_us.compare_exchange_strong(expected, latency_us > 0 ? latency_us : 1)) {
+        return;
+    }
+    if (latency_us > STATE_HANDLE_SLOW_US) {
+        ESP_LOGW(TAG, "State %s -> %s handled after %lld ms", GetStateName(record.from),
+                 GetStateName(record.to), (long long)(latency_us / 1000));
+    }
+}
+
+cJSON* DeviceStateMachine::GetTransitionLogJson() const {
+    int64_t now_us = esp_timer_get_time();
+    int64_t state_since_us = 0;
+
+    cJSON* json = cJSON_CreateObject();
+    cJSON* transitions = cJSON_CreateArray();
+    uint32_t end = next_sequence_.load(std::memory_order_acquire);
+    uint32_t begin = end > kTransitionLogSize ? end - kTransitionLogSize : 0;
+    for (uint32_t sequence = begin; sequence < end; sequence++) {
+        auto& slot = transition_log_[sequence % kTransitionLogSize];
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        int64_t time_us = slot.time_us;
+        DeviceState from = slot.from;
+        DeviceState to = slot.to;
+        bool accepted = slot.accepted;
+        uint32_t handled_latency_us = slot.handled_latency_us.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        // Skip records overwritten or still being written while copying
+        if (before != sequence + 1 || slot.sequence.load(std::memory_order_relaxed) != before) {
+            continue;
+        }
+
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "time_ms", time_us / 1000);
+        cJSON_AddStringToObject(item, "from", GetStateName(from));
+        cJSON_AddStringToObject(item, "to", GetStateName(to));
+        if (!accepted) {
+            cJSON_AddBoolToObject(item, "rejected", true);
+        } else {
+            state_since_us = time_us;
+            if (handled_latency_us != 0) {
+                cJSON_AddNumberToObject(item, "handled_us", handled_latency_us);
+            }
+        }
+        cJSON_AddItemToArray(transitions, item);
+    }
+
+    cJSON_AddStringToObject(json, "state", GetStateName(current_state_.load()));
+    if (state_since_us != 0) {
+        cJSON_AddNumberToObject(json, "state_age_ms", (now_us - state_since_us) / 1000);
     }
+    cJSON_AddNumberToObject(json, "uptime_ms", now_us / 1000);
+    cJSON_AddItemToObject(json, "transitions", transitions);
+    return json;
 }
@@ -2,9 +2,10 @@
 #define DEVICE_STATE_MACHINE_H
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
-#include <mutex>
-#include <vector>
+
+#include <cJSON.h>
 
 #include "device_state.h"
 
@@ -12,7 +13,8 @@
  * DeviceStateMachine - Manages device state transitions with validation
  * 
  * This class ensures strict state transition rules and provides a callback mechanism
- * for components to react to state changes.
+ * for components to react to state changes. Every transition request is recorded in a
+ * timestamped ring buffer, together with the latency until the new state was handled.
  */
 class DeviceStateMachine {
 public:
@@ -49,25 +51,70 @@ public:
     /**
      * Add a state change listener (observer pattern)
      * Callback is invoked in the context of the caller of TransitionTo()
-     * @return listener id for removal
+     * @return listener id for removal, -1 if all listener slots are in use. Ids carry the
+     *         generation of their slot, so an id stays stale after its listener is removed
      */
     int AddStateChangeListener(StateCallback callback);
 
     /**
-     * Remove a state change listener by id
+     * Remove a state change listener by id, a stale id is ignored
+     * Waits for running invocations of the callback, must not be called from a listener
      */
     void RemoveStateChangeListener(int listener_id);
 
+    /**
+     * Mark the current state as handled by the application
+     * Records the latency from the transition request in the transition log
+     */
+    void MarkStateHandled(DeviceState state);
+
+    /**
+     * Export the transition log, oldest first
+     * Caller takes ownership of the returned object
+     */
+    cJSON* GetTransitionLogJson() const;
+
     /**
      * Get state name string for logging
      */
     static const char* GetStateName(DeviceState state);
 
+    static constexpr int kMaxListeners = 4;
+    static constexpr uint32_t kTransitionLogSize = 32;
+
 private:
+    // A slot is free (kSlotFree), being set up or torn down (kSlotBusy), or ready, plus the
+    // number of notifications currently running its callback and the generation of the slot,
+    // counted up each time a listener is added to it
+    static constexpr uint32_t kSlotFree = 0;
+    static constexpr uint32_t kSlotBusy = 1;
+    static constexpr uint32_t kSlotReady = 2;
+    static constexpr uint32_t kSlotStateMask = 3;
+    static constexpr uint32_t kSlotUserIncrement = 4;
+    static constexpr uint32_t kSlotUserMask = 0x3fc;
+    static constexpr int kSlotGenerationShift = 10;
+
+    struct ListenerSlot {
+        std::atomic<uint32_t> state{kSlotFree};
+        StateCallback callback;
+    };
+
+    struct TransitionRecord {
+        // Sequence of the record + 1, 0 while the record is being written
+        std::atomic<uint32_t> sequence{0};
+        int64_t time_us = 0;
+        DeviceState from = kDeviceStateUnknown;
+        DeviceState to = kDeviceStateUnknown;
+        bool accepted = false;
+        // Microseconds from the request until the state was handled, 0 if not handled yet
+        std::atomic<uint32_t> handled_latency_us{0};
+    };
+
     std::atomic<DeviceState> current_state_{kDeviceStateUnknown};
-    std::vector<std::pair<int, StateCallback>> listeners_;
-    int next_listener_id_{0};
-    std::mutex mutex_;
+    ListenerSlot listeners_[kMaxListeners];
+    TransitionRecord transition_log_[kTransitionLogSize];
+    std::atomic<uint32_t> next_sequence_{0};
+    std::atomic<uint32_t> last_accepted_sequence_{0};
 
     /**
      * Check if transition from source to target is valid
@@ -78,6 +125,11 @@ private:
      * Notify callback of state change
      */
     void NotifyStateChange(DeviceState old_state, DeviceState new_state);
+
+    /**
+     * Append a transition request to the log, returns its sequence number
+     */
+    uint32_t RecordTransition(DeviceState from, DeviceState to, bool accepted);
 };
 
 #endif // DEVICE_STATE_MACHINE_H
@@ -549,6 +549,7 @@ void LcdDisplay::SetChatMessage(const char* role, const char* content) {
     }
 
     auto lvgl_theme = static_cast<LvglTheme*>(current_theme_);
+    lvgl_theme->text_font()->Prefetch(content);
     auto text_font = lvgl_theme->text_font()->font();
 
     // Create a message bubble
@@ -966,6 +967,7 @@ void LcdDisplay::SetChatMessage(const char* role, const char* content) {
     if (chat_message_label_ == nullptr) {
         return;
     }
+    static_cast<LvglTheme*>(current_theme_)->text_font()->Prefetch(content);
     lv_label_set_text(chat_message_label_, content);
 }
 #endif
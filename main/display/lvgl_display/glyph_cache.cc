@@ -0,0 +1,140 @@
+#include "glyph_cache.h"
+
+#include <algorithm>
+
+GlyphCache::GlyphCache(uint8_t* arena, size_t arena_size, size_t slot_size)
+    : arena_(arena), slot_size_(std::max<size_t>(slot_size, 1)) {
+    size_t count = arena != nullptr ? std::min<size_t>(arena_size / slot_size_, INT16_MAX) : 0;
+    slots_.resize(count);
+
+    // Keep the table at most half full so probes stay short
+    size_t table_size = 4;
+    while (table_size < count * 2) {
+        table_size *= 2;
+    }
+    table_.assign(table_size, kNone);
+    mask_ = table_size - 1;
+}
+
+int GlyphCache::Lookup(uint32_t key) const {
+    if (used_ == 0) {
+        return kNone;
+    }
+    for (size_t i = Hash(key); table_[i] != kNone; i = (i + 1) & mask_) {
+        if (slots_[table_[i]].key == key) {
+            return table_[i];
+        }
+    }
+    return kNone;
+}
+
+void GlyphCache::TableInsert(int16_t index) {
+    size_t i = Hash(slots_[index].key);
+    while (table_[i] != kNone) {
+        i = (i + 1) & mask_;
+    }
+    table_[i] = index;
+}
+
+void GlyphCache::TableErase(uint32_t key) {
+    size_t i = Hash(key);
+    while (slots_[table_[i]].key != key) {
+        i = (i + 1) & mask_;
+    }
+    // Move later entries of the probe sequence back into the hole
+    size_t hole = i;
+    for (size_t j = (hole + 1) & mask_; table_[j] != kNone; j = (j + 1) & mask_) {
+        size_t home = Hash(slots_[table_[j]].key);
+        if (((j - home) & mask_) >= ((j - hole) & mask_)) {
+            table_[hole] = table_[j];
+            hole = j;
+        }
+    }
+    table_[hole] = kNone;
+}
+
+void GlyphCache::Unlink(int16_t index) {
+    auto& slot = slots_[index];
+    if (slot.prev != kNone) {
+        slots_[slot.prev].next = slot.next;
+    } else {
+        head_ = slot.next;
+    }
+    if (slot.next != kNone) {
+        slots_[slot.next].prev = slot.prev;
+    } else {
+        tail_ = slot.prev;
+    }
+}
+
+void GlyphCache::PushFront(int16_t index) {
+    auto& slot = slots_[index];
+    slot.prev = kNone;
+    slot.next = head_;
+    if (head_ != kNone) {
+        slots_[head_].prev = index;
+    }
+    head_ = index;
+    if (tail_ == kNone) {
+        tail_ = index;
+    }
+}
+
+const uint8_t* GlyphCache::Find(uint32_t key, size_t& size) {
+    int index = Lookup(key);
+    if (index == kNone) {
+        misses_++;
+        return nullptr;
+    }
+    hits_++;
+    if (index != head_) {
+        Unlink(index);
+        PushFront(index);
+    }
+    size = slots_[index].size;
+    return arena_ + index * slot_size_;
+}
+
+uint8_t* GlyphCache::Insert(uint32_t key, size_t size, bool prefetch) {
+    if (size > slot_size_ || slots_.empty()) {
+        oversized_++;
+        return nullptr;
+    }
+
+    int16_t index = Lookup(key);
+    if (index != kNone) {
+        Unlink(index);
+    } else if (used_ < slots_.size()) {
+        index = used_++;
+        slots_[index].key = key;
+        TableInsert(index);
+    } else {
+        index = tail_;
+        Unlink(index);
+        TableErase(slots_[index].key);
+        slots_[index].key = key;
+        TableInsert(index);
+        evictions_++;
+    }
+    slots_[index].size = size;
+    PushFront(index);
+    if (prefetch) {
+        prefetched_++;
+    }
+    return arena_ + index * slot_size_;
+}
+
+cJSON* GlyphCache::GetStatsJson() const {
+    uint32_t lookups = hits_ + misses_;
+    cJSON* json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "slots", slots_.size());
+    cJSON_AddNumberToObject(json, "slot_size", slot_size_);
+    cJSON_AddNumberToObject(json, "cached", used_);
+    cJSON_AddNumberToObject(json, "hits", hits_);
+    cJSON_AddNumberToObject(json, "misses", misses_);
+    cJSON_AddNumberToObject(json, "hit_rate_percent", lookups > 0 ? hits_ * 1000ULL / lookups / 10.0 : 0);
+    cJSON_AddNumberToObject(json, "prefetched", prefetched_);
+    cJSON_AddNumberToObject(json, "evictions", evictions_);
+    cJSON_AddNumberToObject(json, "oversized", oversized_);
+    return json;
+}
@@ -0,0 +1,73 @@
+#ifndef GLYPH_CACHE_H
+#define GLYPH_CACHE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include <cJSON.h>
+
+/**
+ * LRU cache of decoded glyph bitmaps in a fixed arena.
+ *
+ * The arena is split into equal slots, each big enough for one glyph of the font, and nothing
+ * is allocated after construction. Glyphs are looked up by key (the glyph id of the font), the
+ * least recently used slot is reused when the cache is full.
+ *
+ * Not thread safe, the owner calls it from the LVGL task only.
+ */
+class GlyphCache {
+public:
+    GlyphCache(uint8_t* arena, size_t arena_size, size_t slot_size);
+
+    // Bitmap of a cached glyph and mark it as recently used, nullptr if not cached.
+    // Counts a hit or a miss.
+    const uint8_t* Find(uint32_t key, size_t& size);
+    // Slot to copy a glyph of `size` bytes into, evicting the least recently used glyph if needed.
+    // nullptr if the glyph is larger than a slot.
+    uint8_t* Insert(uint32_t key, size_t size, bool prefetch = false);
+    // Check without touching the LRU order or the counters
+    bool Contains(uint32_t key) const { return Lookup(key) >= 0; }
+
+    size_t capacity() const { return slots_.size(); }
+    size_t slot_size() const { return slot_size_; }
+
+    // Caller takes ownership of the returned object
+    cJSON* GetStatsJson() const;
+
+private:
+    static constexpr int16_t kNone = -1;
+
+    struct Slot {
+        uint32_t key;
+        uint16_t size;
+        int16_t prev;
+        int16_t next;
+    };
+
+    uint8_t* arena_;
+    size_t slot_size_;
+    std::vector<Slot> slots_;
+    size_t used_ = 0;
+    // Most recently used at the head
+    int16_t head_ = kNone;
+    int16_t tail_ = kNone;
+    // Open addressing table of slot indexes
+    std::vector<int16_t> table_;
+    uint32_t mask_ = 0;
+
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+    uint32_t prefetched_ = 0;
+    uint32_t evictions_ = 0;
+    uint32_t oversized_ = 0;
+
+    size_t Hash(uint32_t key) const { return (key * 2654435761u) & mask_; }
+    int Lookup(uint32_t key) const;
+    void TableInsert(int16_t index);
+    void TableErase(uint32_t key);
+    void Unlink(int16_t index);
+    void PushFront(int16_t index);
+};
+
+#endif // GLYPH_CACHE_H
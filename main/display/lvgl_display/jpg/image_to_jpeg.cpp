@@ -275,14 +275,13 @@ static uint8_t* convert_input_to_hw_encoder_buf(const uint8_t* src, uint16_t wid
     return NULL;
 }
 
+static bool hw_encode_buffer(uint8_t* enc_in, int enc_in_size, jpeg_enc_input_format_t enc_src_type, uint16_t width,
+                             uint16_t height, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len, jpg_out_cb cb,
+                             void* cb_arg);
+
 static bool encode_with_hw_jpeg(const uint8_t* src, size_t src_len, uint16_t width, uint16_t height,
                                 v4l2_pix_fmt_t format, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len,
                                 jpg_out_cb cb, void* cb_arg) {
-    if (quality < 1)
-        quality = 1;
-    if (quality > 100)
-        quality = 100;
-
     jpeg_enc_input_format_t enc_src_type = JPEG_ENCODE_IN_FORMAT_RGB888;
     int enc_in_size = 0;
     uint8_t* enc_in = convert_input_to_hw_encoder_buf(src, width, height, format, &enc_src_type, &enc_in_size);
@@ -291,8 +290,20 @@ static bool encode_with_hw_jpeg(const uint8_t* src, size_t src_len, uint16_t wid
         return false;
     }
 
+    bool ok = hw_encode_buffer(enc_in, enc_in_size, enc_src_type, width, height, quality, jpg_out, jpg_out_len, cb, cb_arg);
+    free(enc_in);
+    return ok;
+}
+
+static bool hw_encode_buffer(uint8_t* enc_in, int enc_in_size, jpeg_enc_input_format_t enc_src_type, uint16_t width,
+                             uint16_t height, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len, jpg_out_cb cb,
+                             void* cb_arg) {
+    if (quality < 1)
+        quality = 1;
+    if (quality > 100)
+        quality = 100;
+
     if (!hw_jpeg_ensure_inited()) {
-        free(enc_in);
         return false;
     }
 
@@ -310,14 +321,12 @@ static bool encode_with_hw_jpeg(const uint8_t* src, size_t src_len, uint16_t wid
     size_t out_cap_aligned = 0;
     uint8_t* outbuf = (uint8_t*)jpeg_alloc_encoder_mem(out_cap, &jpeg_enc_output_mem_cfg, &out_cap_aligned);
     if (!outbuf) {
-        free(enc_in);
         ESP_LOGE(TAG, "alloc out buffer failed");
         return false;
     }
 
     uint32_t out_len = 0;
     esp_err_t er = jpeg_encoder_process(s_hw_jpeg_handle, &enc_cfg, enc_in, (uint32_t)enc_in_size, outbuf, (uint32_t)out_cap_aligned, &out_len);
-    free(enc_in);
 
     if (er != ESP_OK) {
         free(outbuf);
@@ -347,14 +356,13 @@ static bool encode_with_hw_jpeg(const uint8_t* src, size_t src_len, uint16_t wid
 }
 #endif // CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
 
+static bool sw_encode_buffer(uint8_t* enc_in, int enc_in_size, jpeg_pixel_format_t enc_src_type, uint16_t width,
+                             uint16_t height, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len, jpg_out_cb cb,
+                             void* cb_arg);
+
 static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_t width, uint16_t height,
                                      v4l2_pix_fmt_t format, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len,
                                      jpg_out_cb cb, void* cb_arg) {
-    if (quality < 1)
-        quality = 1;
-    if (quality > 100)
-        quality = 100;
-
     jpeg_pixel_format_t enc_src_type = JPEG_PIXEL_FORMAT_RGB888;
     int enc_in_size = 0;
     uint8_t* enc_in = convert_input_to_encoder_buf(src, width, height, format, &enc_src_type, &enc_in_size);
@@ -363,6 +371,19 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
         return false;
     }
 
+    bool ok = sw_encode_buffer(enc_in, enc_in_size, enc_src_type, width, height, quality, jpg_out, jpg_out_len, cb, cb_arg);
+    jpeg_free_align(enc_in);
+    return ok;
+}
+
+static bool sw_encode_buffer(uint8_t* enc_in, int enc_in_size, jpeg_pixel_format_t enc_src_type, uint16_t width,
+                             uint16_t height, uint8_t quality, uint8_t** jpg_out, size_t* jpg_out_len, jpg_out_cb cb,
+                             void* cb_arg) {
+    if (quality < 1)
+        quality = 1;
+    if (quality > 100)
+        quality = 100;
+
     jpeg_enc_config_t cfg = DEFAULT_JPEG_ENC_CONFIG();
     cfg.width = width;
     cfg.height = height;
@@ -375,7 +396,6 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
     jpeg_enc_handle_t h = NULL;
     jpeg_error_t ret = jpeg_enc_open(&cfg, &h);
     if (ret != JPEG_ERR_OK) {
-        jpeg_free_align(enc_in);
         ESP_LOGE(TAG, "jpeg_enc_open failed: %d", (int)ret);
         return false;
     }
@@ -387,7 +407,6 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
     uint8_t* outbuf = (uint8_t*)malloc_psram(out_cap);
     if (!outbuf) {
         jpeg_enc_close(h);
-        jpeg_free_align(enc_in);
         ESP_LOGE(TAG, "alloc out buffer failed");
         return false;
     }
@@ -395,7 +414,6 @@ static bool encode_with_esp_new_jpeg(const uint8_t* src, size_t src_len, uint16_
     int out_len = 0;
     ret = jpeg_enc_process(h, enc_in, enc_in_size, outbuf, (int)out_cap, &out_len);
     jpeg_enc_close(h);
-    jpeg_free_align(enc_in);
 
     if (ret != JPEG_ERR_OK) {
         free(outbuf);
@@ -465,3 +483,201 @@ bool image_to_jpeg_cb(uint8_t* src, size_t src_len, uint16_t width, uint16_t hei
 #endif
     return encode_with_esp_new_jpeg(src, src_len, width, height, format, quality, NULL, NULL, cb, arg);
 }
+
+static __always_inline void rgb_to_yuv(int r, int g, int b, int* y, int* u, int* v) {
+    // BT.601, full range
+    *y = (77 * r + 150 * g + 29 * b) >> 8;
+    *u = ((-43 * r - 85 * g + 128 * b) >> 8) + 128;
+    *v = ((128 * r - 107 * g - 21 * b) >> 8) + 128;
+}
+
+static __always_inline void read_rgb(const uint8_t* row, int x, v4l2_pix_fmt_t format, int* r, int* g, int* b) {
+    if (format == V4L2_PIX_FMT_RGB24) {
+        const uint8_t* p = row + x * 3;
+        *r = p[0];
+        *g = p[1];
+        *b = p[2];
+        return;
+    }
+    const uint8_t* p = row + x * 2;
+    uint16_t pixel = (format == V4L2_PIX_FMT_RGB565) ? (p[0] | (p[1] << 8)) : ((p[0] << 8) | p[1]);
+    *r = expand_5_to_8(pixel >> 11);
+    *g = expand_6_to_8((pixel >> 5) & 0x3F);
+    *b = expand_5_to_8(pixel & 0x1F);
+}
+
+struct scaled_output_t {
+    uint16_t width;
+    uint16_t height;
+    uint8_t* buf;
+    int size;
+    int next_row;
+};
+
+// Convert one source row into one row of the scaled YUYV (or GRAY) buffer, nearest neighbour sampling.
+// The hardware encoder takes YUV422 as | U Y0 V Y1 |, the software encoder as | Y0 U Y1 V |.
+static void convert_scaled_row(const uint8_t* src_row, uint16_t src_width, v4l2_pix_fmt_t format,
+                               const scaled_output_t* out, uint8_t* dst, bool hw_layout) {
+    if (format == V4L2_PIX_FMT_GREY) {
+        for (int dx = 0; dx < out->width; dx++) {
+            dst[dx] = src_row[dx * src_width / out->width];
+        }
+        return;
+    }
+
+    for (int dx = 0; dx < out->width; dx += 2) {
+        int sx0 = dx * src_width / out->width;
+        int sx1 = (dx + 1) * src_width / out->width;
+        int y0, y1, u, v;
+        if (format == V4L2_PIX_FMT_YUYV) {
+            const uint8_t* pair = src_row + (sx0 & ~1) * 2;
+            y0 = src_row[sx0 * 2];
+            y1 = src_row[sx1 * 2];
+            u = pair[1];
+            v = pair[3];
+        } else {
+            int r, g, b, u0, v0, u1, v1;
+            read_rgb(src_row, sx0, format, &r, &g, &b);
+            rgb_to_yuv(r, g, b, &y0, &u0, &v0);
+            read_rgb(src_row, sx1, format, &r, &g, &b);
+            rgb_to_yuv(r, g, b, &y1, &u1, &v1);
+            u = (u0 + u1) >> 1;
+            v = (v0 + v1) >> 1;
+        }
+        if (hw_layout) {
+            dst[0] = u;
+            dst[1] = y0;
+            dst[2] = v;
+            dst[3] = y1;
+        } else {
+            dst[0] = y0;
+            dst[1] = u;
+            dst[2] = y1;
+            dst[3] = v;
+        }
+        dst += 4;
+    }
+}
+
+static void scale_to_max_size(uint16_t width, uint16_t height, uint16_t max_size, uint16_t* out_width,
+                              uint16_t* out_height) {
+    uint16_t longest = width > height ? width : height;
+    if (max_size == 0 || max_size >= longest) {
+        *out_width = width;
+        *out_height = height;
+    } else {
+        *out_width = (uint32_t)width * max_size / longest;
+        *out_height = (uint32_t)height * max_size / longest;
+    }
+    // Full MCUs for both encoders
+    if (*out_width != width || *out_height != height) {
+        *out_width = *out_width >= 16 ? (*out_width & ~15) : 16;
+        *out_height = *out_height >= 8 ? (*out_height & ~7) : 8;
+    } else {
+        *out_width &= ~1;
+    }
+}
+
+bool image_to_jpeg_multi(uint8_t* src, size_t src_len, uint16_t width, uint16_t height, v4l2_pix_fmt_t format,
+                         const jpeg_output_t* outputs, size_t output_count) {
+    if (src == NULL || outputs == NULL || output_count == 0 || output_count > JPEG_MULTI_MAX_OUTPUTS) {
+        return false;
+    }
+
+    if (format != V4L2_PIX_FMT_RGB565 && format != V4L2_PIX_FMT_RGB565X && format != V4L2_PIX_FMT_RGB24 &&
+        format != V4L2_PIX_FMT_YUYV && format != V4L2_PIX_FMT_GREY) {
+        // No scaling for the other formats, encode every output at the source resolution
+        ESP_LOGW(TAG, "scaling not supported for format 0x%08lx, using source resolution", format);
+        for (size_t i = 0; i < output_count; i++) {
+            if (!image_to_jpeg_cb(src, src_len, width, height, format, outputs[i].quality, outputs[i].cb, outputs[i].arg)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    size_t bytes_per_pixel = (format == V4L2_PIX_FMT_GREY) ? 1 : (format == V4L2_PIX_FMT_RGB24) ? 3 : 2;
+    if (src_len < (size_t)width * height * bytes_per_pixel) {
+        ESP_LOGE(TAG, "source buffer too short: %u", src_len);
+        return false;
+    }
+
+    bool hw_layout = false;
+#if CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
+    hw_layout = format != V4L2_PIX_FMT_GREY && hw_jpeg_ensure_inited();
+#endif
+
+    scaled_output_t scaled[JPEG_MULTI_MAX_OUTPUTS] = {};
+    int out_bpp = (format == V4L2_PIX_FMT_GREY) ? 1 : 2;
+    bool ok = true;
+    for (size_t i = 0; i < output_count; i++) {
+        scale_to_max_size(width, height, outputs[i].max_size, &scaled[i].width, &scaled[i].height);
+        scaled[i].size = (int)scaled[i].width * scaled[i].height * out_bpp;
+        scaled[i].buf = (uint8_t*)jpeg_calloc_align(scaled[i].size, 16);
+        if (scaled[i].buf == NULL) {
+            ESP_LOGE(TAG, "alloc scaled buffer failed: %dx%d", scaled[i].width, scaled[i].height);
+            ok = false;
+            break;
+        }
+    }
+
+    // Single pass over the source: every output picks the rows it needs while the row is hot in cache
+    size_t src_stride = (size_t)width * bytes_per_pixel;
+    for (int sy = 0; ok && sy < height; sy++) {
+        const uint8_t* src_row = src + sy * src_stride;
+        for (size_t i = 0; i < output_count; i++) {
+            scaled_output_t* out = &scaled[i];
+            while (out->next_row < out->height && out->next_row * height / out->height == sy) {
+                uint8_t* dst = out->buf + (size_t)out->next_row * out->width * out_bpp;
+                convert_scaled_row(src_row, width, format, out, dst, hw_layout);
+                out->next_row++;
+            }
+        }
+    }
+
+    for (size_t i = 0; ok && i < output_count; i++) {
+        bool encoded = false;
+#if CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER
+        if (hw_layout) {
+            encoded = hw_encode_buffer(scaled[i].buf, scaled[i].size, JPEG_ENCODE_IN_FORMAT_YUV422, scaled[i].width,
+                                       scaled[i].height, outputs[i].quality, NULL, NULL, outputs[i].cb, outputs[i].arg);
+            if (!encoded) {
+                // Back to | Y0 U Y1 V | for the software encoder
+                uint16_t* buf16 = (uint16_t*)scaled[i].buf;
+                for (int j = 0; j < scaled[i].size / 2; j++) {
+                    buf16[j] = __builtin_bswap16(buf16[j]);
+                }
+            }
+        }
+#endif
+        if (!encoded) {
+            jpeg_pixel_format_t enc_src_type = (format == V4L2_PIX_FMT_GREY) ? JPEG_PIXEL_FORMAT_GRAY : JPEG_PIXEL_FORMAT_YCbYCr;
+            encoded = sw_encode_buffer(scaled[i].buf, scaled[i].size, enc_src_type, scaled[i].width, scaled[i].height,
+                                       outputs[i].quality, NULL, NULL, outputs[i].cb, outputs[i].arg);
+        }
+        ESP_LOGI(TAG, "Encoded output %u: %dx%d from %dx%d", i, scaled[i].width, scaled[i].height, width, height);
+        ok = encoded;
+    }
+
+    for (size_t i = 0; i < output_count; i++) {
+        if (scaled[i].buf) {
+            jpeg_free_align(scaled[i].buf);
+        }
+    }
+    return ok;
+}
+
+bool image_to_jpeg_scaled_cb(uint8_t* src, size_t src_len, uint16_t width, uint16_t height, v4l2_pix_fmt_t format,
+                             uint16_t max_size, uint8_t quality, jpg_out_cb cb, void* arg) {
+    uint16_t longest = width > height ? width : height;
+    if (max_size == 0 || max_size >= longest) {
+        return image_to_jpeg_cb(src, src_len, width, height, format, quality, cb, arg);
+    }
+    jpeg_output_t output = {
+        .max_size = max_size,
+        .quality = quality,
+        .cb = cb,
+        .arg = arg,
+    };
+    return image_to_jpeg_multi(src, src_len, width, height, format, &output, 1);
+}
@@ -79,6 +79,44 @@ extern "C"
     bool image_to_jpeg_cb(uint8_t *src, size_t src_len, uint16_t width, uint16_t height,
                           v4l2_pix_fmt_t format, uint8_t quality, jpg_out_cb cb, void *arg);
 
+#define JPEG_MULTI_MAX_OUTPUTS 4
+
+    // 一个 JPEG 输出（例如缩略图和大图）
+    typedef struct
+    {
+        uint16_t max_size; // 最长边的像素数，0 表示保持原分辨率
+        uint8_t quality;   // JPEG质量 (1-100)
+        jpg_out_cb cb;     // 输出回调函数
+        void *arg;         // 传递给回调函数的用户参数
+    } jpeg_output_t;
+
+    /**
+     * @brief 将图像缩放并转换为JPEG（回调版本）
+     *
+     * 在颜色转换的同时缩小图像，不需要全分辨率的中间缓冲区：
+     * - 按最长边 max_size 等比例缩小（最近邻采样）
+     * - 启用 CONFIG_XIAOZHI_ENABLE_HARDWARE_JPEG_ENCODER 时优先使用硬件编码器
+     * - max_size 为 0 或不小于原图时与 image_to_jpeg_cb 相同
+     *
+     * @return true 成功, false 失败
+     */
+    bool image_to_jpeg_scaled_cb(uint8_t *src, size_t src_len, uint16_t width, uint16_t height,
+                                 v4l2_pix_fmt_t format, uint16_t max_size, uint8_t quality, jpg_out_cb cb, void *arg);
+
+    /**
+     * @brief 一次遍历源图像，生成多个不同分辨率的JPEG（例如缩略图 + 大图）
+     *
+     * 支持 RGB565/RGB565X/RGB24/YUYV/GREY 输入，其他格式按原分辨率逐个编码。
+     * 每个输出按顺序编码，并通过各自的回调函数输出。
+     *
+     * @param outputs       输出描述数组
+     * @param output_count  输出数量 (最多 JPEG_MULTI_MAX_OUTPUTS)
+     *
+     * @return true 全部成功, false 失败
+     */
+    bool image_to_jpeg_multi(uint8_t *src, size_t src_len, uint16_t width, uint16_t height,
+                             v4l2_pix_fmt_t format, const jpeg_output_t *outputs, size_t output_count);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,13 +1,144 @@
 #include "lvgl_font.h"
 #include <cbin_font.h>
+#include <esp_log.h>
+#include <esp_heap_caps.h>
+#include <cstring>
+
+#define TAG "LvglFont"
 
 
 LvglCBinFont::LvglCBinFont(void* data) {
     font_ = cbin_font_create(static_cast<uint8_t*>(data));
+#if CONFIG_USE_FONT_GLYPH_CACHE
+    if (font_ != nullptr) {
+        InitializeCache();
+    }
+#endif
 }
 
 LvglCBinFont::~LvglCBinFont() {
+    if (prefetch_buf_ != nullptr) {
+        lv_draw_buf_destroy(prefetch_buf_);
+    }
+    cache_.reset();
+    if (cache_arena_ != nullptr) {
+        heap_caps_free(cache_arena_);
+    }
     if (font_ != nullptr) {
         cbin_font_delete(font_);
     }
-}
\ No newline at end of file
+}
+
+const lv_font_t* LvglCBinFont::font() const {
+    return cache_ ? &cached_font_.font : font_;
+}
+
+void LvglCBinFont::InitializeCache() {
+#if CONFIG_USE_FONT_GLYPH_CACHE
+    // One slot holds a glyph as large as the line height in A8
+    uint32_t line_height = font_->line_height;
+    size_t slot_size = lv_draw_buf_width_to_stride(line_height, LV_COLOR_FORMAT_A8) * line_height;
+    size_t arena_size = CONFIG_FONT_GLYPH_CACHE_SIZE * 1024;
+    cache_arena_ = (uint8_t*)heap_caps_malloc(arena_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (cache_arena_ == nullptr) {
+        ESP_LOGW(TAG, "Failed to allocate %u bytes for the glyph cache", (unsigned)arena_size);
+        return;
+    }
+    cache_ = std::make_unique<GlyphCache>(cache_arena_, arena_size, slot_size);
+
+    // LVGL resolves glyphs to the copy, so the bitmaps are fetched through GetGlyphBitmap
+    cached_font_.font = *font_;
+    cached_font_.font.get_glyph_dsc = GetGlyphDsc;
+    cached_font_.font.get_glyph_bitmap = GetGlyphBitmap;
+    cached_font_.owner = this;
+    ESP_LOGI(TAG, "Glyph cache: %u slots of %u bytes", (unsigned)cache_->capacity(), (unsigned)slot_size);
+#endif
+}
+
+bool LvglCBinFont::GetGlyphDsc(const lv_font_t* font, lv_font_glyph_dsc_t* dsc, uint32_t letter, uint32_t letter_next) {
+    auto self = reinterpret_cast<const CachedFont*>(font)->owner;
+    if (!self->font_->get_glyph_dsc(font, dsc, letter, letter_next)) {
+        return false;
+    }
+    dsc->resolved_font = font;
+    return true;
+}
+
+const void* LvglCBinFont::GetGlyphBitmap(lv_font_glyph_dsc_t* g_dsc, lv_draw_buf_t* draw_buf) {
+    auto self = reinterpret_cast<const CachedFont*>(g_dsc->resolved_font)->owner;
+    return self->GetCachedBitmap(g_dsc, draw_buf, false);
+}
+
+const void* LvglCBinFont::GetCachedBitmap(lv_font_glyph_dsc_t* g_dsc, lv_draw_buf_t* draw_buf, bool prefetch) {
+    auto decode = font_->get_glyph_bitmap;
+    // Only bitmaps decoded into the draw buffer are cached, raw and image glyphs point into the font
+    if (draw_buf == nullptr || g_dsc->req_raw_bitmap
+        || g_dsc->format < LV_FONT_GLYPH_FORMAT_A1 || g_dsc->format > LV_FONT_GLYPH_FORMAT_A8) {
+        return decode(g_dsc, draw_buf);
+    }
+
+    uint32_t key = g_dsc->gid.index;
+    size_t size = draw_buf->header.stride * g_dsc->box_h;
+    if (!prefetch) {
+        size_t cached_size = 0;
+        auto bitmap = cache_->Find(key, cached_size);
+        if (bitmap != nullptr && cached_size == size && size <= draw_buf->data_size) {
+            memcpy(draw_buf->data, bitmap, size);
+            return bitmap_is_draw_buf_ ? static_cast<const void*>(draw_buf) : draw_buf->data;
+        }
+    }
+
+    const void* result = decode(g_dsc, draw_buf);
+    if (result != draw_buf && result != draw_buf->data) {
+        return result;
+    }
+    bitmap_is_draw_buf_ = result == draw_buf;
+    uint8_t* slot = cache_->Insert(key, size, prefetch);
+    if (slot != nullptr) {
+        memcpy(slot, draw_buf->data, size);
+    }
+    return result;
+}
+
+void LvglCBinFont::Prefetch(const char* text) {
+    if (!cache_ || text == nullptr) {
+        return;
+    }
+
+    auto font = &cached_font_.font;
+    if (prefetch_buf_ == nullptr) {
+        prefetch_buf_ = lv_draw_buf_create(font->line_height, font->line_height, LV_COLOR_FORMAT_A8, LV_STRIDE_AUTO);
+        if (prefetch_buf_ == nullptr) {
+            return;
+        }
+    }
+
+    // Decode the glyphs missing from the cache before the label is created, so it is drawn from
+    // internal RAM. Stop at half of the cache, a longer text would evict its own glyphs.
+    size_t decoded = 0;
+    uint32_t i = 0;
+    uint32_t letter;
+    while (decoded < cache_->capacity() / 2 && (letter = lv_text_encoded_next(text, &i)) != 0) {
+        lv_font_glyph_dsc_t dsc = {};
+        if (!GetGlyphDsc(font, &dsc, letter, 0) || dsc.box_w == 0 || dsc.box_h == 0
+            || cache_->Contains(dsc.gid.index)) {
+            continue;
+        }
+        // Fails for glyphs larger than a slot, which are not cached anyway
+        if (lv_draw_buf_reshape(prefetch_buf_, LV_COLOR_FORMAT_A8, dsc.box_w, dsc.box_h, LV_STRIDE_AUTO) == nullptr) {
+            continue;
+        }
+        GetCachedBitmap(&dsc, prefetch_buf_, true);
+        if (font_->release_glyph != nullptr) {
+            font_->release_glyph(font, &dsc);
+        }
+        decoded++;
+    }
+    if (decoded > 0) {
+        ESP_LOGD(TAG, "Prefetched %u glyphs", (unsigned)decoded);
+    }
+}
+
+cJSON* LvglCBinFont::GetCacheStatsJson() const {
+    return cache_ ? cache_->GetStatsJson() : nullptr;
+}
@@ -1,12 +1,21 @@
 #pragma once
 
 #include <lvgl.h>
+#include <cJSON.h>
+#include <memory>
+
+#include "glyph_cache.h"
 
 
 class LvglFont {
 public:
     virtual const lv_font_t* font() const = 0;
     virtual ~LvglFont() = default;
+
+    // Decode the glyphs of a text ahead of rendering it, must be called with the display locked
+    virtual void Prefetch(const char* text) {}
+    // Glyph cache statistics, nullptr if the font has no cache. Caller takes ownership.
+    virtual cJSON* GetCacheStatsJson() const { return nullptr; }
 };
 
 // Built-in font
@@ -20,12 +29,35 @@ private:
 };
 
 
+// Font in the assets partition, rendered straight from the memory mapped flash.
+// With CONFIG_USE_FONT_GLYPH_CACHE the decoded glyph bitmaps are kept in an LRU cache in internal RAM,
+// so redrawing text does not go through the flash cache again.
 class LvglCBinFont : public LvglFont {
 public:
     LvglCBinFont(void* data);
     virtual ~LvglCBinFont();
-    virtual const lv_font_t* font() const override { return font_; }
+    virtual const lv_font_t* font() const override;
+    virtual void Prefetch(const char* text) override;
+    virtual cJSON* GetCacheStatsJson() const override;
 
 private:
+    // Copy of the font with the glyph callbacks going through the cache
+    struct CachedFont {
+        lv_font_t font;
+        LvglCBinFont* owner;
+    };
+
     lv_font_t* font_;
+    CachedFont cached_font_ = {};
+    uint8_t* cache_arena_ = nullptr;
+    std::unique_ptr<GlyphCache> cache_;
+    lv_draw_buf_t* prefetch_buf_ = nullptr;
+    // Whether the font returns the draw buffer or its data from get_glyph_bitmap
+    bool bitmap_is_draw_buf_ = true;
+
+    void InitializeCache();
+    const void* GetCachedBitmap(lv_font_glyph_dsc_t* g_dsc, lv_draw_buf_t* draw_buf, bool prefetch);
+
+    static bool GetGlyphDsc(const lv_font_t* font, lv_font_glyph_dsc_t* dsc, uint32_t letter, uint32_t letter_next);
+    static const void* GetGlyphBitmap(lv_font_glyph_dsc_t* g_dsc, lv_draw_buf_t* draw_buf);
 };
@@ -1,16 +1,19 @@
 #include "circular_strip.h"
+#include "led_animator.h"
+#include "led_effects.h"
 #include "application.h"
 #include <esp_log.h>
+#include <algorithm>
 
 #define TAG "CircularStrip"
 
-#define BLINK_INFINITE -1
-
 CircularStrip::CircularStrip(gpio_num_t gpio, uint8_t max_leds) : max_leds_(max_leds) {
     // If the gpio is not connected, you should use NoLed class
     assert(gpio != GPIO_NUM_NC);
 
     colors_.resize(max_leds_);
+    frame_.resize(max_leds_);
+    shown_.resize(max_leds_);
 
     led_strip_config_t strip_config = {};
     strip_config.strip_gpio_num = gpio;
@@ -23,165 +26,186 @@ CircularStrip::CircularStrip(gpio_num_t gpio, uint8_t max_leds) : max_leds_(max_
 
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip_));
     led_strip_clear(led_strip_);
-
-    esp_timer_create_args_t strip_timer_args = {
-        .callback = [](void *arg) {
-            auto strip = static_cast<CircularStrip*>(arg);
-            std::lock_guard<std::mutex> lock(strip->mutex_);
-            if (strip->strip_callback_ != nullptr) {
-                strip->strip_callback_();
-            }
-        },
-        .arg = this,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "strip_timer",
-        .skip_unhandled_events = false,
-    };
-    ESP_ERROR_CHECK(esp_timer_create(&strip_timer_args, &strip_timer_));
+    shown_valid_ = true;
 }
 
 CircularStrip::~CircularStrip() {
-    esp_timer_stop(strip_timer_);
+    LedAnimator::GetInstance().Stop(this);
     if (led_strip_ != nullptr) {
         led_strip_del(led_strip_);
     }
 }
 
+// Push the pixels of frame_ that differ from what the strip shows, must be called with mutex_ held
+void CircularStrip::Refresh() {
+    bool changed = false;
+    for (int i = 0; i < max_leds_; i++) {
+        auto& c = frame_[i];
+        auto& s = shown_[i];
+        if (shown_valid_ && c.red == s.red && c.green == s.green && c.blue == s.blue) {
+            continue;
+        }
+        led_strip_set_pixel(led_strip_, i, c.red, c.green, c.blue);
+        s = c;
+        changed = true;
+    }
+    shown_valid_ = true;
+    if (changed) {
+        led_strip_refresh(led_strip_);
+    }
+}
+
+void CircularStrip::StartEffect(int interval_ms, std::function<int()> step) {
+    if (led_strip_ == nullptr) {
+        return;
+    }
+    // The step of the previous effect must not see the reset counters
+    StopEffect();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        effect_step_ = 0;
+        effect_interval_ms_ = interval_ms;
+    }
+    LedAnimator::GetInstance().Start(this, 0, std::move(step));
+}
+
+void CircularStrip::StopEffect() {
+    LedAnimator::GetInstance().Stop(this);
+}
 
 void CircularStrip::SetAllColor(StripColor color) {
+    StopEffect();
     std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(strip_timer_);
     for (int i = 0; i < max_leds_; i++) {
         colors_[i] = color;
-        led_strip_set_pixel(led_strip_, i, color.red, color.green, color.blue);
+        frame_[i] = color;
     }
-    led_strip_refresh(led_strip_);
+    Refresh();
 }
 
 void CircularStrip::SetSingleColor(uint8_t index, StripColor color) {
+    StopEffect();
     std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(strip_timer_);
     colors_[index] = color;
-    led_strip_set_pixel(led_strip_, index, color.red, color.green, color.blue);
-    led_strip_refresh(led_strip_);
+    frame_[index] = color;
+    Refresh();
 }
 
 void CircularStrip::Blink(StripColor color, int interval_ms) {
-    for (int i = 0; i < max_leds_; i++) {
-        colors_[i] = color;
+    // Stop the running effect first, its step would overwrite the new colors
+    StopEffect();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int i = 0; i < max_leds_; i++) {
+            colors_[i] = color;
+        }
     }
-    StartStripTask(interval_ms, [this]() {
-        static bool on = true;
-        if (on) {
-            for (int i = 0; i < max_leds_; i++) {
-                led_strip_set_pixel(led_strip_, i, colors_[i].red, colors_[i].green, colors_[i].blue);
-            }
-            led_strip_refresh(led_strip_);
-        } else {
-            led_strip_clear(led_strip_);
+    StartEffect(interval_ms, [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool on = (effect_step_++ & 1) == 0;
+        for (int i = 0; i < max_leds_; i++) {
+            frame_[i] = on ? colors_[i] : StripColor{};
         }
-        on = !on;
+        Refresh();
+        return effect_interval_ms_;
     });
 }
 
 void CircularStrip::FadeOut(int interval_ms) {
-    StartStripTask(interval_ms, [this]() {
-        bool all_off = true;
+    StartEffect(interval_ms, [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint8_t level = led_effects::kFadeOutCurve[effect_step_++];
         for (int i = 0; i < max_leds_; i++) {
-            colors_[i].red /= 2;
-            colors_[i].green /= 2;
-            colors_[i].blue /= 2;
-            if (colors_[i].red != 0 || colors_[i].green != 0 || colors_[i].blue != 0) {
-                all_off = false;
-            }
-            led_strip_set_pixel(led_strip_, i, colors_[i].red, colors_[i].green, colors_[i].blue);
+            frame_[i] = {
+                led_effects::Mix(0, colors_[i].red, level),
+                led_effects::Mix(0, colors_[i].green, level),
+                led_effects::Mix(0, colors_[i].blue, level),
+            };
         }
-        if (all_off) {
-            led_strip_clear(led_strip_);
-            esp_timer_stop(strip_timer_);
-        } else {
-            led_strip_refresh(led_strip_);
+        Refresh();
+        if (effect_step_ >= (int)led_effects::kFadeOutCurve.size()) {
+            for (int i = 0; i < max_leds_; i++) {
+                colors_[i] = {};
+            }
+            return -1;
         }
+        return effect_interval_ms_;
     });
 }
 
 void CircularStrip::Breathe(StripColor low, StripColor high, int interval_ms) {
-    StartStripTask(interval_ms, [this, low, high]() {
-        static bool increase = true;
-        static StripColor color = low;
-        if (increase) {
-            if (color.red < high.red) {
-                color.red++;
-            }
-            if (color.green < high.green) {
-                color.green++;
-            }
-            if (color.blue < high.blue) {
-                color.blue++;
-            }
-            if (color.red == high.red && color.green == high.green && color.blue == high.blue) {
-                increase = false;
-            }
-        } else {
-            if (color.red > low.red) {
-                color.red--;
-            }
-            if (color.green > low.green) {
-                color.green--;
-            }
-            if (color.blue > low.blue) {
-                color.blue--;
-            }
-            if (color.red == low.red && color.green == low.green && color.blue == low.blue) {
-                increase = true;
-            }
-        }
+    StopEffect();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        effect_low_ = low;
+        effect_high_ = high;
+    }
+    StartEffect(interval_ms, [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        uint8_t level = led_effects::kBreatheCurve[effect_step_];
+        effect_step_ = (effect_step_ + 1) % LED_BREATHE_STEPS;
+        StripColor color = {
+            led_effects::Mix(effect_low_.red, effect_high_.red, level),
+            led_effects::Mix(effect_low_.green, effect_high_.green, level),
+            led_effects::Mix(effect_low_.blue, effect_high_.blue, level),
+        };
         for (int i = 0; i < max_leds_; i++) {
-            led_strip_set_pixel(led_strip_, i, color.red, color.green, color.blue);
+            colors_[i] = color;
+            frame_[i] = color;
         }
-        led_strip_refresh(led_strip_);
+        Refresh();
+        return effect_interval_ms_;
     });
 }
 
 void CircularStrip::Scroll(StripColor low, StripColor high, int length, int interval_ms) {
-    for (int i = 0; i < max_leds_; i++) {
-        colors_[i] = low;
+    StopEffect();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        effect_low_ = low;
+        effect_high_ = high;
+        effect_length_ = length;
     }
-    StartStripTask(interval_ms, [this, low, high, length]() {
-        static int offset = 0;
+    StartEffect(interval_ms, [this]() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int offset = effect_step_;
+        effect_step_ = (effect_step_ + 1) % max_leds_;
         for (int i = 0; i < max_leds_; i++) {
-            colors_[i] = low;
+            colors_[i] = effect_low_;
         }
-        for (int j = 0; j < length; j++) {
-            int i = (offset + j) % max_leds_;
-            colors_[i] = high;
+        for (int j = 0; j < effect_length_; j++) {
+            colors_[(offset + j) % max_leds_] = effect_high_;
         }
-        for (int i = 0; i < max_leds_; i++) {
-            led_strip_set_pixel(led_strip_, i, colors_[i].red, colors_[i].green, colors_[i].blue);
-        }
-        led_strip_refresh(led_strip_);
-        offset = (offset + 1) % max_leds_;
+        // Only the head and tail pixels change between frames
+        frame_ = colors_;
+        Refresh();
+        return effect_interval_ms_;
     });
 }
 
-void CircularStrip::StartStripTask(int interval_ms, std::function<void()> cb) {
-    if (led_strip_ == nullptr) {
-        return;
-    }
-
-    std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(strip_timer_);
-    
-    strip_callback_ = cb;
-    esp_timer_start_periodic(strip_timer_, interval_ms * 1000);
-}
-
 void CircularStrip::SetBrightness(uint8_t default_brightness, uint8_t low_brightness) {
     default_brightness_ = default_brightness;
     low_brightness_ = low_brightness;
     OnStateChanged();
 }
 
+void CircularStrip::OnSoundDirection(int degrees) {
+    if (degrees < 0 || Application::GetInstance().GetDeviceState() != kDeviceStateListening) {
+        return;
+    }
+    // Brighten the LED toward the talker over the dimmed listening color
+    int index = std::min(degrees * max_leds_ / 180, max_leds_ - 1);
+    StripColor dim = { low_brightness_, 0, 0 };
+    StripColor bright = { default_brightness_, low_brightness_, low_brightness_ };
+    StopEffect();
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < max_leds_; i++) {
+        colors_[i] = i == index ? bright : dim;
+        frame_[i] = colors_[i];
+    }
+    Refresh();
+}
+
 void CircularStrip::OnStateChanged() {
     auto& app = Application::GetInstance();
     auto device_state = app.GetDeviceState();
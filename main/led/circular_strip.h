@@ -4,8 +4,7 @@
 #include "led.h"
 #include <driver/gpio.h>
 #include <led_strip.h>
-#include <esp_timer.h>
-#include <atomic>
+#include <functional>
 #include <mutex>
 #include <vector>
 
@@ -22,6 +21,7 @@ public:
     virtual ~CircularStrip();
 
     void OnStateChanged() override;
+    void OnSoundDirection(int degrees) override;
     void SetBrightness(uint8_t default_brightness, uint8_t low_brightness);
     void SetAllColor(StripColor color);
     void SetSingleColor(uint8_t index, StripColor color);
@@ -31,19 +31,26 @@ public:
 
 private:
     std::mutex mutex_;
-    TaskHandle_t blink_task_ = nullptr;
     led_strip_handle_t led_strip_ = nullptr;
     int max_leds_ = 0;
     std::vector<StripColor> colors_;
-    int blink_counter_ = 0;
-    int blink_interval_ms_ = 0;
-    esp_timer_handle_t strip_timer_ = nullptr;
-    std::function<void()> strip_callback_ = nullptr;
+    std::vector<StripColor> frame_;
+    std::vector<StripColor> shown_;
+    bool shown_valid_ = false;
+
+    // Per-instance effect state, driven by LedAnimator
+    StripColor effect_low_;
+    StripColor effect_high_;
+    int effect_length_ = 0;
+    int effect_step_ = 0;
+    int effect_interval_ms_ = 0;
 
     uint8_t default_brightness_ = DEFAULT_BRIGHTNESS;
     uint8_t low_brightness_ = LOW_BRIGHTNESS;
 
-    void StartStripTask(int interval_ms, std::function<void()> cb);
+    void StartEffect(int interval_ms, std::function<int()> step);
+    void StopEffect();
+    void Refresh();
     void Rainbow(StripColor low, StripColor high, int interval_ms);
     void FadeOut(int interval_ms);
 };
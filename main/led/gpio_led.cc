@@ -1,4 +1,5 @@
 #include "gpio_led.h"
+#include "led_animator.h"
 #include "application.h"
 #include "device_state.h"
 #include <esp_log.h>
@@ -70,18 +71,6 @@ GpioLed::GpioLed(gpio_num_t gpio, int output_invert, ledc_timer_t timer_num, led
     };
     ledc_cb_register(ledc_channel_.speed_mode, ledc_channel_.channel, &ledc_callbacks, this);
 
-    esp_timer_create_args_t blink_timer_args = {
-        .callback = [](void *arg) {
-            auto led = static_cast<GpioLed*>(arg);
-            led->OnBlinkTimer();
-        },
-        .arg = this,
-        .dispatch_method = ESP_TIMER_TASK,
-        .name = "Blink Timer",
-        .skip_unhandled_events = false,
-    };
-    ESP_ERROR_CHECK(esp_timer_create(&blink_timer_args, &blink_timer_));
-
     xTaskCreate(EventTask, "LedEvent", 2048, this, 
             tskIDLE_PRIORITY + 2, &event_task_handle_);
 
@@ -89,7 +78,7 @@ GpioLed::GpioLed(gpio_num_t gpio, int output_invert, ledc_timer_t timer_num, led
 }
 
 GpioLed::~GpioLed() {
-    esp_timer_stop(blink_timer_);
+    LedAnimator::GetInstance().Stop(this);
     if (ledc_initialized_) {
         ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
         ledc_fade_func_uninstall();
@@ -110,8 +99,8 @@ void GpioLed::TurnOn() {
         return;
     }
 
+    LedAnimator::GetInstance().Stop(this);
     std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(blink_timer_);
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
     ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, duty_);
     ledc_update_duty(ledc_channel_.speed_mode, ledc_channel_.channel);
@@ -122,8 +111,8 @@ void GpioLed::TurnOff() {
         return;
     }
 
+    LedAnimator::GetInstance().Stop(this);
     std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(blink_timer_);
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
     ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, 0);
     ledc_update_duty(ledc_channel_.speed_mode, ledc_channel_.channel);
@@ -146,28 +135,32 @@ void GpioLed::StartBlinkTask(int times, int interval_ms) {
         return;
     }
 
+    LedAnimator::GetInstance().Stop(this);
     std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(blink_timer_);
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
 
     blink_counter_ = times * 2;
     blink_interval_ms_ = interval_ms;
-    esp_timer_start_periodic(blink_timer_, interval_ms * 1000);
+    LedAnimator::GetInstance().Start(this, interval_ms, [this]() {
+        return OnBlinkStep();
+    });
 }
 
-void GpioLed::OnBlinkTimer() {
+int GpioLed::OnBlinkStep() {
     std::lock_guard<std::mutex> lock(mutex_);
     blink_counter_--;
+    int next_ms = blink_interval_ms_;
     if (blink_counter_ & 1) {
         ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, duty_);
     } else {
         ledc_set_duty(ledc_channel_.speed_mode, ledc_channel_.channel, 0);
 
         if (blink_counter_ == 0) {
-            esp_timer_stop(blink_timer_);
+            next_ms = -1;
         }
     }
     ledc_update_duty(ledc_channel_.speed_mode, ledc_channel_.channel);
+    return next_ms;
 }
 
 void GpioLed::StartFadeTask() {
@@ -175,8 +168,8 @@ void GpioLed::StartFadeTask() {
         return;
     }
 
+    LedAnimator::GetInstance().Stop(this);
     std::lock_guard<std::mutex> lock(mutex_);
-    esp_timer_stop(blink_timer_);
     ledc_fade_stop(ledc_channel_.speed_mode, ledc_channel_.channel);
     fade_up_ = true;
     ledc_set_fade_with_time(ledc_channel_.speed_mode,
@@ -6,7 +6,6 @@
 #include "led.h"
 #include <driver/gpio.h>
 #include <driver/ledc.h>
-#include <esp_timer.h>
 #include <atomic>
 #include <mutex>
 
@@ -30,13 +29,12 @@ class GpioLed : public Led {
     uint32_t duty_ = 0;
     int blink_counter_ = 0;
     int blink_interval_ms_ = 0;
-    esp_timer_handle_t blink_timer_ = nullptr;
     bool fade_up_ = true;
     TaskHandle_t event_task_handle_;
     
     static void EventTask(void* arg);
     void StartBlinkTask(int times, int interval_ms);
-    void OnBlinkTimer();
+    int OnBlinkStep();
 
     void BlinkOnce();
     void Blink(int times, int interval_ms);
@@ -6,6 +6,8 @@ public:
     virtual ~Led() = default;
     // Set the led state based on the device state
     virtual void OnStateChanged() = 0;
+    // Show where the talker is, 0 to 180 degrees along the microphone array
+    virtual void OnSoundDirection(int degrees) { (void)degrees; }
 };
 
 
@@ -0,0 +1,115 @@
+#include "led_animator.h"
+
+#include <esp_log.h>
+#include <algorithm>
+
+#define TAG "LedAnimator"
+
+LedAnimator::LedAnimator() {
+    esp_timer_create_args_t timer_args = {
+        .callback = [](void* arg) {
+            static_cast<LedAnimator*>(arg)->OnTimer();
+        },
+        .arg = this,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "led_animator",
+        .skip_unhandled_events = true,
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &timer_));
+}
+
+LedAnimator::~LedAnimator() {
+    esp_timer_stop(timer_);
+    esp_timer_delete(timer_);
+}
+
+void LedAnimator::Start(void* owner, int delay_ms, StepCallback step) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    WaitForStep(lock, owner);
+    auto due_us = esp_timer_get_time() + (int64_t)delay_ms * 1000;
+    auto it = std::find_if(animations_.begin(), animations_.end(), [owner](const Animation& a) { return a.owner == owner; });
+    if (it != animations_.end()) {
+        *it = {owner, ++generation_, due_us, std::move(step)};
+    } else {
+        animations_.push_back({owner, ++generation_, due_us, std::move(step)});
+    }
+    ArmTimer();
+}
+
+void LedAnimator::Stop(void* owner) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    animations_.erase(std::remove_if(animations_.begin(), animations_.end(),
+        [owner](const Animation& a) { return a.owner == owner; }), animations_.end());
+    ArmTimer();
+    WaitForStep(lock, owner);
+}
+
+void LedAnimator::WaitForStep(std::unique_lock<std::mutex>& lock, void* owner) {
+    // A step that starts or stops animations runs in the timer task and must not wait for itself
+    if (xTaskGetCurrentTaskHandle() == timer_task_) {
+        return;
+    }
+    step_done_.wait(lock, [this, owner]() { return running_owner_ != owner; });
+}
+
+void LedAnimator::ArmTimer() {
+    esp_timer_stop(timer_);
+    if (animations_.empty()) {
+        return;
+    }
+    auto next = std::min_element(animations_.begin(), animations_.end(),
+        [](const Animation& a, const Animation& b) { return a.due_us < b.due_us; });
+    auto delay_us = std::max<int64_t>(next->due_us - esp_timer_get_time(), 0);
+    esp_timer_start_once(timer_, delay_us);
+}
+
+void LedAnimator::OnTimer() {
+    // Run the due steps without holding the lock, a step may start or stop animations
+    std::vector<Animation> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timer_task_ = xTaskGetCurrentTaskHandle();
+        auto now = esp_timer_get_time();
+        for (auto& animation : animations_) {
+            if (animation.due_us <= now + 1000) {
+                due.push_back(animation);
+            }
+        }
+    }
+
+    for (auto& animation : due) {
+        auto is_current = [this, &animation]() {
+            return std::find_if(animations_.begin(), animations_.end(), [&animation](const Animation& a) {
+                return a.owner == animation.owner && a.generation == animation.generation;
+            });
+        };
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (is_current() == animations_.end()) {
+                // Replaced or stopped by an earlier step
+                continue;
+            }
+            running_owner_ = animation.owner;
+        }
+
+        int next_ms = animation.step();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_owner_ = nullptr;
+        step_done_.notify_all();
+        auto it = is_current();
+        if (it == animations_.end()) {
+            // Replaced or stopped while the step was running
+            continue;
+        }
+        if (next_ms < 0) {
+            animations_.erase(it);
+        } else {
+            // Keep the cadence stable even if the timer fired late
+            it->due_us = std::max(it->due_us + (int64_t)next_ms * 1000, esp_timer_get_time());
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    ArmTimer();
+}
@@ -0,0 +1,59 @@
+#ifndef _LED_ANIMATOR_H_
+#define _LED_ANIMATOR_H_
+
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+/**
+ * Drives the animations of all LEDs from a single one-shot esp_timer.
+ *
+ * The timer is armed for the earliest due animation only, so static colors cost no wakeups.
+ * Each LED keeps its effect state in its own members and registers a step function with
+ * itself as the owner; starting a new animation for the same owner replaces the old one.
+ * Start and Stop wait for a step of the owner that is running, so once Stop returns the
+ * owner is no longer used and may be destroyed.
+ */
+class LedAnimator {
+public:
+    // Renders one frame, returns the delay in ms until the next frame or -1 when finished
+    using StepCallback = std::function<int()>;
+
+    static LedAnimator& GetInstance() {
+        static LedAnimator instance;
+        return instance;
+    }
+
+    void Start(void* owner, int delay_ms, StepCallback step);
+    void Stop(void* owner);
+
+private:
+    struct Animation {
+        void* owner;
+        uint32_t generation;
+        int64_t due_us;
+        StepCallback step;
+    };
+
+    std::mutex mutex_;
+    std::condition_variable step_done_;
+    std::vector<Animation> animations_;
+    // The owner whose step runs in the timer task, without mutex_ held
+    void* running_owner_ = nullptr;
+    TaskHandle_t timer_task_ = nullptr;
+    uint32_t generation_ = 0;
+    esp_timer_handle_t timer_ = nullptr;
+
+    LedAnimator();
+    ~LedAnimator();
+
+    void OnTimer();
+    void ArmTimer();
+    void WaitForStep(std::unique_lock<std::mutex>& lock, void* owner);
+};
+
+#endif // _LED_ANIMATOR_H_
@@ -0,0 +1,46 @@
+#ifndef _LED_EFFECTS_H_
+#define _LED_EFFECTS_H_
+
+#include <array>
+#include <cstdint>
+
+// Effect curves are generated at compile time, animations only index into them
+
+#define LED_BREATHE_STEPS 64
+
+namespace led_effects {
+
+// One breathe cycle (rise then fall), gamma 2 so the low end changes slowly like the eye expects
+constexpr std::array<uint8_t, LED_BREATHE_STEPS> MakeBreatheCurve() {
+    std::array<uint8_t, LED_BREATHE_STEPS> curve = {};
+    constexpr int half = LED_BREATHE_STEPS / 2;
+    for (int i = 0; i < LED_BREATHE_STEPS; i++) {
+        int x = i < half ? i * 255 / (half - 1) : (LED_BREATHE_STEPS - 1 - i) * 255 / (half - 1);
+        curve[i] = (uint8_t)(x * x / 255);
+    }
+    return curve;
+}
+
+// Each step halves the brightness, 9 steps take any 8-bit level to 0
+constexpr std::array<uint8_t, 9> MakeFadeOutCurve() {
+    std::array<uint8_t, 9> curve = {};
+    for (int i = 0; i < 9; i++) {
+        curve[i] = (uint8_t)(255 >> i);
+    }
+    return curve;
+}
+
+inline constexpr auto kBreatheCurve = MakeBreatheCurve();
+inline constexpr auto kFadeOutCurve = MakeFadeOutCurve();
+
+// Linear mix of two channel values, level 0 gives low and 255 gives high
+constexpr uint8_t Mix(uint8_t low, uint8_t high, uint8_t level) {
+    return (uint8_t)(low + ((int)high - (int)low) * level / 255);
+}
+
+static_assert(kBreatheCurve[0] == 0 && kBreatheCurve[LED_BREATHE_STEPS / 2 - 1] == 255);
+static_assert(kFadeOutCurve.back() == 0);
+
+} // namespace led_effects
+
+#endif // _LED_EFFECTS_H_
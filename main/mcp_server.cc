@@ -8,9 +8,11 @@
 #include <esp_app_desc.h>
 #include <algorithm>
 #include <cstring>
+#include <cstdlib>
 #include <esp_pthread.h>
 
 #include "application.h"
+#include "json_writer.h"
 #include "display.h"
 #include "oled_display.h"
 #include "board.h"
@@ -24,6 +26,10 @@ McpServer::McpServer() {
 }
 
 McpServer::~McpServer() {
+    if (tool_timeout_timer_ != nullptr) {
+        esp_timer_stop(tool_timeout_timer_);
+        esp_timer_delete(tool_timeout_timer_);
+    }
     for (auto tool : tools_) {
         delete tool;
     }
@@ -117,12 +123,29 @@ void McpServer::AddCommonTools() {
                 }
                 auto question = properties["question"].value<std::string>();
                 return camera->Explain(question);
-            });
+            }, kMcpToolExecutionBackground, 60000);
+
+        if (camera->HasLivePreview()) {
+            AddTool("self.camera.set_live_preview",
+                "Show what the camera sees on the screen continuously, or stop showing it.\n"
+                "Args:\n"
+                "  `enabled`: true to start the live preview, false to stop it.",
+                PropertyList({
+                    Property("enabled", kPropertyTypeBoolean)
+                }),
+                [camera](const PropertyList& properties) -> ReturnValue {
+                    if (!camera->SetLivePreview(properties["enabled"].value<bool>())) {
+                        throw std::runtime_error("Failed to start the live preview");
+                    }
+                    return true;
+                });
+        }
     }
 #endif
 
     // Restore the original tools list to the end of the tools list
     tools_.insert(tools_.end(), original_tools.begin(), original_tools.end());
+    tools_json_dirty_ = true;
 }
 
 void McpServer::AddUserOnlyTools() {
@@ -148,6 +171,40 @@ void McpServer::AddUserOnlyTools() {
             return true;
         });
 
+    AddUserOnlyTool("self.audio_speaker.get_power_stats",
+        "Get the audio codec power statistics, including on time, power ups and the wait caused by powering up on demand",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            return Application::GetInstance().GetAudioService().GetPowerStatsJson();
+        }, kMcpToolExecutionInline);
+
+#if CONFIG_USE_LOW_POWER_WAKE_WORD
+    AddUserOnlyTool("self.wake_word.get_power_stats",
+        "Get the wake word listening statistics in power save mode, including the duty cycle of the wake word engine and the estimated battery life compared to always-on detection",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            return Application::GetInstance().GetAudioService().GetWakeWordGateStatsJson();
+        }, kMcpToolExecutionInline);
+#endif
+
+#if CONFIG_USE_MIC_ARRAY
+    if (Application::GetInstance().GetAudioService().HasMicArray()) {
+        AddUserOnlyTool("self.audio.get_mic_array_stats",
+            "Get the microphone array statistics, including the direction of the talker, the correlation of the microphones and the best microphone",
+            PropertyList(),
+            [](const PropertyList& properties) -> ReturnValue {
+                return Application::GetInstance().GetAudioService().GetMicArrayStatsJson();
+            }, kMcpToolExecutionInline);
+    }
+#endif
+
+    AddUserOnlyTool("self.get_state_history",
+        "Get the recent device state transitions with timestamps and the latency until each state was handled",
+        PropertyList(),
+        [](const PropertyList& properties) -> ReturnValue {
+            return Application::GetInstance().GetStateHistoryJson();
+        }, kMcpToolExecutionInline);
+
     // Firmware upgrade
     AddUserOnlyTool("self.upgrade_firmware", "Upgrade firmware from a specific URL. This will download and install the firmware, then reboot the device.",
         PropertyList({
@@ -157,13 +214,22 @@ void McpServer::AddUserOnlyTools() {
             auto url = properties["url"].value<std::string>();
             ESP_LOGI(TAG, "User requested firmware upgrade from URL: %s", url.c_str());
             
-            auto& app = Application::GetInstance();
-            app.Schedule([url, &app]() {
-                bool success = app.UpgradeFirmware(url);
+            // The download runs in its own task, UpgradeFirmware() schedules the state changes on the
+            // main task, which keeps ticking and showing the progress
+            auto url_copy = new std::string(std::move(url));
+            BaseType_t ret = xTaskCreate([](void* arg) {
+                auto url = static_cast<std::string*>(arg);
+                bool success = Application::GetInstance().UpgradeFirmware(*url);
                 if (!success) {
                     ESP_LOGE(TAG, "Firmware upgrade failed");
                 }
-            });
+                delete url;
+                vTaskDelete(NULL);
+            }, "upgrade", 4096 * 2, url_copy, 2, nullptr);
+            if (ret != pdPASS) {
+                delete url_copy;
+                throw std::runtime_error("Failed to create upgrade task");
+            }
             
             return true;
         });
@@ -281,6 +347,21 @@ void McpServer::AddUserOnlyTools() {
                 return true;
             });
 #endif // CONFIG_LV_USE_SNAPSHOT
+
+#if CONFIG_USE_FONT_GLYPH_CACHE
+        AddUserOnlyTool("self.screen.get_font_cache_stats",
+            "Get the glyph cache statistics of the text font, including the hit rate and the glyphs prefetched for chat messages",
+            PropertyList(),
+            [display](const PropertyList& properties) -> ReturnValue {
+                auto theme = static_cast<LvglTheme*>(display->GetTheme());
+                auto text_font = theme != nullptr ? theme->text_font() : nullptr;
+                auto json = text_font != nullptr ? text_font->GetCacheStatsJson() : nullptr;
+                if (json == nullptr) {
+                    throw std::runtime_error("The text font has no glyph cache");
+                }
+                return json;
+            });
+#endif
     }
 #endif // HAVE_LVGL
 
@@ -309,15 +390,21 @@ void McpServer::AddTool(McpTool* tool) {
 
     ESP_LOGI(TAG, "Add tool: %s%s", tool->name().c_str(), tool->user_only() ? " [user]" : "");
     tools_.push_back(tool);
+    tools_json_dirty_ = true;
 }
 
-void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback) {
-    AddTool(new McpTool(name, description, properties, callback));
+void McpServer::AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback,
+                        McpToolExecution execution, int timeout_ms) {
+    auto tool = new McpTool(name, description, properties, callback);
+    tool->set_execution(execution, timeout_ms);
+    AddTool(tool);
 }
 
-void McpServer::AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback) {
+void McpServer::AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback,
+                                McpToolExecution execution) {
     auto tool = new McpTool(name, description, properties, callback);
     tool->set_user_only(true);
+    tool->set_execution(execution);
     AddTool(tool);
 }
 
@@ -436,75 +523,62 @@ void McpServer::ParseMessage(const cJSON* json) {
 }
 
 void McpServer::ReplyResult(int id, const std::string& result) {
-    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
-    payload += std::to_string(id) + ",\"result\":";
-    payload += result;
-    payload += "}";
+    std::string payload(result.size() + 48, '\0');
+    JsonWriter writer(payload.data(), payload.size());
+    writer.BeginObject()
+        .AddString("jsonrpc", "2.0")
+        .AddInt("id", id)
+        .AddRaw("result", result)
+        .EndObject();
+    payload.resize(writer.length());
     Application::GetInstance().SendMcpMessage(payload);
 }
 
 void McpServer::ReplyError(int id, const std::string& message) {
-    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":";
-    payload += std::to_string(id);
-    payload += ",\"error\":{\"message\":\"";
-    payload += message;
-    payload += "\"}}";
+    std::string payload(JsonWriter::EscapedLength(message) + 64, '\0');
+    JsonWriter writer(payload.data(), payload.size());
+    writer.BeginObject()
+        .AddString("jsonrpc", "2.0")
+        .AddInt("id", id)
+        .BeginObject("error")
+        .AddString("message", message)
+        .EndObject()
+        .EndObject();
+    payload.resize(writer.length());
     Application::GetInstance().SendMcpMessage(payload);
 }
 
-void McpServer::GetToolsList(int id, const std::string& cursor, bool list_user_only_tools) {
-    const int max_payload_size = 8000;
-    std::string json = "{\"tools\":[";
-    
-    bool found_cursor = cursor.empty();
-    auto it = tools_.begin();
-    std::string next_cursor = "";
-    
-    while (it != tools_.end()) {
-        // 如果我们还没有找到起始位置，继续搜索
-        if (!found_cursor) {
-            if ((*it)->name() == cursor) {
-                found_cursor = true;
-            } else {
-                ++it;
-                continue;
-            }
-        }
-
-        if (!list_user_only_tools && (*it)->user_only()) {
-            ++it;
-            continue;
-        }
-        
-        // 添加tool前检查大小
-        std::string tool_json = (*it)->to_json() + ",";
-        if (json.length() + tool_json.length() + 30 > max_payload_size) {
-            // 如果添加这个tool会超出大小限制，设置next_cursor并退出循环
-            next_cursor = (*it)->name();
-            break;
-        }
-        
-        json += tool_json;
-        ++it;
+void McpServer::BuildToolsJson() {
+    std::vector<std::string> descriptors;
+    descriptors.reserve(tools_.size());
+    size_t total = 0;
+    for (auto tool : tools_) {
+        descriptors.push_back(tool->to_json());
+        total += descriptors.back().length();
     }
-    
-    if (json.back() == ',') {
-        json.pop_back();
+
+    tools_json_.Clear();
+    tools_json_.Reserve(tools_.size(), total);
+    for (size_t i = 0; i < tools_.size(); i++) {
+        tools_json_.Add(tools_[i]->name(), descriptors[i], tools_[i]->user_only());
     }
-    
-    if (json.back() == '[' && !tools_.empty()) {
-        // 如果没有添加任何tool，返回错误
-        ESP_LOGE(TAG, "tools/list: Failed to add tool %s because of payload size limit", next_cursor.c_str());
-        ReplyError(id, "Failed to add tool " + next_cursor + " because of payload size limit");
-        return;
+    tools_json_dirty_ = false;
+    ESP_LOGI(TAG, "Serialized %u tools, %u bytes", tools_json_.size(), tools_json_.length());
+}
+
+void McpServer::GetToolsList(int id, const std::string& cursor, bool list_user_only_tools) {
+    const size_t max_payload_size = 8000;
+    if (tools_json_dirty_) {
+        BuildToolsJson();
     }
 
-    if (next_cursor.empty()) {
-        json += "]}";
-    } else {
-        json += "],\"nextCursor\":\"" + next_cursor + "\"}";
+    std::string json;
+    std::string error;
+    if (!tools_json_.GetPage(cursor, list_user_only_tools, max_payload_size, json, error)) {
+        ESP_LOGE(TAG, "tools/list: %s", error.c_str());
+        ReplyError(id, error);
+        return;
     }
-    
     ReplyResult(id, json);
 }
 
@@ -550,14 +624,189 @@ void McpServer::DoToolCall(int id, const std::string& tool_name, const cJSON* to
         return;
     }
 
-    // Use main thread to call the tool
-    auto& app = Application::GetInstance();
-    app.Schedule([this, id, tool_iter, arguments = std::move(arguments)]() {
+    auto tool = *tool_iter;
+    switch (tool->execution()) {
+    case kMcpToolExecutionInline:
         try {
-            ReplyResult(id, (*tool_iter)->Call(arguments));
+            ReplyResult(id, tool->Call(arguments));
         } catch (const std::exception& e) {
             ESP_LOGE(TAG, "tools/call: %s", e.what());
             ReplyError(id, e.what());
         }
-    });
+        break;
+    case kMcpToolExecutionBackground:
+        RunToolInBackground(id, tool, std::move(arguments));
+        break;
+    default:
+        // Use main thread to call the tool
+        Application::GetInstance().Schedule([this, id, tool, arguments = std::move(arguments)]() {
+            try {
+                ReplyResult(id, tool->Call(arguments));
+            } catch (const std::exception& e) {
+                ESP_LOGE(TAG, "tools/call: %s", e.what());
+                ReplyError(id, e.what());
+            }
+        });
+        break;
+    }
+}
+
+void McpServer::RunToolInBackground(int id, McpTool* tool, PropertyList&& arguments) {
+    {
+        std::lock_guard<std::mutex> lock(tool_workers_mutex_);
+        if (tool_timeout_timer_ == nullptr) {
+            esp_timer_create_args_t timer_args = {
+                .callback = [](void* arg) {
+                    static_cast<McpServer*>(arg)->CheckToolTimeouts();
+                },
+                .arg = this,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "mcp_tool_timeout",
+                .skip_unhandled_events = true,
+            };
+            ESP_ERROR_CHECK(esp_timer_create(&timer_args, &tool_timeout_timer_));
+        }
+        // Start the workers on the first background call, and retry the ones that failed to start
+        if (tool_call_queue_ == nullptr) {
+            tool_call_queue_ = xQueueCreate(kToolQueueLength, sizeof(ToolCallRequest*));
+            if (tool_call_queue_ == nullptr) {
+                ESP_LOGE(TAG, "tools/call: Failed to create the tool call queue, drop %s", tool->name().c_str());
+                ReplyError(id, "Failed to start tool worker");
+                return;
+            }
+        }
+        bool any_started = false;
+        for (int i = 0; i < kToolWorkerCount; i++) {
+            auto& slot = tool_worker_slots_[i];
+            if (!slot.started) {
+                slot.started = xTaskCreate([](void* arg) {
+                    auto slot_index = (int)(intptr_t)arg;
+                    McpServer::GetInstance().ToolWorkerLoop(slot_index);
+                }, "mcp_tool", 4096 * 2, (void*)(intptr_t)i, 2, nullptr) == pdPASS;
+                if (!slot.started) {
+                    ESP_LOGE(TAG, "tools/call: Failed to start tool worker %d", i);
+                }
+            }
+            any_started |= slot.started;
+        }
+        if (!any_started) {
+            // Nothing reads the queue yet, create it again with the workers on the next call
+            vQueueDelete(tool_call_queue_);
+            tool_call_queue_ = nullptr;
+            ReplyError(id, "Failed to start tool worker");
+            return;
+        }
+
+        // Tools are not reentrant (the camera keeps one frame and one encoder thread), so a second
+        // call of a tool is refused while the first is still queued or running
+        if (std::find(tools_in_flight_.begin(), tools_in_flight_.end(), tool) != tools_in_flight_.end()) {
+            ESP_LOGW(TAG, "tools/call: %s is already running", tool->name().c_str());
+            ReplyError(id, "Tool is busy, try again later");
+            return;
+        }
+        // A worker whose call timed out is still blocked in the callback, it is not free
+        bool worker_available = false;
+        for (auto& slot : tool_worker_slots_) {
+            if (slot.started && (!slot.busy || !slot.replied)) {
+                worker_available = true;
+                break;
+            }
+        }
+        if (!worker_available) {
+            ESP_LOGE(TAG, "tools/call: All workers are held by timed out calls, drop %s", tool->name().c_str());
+            ReplyError(id, "No tool worker available");
+            return;
+        }
+        tools_in_flight_.push_back(tool);
+    }
+
+    auto request = new ToolCallRequest{id, tool, std::move(arguments)};
+    if (xQueueSend(tool_call_queue_, &request, 0) != pdTRUE) {
+        delete request;
+        {
+            std::lock_guard<std::mutex> lock(tool_workers_mutex_);
+            tools_in_flight_.erase(std::find(tools_in_flight_.begin(), tools_in_flight_.end(), tool));
+        }
+        ESP_LOGE(TAG, "tools/call: Too many tool calls in progress, drop %s", tool->name().c_str());
+        ReplyError(id, "Too many tool calls in progress");
+    }
+}
+
+void McpServer::ToolWorkerLoop(int slot_index) {
+    auto& slot = tool_worker_slots_[slot_index];
+    while (true) {
+        ToolCallRequest* request = nullptr;
+        if (xQueueReceive(tool_call_queue_, &request, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(tool_workers_mutex_);
+            slot.id = request->id;
+            slot.busy = true;
+            slot.replied = false;
+            slot.deadline_us = 0;
+            if (request->tool->timeout_ms() > 0) {
+                slot.deadline_us = esp_timer_get_time() + (int64_t)request->tool->timeout_ms() * 1000;
+                if (!esp_timer_is_active(tool_timeout_timer_)) {
+                    esp_timer_start_periodic(tool_timeout_timer_, 500 * 1000);
+                }
+            }
+        }
+
+        std::string result;
+        std::string error;
+        try {
+            result = request->tool->Call(request->arguments);
+        } catch (const std::exception& e) {
+            ESP_LOGE(TAG, "tools/call: %s", e.what());
+            error = e.what();
+        }
+
+        bool replied;
+        {
+            std::lock_guard<std::mutex> lock(tool_workers_mutex_);
+            replied = slot.replied;
+            slot.busy = false;
+            slot.deadline_us = 0;
+            tools_in_flight_.erase(std::find(tools_in_flight_.begin(), tools_in_flight_.end(), request->tool));
+        }
+
+        if (replied) {
+            ESP_LOGW(TAG, "tools/call: %s finished after timeout, result dropped", request->tool->name().c_str());
+        } else if (error.empty()) {
+            ReplyResult(request->id, result);
+        } else {
+            ReplyError(request->id, error);
+        }
+        delete request;
+    }
+}
+
+void McpServer::CheckToolTimeouts() {
+    std::vector<int> expired_ids;
+    {
+        std::lock_guard<std::mutex> lock(tool_workers_mutex_);
+        auto now = esp_timer_get_time();
+        bool pending = false;
+        for (auto& slot : tool_worker_slots_) {
+            if (!slot.busy || slot.replied || slot.deadline_us == 0) {
+                continue;
+            }
+            if (now >= slot.deadline_us) {
+                slot.replied = true;
+                expired_ids.push_back(slot.id);
+            } else {
+                pending = true;
+            }
+        }
+        if (!pending) {
+            esp_timer_stop(tool_timeout_timer_);
+        }
+    }
+
+    for (auto id : expired_ids) {
+        ESP_LOGE(TAG, "tools/call: Timeout, id: %d", id);
+        ReplyError(id, "Tool call timed out");
+    }
 }
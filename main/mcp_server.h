@@ -9,9 +9,16 @@
 #include <optional>
 #include <stdexcept>
 #include <thread>
+#include <mutex>
+#include <array>
 #include <mbedtls/base64.h>
 
 #include <cJSON.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+
+#include "mcp_tools_json.h"
 
 class ImageContent {
 private:
@@ -120,7 +127,7 @@ public:
         value_ = value;
     }
 
-    std::string to_json() const {
+    cJSON* to_cjson() const {
         cJSON *json = cJSON_CreateObject();
         
         if (type_ == kPropertyTypeBoolean) {
@@ -145,7 +152,11 @@ public:
                 cJSON_AddStringToObject(json, "default", value<std::string>().c_str());
             }
         }
-        
+        return json;
+    }
+
+    std::string to_json() const {
+        cJSON *json = to_cjson();
         char *json_str = cJSON_PrintUnformatted(json);
         std::string result(json_str);
         cJSON_free(json_str);
@@ -188,14 +199,16 @@ public:
         return required;
     }
 
-    std::string to_json() const {
+    cJSON* to_cjson() const {
         cJSON *json = cJSON_CreateObject();
-        
         for (const auto& property : properties_) {
-            cJSON *prop_json = cJSON_Parse(property.to_json().c_str());
-            cJSON_AddItemToObject(json, property.name().c_str(), prop_json);
+            cJSON_AddItemToObject(json, property.name().c_str(), property.to_cjson());
         }
-        
+        return json;
+    }
+
+    std::string to_json() const {
+        cJSON *json = to_cjson();
         char *json_str = cJSON_PrintUnformatted(json);
         std::string result(json_str);
         cJSON_free(json_str);
@@ -205,6 +218,13 @@ public:
     }
 };
 
+// Where tools/call runs the tool callback
+enum McpToolExecution {
+    kMcpToolExecutionInline,        // In the task that received the message, only for quick getters that lock their own state
+    kMcpToolExecutionMainThread,    // Scheduled to the main task
+    kMcpToolExecutionBackground,    // In the MCP worker pool, for tools that block for a long time
+};
+
 class McpTool {
 private:
     std::string name_;
@@ -212,6 +232,8 @@ private:
     PropertyList properties_;
     std::function<ReturnValue(const PropertyList&)> callback_;
     bool user_only_ = false;
+    McpToolExecution execution_ = kMcpToolExecutionMainThread;
+    int timeout_ms_ = 0;
 
 public:
     McpTool(const std::string& name, 
@@ -224,10 +246,18 @@ public:
         callback_(callback) {}
 
     void set_user_only(bool user_only) { user_only_ = user_only; }
+    // timeout_ms only applies to background tools, 0 waits forever. A timeout replies an error to
+    // the caller but cannot stop the callback, which keeps its worker until it returns.
+    void set_execution(McpToolExecution execution, int timeout_ms = 0) {
+        execution_ = execution;
+        timeout_ms_ = timeout_ms;
+    }
     inline const std::string& name() const { return name_; }
     inline const std::string& description() const { return description_; }
     inline const PropertyList& properties() const { return properties_; }
     inline bool user_only() const { return user_only_; }
+    inline McpToolExecution execution() const { return execution_; }
+    inline int timeout_ms() const { return timeout_ms_; }
 
     std::string to_json() const {
         std::vector<std::string> required = properties_.GetRequired();
@@ -239,8 +269,7 @@ public:
         cJSON *input_schema = cJSON_CreateObject();
         cJSON_AddStringToObject(input_schema, "type", "object");
         
-        cJSON *properties = cJSON_Parse(properties_.to_json().c_str());
-        cJSON_AddItemToObject(input_schema, "properties", properties);
+        cJSON_AddItemToObject(input_schema, "properties", properties_.to_cjson());
         
         if (!required.empty()) {
             cJSON *required_array = cJSON_CreateArray();
@@ -321,8 +350,10 @@ public:
     void AddCommonTools();
     void AddUserOnlyTools();
     void AddTool(McpTool* tool);
-    void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
-    void AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback);
+    void AddTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback,
+                 McpToolExecution execution = kMcpToolExecutionMainThread, int timeout_ms = 0);
+    void AddUserOnlyTool(const std::string& name, const std::string& description, const PropertyList& properties, std::function<ReturnValue(const PropertyList&)> callback,
+                         McpToolExecution execution = kMcpToolExecutionMainThread);
     void ParseMessage(const cJSON* json);
     void ParseMessage(const std::string& message);
 
@@ -337,8 +368,37 @@ private:
 
     void GetToolsList(int id, const std::string& cursor, bool list_user_only_tools);
     void DoToolCall(int id, const std::string& tool_name, const cJSON* tool_arguments);
+    void BuildToolsJson();
+    void RunToolInBackground(int id, McpTool* tool, PropertyList&& arguments);
+    void ToolWorkerLoop(int slot_index);
+    void CheckToolTimeouts();
 
     std::vector<McpTool*> tools_;
+
+    // Worker pool for background tools, a slot tracks the call running on each worker
+    static constexpr int kToolWorkerCount = 2;
+    static constexpr int kToolQueueLength = 4;
+    struct ToolCallRequest {
+        int id;
+        McpTool* tool;
+        PropertyList arguments;
+    };
+    struct ToolWorkerSlot {
+        int id = 0;
+        int64_t deadline_us = 0;
+        bool started = false;
+        bool busy = false;
+        bool replied = false;
+    };
+    std::mutex tool_workers_mutex_;
+    // Background tools queued or running, each tool runs one call at a time
+    std::vector<const McpTool*> tools_in_flight_;
+    QueueHandle_t tool_call_queue_ = nullptr;
+    std::array<ToolWorkerSlot, kToolWorkerCount> tool_worker_slots_;
+    esp_timer_handle_t tool_timeout_timer_ = nullptr;
+
+    McpToolsJson tools_json_;
+    bool tools_json_dirty_ = true;
 };
 
 #endif // MCP_SERVER_H
@@ -0,0 +1,68 @@
+#include "mcp_tools_json.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+void McpToolsJson::Clear() {
+    json_.clear();
+    tools_.clear();
+}
+
+void McpToolsJson::Reserve(size_t tools, size_t length) {
+    tools_.reserve(tools);
+    json_.reserve(length);
+}
+
+void McpToolsJson::Add(const std::string& name, const std::string& json, bool user_only) {
+    tools_.push_back({name, json_.length(), json.length(), user_only});
+    json_ += json;
+}
+
+bool McpToolsJson::GetPage(const std::string& cursor, bool list_user_only_tools, size_t max_size, std::string& result,
+                           std::string& error) const {
+    size_t index = 0;
+    if (!cursor.empty()) {
+        // Digits only, strtoul would also take a sign or leading spaces
+        bool digits = std::all_of(cursor.begin(), cursor.end(), [](char c) { return c >= '0' && c <= '9'; });
+        index = digits ? strtoul(cursor.c_str(), nullptr, 10) : 0;
+        if (!digits || index > tools_.size()) {
+            error = "Invalid cursor: " + cursor;
+            return false;
+        }
+    }
+
+    result.clear();
+    result.reserve(std::min(json_.length(), max_size) + 64);
+    result += "{\"tools\":[";
+    // Room for the closing `],"nextCursor":"<index>"}`
+    const size_t closing_length = 16 + std::to_string(tools_.size()).length() + 2;
+    size_t count = 0;
+    for (; index < tools_.size(); ++index) {
+        auto& tool = tools_[index];
+        if (!list_user_only_tools && tool.user_only) {
+            continue;
+        }
+
+        if (result.length() + (count > 0) + tool.length + closing_length > max_size) {
+            // 如果添加这个tool会超出大小限制，从这个tool开始下一页
+            break;
+        }
+        if (count++ > 0) {
+            result += ',';
+        }
+        result.append(json_, tool.offset, tool.length);
+    }
+
+    if (count == 0 && index < tools_.size()) {
+        // 如果没有添加任何tool，返回错误
+        error = "Failed to add tool " + tools_[index].name + " because of payload size limit";
+        return false;
+    }
+
+    if (index >= tools_.size()) {
+        result += "]}";
+    } else {
+        result += "],\"nextCursor\":\"" + std::to_string(index) + "\"}";
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef MCP_TOOLS_JSON_H
+#define MCP_TOOLS_JSON_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Serialized tool descriptors, built once after the tools change and sliced by index for tools/list
+class McpToolsJson {
+public:
+    void Clear();
+    void Reserve(size_t tools, size_t length);
+    // Append the descriptor of the next tool, `json` is the output of McpTool::to_json()
+    void Add(const std::string& name, const std::string& json, bool user_only);
+
+    // Build the tools/list result starting at `cursor`, the index of the first tool of the page (empty for
+    // the first page). Tools are added until the result would exceed `max_size`, a nextCursor points at
+    // the rest. Returns false with `error` set for an invalid cursor or a tool too large for a page.
+    bool GetPage(const std::string& cursor, bool list_user_only_tools, size_t max_size, std::string& result,
+                 std::string& error) const;
+
+    inline size_t size() const { return tools_.size(); }
+    inline size_t length() const { return json_.length(); }
+
+private:
+    struct Tool {
+        std::string name;
+        size_t offset;
+        size_t length;
+        bool user_only;
+    };
+    std::string json_;
+    std::vector<Tool> tools_;
+};
+
+#endif // MCP_TOOLS_JSON_H
@@ -1,4 +1,5 @@
 #include "ota.h"
+#include "delta_ota_patch.h"
 #include "system_info.h"
 #include "settings.h"
 #include "assets/lang_config.h"
@@ -13,6 +14,9 @@
 #ifdef SOC_HMAC_SUPPORTED
 #include <esp_hmac.h>
 #endif
+#if CONFIG_USE_DELTA_OTA
+#include <esp_delta_ota.h>
+#endif
 
 #include <cstring>
 #include <vector>
@@ -218,6 +222,15 @@ esp_err_t Ota::CheckVersion() {
         if (cJSON_IsString(url)) {
             firmware_url_ = url->valuestring;
         }
+        // Optional binary patch against the running firmware, verified by the SHA-256 of the full image
+        firmware_patch_url_.clear();
+        firmware_sha256_.clear();
+        cJSON *patch_url = cJSON_GetObjectItem(firmware, "patch_url");
+        cJSON *sha256 = cJSON_GetObjectItem(firmware, "sha256");
+        if (cJSON_IsString(patch_url) && cJSON_IsString(sha256)) {
+            firmware_patch_url_ = patch_url->valuestring;
+            firmware_sha256_ = sha256->valuestring;
+        }
 
         if (cJSON_IsString(version) && cJSON_IsString(url)) {
             // Check if the version is newer, for example, 0.1.0 is newer than 0.0.1
@@ -367,7 +380,181 @@ bool Ota::Upgrade(const std::string& firmware_url, std::function<void(int progre
     return true;
 }
 
+#if CONFIG_USE_DELTA_OTA
+struct DeltaOtaContext {
+    esp_ota_handle_t update_handle;
+    DeltaOtaPatch* patch;
+};
+
+// The source read callback of esp_delta_ota carries no user data
+static const esp_partition_t* delta_source_partition = nullptr;
+
+static esp_err_t DeltaOtaReadSource(uint8_t* buf, size_t size, int src_offset) {
+    if (size == 0 || delta_source_partition == nullptr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return esp_partition_read(delta_source_partition, src_offset, buf, size);
+}
+
+static esp_err_t DeltaOtaWriteMerged(const uint8_t* buf, size_t size, void* user_data) {
+    auto ctx = static_cast<DeltaOtaContext*>(user_data);
+    if (size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ctx->patch->OnImageData(buf, size);
+    return esp_ota_write(ctx->update_handle, buf, size);
+}
+#endif
+
+bool Ota::UpgradeDelta(const std::string& patch_url, const std::string& sha256, std::function<void(int progress, size_t speed)> callback) {
+#if CONFIG_USE_DELTA_OTA
+    ESP_LOGI(TAG, "Upgrading firmware with patch from %s", patch_url.c_str());
+    if (sha256.size() != 64) {
+        ESP_LOGE(TAG, "Invalid firmware SHA-256: %s", sha256.c_str());
+        return false;
+    }
+
+    auto running_partition = esp_ota_get_running_partition();
+    auto update_partition = esp_ota_get_next_update_partition(NULL);
+    if (update_partition == NULL) {
+        ESP_LOGE(TAG, "Failed to get update partition");
+        return false;
+    }
+
+    // The patch must be built against the running firmware
+    uint8_t running_sha256[32];
+    if (esp_partition_get_sha256(running_partition, running_sha256) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to get the running firmware SHA-256");
+        return false;
+    }
+
+    auto network = Board::GetInstance().GetNetwork();
+    auto http = network->CreateHttp(0);
+    if (!http->Open("GET", patch_url)) {
+        ESP_LOGE(TAG, "Failed to open HTTP connection");
+        return false;
+    }
+
+    if (http->GetStatusCode() != 200) {
+        ESP_LOGE(TAG, "Failed to get firmware patch, status code: %d", http->GetStatusCode());
+        return false;
+    }
+
+    size_t content_length = http->GetBodyLength();
+    if (content_length <= DELTA_OTA_PATCH_HEADER_SIZE) {
+        ESP_LOGE(TAG, "Invalid patch content length: %u", content_length);
+        return false;
+    }
+
+    esp_delta_ota_handle_t delta_handle = nullptr;
+    DeltaOtaPatch patch(running_sha256, [&delta_handle](const uint8_t* data, size_t size) {
+        auto err = esp_delta_ota_feed_patch(delta_handle, data, size);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to apply patch: %s", esp_err_to_name(err));
+            return false;
+        }
+        return true;
+    });
+
+    DeltaOtaContext ctx = {};
+    ctx.patch = &patch;
+    if (esp_ota_begin(update_partition, OTA_WITH_SEQUENTIAL_WRITES, &ctx.update_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to begin OTA");
+        return false;
+    }
+
+    delta_source_partition = running_partition;
+    esp_delta_ota_cfg_t cfg = {};
+    cfg.user_data = &ctx;
+    cfg.read_cb = DeltaOtaReadSource;
+    cfg.write_cb_with_user_data = DeltaOtaWriteMerged;
+    delta_handle = esp_delta_ota_init(&cfg);
+    if (delta_handle == nullptr) {
+        ESP_LOGE(TAG, "Failed to initialize delta OTA");
+        esp_ota_abort(ctx.update_handle);
+        delta_source_partition = nullptr;
+        return false;
+    }
+
+    auto fail = [&]() {
+        esp_delta_ota_deinit(delta_handle);
+        esp_ota_abort(ctx.update_handle);
+        delta_source_partition = nullptr;
+        return false;
+    };
+
+    char buffer[512];
+    size_t total_read = 0, recent_read = 0;
+    auto last_calc_time = esp_timer_get_time();
+    while (true) {
+        int ret = http->Read(buffer, sizeof(buffer));
+        if (ret < 0) {
+            ESP_LOGE(TAG, "Failed to read HTTP data: %s", esp_err_to_name(ret));
+            return fail();
+        }
+
+        recent_read += ret;
+        total_read += ret;
+        if (esp_timer_get_time() - last_calc_time >= 1000000 || ret == 0) {
+            size_t progress = total_read * 100 / content_length;
+            ESP_LOGI(TAG, "Patch progress: %u%% (%u/%u), Speed: %uB/s, Image: %u bytes", progress, total_read, content_length, recent_read, patch.image_size());
+            if (callback) {
+                callback(progress, recent_read);
+            }
+            last_calc_time = esp_timer_get_time();
+            recent_read = 0;
+        }
+
+        if (ret == 0) {
+            break;
+        }
+
+        // Checks the header first, nothing reaches the patch engine before it matches
+        if (!patch.Feed(reinterpret_cast<const uint8_t*>(buffer), ret)) {
+            return fail();
+        }
+    }
+    http->Close();
+
+    if (!patch.header_verified() || esp_delta_ota_finalize(delta_handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to finalize patch");
+        return fail();
+    }
+    esp_delta_ota_deinit(delta_handle);
+    delta_source_partition = nullptr;
+
+    if (!patch.Verify(sha256)) {
+        esp_ota_abort(ctx.update_handle);
+        return false;
+    }
+
+    esp_err_t err = esp_ota_end(ctx.update_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to end OTA: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    err = esp_ota_set_boot_partition(update_partition);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to set boot partition: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    ESP_LOGI(TAG, "Firmware upgrade with patch successful, image size: %u, patch size: %u", patch.image_size(), content_length);
+    return true;
+#else
+    ESP_LOGW(TAG, "Delta OTA is disabled");
+    return false;
+#endif
+}
+
 bool Ota::StartUpgrade(std::function<void(int progress, size_t speed)> callback) {
+    if (!firmware_patch_url_.empty()) {
+        if (UpgradeDelta(firmware_patch_url_, firmware_sha256_, callback)) {
+            return true;
+        }
+        ESP_LOGW(TAG, "Delta upgrade failed, falling back to full image");
+    }
     return Upgrade(firmware_url_, callback);
 }
 
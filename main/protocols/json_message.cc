@@ -0,0 +1,254 @@
+#include "json_message.h"
+
+#include <cstdlib>
+
+namespace {
+
+inline size_t SkipWhitespace(std::string_view s, size_t pos) {
+    while (pos < s.size() && (s[pos] == ' ' || s[pos] == '\t' || s[pos] == '\n' || s[pos] == '\r')) {
+        pos++;
+    }
+    return pos;
+}
+
+// pos points at the opening quote, returns the position after the closing quote or npos
+size_t SkipString(std::string_view s, size_t pos) {
+    for (pos++; pos < s.size(); pos++) {
+        if (s[pos] == '\\') {
+            pos++;
+        } else if (s[pos] == '"') {
+            return pos + 1;
+        }
+    }
+    return std::string_view::npos;
+}
+
+// pos points at '{' or '[', returns the position after the matching bracket or npos
+size_t SkipContainer(std::string_view s, size_t pos) {
+    int depth = 0;
+    while (pos < s.size()) {
+        char c = s[pos];
+        if (c == '"') {
+            pos = SkipString(s, pos);
+            if (pos == std::string_view::npos) {
+                return pos;
+            }
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) {
+                return pos + 1;
+            }
+        }
+        pos++;
+    }
+    return std::string_view::npos;
+}
+
+void AppendUtf8(std::string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    } else if (cp < 0x800) {
+        out += (char)(0xC0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += (char)(0xE0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    } else {
+        out += (char)(0xF0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3F));
+        out += (char)(0x80 | ((cp >> 6) & 0x3F));
+        out += (char)(0x80 | (cp & 0x3F));
+    }
+}
+
+bool ParseHex4(std::string_view s, size_t pos, uint32_t& value) {
+    if (pos + 4 > s.size()) {
+        return false;
+    }
+    value = 0;
+    for (size_t i = pos; i < pos + 4; i++) {
+        char c = s[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool JsonMessage::Parse(std::string_view json) {
+    source_ = json;
+    type_ = {};
+    field_count_ = 0;
+
+    size_t pos = SkipWhitespace(json, 0);
+    if (pos >= json.size() || json[pos] != '{') {
+        return false;
+    }
+    pos = SkipWhitespace(json, pos + 1);
+    if (pos < json.size() && json[pos] == '}') {
+        return true;
+    }
+
+    while (pos < json.size()) {
+        if (json[pos] != '"') {
+            return false;
+        }
+        size_t key_end = SkipString(json, pos);
+        if (key_end == std::string_view::npos) {
+            return false;
+        }
+        std::string_view key = json.substr(pos + 1, key_end - pos - 2);
+
+        pos = SkipWhitespace(json, key_end);
+        if (pos >= json.size() || json[pos] != ':') {
+            return false;
+        }
+        pos = SkipWhitespace(json, pos + 1);
+        if (pos >= json.size()) {
+            return false;
+        }
+
+        Field field = {key, {}, kValueLiteral};
+        char c = json[pos];
+        size_t value_end;
+        if (c == '"') {
+            value_end = SkipString(json, pos);
+            if (value_end == std::string_view::npos) {
+                return false;
+            }
+            field.value = json.substr(pos + 1, value_end - pos - 2);
+            field.kind = kValueString;
+        } else if (c == '{' || c == '[') {
+            value_end = SkipContainer(json, pos);
+            if (value_end == std::string_view::npos) {
+                return false;
+            }
+            field.value = json.substr(pos, value_end - pos);
+            field.kind = (c == '{') ? kValueObject : kValueArray;
+        } else {
+            value_end = pos;
+            while (value_end < json.size() && json[value_end] != ',' && json[value_end] != '}' &&
+                   json[value_end] != ' ' && json[value_end] != '\t' && json[value_end] != '\n' && json[value_end] != '\r') {
+                value_end++;
+            }
+            if (value_end == pos) {
+                return false;
+            }
+            field.value = json.substr(pos, value_end - pos);
+            field.kind = (c == '-' || (c >= '0' && c <= '9')) ? kValueNumber : kValueLiteral;
+        }
+
+        if (field.kind == kValueString && key == "type") {
+            type_ = field.value;
+        }
+        if (field_count_ < kMaxFields) {
+            fields_[field_count_++] = field;
+        }
+
+        pos = SkipWhitespace(json, value_end);
+        if (pos >= json.size()) {
+            return false;
+        }
+        if (json[pos] == '}') {
+            return true;
+        }
+        if (json[pos] != ',') {
+            return false;
+        }
+        pos = SkipWhitespace(json, pos + 1);
+    }
+    return false;
+}
+
+const JsonMessage::Field* JsonMessage::Find(std::string_view key) const {
+    for (int i = 0; i < field_count_; i++) {
+        if (fields_[i].key == key) {
+            return &fields_[i];
+        }
+    }
+    return nullptr;
+}
+
+bool JsonMessage::Has(std::string_view key, ValueKind kind) const {
+    auto field = Find(key);
+    return field != nullptr && field->kind == kind;
+}
+
+std::string_view JsonMessage::GetString(std::string_view key) const {
+    auto field = Find(key);
+    if (field == nullptr || field->kind != kValueString) {
+        return {};
+    }
+    return field->value;
+}
+
+std::string_view JsonMessage::GetRaw(std::string_view key) const {
+    auto field = Find(key);
+    if (field == nullptr) {
+        return {};
+    }
+    if (field->kind == kValueString) {
+        // Include the quotes
+        return std::string_view(field->value.data() - 1, field->value.size() + 2);
+    }
+    return field->value;
+}
+
+int JsonMessage::GetInt(std::string_view key, int default_value) const {
+    auto field = Find(key);
+    if (field == nullptr || field->kind != kValueNumber) {
+        return default_value;
+    }
+    // The value is always followed by a delimiter in the source, so strtol stops in the buffer
+    return (int)strtol(field->value.data(), nullptr, 10);
+}
+
+std::string JsonMessage::Unescape(std::string_view raw) {
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+        char c = raw[i];
+        if (c != '\\' || i + 1 >= raw.size()) {
+            out += c;
+            continue;
+        }
+        c = raw[++i];
+        switch (c) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!ParseHex4(raw, i + 1, cp)) {
+                    out += 'u';
+                    break;
+                }
+                i += 4;
+                // Surrogate pair
+                uint32_t low;
+                if (cp >= 0xD800 && cp <= 0xDBFF && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u' &&
+                    ParseHex4(raw, i + 3, low) && low >= 0xDC00 && low <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    i += 6;
+                }
+                AppendUtf8(out, cp);
+                break;
+            }
+            default:
+                // \" \\ \/
+                out += c;
+                break;
+        }
+    }
+    return out;
+}
@@ -0,0 +1,69 @@
+#ifndef JSON_MESSAGE_H
+#define JSON_MESSAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/**
+ * Zero-allocation view of the top level fields of a JSON object.
+ *
+ * Parse() scans the buffer once and records where each top level value starts and ends,
+ * nested objects and arrays are skipped and can be parsed again with another JsonMessage.
+ * All returned views point into the source buffer, which must outlive the message.
+ * String views are the raw (still escaped) content, use Unescape() to get the text.
+ */
+class JsonMessage {
+public:
+    enum ValueKind : uint8_t {
+        kValueString,
+        kValueNumber,
+        kValueObject,
+        kValueArray,
+        kValueLiteral,  // true, false, null
+    };
+
+    static constexpr int kMaxFields = 16;
+
+    // Returns false if the buffer is not a well formed JSON object
+    bool Parse(std::string_view json);
+
+    inline std::string_view source() const { return source_; }
+    // Raw value of the "type" field, empty if missing or not a string
+    inline std::string_view type() const { return type_; }
+
+    bool Has(std::string_view key, ValueKind kind) const;
+    // Raw string content, empty if missing or not a string
+    std::string_view GetString(std::string_view key) const;
+    // The whole value as JSON text (e.g. a nested object), empty if missing
+    std::string_view GetRaw(std::string_view key) const;
+    int GetInt(std::string_view key, int default_value = 0) const;
+
+    static std::string Unescape(std::string_view raw);
+
+    // FNV-1a, used to dispatch on the message type with a switch
+    static constexpr uint32_t Hash(std::string_view s) {
+        uint32_t hash = 2166136261u;
+        for (char c : s) {
+            hash = (hash ^ (uint8_t)c) * 16777619u;
+        }
+        return hash;
+    }
+
+private:
+    struct Field {
+        std::string_view key;
+        std::string_view value;  // Without quotes for strings
+        ValueKind kind;
+    };
+
+    std::string_view source_;
+    std::string_view type_;
+    Field fields_[kMaxFields];
+    int field_count_ = 0;
+
+    const Field* Find(std::string_view key) const;
+};
+
+#endif // JSON_MESSAGE_H
@@ -0,0 +1,158 @@
+#include "json_writer.h"
+
+#include <cstdio>
+#include <cstring>
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity) : buffer_(buffer), capacity_(capacity) {
+    if (capacity_ == 0) {
+        overflow_ = true;
+    } else {
+        buffer_[0] = '\0';
+    }
+}
+
+void JsonWriter::Put(char c) {
+    if (overflow_ || length_ + 1 >= capacity_) {
+        overflow_ = true;
+        return;
+    }
+    buffer_[length_++] = c;
+    buffer_[length_] = '\0';
+}
+
+void JsonWriter::Put(std::string_view s) {
+    if (overflow_ || length_ + s.size() >= capacity_) {
+        overflow_ = true;
+        return;
+    }
+    memcpy(buffer_ + length_, s.data(), s.size());
+    length_ += s.size();
+    buffer_[length_] = '\0';
+}
+
+void JsonWriter::PutEscaped(std::string_view s) {
+    // Copy the runs that need no escaping in one go
+    size_t run_start = 0;
+    for (size_t i = 0; i < s.size(); i++) {
+        unsigned char c = s[i];
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        Put(s.substr(run_start, i - run_start));
+        run_start = i + 1;
+        switch (c) {
+            case '"': Put("\\\""); break;
+            case '\\': Put("\\\\"); break;
+            case '\b': Put("\\b"); break;
+            case '\f': Put("\\f"); break;
+            case '\n': Put("\\n"); break;
+            case '\r': Put("\\r"); break;
+            case '\t': Put("\\t"); break;
+            default: {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                Put(escaped);
+                break;
+            }
+        }
+    }
+    Put(s.substr(run_start));
+}
+
+size_t JsonWriter::EscapedLength(std::string_view value) {
+    size_t length = value.size();
+    for (unsigned char c : value) {
+        if (c == '"' || c == '\\' || c == '\b' || c == '\f' || c == '\n' || c == '\r' || c == '\t') {
+            length += 1;
+        } else if (c < 0x20) {
+            length += 5;
+        }
+    }
+    return length;
+}
+
+void JsonWriter::BeginValue(const char* key) {
+    if (depth_ == 0) {
+        return;
+    }
+    uint32_t bit = 1u << (depth_ - 1);
+    if (has_items_ & bit) {
+        Put(',');
+    }
+    has_items_ |= bit;
+    if (key != nullptr && !(in_array_ & bit)) {
+        Put('"');
+        PutEscaped(key);
+        Put("\":");
+    }
+}
+
+JsonWriter& JsonWriter::BeginObject(const char* key) {
+    BeginValue(key);
+    if (depth_ >= kMaxDepth) {
+        overflow_ = true;
+        return *this;
+    }
+    Put('{');
+    uint32_t bit = 1u << depth_++;
+    has_items_ &= ~bit;
+    in_array_ &= ~bit;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndObject() {
+    if (depth_ > 0) {
+        depth_--;
+    }
+    Put('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::BeginArray(const char* key) {
+    BeginValue(key);
+    if (depth_ >= kMaxDepth) {
+        overflow_ = true;
+        return *this;
+    }
+    Put('[');
+    uint32_t bit = 1u << depth_++;
+    has_items_ &= ~bit;
+    in_array_ |= bit;
+    return *this;
+}
+
+JsonWriter& JsonWriter::EndArray() {
+    if (depth_ > 0) {
+        depth_--;
+    }
+    Put(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::AddString(const char* key, std::string_view value) {
+    BeginValue(key);
+    Put('"');
+    PutEscaped(value);
+    Put('"');
+    return *this;
+}
+
+JsonWriter& JsonWriter::AddInt(const char* key, int value) {
+    BeginValue(key);
+    char number[16];
+    int len = snprintf(number, sizeof(number), "%d", value);
+    Put(std::string_view(number, len));
+    return *this;
+}
+
+JsonWriter& JsonWriter::AddBool(const char* key, bool value) {
+    BeginValue(key);
+    Put(value ? "true" : "false");
+    return *this;
+}
+
+JsonWriter& JsonWriter::AddRaw(const char* key, std::string_view json) {
+    BeginValue(key);
+    Put(json);
+    return *this;
+}
@@ -0,0 +1,55 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * Streaming JSON writer over a fixed buffer.
+ *
+ * Commas, quotes and string escaping are handled by the writer, nothing is allocated.
+ * If the buffer is too small, the writer stops writing and ok() returns false.
+ * The output is always null terminated.
+ */
+class JsonWriter {
+public:
+    JsonWriter(char* buffer, size_t capacity);
+
+    // key is ignored (pass nullptr) for values inside an array or the root value
+    JsonWriter& BeginObject(const char* key = nullptr);
+    JsonWriter& EndObject();
+    JsonWriter& BeginArray(const char* key = nullptr);
+    JsonWriter& EndArray();
+    JsonWriter& AddString(const char* key, std::string_view value);
+    JsonWriter& AddInt(const char* key, int value);
+    JsonWriter& AddBool(const char* key, bool value);
+    // The value must already be valid JSON and is copied as is
+    JsonWriter& AddRaw(const char* key, std::string_view json);
+
+    inline bool ok() const { return !overflow_ && depth_ == 0; }
+    inline const char* data() const { return buffer_; }
+    inline size_t length() const { return length_; }
+    inline std::string_view view() const { return std::string_view(buffer_, length_); }
+
+    // Length of the value once escaped, without the quotes
+    static size_t EscapedLength(std::string_view value);
+
+private:
+    static constexpr int kMaxDepth = 32;
+
+    char* buffer_;
+    size_t capacity_;
+    size_t length_ = 0;
+    bool overflow_ = false;
+    int depth_ = 0;
+    uint32_t has_items_ = 0;  // One bit per nesting level
+    uint32_t in_array_ = 0;
+
+    void BeginValue(const char* key);
+    void Put(char c);
+    void Put(std::string_view s);
+    void PutEscaped(std::string_view s);
+};
+
+#endif // JSON_WRITER_H
@@ -98,24 +98,24 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
     });
 
     mqtt_->OnMessage([this](const std::string& topic, const std::string& payload) {
-        cJSON* root = cJSON_Parse(payload.c_str());
-        if (root == nullptr) {
+        JsonMessage root;
+        if (!root.Parse(payload)) {
             ESP_LOGE(TAG, "Failed to parse json message %s", payload.c_str());
             return;
         }
-        cJSON* type = cJSON_GetObjectItem(root, "type");
-        if (!cJSON_IsString(type)) {
+        auto type = root.type();
+        if (type.empty()) {
             ESP_LOGE(TAG, "Message type is invalid");
-            cJSON_Delete(root);
             return;
         }
 
-        if (strcmp(type->valuestring, "hello") == 0) {
+        if (type == "hello") {
             ParseServerHello(root);
-        } else if (strcmp(type->valuestring, "goodbye") == 0) {
-            auto session_id = cJSON_GetObjectItem(root, "session_id");
-            ESP_LOGI(TAG, "Received goodbye message, session_id: %s", session_id ? session_id->valuestring : "null");
-            if (session_id == nullptr || session_id_ == session_id->valuestring) {
+        } else if (type == "goodbye") {
+            bool has_session_id = root.Has("session_id", JsonMessage::kValueString);
+            auto session_id = JsonMessage::Unescape(root.GetString("session_id"));
+            ESP_LOGI(TAG, "Received goodbye message, session_id: %s", has_session_id ? session_id.c_str() : "null");
+            if (!has_session_id || session_id == session_id_) {
                 auto alive = alive_;  // Capture alive flag
                 Application::GetInstance().Schedule([this, alive]() {
                     if (*alive) {
@@ -126,7 +126,6 @@ bool MqttProtocol::StartMqttClient(bool report_error) {
         } else if (on_incoming_json_ != nullptr) {
             on_incoming_json_(root);
         }
-        cJSON_Delete(root);
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
 
@@ -194,11 +193,13 @@ void MqttProtocol::CloseAudioChannel() {
         udp_.reset();
     }
 
-    std::string message = "{";
-    message += "\"session_id\":\"" + session_id_ + "\",";
-    message += "\"type\":\"goodbye\"";
-    message += "}";
-    SendText(message);
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("session_id", session_id_)
+        .AddString("type", "goodbye")
+        .EndObject();
+    SendJson(writer);
 
     if (on_audio_channel_closed_ != nullptr) {
         on_audio_channel_closed_();
@@ -289,64 +290,56 @@ bool MqttProtocol::OpenAudioChannel() {
 
 std::string MqttProtocol::GetHelloMessage() {
     // 发送 hello 消息申请 UDP 通道
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "hello");
-    cJSON_AddNumberToObject(root, "version", 3);
-    cJSON_AddStringToObject(root, "transport", "udp");
-    cJSON* features = cJSON_CreateObject();
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("type", "hello")
+        .AddInt("version", 3)
+        .AddString("transport", "udp")
+        .BeginObject("features");
 #if CONFIG_USE_SERVER_AEC
-    cJSON_AddBoolToObject(features, "aec", true);
+    writer.AddBool("aec", true);
 #endif
-    cJSON_AddBoolToObject(features, "mcp", true);
-    cJSON_AddItemToObject(root, "features", features);
-    cJSON* audio_params = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio_params, "format", "opus");
-    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
-    cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
-    cJSON_AddItemToObject(root, "audio_params", audio_params);
-    auto json_str = cJSON_PrintUnformatted(root);
-    std::string message(json_str);
-    cJSON_free(json_str);
-    cJSON_Delete(root);
-    return message;
+    writer.AddBool("mcp", true)
+        .EndObject()
+        .BeginObject("audio_params")
+        .AddString("format", "opus")
+        .AddInt("sample_rate", 16000)
+        .AddInt("channels", 1)
+        .AddInt("frame_duration", OPUS_FRAME_DURATION_MS)
+        .EndObject()
+        .EndObject();
+    return std::string(writer.view());
 }
 
-void MqttProtocol::ParseServerHello(const cJSON* root) {
-    auto transport = cJSON_GetObjectItem(root, "transport");
-    if (transport == nullptr || strcmp(transport->valuestring, "udp") != 0) {
-        ESP_LOGE(TAG, "Unsupported transport: %s", transport->valuestring);
+void MqttProtocol::ParseServerHello(const JsonMessage& root) {
+    auto transport = root.GetString("transport");
+    if (transport != "udp") {
+        ESP_LOGE(TAG, "Unsupported transport: %.*s", (int)transport.size(), transport.data());
         return;
     }
 
-    auto session_id = cJSON_GetObjectItem(root, "session_id");
-    if (cJSON_IsString(session_id)) {
-        session_id_ = session_id->valuestring;
+    if (root.Has("session_id", JsonMessage::kValueString)) {
+        session_id_ = JsonMessage::Unescape(root.GetString("session_id"));
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
     // Get sample rate from hello message
-    auto audio_params = cJSON_GetObjectItem(root, "audio_params");
-    if (cJSON_IsObject(audio_params)) {
-        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
-        if (cJSON_IsNumber(sample_rate)) {
-            server_sample_rate_ = sample_rate->valueint;
-        }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-        }
+    JsonMessage audio_params;
+    if (root.Has("audio_params", JsonMessage::kValueObject) && audio_params.Parse(root.GetRaw("audio_params"))) {
+        server_sample_rate_ = audio_params.GetInt("sample_rate", server_sample_rate_);
+        server_frame_duration_ = audio_params.GetInt("frame_duration", server_frame_duration_);
     }
 
-    auto udp = cJSON_GetObjectItem(root, "udp");
-    if (!cJSON_IsObject(udp)) {
+    JsonMessage udp;
+    if (!root.Has("udp", JsonMessage::kValueObject) || !udp.Parse(root.GetRaw("udp"))) {
         ESP_LOGE(TAG, "UDP is not specified");
         return;
     }
-    udp_server_ = cJSON_GetObjectItem(udp, "server")->valuestring;
-    udp_port_ = cJSON_GetObjectItem(udp, "port")->valueint;
-    auto key = cJSON_GetObjectItem(udp, "key")->valuestring;
-    auto nonce = cJSON_GetObjectItem(udp, "nonce")->valuestring;
+    udp_server_ = JsonMessage::Unescape(udp.GetString("server"));
+    udp_port_ = udp.GetInt("port");
+    std::string key(udp.GetString("key"));
+    std::string nonce(udp.GetString("nonce"));
 
     // auto encryption = cJSON_GetObjectItem(udp, "encryption")->valuestring;
     // ESP_LOGI(TAG, "UDP server: %s, port: %d, encryption: %s", udp_server_.c_str(), udp_port_, encryption);
@@ -54,7 +54,7 @@ private:
     esp_timer_handle_t reconnect_timer_;
 
     bool StartMqttClient(bool report_error=false);
-    void ParseServerHello(const cJSON* root);
+    void ParseServerHello(const JsonMessage& root);
     std::string DecodeHexString(const std::string& hex_string);
 
     bool SendText(const std::string& text) override;
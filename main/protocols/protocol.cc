@@ -4,7 +4,7 @@
 
 #define TAG "Protocol"
 
-void Protocol::OnIncomingJson(std::function<void(const cJSON* root)> callback) {
+void Protocol::OnIncomingJson(std::function<void(const JsonMessage& message)> callback) {
     on_incoming_json_ = callback;
 }
 
@@ -39,43 +39,79 @@ void Protocol::SetError(const std::string& message) {
     }
 }
 
+bool Protocol::SendJson(const JsonWriter& writer) {
+    if (!writer.ok()) {
+        ESP_LOGE(TAG, "JSON message too long: %.*s", (int)writer.length(), writer.data());
+        return false;
+    }
+    return SendText(std::string(writer.data(), writer.length()));
+}
+
 void Protocol::SendAbortSpeaking(AbortReason reason) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"abort\"";
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("session_id", session_id_)
+        .AddString("type", "abort");
     if (reason == kAbortReasonWakeWordDetected) {
-        message += ",\"reason\":\"wake_word_detected\"";
+        writer.AddString("reason", "wake_word_detected");
     }
-    message += "}";
-    SendText(message);
+    writer.EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendWakeWordDetected(const std::string& wake_word) {
-    std::string json = "{\"session_id\":\"" + session_id_ + 
-                      "\",\"type\":\"listen\",\"state\":\"detect\",\"text\":\"" + wake_word + "\"}";
-    SendText(json);
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("session_id", session_id_)
+        .AddString("type", "listen")
+        .AddString("state", "detect")
+        .AddString("text", wake_word)
+        .EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendStartListening(ListeningMode mode) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\"";
-    message += ",\"type\":\"listen\",\"state\":\"start\"";
+    const char* mode_str = "manual";
     if (mode == kListeningModeRealtime) {
-        message += ",\"mode\":\"realtime\"";
+        mode_str = "realtime";
     } else if (mode == kListeningModeAutoStop) {
-        message += ",\"mode\":\"auto\"";
-    } else {
-        message += ",\"mode\":\"manual\"";
+        mode_str = "auto";
     }
-    message += "}";
-    SendText(message);
+
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("session_id", session_id_)
+        .AddString("type", "listen")
+        .AddString("state", "start")
+        .AddString("mode", mode_str)
+        .EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendStopListening() {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"listen\",\"state\":\"stop\"}";
-    SendText(message);
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("session_id", session_id_)
+        .AddString("type", "listen")
+        .AddString("state", "stop")
+        .EndObject();
+    SendJson(writer);
 }
 
 void Protocol::SendMcpMessage(const std::string& payload) {
-    std::string message = "{\"session_id\":\"" + session_id_ + "\",\"type\":\"mcp\",\"payload\":" + payload + "}";
-    SendText(message);
+    // The payload is already JSON, size the buffer once for the envelope around it
+    std::string buffer(payload.size() + JsonWriter::EscapedLength(session_id_) + 64, '\0');
+    JsonWriter writer(buffer.data(), buffer.size());
+    writer.BeginObject()
+        .AddString("session_id", session_id_)
+        .AddString("type", "mcp")
+        .AddRaw("payload", payload)
+        .EndObject();
+    SendJson(writer);
 }
 
 bool Protocol::IsTimeout() const {
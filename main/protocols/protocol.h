@@ -1,12 +1,17 @@
 #ifndef PROTOCOL_H
 #define PROTOCOL_H
 
-#include <cJSON.h>
 #include <string>
 #include <functional>
 #include <chrono>
 #include <vector>
 
+#include "json_writer.h"
+#include "json_message.h"
+
+// Stack buffer for the small control messages (listen, abort, hello...)
+#define PROTOCOL_MESSAGE_BUFFER_SIZE 384
+
 struct AudioStreamPacket {
     int sample_rate = 0;
     int frame_duration = 0;
@@ -56,7 +61,7 @@ public:
     }
 
     void OnIncomingAudio(std::function<void(std::unique_ptr<AudioStreamPacket> packet)> callback);
-    void OnIncomingJson(std::function<void(const cJSON* root)> callback);
+    void OnIncomingJson(std::function<void(const JsonMessage& message)> callback);
     void OnAudioChannelOpened(std::function<void()> callback);
     void OnAudioChannelClosed(std::function<void()> callback);
     void OnNetworkError(std::function<void(const std::string& message)> callback);
@@ -75,7 +80,7 @@ public:
     virtual void SendMcpMessage(const std::string& message);
 
 protected:
-    std::function<void(const cJSON* root)> on_incoming_json_;
+    std::function<void(const JsonMessage& message)> on_incoming_json_;
     std::function<void(std::unique_ptr<AudioStreamPacket> packet)> on_incoming_audio_;
     std::function<void()> on_audio_channel_opened_;
     std::function<void()> on_audio_channel_closed_;
@@ -90,6 +95,8 @@ protected:
     std::chrono::time_point<std::chrono::steady_clock> last_incoming_time_;
 
     virtual bool SendText(const std::string& text) = 0;
+    // Send the message built by the writer, transports that can send from a buffer override this
+    virtual bool SendJson(const JsonWriter& writer);
     virtual void SetError(const std::string& message);
     virtual bool IsTimeout() const;
 };
@@ -5,7 +5,6 @@
 #include "settings.h"
 
 #include <cstring>
-#include <cJSON.h>
 #include <esp_log.h>
 #include <arpa/inet.h>
 #include "assets/lang_config.h"
@@ -71,6 +70,24 @@ bool WebsocketProtocol::SendText(const std::string& text) {
     return true;
 }
 
+bool WebsocketProtocol::SendJson(const JsonWriter& writer) {
+    if (!writer.ok()) {
+        ESP_LOGE(TAG, "JSON message too long: %.*s", (int)writer.length(), writer.data());
+        return false;
+    }
+    if (websocket_ == nullptr || !websocket_->IsConnected()) {
+        return false;
+    }
+
+    // Send straight from the writer buffer, no string copy
+    if (!websocket_->Send(writer.data(), writer.length(), false)) {
+        ESP_LOGE(TAG, "Failed to send text: %s", writer.data());
+        SetError(Lang::Strings::SERVER_ERROR);
+        return false;
+    }
+    return true;
+}
+
 bool WebsocketProtocol::IsAudioChannelOpened() const {
     return websocket_ != nullptr && websocket_->IsConnected() && !error_occurred_ && !IsTimeout();
 }
@@ -145,21 +162,17 @@ bool WebsocketProtocol::OpenAudioChannel() {
                 }
             }
         } else {
-            // Parse JSON data
-            auto root = cJSON_Parse(data);
-            auto type = cJSON_GetObjectItem(root, "type");
-            if (cJSON_IsString(type)) {
-                if (strcmp(type->valuestring, "hello") == 0) {
-                    ParseServerHello(root);
-                } else {
-                    if (on_incoming_json_ != nullptr) {
-                        on_incoming_json_(root);
-                    }
-                }
-            } else {
-                ESP_LOGE(TAG, "Missing message type, data: %s", data);
+            // Parse JSON data in place, no tree is allocated
+            JsonMessage message;
+            if (!message.Parse(std::string_view(data, len))) {
+                ESP_LOGE(TAG, "Failed to parse json message: %.*s", (int)len, data);
+            } else if (message.type().empty()) {
+                ESP_LOGE(TAG, "Missing message type, data: %.*s", (int)len, data);
+            } else if (message.type() == "hello") {
+                ParseServerHello(message);
+            } else if (on_incoming_json_ != nullptr) {
+                on_incoming_json_(message);
             }
-            cJSON_Delete(root);
         }
         last_incoming_time_ = std::chrono::steady_clock::now();
     });
@@ -201,52 +214,44 @@ bool WebsocketProtocol::OpenAudioChannel() {
 
 std::string WebsocketProtocol::GetHelloMessage() {
     // keys: message type, version, audio_params (format, sample_rate, channels)
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddStringToObject(root, "type", "hello");
-    cJSON_AddNumberToObject(root, "version", version_);
-    cJSON* features = cJSON_CreateObject();
+    char buffer[PROTOCOL_MESSAGE_BUFFER_SIZE];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("type", "hello")
+        .AddInt("version", version_)
+        .BeginObject("features");
 #if CONFIG_USE_SERVER_AEC
-    cJSON_AddBoolToObject(features, "aec", true);
+    writer.AddBool("aec", true);
 #endif
-    cJSON_AddBoolToObject(features, "mcp", true);
-    cJSON_AddItemToObject(root, "features", features);
-    cJSON_AddStringToObject(root, "transport", "websocket");
-    cJSON* audio_params = cJSON_CreateObject();
-    cJSON_AddStringToObject(audio_params, "format", "opus");
-    cJSON_AddNumberToObject(audio_params, "sample_rate", 16000);
-    cJSON_AddNumberToObject(audio_params, "channels", 1);
-    cJSON_AddNumberToObject(audio_params, "frame_duration", OPUS_FRAME_DURATION_MS);
-    cJSON_AddItemToObject(root, "audio_params", audio_params);
-    auto json_str = cJSON_PrintUnformatted(root);
-    std::string message(json_str);
-    cJSON_free(json_str);
-    cJSON_Delete(root);
-    return message;
+    writer.AddBool("mcp", true)
+        .EndObject()
+        .AddString("transport", "websocket")
+        .BeginObject("audio_params")
+        .AddString("format", "opus")
+        .AddInt("sample_rate", 16000)
+        .AddInt("channels", 1)
+        .AddInt("frame_duration", OPUS_FRAME_DURATION_MS)
+        .EndObject()
+        .EndObject();
+    return std::string(writer.view());
 }
 
-void WebsocketProtocol::ParseServerHello(const cJSON* root) {
-    auto transport = cJSON_GetObjectItem(root, "transport");
-    if (transport == nullptr || strcmp(transport->valuestring, "websocket") != 0) {
-        ESP_LOGE(TAG, "Unsupported transport: %s", transport->valuestring);
+void WebsocketProtocol::ParseServerHello(const JsonMessage& root) {
+    auto transport = root.GetString("transport");
+    if (transport != "websocket") {
+        ESP_LOGE(TAG, "Unsupported transport: %.*s", (int)transport.size(), transport.data());
         return;
     }
 
-    auto session_id = cJSON_GetObjectItem(root, "session_id");
-    if (cJSON_IsString(session_id)) {
-        session_id_ = session_id->valuestring;
+    if (root.Has("session_id", JsonMessage::kValueString)) {
+        session_id_ = JsonMessage::Unescape(root.GetString("session_id"));
         ESP_LOGI(TAG, "Session ID: %s", session_id_.c_str());
     }
 
-    auto audio_params = cJSON_GetObjectItem(root, "audio_params");
-    if (cJSON_IsObject(audio_params)) {
-        auto sample_rate = cJSON_GetObjectItem(audio_params, "sample_rate");
-        if (cJSON_IsNumber(sample_rate)) {
-            server_sample_rate_ = sample_rate->valueint;
-        }
-        auto frame_duration = cJSON_GetObjectItem(audio_params, "frame_duration");
-        if (cJSON_IsNumber(frame_duration)) {
-            server_frame_duration_ = frame_duration->valueint;
-        }
+    JsonMessage audio_params;
+    if (root.Has("audio_params", JsonMessage::kValueObject) && audio_params.Parse(root.GetRaw("audio_params"))) {
+        server_sample_rate_ = audio_params.GetInt("sample_rate", server_sample_rate_);
+        server_frame_duration_ = audio_params.GetInt("frame_duration", server_frame_duration_);
     }
 
     xEventGroupSetBits(event_group_handle_, WEBSOCKET_PROTOCOL_SERVER_HELLO_EVENT);
@@ -26,8 +26,9 @@ private:
     std::unique_ptr<WebSocket> websocket_;
     int version_ = 1;
 
-    void ParseServerHello(const cJSON* root);
+    void ParseServerHello(const JsonMessage& root);
     bool SendText(const std::string& text) override;
+    bool SendJson(const JsonWriter& writer) override;
     std::string GetHelloMessage();
 };
 
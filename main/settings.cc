@@ -1,108 +1,262 @@
 #include "settings.h"
 
 #include <esp_log.h>
+#include <esp_system.h>
+#include <esp_timer.h>
 #include <nvs_flash.h>
 
+#include <map>
+#include <mutex>
+
 #define TAG "Settings"
 
-Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
-    nvs_open(ns.c_str(), read_write_ ? NVS_READWRITE : NVS_READONLY, &nvs_handle_);
+namespace {
+
+enum EntryType {
+    kEntryString,
+    kEntryInt,
+    kEntryBool,
+};
+
+struct Entry {
+    EntryType type;
+    bool exists = false;    // A missing key is cached too
+    bool dirty = false;
+    std::string string_value;
+    int32_t int_value = 0;
+};
+
+struct SettingsCache {
+    std::recursive_mutex mutex;
+    std::map<std::string, std::map<std::string, Entry>> namespaces;
+    esp_timer_handle_t commit_timer = nullptr;
+};
+
+SettingsCache& GetCache() {
+    static SettingsCache cache;
+    return cache;
 }
 
-Settings::~Settings() {
-    if (nvs_handle_ != 0) {
-        if (read_write_ && dirty_) {
-            ESP_ERROR_CHECK(nvs_commit(nvs_handle_));
+void ReadEntry(const std::string& ns, const std::string& key, Entry& entry) {
+    entry.exists = false;
+    nvs_handle_t handle;
+    if (nvs_open(ns.c_str(), NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+
+    if (entry.type == kEntryString) {
+        size_t length = 0;
+        if (nvs_get_str(handle, key.c_str(), nullptr, &length) == ESP_OK) {
+            entry.string_value.resize(length);
+            if (nvs_get_str(handle, key.c_str(), entry.string_value.data(), &length) == ESP_OK) {
+                while (!entry.string_value.empty() && entry.string_value.back() == '\0') {
+                    entry.string_value.pop_back();
+                }
+                entry.exists = true;
+            }
+        }
+    } else if (entry.type == kEntryInt) {
+        entry.exists = nvs_get_i32(handle, key.c_str(), &entry.int_value) == ESP_OK;
+    } else {
+        uint8_t value;
+        if (nvs_get_u8(handle, key.c_str(), &value) == ESP_OK) {
+            entry.int_value = value;
+            entry.exists = true;
         }
-        nvs_close(nvs_handle_);
     }
+    nvs_close(handle);
 }
 
-std::string Settings::GetString(const std::string& key, const std::string& default_value) {
-    if (nvs_handle_ == 0) {
-        return default_value;
+// Must be called with the cache mutex held
+Entry& LoadEntry(const std::string& ns, const std::string& key, EntryType type) {
+    auto& entries = GetCache().namespaces[ns];
+    auto it = entries.find(key);
+    if (it != entries.end() && (it->second.type == type || it->second.dirty)) {
+        return it->second;
+    }
+    if (it == entries.end()) {
+        it = entries.emplace(key, Entry{.type = type}).first;
     }
+    // Not cached yet, or cached as another type
+    it->second.type = type;
+    ReadEntry(ns, key, it->second);
+    return it->second;
+}
 
-    size_t length = 0;
-    if (nvs_get_str(nvs_handle_, key.c_str(), nullptr, &length) != ESP_OK) {
-        return default_value;
+void CommitAll() {
+    auto& cache = GetCache();
+    std::lock_guard<std::recursive_mutex> lock(cache.mutex);
+    for (auto& [ns, entries] : cache.namespaces) {
+        nvs_handle_t handle = 0;
+        int count = 0;
+        for (auto& [key, entry] : entries) {
+            if (!entry.dirty) {
+                continue;
+            }
+            if (handle == 0 && nvs_open(ns.c_str(), NVS_READWRITE, &handle) != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to open namespace %s", ns.c_str());
+                break;
+            }
+            esp_err_t ret;
+            if (entry.type == kEntryString) {
+                ret = nvs_set_str(handle, key.c_str(), entry.string_value.c_str());
+            } else if (entry.type == kEntryInt) {
+                ret = nvs_set_i32(handle, key.c_str(), entry.int_value);
+            } else {
+                ret = nvs_set_u8(handle, key.c_str(), entry.int_value ? 1 : 0);
+            }
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "Failed to write %s.%s: %s", ns.c_str(), key.c_str(), esp_err_to_name(ret));
+            }
+            entry.dirty = false;
+            count++;
+        }
+        if (handle != 0) {
+            ESP_ERROR_CHECK(nvs_commit(handle));
+            nvs_close(handle);
+            ESP_LOGI(TAG, "Committed %d keys in %s", count, ns.c_str());
+        }
     }
+}
 
-    std::string value;
-    value.resize(length);
-    ESP_ERROR_CHECK(nvs_get_str(nvs_handle_, key.c_str(), value.data(), &length));
-    while (!value.empty() && value.back() == '\0') {
-        value.pop_back();
+void ScheduleCommit() {
+    auto& cache = GetCache();
+    if (cache.commit_timer == nullptr) {
+        esp_timer_create_args_t timer_args = {
+            .callback = [](void* arg) {
+                CommitAll();
+            },
+            .arg = nullptr,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "settings_commit",
+            .skip_unhandled_events = true,
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&timer_args, &cache.commit_timer));
+        // Commits the pending writes on esp_restart(), power off paths call Settings::Flush()
+        esp_err_t ret = esp_register_shutdown_handler(CommitAll);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to register shutdown handler: %s", esp_err_to_name(ret));
+        }
+    }
+    // The window starts at the first pending write, later writes join the same commit
+    if (!esp_timer_is_active(cache.commit_timer)) {
+        esp_timer_start_once(cache.commit_timer, SETTINGS_COMMIT_DELAY_MS * 1000);
     }
-    return value;
+}
+
+// Unchanged values are not written again
+void StoreEntry(const std::string& ns, const std::string& key, EntryType type, const std::string& string_value, int32_t int_value) {
+    auto& cache = GetCache();
+    std::lock_guard<std::recursive_mutex> lock(cache.mutex);
+    auto& entry = LoadEntry(ns, key, type);
+    if (entry.exists && entry.type == type && entry.string_value == string_value && entry.int_value == int_value) {
+        return;
+    }
+    entry.type = type;
+    entry.exists = true;
+    entry.dirty = true;
+    entry.string_value = string_value;
+    entry.int_value = int_value;
+    ScheduleCommit();
+}
+
+} // namespace
+
+Settings::Settings(const std::string& ns, bool read_write) : ns_(ns), read_write_(read_write) {
+}
+
+std::string Settings::GetString(const std::string& key, const std::string& default_value) {
+    std::lock_guard<std::recursive_mutex> lock(GetCache().mutex);
+    auto& entry = LoadEntry(ns_, key, kEntryString);
+    if (!entry.exists || entry.type != kEntryString) {
+        return default_value;
+    }
+    return entry.string_value;
 }
 
 void Settings::SetString(const std::string& key, const std::string& value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_str(nvs_handle_, key.c_str(), value.c_str()));
-        dirty_ = true;
+        StoreEntry(ns_, key, kEntryString, value, 0);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
 
 int32_t Settings::GetInt(const std::string& key, int32_t default_value) {
-    if (nvs_handle_ == 0) {
+    std::lock_guard<std::recursive_mutex> lock(GetCache().mutex);
+    auto& entry = LoadEntry(ns_, key, kEntryInt);
+    if (!entry.exists || entry.type != kEntryInt) {
         return default_value;
     }
-
-    int32_t value;
-    if (nvs_get_i32(nvs_handle_, key.c_str(), &value) != ESP_OK) {
-        return default_value;
-    }
-    return value;
+    return entry.int_value;
 }
 
 void Settings::SetInt(const std::string& key, int32_t value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_i32(nvs_handle_, key.c_str(), value));
-        dirty_ = true;
+        StoreEntry(ns_, key, kEntryInt, "", value);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
 
 bool Settings::GetBool(const std::string& key, bool default_value) {
-    if (nvs_handle_ == 0) {
-        return default_value;
-    }
-
-    uint8_t value;
-    if (nvs_get_u8(nvs_handle_, key.c_str(), &value) != ESP_OK) {
+    std::lock_guard<std::recursive_mutex> lock(GetCache().mutex);
+    auto& entry = LoadEntry(ns_, key, kEntryBool);
+    if (!entry.exists || entry.type != kEntryBool) {
         return default_value;
     }
-    return value != 0;
+    return entry.int_value != 0;
 }
 
 void Settings::SetBool(const std::string& key, bool value) {
     if (read_write_) {
-        ESP_ERROR_CHECK(nvs_set_u8(nvs_handle_, key.c_str(), value ? 1 : 0));
-        dirty_ = true;
+        StoreEntry(ns_, key, kEntryBool, "", value ? 1 : 0);
     } else {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
     }
 }
 
 void Settings::EraseKey(const std::string& key) {
-    if (read_write_) {
-        auto ret = nvs_erase_key(nvs_handle_, key.c_str());
-        if (ret != ESP_ERR_NVS_NOT_FOUND) {
-            ESP_ERROR_CHECK(ret);
-        }
-    } else {
+    if (!read_write_) {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
+        return;
+    }
+
+    auto& cache = GetCache();
+    std::lock_guard<std::recursive_mutex> lock(cache.mutex);
+    cache.namespaces[ns_].erase(key);
+
+    nvs_handle_t handle;
+    ESP_ERROR_CHECK(nvs_open(ns_.c_str(), NVS_READWRITE, &handle));
+    auto ret = nvs_erase_key(handle, key.c_str());
+    if (ret != ESP_ERR_NVS_NOT_FOUND) {
+        ESP_ERROR_CHECK(ret);
+        ESP_ERROR_CHECK(nvs_commit(handle));
     }
+    nvs_close(handle);
 }
 
 void Settings::EraseAll() {
-    if (read_write_) {
-        ESP_ERROR_CHECK(nvs_erase_all(nvs_handle_));
-    } else {
+    if (!read_write_) {
         ESP_LOGW(TAG, "Namespace %s is not open for writing", ns_.c_str());
+        return;
+    }
+
+    auto& cache = GetCache();
+    std::lock_guard<std::recursive_mutex> lock(cache.mutex);
+    cache.namespaces.erase(ns_);
+
+    nvs_handle_t handle;
+    ESP_ERROR_CHECK(nvs_open(ns_.c_str(), NVS_READWRITE, &handle));
+    ESP_ERROR_CHECK(nvs_erase_all(handle));
+    ESP_ERROR_CHECK(nvs_commit(handle));
+    nvs_close(handle);
+}
+
+void Settings::Flush() {
+    auto& cache = GetCache();
+    if (cache.commit_timer != nullptr) {
+        esp_timer_stop(cache.commit_timer);
     }
+    CommitAll();
 }
@@ -4,10 +4,21 @@
 #include <string>
 #include <nvs_flash.h>
 
+// Writes are kept in RAM and committed to flash after this delay, so bursts of changes
+// (e.g. dragging the volume slider) cost a single commit
+#define SETTINGS_COMMIT_DELAY_MS 3000
+
+/**
+ * Settings stored in NVS, backed by a process-wide RAM cache.
+ *
+ * Settings objects are cheap to create: values are read from NVS once and served from the
+ * cache afterwards. Setters update the cache and schedule a deferred commit, pending writes
+ * are also committed on esp_restart() or by calling Flush(), which every power off or deep
+ * sleep path has to do.
+ */
 class Settings {
 public:
     Settings(const std::string& ns, bool read_write = false);
-    ~Settings();
 
     std::string GetString(const std::string& key, const std::string& default_value = "");
     void SetString(const std::string& key, const std::string& value);
@@ -18,11 +29,12 @@ public:
     void EraseKey(const std::string& key);
     void EraseAll();
 
+    // Commit all pending writes now, call before powering off or entering deep sleep
+    static void Flush();
+
 private:
     std::string ns_;
-    nvs_handle_t nvs_handle_ = 0;
     bool read_write_ = false;
-    bool dirty_ = false;
 };
 
 #endif
@@ -17,6 +17,7 @@ import shutil
 import sys
 import json
 import struct
+import hashlib
 from datetime import datetime
 
 
@@ -428,6 +429,232 @@ def pack_assets_simple(target_path, include_path, out_file, assets_path, max_nam
     print(f'All files have been merged into {os.path.basename(out_file)}')
 
 
+# =============================================================================
+# Asset pack generation (read by main/asset_pack.cc)
+# =============================================================================
+
+ASSET_PACK_MAGIC = b'XZAP'
+ASSET_PACK_VERSION = 1
+ASSET_PACK_HEADER = struct.Struct('<4sHHIIII32s')
+ASSET_PACK_ENTRY = struct.Struct('<IHBBIIIHH')
+ASSET_CODEC_STORED = 0
+ASSET_CODEC_LZ4 = 1
+ASSET_FLAG_ALIGNED = 0x01
+ASSET_ALIGNMENT = 4
+ASSET_HOT_ALIGNMENT = 4096
+LVGL_IMAGE_MAGIC = 0x19
+
+LZ4_MIN_MATCH = 4
+LZ4_LAST_LITERALS = 5
+LZ4_MATCH_LIMIT = 12
+LZ4_MAX_OFFSET = 65535
+
+
+def lz4_write_length(out, length):
+    while length >= 255:
+        out.append(255)
+        length -= 255
+    out.append(length)
+
+
+def lz4_write_sequence(out, literals, offset=0, match_length=0):
+    literal_length = len(literals)
+    match_code = match_length - LZ4_MIN_MATCH if match_length else 0
+    out.append((min(literal_length, 15) << 4) | min(match_code, 15))
+    if literal_length >= 15:
+        lz4_write_length(out, literal_length - 15)
+    out += literals
+    if match_length:
+        out += struct.pack('<H', offset)
+        if match_code >= 15:
+            lz4_write_length(out, match_code - 15)
+
+
+def lz4_compress_block(data):
+    """
+    Compress data into a raw LZ4 block (no frame) with greedy matching.
+    The block ends with at least 5 literals and the last match starts 12 bytes before the end,
+    as required by the LZ4 block format.
+    """
+    out = bytearray()
+    table = {}
+    anchor = 0
+    pos = 0
+    match_start_limit = len(data) - LZ4_MATCH_LIMIT
+    match_end_limit = len(data) - LZ4_LAST_LITERALS
+    while pos < match_start_limit:
+        key = data[pos:pos + LZ4_MIN_MATCH]
+        candidate = table.get(key)
+        table[key] = pos
+        if candidate is None or pos - candidate > LZ4_MAX_OFFSET:
+            pos += 1
+            continue
+        end = pos + LZ4_MIN_MATCH
+        while end < match_end_limit and data[end] == data[end - pos + candidate]:
+            end += 1
+        lz4_write_sequence(out, data[anchor:pos], pos - candidate, end - pos)
+        pos = anchor = end
+    lz4_write_sequence(out, data[anchor:])
+    return bytes(out)
+
+
+def is_lvgl_raw_image(file_name, data):
+    return file_name.endswith('.bin') and len(data) >= 12 and data[0] == LVGL_IMAGE_MAGIC
+
+
+def align_up(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def pack_assets(target_path, out_file, compress=False, no_compress=()):
+    """
+    Pack the files into an asset pack:
+
+        header | index (sorted by name) | names | data
+
+    - Identical files are stored once and share their data
+    - LVGL raw images are stored uncompressed on a 4 KB boundary, so they can be used in place
+    - With compress=True other files are stored as LZ4 blocks if that saves at least 10%,
+      the device decompresses them into PSRAM on first use
+    - The SHA-256 in the header covers everything after the header
+    """
+    skip_files = ['config.json']
+    os.makedirs(os.path.dirname(out_file), exist_ok=True)
+
+    files = []
+    for file_name in sorted(os.listdir(target_path), key=sort_key):
+        file_path = os.path.join(target_path, file_name)
+        if file_name in skip_files or not os.path.isfile(file_path):
+            continue
+        with open(file_path, 'rb') as f:
+            files.append((file_name, f.read()))
+
+    header_size = ASSET_PACK_HEADER.size
+    names = bytearray()
+    name_offsets = {}
+    for file_name, _ in files:
+        name_offsets[file_name] = len(names)
+        names += file_name.encode('utf-8')
+    names_offset = header_size + ASSET_PACK_ENTRY.size * len(files)
+
+    # Place the data, identical content is stored once
+    data = bytearray()
+    data_start = align_up(names_offset + len(names), ASSET_ALIGNMENT)
+    blobs = {}
+    entries = []
+    raw_size = 0
+    for file_name, content in files:
+        raw_size += len(content)
+        digest = hashlib.sha256(content).digest()
+        if digest not in blobs:
+            codec, flags, stored = ASSET_CODEC_STORED, 0, content
+            width, height = 0, 0
+            if is_lvgl_raw_image(file_name, content):
+                flags = ASSET_FLAG_ALIGNED
+                width, height = struct.unpack_from('<HH', content, 4)
+            elif compress and file_name not in no_compress and len(content) >= 256:
+                compressed = lz4_compress_block(content)
+                if len(compressed) * 10 <= len(content) * 9:
+                    codec, stored = ASSET_CODEC_LZ4, compressed
+
+            alignment = ASSET_HOT_ALIGNMENT if flags & ASSET_FLAG_ALIGNED else ASSET_ALIGNMENT
+            offset = align_up(data_start + len(data), alignment)
+            data += b'\0' * (offset - data_start - len(data))
+            data += stored
+            blobs[digest] = (offset, len(stored), codec, flags, width, height)
+        else:
+            print(f'Deduplicated {file_name}')
+
+        offset, stored_size, codec, flags, width, height = blobs[digest]
+        entries.append((file_name.encode('utf-8'), ASSET_PACK_ENTRY.pack(
+            name_offsets[file_name], len(file_name.encode('utf-8')), codec, flags,
+            offset, stored_size, len(content), width, height)))
+
+    entries.sort(key=lambda entry: entry[0])
+    index = b''.join(entry for _, entry in entries)
+    content = index + names + b'\0' * (data_start - names_offset - len(names)) + data
+    total_size = header_size + len(content)
+    header = ASSET_PACK_HEADER.pack(ASSET_PACK_MAGIC, ASSET_PACK_VERSION, header_size, len(files),
+                                    names_offset, len(names), total_size, hashlib.sha256(content).digest())
+
+    with open(out_file, 'wb') as output_bin:
+        output_bin.write(header + content)
+
+    print(f'Packed {len(files)} files into {os.path.basename(out_file)}: {raw_size} bytes -> {total_size} bytes '
+          f'({len(blobs)} unique, compression {"on" if compress else "off"})')
+
+
+def read_asset_pack(data):
+    """Unpack an asset pack into a {name: bytes} dict, used to check the generated pack"""
+    magic, version, header_size, file_count, names_offset, names_size, total_size, sha256 = \
+        ASSET_PACK_HEADER.unpack_from(data, 0)
+    if magic != ASSET_PACK_MAGIC or version != ASSET_PACK_VERSION or total_size > len(data):
+        raise ValueError('Not an asset pack')
+    if hashlib.sha256(data[header_size:total_size]).digest() != sha256:
+        raise ValueError('Asset pack SHA-256 mismatch')
+
+    files = {}
+    for i in range(file_count):
+        name_offset, name_length, codec, flags, offset, stored_size, size, _, _ = \
+            ASSET_PACK_ENTRY.unpack_from(data, header_size + i * ASSET_PACK_ENTRY.size)
+        name = bytes(data[names_offset + name_offset:names_offset + name_offset + name_length]).decode('utf-8')
+        stored = bytes(data[offset:offset + stored_size])
+        files[name] = stored if codec == ASSET_CODEC_STORED else lz4_decompress_block(stored, size)
+        if flags & ASSET_FLAG_ALIGNED and offset % ASSET_HOT_ALIGNMENT != 0:
+            raise ValueError(f'{name} is not aligned')
+    return files
+
+
+def verify_asset_pack(pack_file, target_path):
+    """Read the pack back and compare every file with its source"""
+    with open(pack_file, 'rb') as f:
+        files = read_asset_pack(f.read())
+    for file_name in os.listdir(target_path):
+        file_path = os.path.join(target_path, file_name)
+        if file_name == 'config.json' or not os.path.isfile(file_path):
+            continue
+        with open(file_path, 'rb') as f:
+            if files.pop(file_name, None) != f.read():
+                raise ValueError(f'{file_name} does not match after unpacking')
+    if files:
+        raise ValueError(f'Unexpected files in the asset pack: {", ".join(files)}')
+
+
+def lz4_decompress_block(block, size):
+    out = bytearray()
+    pos = 0
+    while pos < len(block):
+        token = block[pos]
+        pos += 1
+        length = token >> 4
+        if length == 15:
+            while True:
+                byte = block[pos]
+                pos += 1
+                length += byte
+                if byte != 255:
+                    break
+        out += block[pos:pos + length]
+        pos += length
+        if pos >= len(block):
+            break
+        offset = block[pos] | (block[pos + 1] << 8)
+        pos += 2
+        length = token & 0x0F
+        if length == 15:
+            while True:
+                byte = block[pos]
+                pos += 1
+                length += byte
+                if byte != 255:
+                    break
+        for _ in range(length + LZ4_MIN_MATCH):
+            out.append(out[-offset])
+    if len(out) != size:
+        raise ValueError('LZ4 block size mismatch')
+    return bytes(out)
+
+
 # =============================================================================
 # Configuration and main functions
 # =============================================================================
@@ -547,6 +774,28 @@ def read_wake_word_type_from_sdkconfig(sdkconfig_path):
     return config_values
 
 
+def read_asset_pack_options_from_sdkconfig(sdkconfig_path):
+    """
+    The emote display mounts the assets with esp_mmap_assets, which only reads the simple format.
+    Compression is only used with PSRAM, where the device keeps the decompressed assets.
+    """
+    options = {
+        'asset_pack': True,
+        'compress': False
+    }
+    if not os.path.exists(sdkconfig_path):
+        return options
+
+    with io.open(sdkconfig_path, "r") as f:
+        for line in f:
+            line = line.strip()
+            if line == 'CONFIG_USE_EMOTE_MESSAGE_STYLE=y':
+                options['asset_pack'] = False
+            elif line == 'CONFIG_SPIRAM=y':
+                options['compress'] = True
+    return options
+
+
 def read_custom_wake_word_from_sdkconfig(sdkconfig_path):
     """
     Read custom wake word configuration from sdkconfig
@@ -698,7 +947,7 @@ def get_emoji_collection_path(default_emoji_collection, xiaozhi_fonts_path):
         return None
 
 
-def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, extra_files_path, output_path, multinet_model_info=None):
+def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, extra_files_path, output_path, multinet_model_info=None, pack_options=None):
     """
     Build assets using integrated functions (no external dependencies)
     """
@@ -731,10 +980,16 @@ def build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font
         with open(config_path, 'r') as f:
             config_data = json.load(f)
         
-        # Use simplified packing function
         include_path = config_data['include_path']
         image_file = config_data['image_file']
-        pack_assets_simple(assets_dir, include_path, image_file, "assets", int(config_data['name_length']))
+        if pack_options and pack_options['asset_pack']:
+            # The font and the models are large and used in place, keep them uncompressed
+            no_compress = [name for name in (srmodels, text_font) if name]
+            pack_assets(assets_dir, image_file, pack_options['compress'], no_compress)
+            verify_asset_pack(image_file, assets_dir)
+        else:
+            # Use simplified packing function
+            pack_assets_simple(assets_dir, include_path, image_file, "assets", int(config_data['name_length']))
         
         # Copy final assets.bin to output location
         if os.path.exists(image_file):
@@ -868,9 +1123,13 @@ def main():
         print(f"Created empty assets.bin: {args.output}")
         return
     
+    # Select the container format
+    pack_options = read_asset_pack_options_from_sdkconfig(args.sdkconfig)
+    print(f"  asset pack: {'yes' if pack_options['asset_pack'] else 'no'}, compression: {'yes' if pack_options['compress'] else 'no'}")
+
     # Build the assets
     success = build_assets_integrated(wakenet_model_paths, multinet_model_paths, text_font_path, emoji_collection_path, 
-                                     extra_files_path, args.output, multinet_model_info)
+                                     extra_files_path, args.output, multinet_model_info, pack_options)
     
     if not success:
         sys.exit(1)
@@ -0,0 +1,90 @@
+#! /usr/bin/env python3
+"""
+Generate a delta OTA patch between two application images.
+
+The patch is compatible with esp_delta_ota (detools, heatshrink compression) and
+carries the 64-byte header checked by Ota::UpgradeDelta:
+    magic (0xfccdde10, little endian) | SHA-256 of the base image | reserved
+
+Usage:
+    python scripts/gen_delta_ota_patch.py base.bin new.bin -o firmware.patch
+
+The script re-applies the patch to the base image in memory and checks the
+SHA-256 of the result before writing the output. The device side of the stream
+(header check, chunked feeding, SHA-256 of the patched image) is covered by
+test/delta_ota_test.cc. The printed SHA-256 of the new
+image must be published as `firmware.sha256` next to `firmware.patch_url` in the
+OTA check version response.
+"""
+import argparse
+import hashlib
+import io
+import struct
+import sys
+
+import detools
+
+DELTA_OTA_MAGIC = 0xfccdde10
+PATCH_HEADER_SIZE = 64
+DIGEST_SIZE = 32
+
+
+def get_image_digest(data):
+    # Application images are built with the SHA-256 digest appended to the end,
+    # which is what esp_partition_get_sha256() returns for the running partition
+    if len(data) < DIGEST_SIZE or data[0] != 0xE9:
+        raise Exception("Invalid application image")
+    if data[23] != 1:
+        raise Exception("Image has no appended SHA-256 digest")
+    return data[-DIGEST_SIZE:]
+
+
+def create_patch(base, new):
+    output = io.BytesIO()
+    detools.create_patch(io.BytesIO(base), io.BytesIO(new), output, compression="heatshrink")
+    header = struct.pack("<I", DELTA_OTA_MAGIC) + get_image_digest(base)
+    header += b"\0" * (PATCH_HEADER_SIZE - len(header))
+    return header + output.getvalue()
+
+
+def verify_patch(base, patch, expected_sha256):
+    magic = struct.unpack("<I", patch[:4])[0]
+    if magic != DELTA_OTA_MAGIC:
+        raise Exception("Invalid patch magic")
+    if patch[4:4 + DIGEST_SIZE] != get_image_digest(base):
+        raise Exception("Patch is not built against the base image")
+    output = io.BytesIO()
+    detools.apply_patch(io.BytesIO(base), io.BytesIO(patch[PATCH_HEADER_SIZE:]), output)
+    if hashlib.sha256(output.getvalue()).hexdigest() != expected_sha256:
+        raise Exception("Patched image SHA-256 mismatch")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate a delta OTA patch")
+    parser.add_argument("base", help="firmware currently running on the device")
+    parser.add_argument("new", help="firmware to upgrade to")
+    parser.add_argument("-o", "--output", default="firmware.patch", help="output patch file")
+    args = parser.parse_args()
+
+    with open(args.base, "rb") as f:
+        base = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    sha256 = hashlib.sha256(new).hexdigest()
+    patch = create_patch(base, new)
+    verify_patch(base, patch, sha256)
+
+    with open(args.output, "wb") as f:
+        f.write(patch)
+
+    print(f"Patch: {args.output}, {len(patch)} bytes ({len(patch) * 100 // len(new)}% of {len(new)} bytes)")
+    print(f"SHA-256: {sha256}")
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except Exception as e:
+        print(f"Error: {e}", file=sys.stderr)
+        sys.exit(1)
@@ -0,0 +1,242 @@
+// AFSK WiFi configuration: bit error rate of the fixed-point demodulator over AWGN and bit phase,
+// and frames built like scripts/sonic_wifi_config.html decoded end to end from 16 kHz audio
+
+#include "afsk_demod.h"
+#include "application.h"
+#include "display.h"
+#include "ssid_manager.h"
+#include "wifi_manager.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace audio_wifi_config;
+
+namespace {
+
+const int kAmplitude = 8000;
+
+std::vector<uint8_t> ToBits(const std::vector<uint8_t>& bytes) {
+    std::vector<uint8_t> bits;
+    for (auto byte : bytes) {
+        for (int i = 7; i >= 0; i--) {
+            bits.push_back((byte >> i) & 1);
+        }
+    }
+    return bits;
+}
+
+// Same framing as the web page: start bytes, text, 8 bit sum, end bytes
+std::vector<uint8_t> BuildFrame(const std::string& text) {
+    std::vector<uint8_t> bytes = {0x01, 0x02};
+    bytes.insert(bytes.end(), text.begin(), text.end());
+    bytes.push_back(AudioDataBuffer::CalculateChecksum(text));
+    bytes.push_back(0x03);
+    bytes.push_back(0x04);
+    return bytes;
+}
+
+// Phase continuous tones, sin(2 * PI * f * t) with t counted from the start of the signal
+std::vector<float> Modulate(const std::vector<uint8_t>& bits, int sample_rate) {
+    int samples_per_bit = sample_rate / kBitRate;
+    std::vector<float> signal(bits.size() * samples_per_bit);
+    for (size_t i = 0; i < signal.size(); i++) {
+        double frequency = bits[i / samples_per_bit] ? kMarkFrequency : kSpaceFrequency;
+        signal[i] = kAmplitude * std::sin(2 * M_PI * frequency * i / sample_rate);
+    }
+    return signal;
+}
+
+// White gaussian noise at the given SNR relative to the tone power, clipped to int16
+std::vector<int16_t> AddNoise(const std::vector<float>& signal, double snr_db, std::mt19937& rng) {
+    double sigma = std::sqrt(kAmplitude * kAmplitude / 2.0 / std::pow(10, snr_db / 10));
+    std::normal_distribution<double> noise(0, sigma);
+    std::vector<int16_t> samples(signal.size());
+    for (size_t i = 0; i < signal.size(); i++) {
+        samples[i] = (int16_t)std::clamp(std::lround(signal[i] + noise(rng)), -32768L, 32767L);
+    }
+    return samples;
+}
+
+// Fraction of wrong bit decisions, the receiver starts `offset` samples into the first bit
+double MeasureBitErrorRate(double snr_db, int offset, int bit_count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> bits(bit_count);
+    for (auto& bit : bits) {
+        bit = rng() & 1;
+    }
+    auto samples = AddNoise(Modulate(bits, kAudioSampleRate), snr_db, rng);
+
+    AudioSignalProcessor processor(kAudioSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate, kWindowSize);
+    size_t errors = 0;
+    size_t decided = 0;
+    for (size_t i = offset; i < samples.size(); i++) {
+        uint16_t mark_probability;
+        if (!processor.ProcessSample(samples[i], mark_probability)) {
+            continue;
+        }
+        // The decision covers the bit the window mostly falls in
+        size_t bit_index = (i - kAudioSampleRate / kBitRate / 2) / (kAudioSampleRate / kBitRate);
+        uint8_t bit = mark_probability > kProbabilityHalf ? 1 : 0;
+        errors += bit != bits[bit_index];
+        decided++;
+    }
+    return decided == 0 ? 1.0 : (double)errors / decided;
+}
+
+struct AudioExhausted {};
+
+}  // namespace
+
+static void TestBitErrorRate() {
+    // Bit aligned, 4000 random bits per point
+    struct {
+        double snr_db;
+        double max_ber;
+    } points[] = {{10, 0}, {0, 0.001}, {-3, 0.005}, {-6, 0.02}, {-9, 0.1}};
+    for (auto& point : points) {
+        double ber = MeasureBitErrorRate(point.snr_db, 0, 4000, 1);
+        std::printf("  SNR %5.1f dB: BER %.4f\n", point.snr_db, ber);
+        CHECK(ber <= point.max_ber);
+    }
+}
+
+static void TestBitPhase() {
+    // The receiver's bit clock is free running, a small phase offset must not cost bits at good SNR
+    int samples_per_bit = kAudioSampleRate / kBitRate;
+    for (int offset = 0; offset <= samples_per_bit / 8; offset++) {
+        double ber = MeasureBitErrorRate(10, offset, 2000, 2 + offset);
+        if (ber > 0.001) {
+            std::fprintf(stderr, "  offset %d samples: BER %.4f\n", offset, ber);
+        }
+        CHECK(ber <= 0.001);
+    }
+}
+
+static void TestSilence() {
+    // Silence has no mark energy and reads as space
+    AudioSignalProcessor processor(kAudioSampleRate, kMarkFrequency, kSpaceFrequency, kBitRate, kWindowSize);
+    uint16_t mark_probability = 1;
+    int bits = 0;
+    for (int i = 0; i < 640; i++) {
+        if (processor.ProcessSample(0, mark_probability)) {
+            CHECK(mark_probability == 0);
+            bits++;
+        }
+    }
+    CHECK(bits == 10);
+}
+
+static void TestFrameBuffer() {
+    std::string text = "MyWiFi\npassw0rd!";
+    auto bits = ToBits(BuildFrame(text));
+
+    AudioDataBuffer buffer;
+    // Idle line before the frame fills the identifier buffer
+    for (int i = 0; i < 20; i++) {
+        CHECK(!buffer.ProcessProbability(0));
+    }
+    bool decoded = false;
+    for (auto bit : bits) {
+        decoded = buffer.ProcessProbability(bit ? 32768 : 0) || decoded;
+    }
+    CHECK(decoded);
+    CHECK(buffer.decoded_text.has_value() && *buffer.decoded_text == text);
+
+    // A frame with a wrong checksum is dropped
+    auto frame = BuildFrame(text);
+    frame[frame.size() - 3] ^= 0x5a;
+    AudioDataBuffer corrupted;
+    for (int i = 0; i < 20; i++) {
+        corrupted.ProcessProbability(0);
+    }
+    decoded = false;
+    for (auto bit : ToBits(frame)) {
+        decoded = corrupted.ProcessProbability(bit ? 32768 : 0) || decoded;
+    }
+    CHECK(!decoded);
+    CHECK(!corrupted.decoded_text.has_value());
+}
+
+static bool ReceiveFromAudio(const std::string& text, size_t channels, double snr_db, int lead_in, uint32_t seed) {
+    const int kInputRate = 16000;
+    std::mt19937 rng(seed);
+    // Idle line, the frame, and a few idle bits before the page loops the frame again
+    std::vector<uint8_t> bits(20, 0);
+    auto frame = ToBits(BuildFrame(text));
+    bits.insert(bits.end(), frame.begin(), frame.end());
+    bits.insert(bits.end(), 20, 0);
+    // `lead_in` samples of silence shift the frame against the receiver's bit clock
+    auto signal = Modulate(bits, kInputRate);
+    signal.insert(signal.begin(), lead_in, 0.0f);
+    auto mono = AddNoise(signal, snr_db, rng);
+
+    Application app;
+    app.device_state = kDeviceStateWifiConfiguring;
+    size_t position = 0;
+    app.GetAudioService().on_read = [&](std::vector<int16_t>& data, int sample_rate, int samples) {
+        CHECK(sample_rate == kInputRate);
+        if (position >= mono.size()) {
+            throw AudioExhausted();
+        }
+        size_t count = std::min<size_t>(samples, mono.size() - position);
+        data.resize(count * channels);
+        for (size_t i = 0; i < count; i++) {
+            for (size_t c = 0; c < channels; c++) {
+                // Only the first channel carries the signal
+                data[i * channels + c] = c == 0 ? mono[position + i] : (int16_t)(rng() % 2001 - 1000);
+            }
+        }
+        position += count;
+        return true;
+    };
+
+    Display display;
+    WifiManager wifi_manager;
+    auto& ssids = SsidManager::GetInstance().ssids;
+    ssids.clear();
+    try {
+        ReceiveWifiCredentialsFromAudio(&app, &wifi_manager, &display, channels);
+    } catch (const AudioExhausted&) {
+        return false;
+    }
+
+    auto newline = text.find('\n');
+    CHECK(ssids.size() == 1);
+    CHECK(!ssids.empty() && ssids[0].first == text.substr(0, newline));
+    CHECK(!ssids.empty() && ssids[0].second == text.substr(newline + 1));
+    CHECK(display.last_message == text);
+    CHECK(wifi_manager.config_ap_stopped);
+    return true;
+}
+
+static void TestReceiveCredentials() {
+    // 16 kHz is decimated to 6.4 kHz, the frame starts up to 1/8 bit off the receiver's bit clock
+    std::string text = "Xiaozhi-5G\n12345678";
+    int received = 0;
+    int attempts = 0;
+    for (size_t channels : {1, 2}) {
+        for (int lead_in = 0; lead_in <= (int)(16000 / kBitRate / 8); lead_in += 2) {
+            attempts++;
+            received += ReceiveFromAudio(text, channels, 6, lead_in, 100 + lead_in);
+        }
+    }
+    std::printf("  %d of %d frames received at 6 dB SNR\n", received, attempts);
+    CHECK(received == attempts);
+
+    // Non ASCII SSIDs are sent as UTF-8 bytes
+    CHECK(ReceiveFromAudio("\xe5\xb0\x8f\xe6\x99\xba\nsecret", 1, 20, 0, 7));
+}
+
+int main() {
+    RUN_TEST(TestBitErrorRate);
+    RUN_TEST(TestBitPhase);
+    RUN_TEST(TestSilence);
+    RUN_TEST(TestFrameBuffer);
+    RUN_TEST(TestReceiveCredentials);
+    return test_result();
+}
@@ -0,0 +1,156 @@
+// Reads the pack written by make_asset_pack.py with the device side AssetPack and checks every file,
+// then feeds corrupted and truncated copies of it, which must be rejected without reading out of bounds.
+#include "asset_pack.h"
+#include "test_util.h"
+
+#include <dirent.h>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+static std::string g_dir;
+
+static std::vector<uint8_t> ReadFile(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::map<std::string, std::vector<uint8_t>> ReadSourceFiles() {
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::string dir = g_dir + "/files";
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr) {
+        return files;
+    }
+    while (auto entry = readdir(d)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == ".." || name == "config.json") {
+            continue;
+        }
+        files[name] = ReadFile(dir + "/" + name);
+    }
+    closedir(d);
+    return files;
+}
+
+// Decompress every entry the way Assets does, returns false if any entry is rejected
+static bool ReadAll(const AssetPack& pack) {
+    bool ok = true;
+    for (size_t i = 0; i < pack.count(); i++) {
+        auto entry = pack.GetEntry(i);
+        // A corrupted size fails the allocation on the device
+        if (entry->size > 1024 * 1024) {
+            ok = false;
+            continue;
+        }
+        std::vector<uint8_t> data(entry->size);
+        ok = pack.Decompress(entry, data.data()) && ok;
+        ok = pack.Find(pack.GetName(entry)) != nullptr && ok;
+    }
+    return ok;
+}
+
+static void TestRoundTrip() {
+    auto pack_data = ReadFile(g_dir + "/assets.bin");
+    auto files = ReadSourceFiles();
+    CHECK(!files.empty());
+
+    AssetPack pack;
+    CHECK(pack.Open(pack_data.data(), pack_data.size()));
+    CHECK(pack.count() == files.size());
+
+    int compressed = 0;
+    for (auto& [name, content] : files) {
+        auto entry = pack.Find(name);
+        CHECK(entry != nullptr);
+        if (entry == nullptr) {
+            continue;
+        }
+        CHECK(entry->size == content.size());
+        std::vector<uint8_t> data(entry->size);
+        CHECK(pack.Decompress(entry, data.data()));
+        CHECK(data == content);
+        if (entry->codec == AssetPack::kCodecLz4) {
+            compressed++;
+        }
+        if (entry->flags & AssetPack::kFlagAligned) {
+            CHECK(entry->offset % 4096 == 0);
+            CHECK(entry->codec == AssetPack::kCodecStored);
+            CHECK(entry->width == (content[5] << 8 | content[4]));
+        } else {
+            CHECK(entry->offset % 4 == 0);
+        }
+    }
+    CHECK(compressed >= 2);
+    // Identical files share their data
+    CHECK(pack.Find("copy.json")->offset == pack.Find("index.json")->offset);
+    CHECK(pack.Find("missing.json") == nullptr);
+    CHECK(pack.Find("") == nullptr);
+}
+
+static void TestTruncated() {
+    auto pack_data = ReadFile(g_dir + "/assets.bin");
+    for (size_t size = 0; size < pack_data.size(); size += (size < 1024 ? 1 : 97)) {
+        // Copy into an exact size buffer, so ASan catches any read past the end
+        std::vector<uint8_t> truncated(pack_data.begin(), pack_data.begin() + size);
+        AssetPack pack;
+        CHECK(!pack.Open(truncated.data(), truncated.size()));
+    }
+}
+
+static void TestCorrupted() {
+    auto pack_data = ReadFile(g_dir + "/assets.bin");
+    std::mt19937 rng(1234);
+    int opened = 0;
+    for (int round = 0; round < 10000; round++) {
+        auto corrupted = pack_data;
+        int flips = 1 + rng() % 4;
+        for (int i = 0; i < flips; i++) {
+            // Mostly hit the header, index and names, where a bad value could send a read out of bounds
+            size_t limit = round % 2 == 0 ? std::min<size_t>(corrupted.size(), 1024) : corrupted.size();
+            corrupted[rng() % limit] ^= 1 << (rng() % 8);
+        }
+        AssetPack pack;
+        if (pack.Open(corrupted.data(), corrupted.size())) {
+            opened++;
+            // Data corruption passes Open() (the SHA-256 is checked by the caller), LZ4 must reject bad blocks
+            ReadAll(pack);
+        }
+    }
+    CHECK(opened > 0);
+}
+
+static void TestLz4Corrupted() {
+    // A literal run longer than the input, a zero offset, an offset before the start, a match past the end
+    const uint8_t long_literals[] = {0xF0, 0x40, 'a'};
+    const uint8_t zero_offset[] = {0x10, 'a', 0x00, 0x00};
+    const uint8_t far_offset[] = {0x10, 'a', 0x02, 0x00};
+    const uint8_t long_match[] = {0x1F, 'a', 0x01, 0x00, 0xFF, 0xFF, 0x10};
+    uint8_t out[64];
+    CHECK(AssetPack::DecompressLz4(long_literals, sizeof(long_literals), out, sizeof(out)) < 0);
+    CHECK(AssetPack::DecompressLz4(zero_offset, sizeof(zero_offset), out, sizeof(out)) < 0);
+    CHECK(AssetPack::DecompressLz4(far_offset, sizeof(far_offset), out, sizeof(out)) < 0);
+    CHECK(AssetPack::DecompressLz4(long_match, sizeof(long_match), out, sizeof(out)) < 0);
+
+    // Overlapping match: one literal repeated
+    const uint8_t repeat[] = {0x14, 'x', 0x01, 0x00, 0x10, 'y'};
+    CHECK(AssetPack::DecompressLz4(repeat, sizeof(repeat), out, sizeof(out)) == 10);
+    CHECK(memcmp(out, "xxxxxxxxxy", 10) == 0);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::fprintf(stderr, "Usage: %s <directory written by make_asset_pack.py>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    g_dir = argv[1];
+    RUN_TEST(TestRoundTrip);
+    RUN_TEST(TestTruncated);
+    RUN_TEST(TestCorrupted);
+    RUN_TEST(TestLz4Corrupted);
+    return test_result();
+}
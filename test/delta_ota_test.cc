@@ -0,0 +1,306 @@
+// DeltaOtaPatch: the streaming side of Ota::UpgradeDelta fed with patches in download chunks of any
+// size. The detools engine of esp_delta_ota is a managed component and not built here, a small copy
+// and literal patch engine with the same read and write callbacks stands in for it.
+
+#include "delta_ota_patch.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> Sha256(const std::vector<uint8_t>& data) {
+    mbedtls_sha256_context ctx;
+    mbedtls_sha256_init(&ctx);
+    mbedtls_sha256_starts(&ctx, 0);
+    mbedtls_sha256_update(&ctx, data.data(), data.size());
+    std::vector<uint8_t> digest(32);
+    mbedtls_sha256_finish(&ctx, digest.data());
+    mbedtls_sha256_free(&ctx);
+    return digest;
+}
+
+std::string Hex(const std::vector<uint8_t>& digest) {
+    std::string hex;
+    char byte[3];
+    for (auto value : digest) {
+        snprintf(byte, sizeof(byte), "%02x", value);
+        hex += byte;
+    }
+    return hex;
+}
+
+void PutU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((uint8_t)(value >> (i * 8)));
+    }
+}
+
+// Header as written by scripts/gen_delta_ota_patch.py
+std::vector<uint8_t> PatchHeader(const std::vector<uint8_t>& base, uint32_t magic = DELTA_OTA_MAGIC) {
+    std::vector<uint8_t> header;
+    PutU32(header, magic);
+    auto digest = Sha256(base);
+    header.insert(header.end(), digest.begin(), digest.end());
+    header.resize(DELTA_OTA_PATCH_HEADER_SIZE, 0);
+    return header;
+}
+
+// Patch body of the stand-in engine: 'C' offset length copies from the base image, 'L' length data
+// inserts literal bytes
+class PatchWriter {
+public:
+    void Copy(uint32_t offset, uint32_t length) {
+        body.push_back('C');
+        PutU32(body, offset);
+        PutU32(body, length);
+    }
+    void Literal(const std::vector<uint8_t>& data) {
+        body.push_back('L');
+        PutU32(body, data.size());
+        body.insert(body.end(), data.begin(), data.end());
+    }
+    std::vector<uint8_t> body;
+};
+
+// Consumes the patch body in whatever pieces DeltaOtaPatch passes on, reads the base image through a
+// read callback and writes the new image in blocks, like esp_delta_ota does
+class TestPatchEngine {
+public:
+    TestPatchEngine(const std::vector<uint8_t>& base, DeltaOtaPatch*& patch) : base_(base), patch_(patch) {}
+
+    bool Feed(const uint8_t* data, size_t size) {
+        fed += size;
+        pending_.insert(pending_.end(), data, data + size);
+        while (true) {
+            if (pending_.size() < 5) {
+                return true;
+            }
+            uint32_t a = ReadU32(1);
+            if (pending_[0] == 'C') {
+                if (pending_.size() < 9) {
+                    return true;
+                }
+                uint32_t b = ReadU32(5);
+                if (a > base_.size() || b > base_.size() - a) {
+                    return false;
+                }
+                for (uint32_t pos = 0; pos < b; pos += 128) {
+                    uint8_t block[128];
+                    uint32_t count = std::min<uint32_t>(128, b - pos);
+                    ReadSource(block, count, a + pos);
+                    Write(block, count);
+                }
+                pending_.erase(pending_.begin(), pending_.begin() + 9);
+            } else if (pending_[0] == 'L') {
+                if (pending_.size() < 5 + a) {
+                    return true;
+                }
+                Write(pending_.data() + 5, a);
+                pending_.erase(pending_.begin(), pending_.begin() + 5 + a);
+            } else {
+                return false;
+            }
+        }
+    }
+
+    // Like esp_delta_ota_finalize(), fails on a truncated operation
+    bool Finalize() const { return pending_.empty(); }
+
+    std::vector<uint8_t> image;
+    size_t fed = 0;
+
+private:
+    uint32_t ReadU32(size_t at) const {
+        return pending_[at] | pending_[at + 1] << 8 | pending_[at + 2] << 16 | (uint32_t)pending_[at + 3] << 24;
+    }
+    void ReadSource(uint8_t* buf, size_t size, size_t offset) { memcpy(buf, base_.data() + offset, size); }
+    void Write(const uint8_t* buf, size_t size) {
+        patch_->OnImageData(buf, size);
+        image.insert(image.end(), buf, buf + size);
+    }
+
+    const std::vector<uint8_t>& base_;
+    DeltaOtaPatch*& patch_;
+    std::vector<uint8_t> pending_;
+};
+
+struct Result {
+    bool fed = false;
+    bool finalized = false;
+    bool verified = false;
+    std::vector<uint8_t> image;
+    size_t engine_bytes = 0;
+};
+
+// Runs a download of `patch` in `chunk` byte reads through DeltaOtaPatch and the stand-in engine, in
+// the order Ota::UpgradeDelta uses
+Result Apply(const std::vector<uint8_t>& running, const std::vector<uint8_t>& patch, size_t chunk,
+             const std::string& sha256) {
+    Result result;
+    auto running_sha256 = Sha256(running);
+    DeltaOtaPatch* patch_ptr = nullptr;
+    TestPatchEngine engine(running, patch_ptr);
+    DeltaOtaPatch delta(running_sha256.data(), [&engine](const uint8_t* data, size_t size) {
+        return engine.Feed(data, size);
+    });
+    patch_ptr = &delta;
+
+    result.fed = true;
+    for (size_t pos = 0; pos < patch.size() && result.fed; pos += chunk) {
+        result.fed = delta.Feed(patch.data() + pos, std::min(chunk, patch.size() - pos));
+    }
+    result.finalized = result.fed && delta.header_verified() && engine.Finalize();
+    result.verified = result.finalized && delta.Verify(sha256);
+    CHECK(delta.image_size() == engine.image.size());
+    result.image = engine.image;
+    result.engine_bytes = engine.fed;
+    return result;
+}
+
+std::vector<uint8_t> RandomBytes(size_t size, std::mt19937& rng) {
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) {
+        byte = (uint8_t)rng();
+    }
+    return data;
+}
+
+}  // namespace
+
+static void TestSha256() {
+    // FIPS 180-2 vectors, the expected digests of the other tests come from the same implementation
+    auto to_bytes = [](const std::string& text) { return std::vector<uint8_t>(text.begin(), text.end()); };
+    CHECK(Hex(Sha256({})) == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    CHECK(Hex(Sha256(to_bytes("abc"))) == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    CHECK(Hex(Sha256(to_bytes("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"))) ==
+          "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    CHECK(Hex(Sha256(std::vector<uint8_t>(1000000, 'a'))) ==
+          "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+}
+
+static void TestChunkSizes() {
+    // A new image sharing most of the base, with moved, changed and appended parts
+    std::mt19937 rng(1);
+    auto base = RandomBytes(20000, rng);
+    auto inserted = RandomBytes(700, rng);
+    auto appended = RandomBytes(3000, rng);
+    PatchWriter writer;
+    writer.Copy(0, 8000);
+    writer.Literal(inserted);
+    writer.Copy(12000, 8000);
+    writer.Copy(8000, 4000);
+    writer.Literal(appended);
+    std::vector<uint8_t> image(base.begin(), base.begin() + 8000);
+    image.insert(image.end(), inserted.begin(), inserted.end());
+    image.insert(image.end(), base.begin() + 12000, base.end());
+    image.insert(image.end(), base.begin() + 8000, base.begin() + 12000);
+    image.insert(image.end(), appended.begin(), appended.end());
+
+    auto patch = PatchHeader(base);
+    patch.insert(patch.end(), writer.body.begin(), writer.body.end());
+    auto sha256 = Hex(Sha256(image));
+    for (size_t chunk : {1, 3, 63, 64, 65, 100, 511, 512, 4096, 100000}) {
+        auto result = Apply(base, patch, chunk, sha256);
+        if (!result.verified) {
+            std::fprintf(stderr, "  %zu byte reads failed\n", chunk);
+        }
+        CHECK(result.verified);
+        CHECK(result.image == image);
+        // Everything after the header reaches the engine, the header does not
+        CHECK(result.engine_bytes == writer.body.size());
+    }
+
+    // The server may send the SHA-256 in upper case
+    std::string upper = sha256;
+    for (auto& c : upper) {
+        c = (char)toupper(c);
+    }
+    CHECK(Apply(base, patch, 512, upper).verified);
+}
+
+static void TestHeaderRejected() {
+    // Nothing reaches the engine, and the OTA partition is never written, for a wrong header
+    std::mt19937 rng(2);
+    auto base = RandomBytes(4096, rng);
+    PatchWriter writer;
+    writer.Copy(0, 4096);
+    auto sha256 = Hex(Sha256(base));
+
+    auto wrong_magic = PatchHeader(base, 0xfccdde11);
+    wrong_magic.insert(wrong_magic.end(), writer.body.begin(), writer.body.end());
+    auto other_base = RandomBytes(4096, rng);
+    auto wrong_base = PatchHeader(other_base);
+    wrong_base.insert(wrong_base.end(), writer.body.begin(), writer.body.end());
+    for (auto& patch : {wrong_magic, wrong_base}) {
+        for (size_t chunk : {1, 64, 512}) {
+            auto result = Apply(base, patch, chunk, sha256);
+            CHECK(!result.fed && !result.verified);
+            CHECK(result.engine_bytes == 0 && result.image.empty());
+        }
+    }
+
+    // A download ending inside the header
+    auto header = PatchHeader(base);
+    header.resize(40);
+    auto result = Apply(base, header, 512, sha256);
+    CHECK(result.fed && !result.finalized && !result.verified);
+}
+
+static void TestImageRejected() {
+    std::mt19937 rng(3);
+    auto base = RandomBytes(4096, rng);
+    auto literal = RandomBytes(100, rng);
+    PatchWriter writer;
+    writer.Copy(100, 3000);
+    writer.Literal(literal);
+    auto patch = PatchHeader(base);
+    patch.insert(patch.end(), writer.body.begin(), writer.body.end());
+    std::vector<uint8_t> image(base.begin() + 100, base.begin() + 3100);
+    image.insert(image.end(), literal.begin(), literal.end());
+    CHECK(Apply(base, patch, 512, Hex(Sha256(image))).verified);
+
+    // A corrupted literal byte is caught by the SHA-256 of the new image
+    auto corrupted = patch;
+    corrupted.back() ^= 0x01;
+    auto result = Apply(base, corrupted, 512, Hex(Sha256(image)));
+    CHECK(result.finalized && !result.verified);
+
+    // A patch cut short leaves the engine with a partial operation
+    auto truncated = patch;
+    truncated.resize(truncated.size() - 10);
+    result = Apply(base, truncated, 512, Hex(Sha256(image)));
+    CHECK(result.fed && !result.finalized && !result.verified);
+
+    // An engine error stops the download
+    auto invalid = patch;
+    invalid[DELTA_OTA_PATCH_HEADER_SIZE] = 'X';
+    result = Apply(base, invalid, 512, Hex(Sha256(image)));
+    CHECK(!result.fed && !result.verified);
+}
+
+static void TestVerifyOnce() {
+    std::vector<uint8_t> base(64, 0x5a);
+    auto patch = PatchHeader(base);
+    DeltaOtaPatch delta(Sha256(base).data(), [](const uint8_t*, size_t) { return true; });
+    CHECK(delta.Feed(patch.data(), patch.size()));
+    delta.OnImageData(reinterpret_cast<const uint8_t*>("abc"), 3);
+    CHECK(delta.Verify("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    // The hash is finished, the stream cannot continue
+    CHECK(!delta.Feed(patch.data(), 1));
+    CHECK(!delta.Verify("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+}
+
+int main() {
+    RUN_TEST(TestSha256);
+    RUN_TEST(TestChunkSizes);
+    RUN_TEST(TestHeaderRejected);
+    RUN_TEST(TestImageRejected);
+    RUN_TEST(TestVerifyOnce);
+    return test_result();
+}
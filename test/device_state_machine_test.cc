@@ -0,0 +1,154 @@
+// DeviceStateMachine: listener ids that stay stale after removal, listener removal racing with
+// notifications, and the transition log
+
+#include "device_state_machine.h"
+#include "test_util.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <thread>
+
+namespace {
+
+void StartToIdle(DeviceStateMachine& machine) {
+    CHECK(machine.TransitionTo(kDeviceStateStarting));
+    CHECK(machine.TransitionTo(kDeviceStateActivating));
+    CHECK(machine.TransitionTo(kDeviceStateIdle));
+}
+
+}  // namespace
+
+static void TestStaleListenerId() {
+    DeviceStateMachine machine;
+    int first_calls = 0, second_calls = 0;
+    int first = machine.AddStateChangeListener([&](DeviceState, DeviceState) { first_calls++; });
+    CHECK(first >= 0);
+    machine.RemoveStateChangeListener(first);
+
+    // The new listener gets the same slot, but not the same id
+    int second = machine.AddStateChangeListener([&](DeviceState, DeviceState) { second_calls++; });
+    CHECK(second >= 0 && second != first);
+    CHECK(second % DeviceStateMachine::kMaxListeners == first % DeviceStateMachine::kMaxListeners);
+
+    // Removing the first listener again must leave the second one in place
+    machine.RemoveStateChangeListener(first);
+    StartToIdle(machine);
+    CHECK(first_calls == 0);
+    CHECK(second_calls == 3);
+
+    machine.RemoveStateChangeListener(second);
+    CHECK(machine.TransitionTo(kDeviceStateListening));
+    CHECK(second_calls == 3);
+
+    // Ids that were never handed out are ignored
+    for (int id : {-1, -5, 0, 1, DeviceStateMachine::kMaxListeners, 1 << 30}) {
+        machine.RemoveStateChangeListener(id);
+    }
+}
+
+static void TestListenerSlots() {
+    DeviceStateMachine machine;
+    std::set<int> ids;
+    int calls[DeviceStateMachine::kMaxListeners] = {};
+    int slot_ids[DeviceStateMachine::kMaxListeners];
+    for (int i = 0; i < DeviceStateMachine::kMaxListeners; i++) {
+        slot_ids[i] = machine.AddStateChangeListener([&calls, i](DeviceState, DeviceState) { calls[i]++; });
+        CHECK(slot_ids[i] >= 0);
+        ids.insert(slot_ids[i]);
+    }
+    CHECK(machine.AddStateChangeListener([](DeviceState, DeviceState) {}) == -1);
+
+    // Reusing a slot many times never repeats an id
+    for (int round = 0; round < 10000; round++) {
+        machine.RemoveStateChangeListener(slot_ids[1]);
+        slot_ids[1] = machine.AddStateChangeListener([&calls](DeviceState, DeviceState) { calls[1]++; });
+        CHECK(slot_ids[1] >= 0);
+        CHECK(ids.insert(slot_ids[1]).second);
+    }
+    CHECK(machine.TransitionTo(kDeviceStateStarting));
+    for (int i = 0; i < DeviceStateMachine::kMaxListeners; i++) {
+        CHECK(calls[i] == 1);
+    }
+}
+
+static void TestRemoveWhileNotifying() {
+    // One task changes state while another adds and removes a listener: once removal returns, its
+    // callback has finished and is never called again
+    DeviceStateMachine machine;
+    StartToIdle(machine);
+    std::atomic<bool> done{false};
+    std::atomic<int> late_calls{0};
+    std::atomic<int> calls{0};
+
+    std::thread notifier([&]() {
+        while (!done.load()) {
+            machine.TransitionTo(machine.GetState() == kDeviceStateIdle ? kDeviceStateListening : kDeviceStateIdle);
+            std::this_thread::yield();
+        }
+    });
+
+    int stale_id = -1;
+    for (int round = 0; round < 5000; round++) {
+        auto removed = std::make_shared<std::atomic<bool>>(false);
+        int id = machine.AddStateChangeListener([&, removed](DeviceState, DeviceState) {
+            calls++;
+            if (removed->load()) {
+                late_calls++;
+            }
+        });
+        CHECK(id >= 0);
+        // A stale id from the previous round must not remove this listener
+        machine.RemoveStateChangeListener(stale_id);
+        // Every other round is removed only once the notifier reached it, so removal meets running callbacks
+        if (round % 2 == 0) {
+            int seen = calls.load();
+            while (calls.load() == seen) {
+                std::this_thread::yield();
+            }
+        }
+        machine.RemoveStateChangeListener(id);
+        removed->store(true);
+        stale_id = id;
+    }
+    done = true;
+    notifier.join();
+    std::printf("  %d notifications while listeners came and went\n", calls.load());
+    CHECK(late_calls == 0);
+    CHECK(calls > 0);
+}
+
+static void TestTransitionLog() {
+    DeviceStateMachine machine;
+    StartToIdle(machine);
+    CHECK(!machine.TransitionTo(kDeviceStateStarting));
+    machine.MarkStateHandled(kDeviceStateIdle);
+
+    cJSON* json = machine.GetTransitionLogJson();
+    auto state = cJSON_GetObjectItem(json, "state");
+    CHECK(cJSON_IsString(state) && strcmp(state->valuestring, "idle") == 0);
+    auto transitions = cJSON_GetObjectItem(json, "transitions");
+    CHECK(cJSON_GetArraySize(transitions) == 4);
+    auto rejected = cJSON_GetArrayItem(transitions, 3);
+    CHECK(cJSON_GetObjectItem(rejected, "rejected") != nullptr);
+    CHECK(strcmp(cJSON_GetObjectItem(rejected, "to")->valuestring, "starting") == 0);
+    CHECK(cJSON_IsNumber(cJSON_GetObjectItem(cJSON_GetArrayItem(transitions, 2), "handled_us")));
+    cJSON_Delete(json);
+
+    // The log keeps the last kTransitionLogSize requests
+    for (int i = 0; i < 100; i++) {
+        machine.TransitionTo(i % 2 ? kDeviceStateIdle : kDeviceStateListening);
+    }
+    json = machine.GetTransitionLogJson();
+    CHECK(cJSON_GetArraySize(cJSON_GetObjectItem(json, "transitions")) == (int)DeviceStateMachine::kTransitionLogSize);
+    cJSON_Delete(json);
+}
+
+int main() {
+    RUN_TEST(TestStaleListenerId);
+    RUN_TEST(TestListenerSlots);
+    RUN_TEST(TestRemoveWhileNotifying);
+    RUN_TEST(TestTransitionLog);
+    return test_result();
+}
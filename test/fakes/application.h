@@ -0,0 +1,36 @@
+#ifndef APPLICATION_H
+#define APPLICATION_H
+
+// Fake of main/application.h with only what the tested sources use
+
+#include "device_state.h"
+
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+class AudioService {
+public:
+    // Set by the test, called for every read
+    std::function<bool(std::vector<int16_t>& data, int sample_rate, int samples)> on_read;
+
+    bool ReadAudioData(std::vector<int16_t>& data, int sample_rate, int samples) {
+        return on_read && on_read(data, sample_rate, samples);
+    }
+};
+
+class Application {
+public:
+    DeviceState device_state = kDeviceStateUnknown;
+
+    DeviceState GetDeviceState() const { return device_state; }
+    AudioService& GetAudioService() { return audio_service_; }
+
+private:
+    AudioService audio_service_;
+};
+
+#endif // APPLICATION_H
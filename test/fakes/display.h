@@ -0,0 +1,21 @@
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+// Fake of main/display/display.h, records the last chat message
+
+#include <string>
+
+class Display {
+public:
+    virtual ~Display() = default;
+
+    virtual void SetChatMessage(const char* role, const char* content) {
+        last_role = role;
+        last_message = content;
+    }
+
+    std::string last_role;
+    std::string last_message;
+};
+
+#endif // DISPLAY_H
@@ -0,0 +1,24 @@
+#ifndef SSID_MANAGER_H
+#define SSID_MANAGER_H
+
+// Fake of the esp-wifi-connect SsidManager, keeps the added credentials in memory
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class SsidManager {
+public:
+    static SsidManager& GetInstance() {
+        static SsidManager instance;
+        return instance;
+    }
+
+    void AddSsid(const std::string& ssid, const std::string& password) {
+        ssids.emplace_back(ssid, password);
+    }
+
+    std::vector<std::pair<std::string, std::string>> ssids;
+};
+
+#endif // SSID_MANAGER_H
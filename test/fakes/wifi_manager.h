@@ -0,0 +1,13 @@
+#ifndef WIFI_MANAGER_H
+#define WIFI_MANAGER_H
+
+// Fake of the esp-wifi-connect WifiManager
+
+class WifiManager {
+public:
+    void StopConfigAp() { config_ap_stopped = true; }
+
+    bool config_ap_stopped = false;
+};
+
+#endif // WIFI_MANAGER_H
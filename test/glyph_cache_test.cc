@@ -0,0 +1,214 @@
+// GlyphCache: LRU order, arena contents and counters checked against a reference model
+
+#include "glyph_cache.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Reference LRU, most recently used at the front
+class ModelCache {
+public:
+    explicit ModelCache(size_t capacity) : capacity_(capacity) {}
+
+    bool Find(uint32_t key) {
+        auto it = index_.find(key);
+        if (it == index_.end()) {
+            return false;
+        }
+        order_.splice(order_.begin(), order_, it->second);
+        return true;
+    }
+
+    // Returns true if a key was evicted
+    bool Insert(uint32_t key) {
+        auto it = index_.find(key);
+        if (it != index_.end()) {
+            order_.splice(order_.begin(), order_, it->second);
+            return false;
+        }
+        bool evicted = false;
+        if (order_.size() == capacity_) {
+            index_.erase(order_.back());
+            order_.pop_back();
+            evicted = true;
+        }
+        order_.push_front(key);
+        index_[key] = order_.begin();
+        return evicted;
+    }
+
+    bool Contains(uint32_t key) const { return index_.count(key) > 0; }
+    size_t size() const { return order_.size(); }
+
+private:
+    size_t capacity_;
+    std::list<uint32_t> order_;
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> index_;
+};
+
+// Glyph bitmaps are filled with a pattern derived from the key, so a slot handed to the wrong key shows
+void FillGlyph(uint8_t* slot, uint32_t key, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        slot[i] = (uint8_t)(key * 31 + i);
+    }
+}
+
+bool CheckGlyph(const uint8_t* slot, uint32_t key, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (slot[i] != (uint8_t)(key * 31 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double GetStat(cJSON* json, const char* name) {
+    auto item = cJSON_GetObjectItem(json, name);
+    CHECK(cJSON_IsNumber(item));
+    return item != nullptr ? item->valuedouble : -1;
+}
+
+}  // namespace
+
+static void TestLruOrder() {
+    std::vector<uint8_t> arena(3 * 16);
+    GlyphCache cache(arena.data(), arena.size(), 16);
+    CHECK(cache.capacity() == 3);
+
+    for (uint32_t key : {1, 2, 3}) {
+        FillGlyph(cache.Insert(key, 16), key, 16);
+    }
+    size_t size = 0;
+    // 1 becomes the most recently used, 2 is evicted next
+    CHECK(cache.Find(1, size) != nullptr && size == 16);
+    FillGlyph(cache.Insert(4, 8), 4, 8);
+    CHECK(!cache.Contains(2));
+    CHECK(cache.Contains(1) && cache.Contains(3) && cache.Contains(4));
+
+    // Contains() does not touch the order, 3 is still the least recently used
+    CHECK(cache.Contains(3));
+    FillGlyph(cache.Insert(5, 16), 5, 16);
+    CHECK(!cache.Contains(3));
+
+    auto bitmap = cache.Find(4, size);
+    CHECK(bitmap != nullptr && size == 8 && CheckGlyph(bitmap, 4, 8));
+    bitmap = cache.Find(1, size);
+    CHECK(bitmap != nullptr && size == 16 && CheckGlyph(bitmap, 1, 16));
+    CHECK(cache.Find(2, size) == nullptr);
+}
+
+static void TestOversizedAndEmpty() {
+    std::vector<uint8_t> arena(64);
+    GlyphCache cache(arena.data(), arena.size(), 32);
+    CHECK(cache.Insert(1, 33) == nullptr);
+    CHECK(!cache.Contains(1));
+
+    GlyphCache no_arena(nullptr, 0, 32);
+    CHECK(no_arena.capacity() == 0);
+    CHECK(no_arena.Insert(1, 8) == nullptr);
+    size_t size;
+    CHECK(no_arena.Find(1, size) == nullptr);
+
+    cJSON* json = cache.GetStatsJson();
+    CHECK(GetStat(json, "oversized") == 1);
+    CHECK(GetStat(json, "slots") == 2);
+    CHECK(GetStat(json, "hit_rate_percent") == 0);
+    cJSON_Delete(json);
+}
+
+static void TestAgainstModel() {
+    // Zipf-like glyph ids, as drawn for subtitles, with a few sizes not fitting a slot
+    const size_t kSlotSize = 24;
+    for (size_t capacity : {1, 2, 7, 64, 200}) {
+        std::vector<uint8_t> arena(capacity * kSlotSize);
+        GlyphCache cache(arena.data(), arena.size(), kSlotSize);
+        ModelCache model(capacity);
+        CHECK(cache.capacity() == capacity);
+
+        std::mt19937 rng(capacity);
+        std::vector<double> weights;
+        for (int i = 1; i <= 3000; i++) {
+            weights.push_back(1.0 / i);
+        }
+        std::discrete_distribution<uint32_t> glyph(weights.begin(), weights.end());
+        std::unordered_map<uint32_t, size_t> sizes;
+        uint32_t hits = 0, misses = 0, evictions = 0, oversized = 0, prefetched = 0;
+
+        for (int round = 0; round < 50000; round++) {
+            // Spread the ids like real glyph ids so the hash table sees collisions
+            uint32_t key = glyph(rng) * 97 + 0x4e00;
+            size_t size = 0;
+            auto bitmap = cache.Find(key, size);
+            CHECK((bitmap != nullptr) == model.Find(key));
+            if (bitmap != nullptr) {
+                hits++;
+                if (size != sizes[key] || !CheckGlyph(bitmap, key, size)) {
+                    std::fprintf(stderr, "Glyph %u corrupted in cache of %zu\n", key, capacity);
+                    CHECK(false);
+                }
+                continue;
+            }
+            misses++;
+
+            size = 1 + rng() % (kSlotSize + 2);
+            bool prefetch = rng() % 4 == 0;
+            auto slot = cache.Insert(key, size, prefetch);
+            if (size > kSlotSize) {
+                CHECK(slot == nullptr);
+                oversized++;
+                continue;
+            }
+            CHECK(slot != nullptr);
+            if (slot == nullptr) {
+                continue;
+            }
+            FillGlyph(slot, key, size);
+            sizes[key] = size;
+            evictions += model.Insert(key);
+            prefetched += prefetch;
+        }
+
+        for (uint32_t i = 0; i < 3000; i++) {
+            CHECK(cache.Contains(i * 97 + 0x4e00) == model.Contains(i * 97 + 0x4e00));
+        }
+
+        cJSON* json = cache.GetStatsJson();
+        CHECK(GetStat(json, "cached") == model.size());
+        CHECK(GetStat(json, "hits") == hits);
+        CHECK(GetStat(json, "misses") == misses);
+        CHECK(GetStat(json, "evictions") == evictions);
+        CHECK(GetStat(json, "oversized") == oversized);
+        CHECK(GetStat(json, "prefetched") == prefetched);
+        std::printf("  %3zu slots: hit rate %.1f%%, %u evictions\n", capacity, GetStat(json, "hit_rate_percent"),
+            evictions);
+        cJSON_Delete(json);
+    }
+}
+
+static void TestReinsertKeepsSlot() {
+    // Inserting a cached key again reuses its slot and makes it the most recently used
+    std::vector<uint8_t> arena(2 * 8);
+    GlyphCache cache(arena.data(), arena.size(), 8);
+    auto first = cache.Insert(10, 8);
+    cache.Insert(11, 8);
+    CHECK(cache.Insert(10, 4) == first);
+    cache.Insert(12, 8);
+    CHECK(cache.Contains(10));
+    CHECK(!cache.Contains(11));
+    size_t size = 0;
+    CHECK(cache.Find(10, size) == first && size == 4);
+}
+
+int main() {
+    RUN_TEST(TestLruOrder);
+    RUN_TEST(TestOversizedAndEmpty);
+    RUN_TEST(TestAgainstModel);
+    RUN_TEST(TestReinsertKeepsSlot);
+    return test_result();
+}
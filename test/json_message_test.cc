@@ -0,0 +1,181 @@
+// JsonMessage: server messages, malformed input and a mutation fuzz run under ASan/UBSan
+
+#include "protocols/json_message.h"
+#include "test_util.h"
+
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Parse from an exact size heap copy, so reading one byte past the message is caught by ASan
+struct Buffer {
+    explicit Buffer(std::string_view text) : size(text.size()), data(new char[text.size() ? text.size() : 1]) {
+        memcpy(data.get(), text.data(), text.size());
+    }
+    std::string_view view() const { return std::string_view(data.get(), size); }
+
+    size_t size;
+    std::unique_ptr<char[]> data;
+};
+
+bool Inside(std::string_view part, std::string_view whole) {
+    return part.empty() || (part.data() >= whole.data() && part.data() + part.size() <= whole.data() + whole.size());
+}
+
+const char* kSamples[] = {
+    R"({"type":"hello","transport":"websocket","session_id":"abc","audio_params":{"format":"opus","sample_rate":24000,"channels":1,"frame_duration":60}})",
+    R"({"type":"tts","state":"sentence_start","text":"你好，\"world\"\n😀"})",
+    R"({ "type" : "stt" , "text" : "hello \\ there" })",
+    R"({"type":"llm","emotion":"happy","text":"😀"})",
+    R"({"type":"mcp","payload":{"jsonrpc":"2.0","id":3,"method":"tools/call","params":{"name":"x","arguments":{"a":[1,2,{"b":"}]"}]}}}})",
+    R"({"type":"system","command":"reboot"})",
+    R"({"type":"alert","status":"err","message":"\/path","emotion":null,"ok":true,"n":-42})",
+    R"({})",
+};
+
+}  // namespace
+
+static void TestServerMessages() {
+    JsonMessage message;
+    Buffer hello(kSamples[0]);
+    CHECK(message.Parse(hello.view()));
+    CHECK(message.type() == "hello");
+    CHECK(message.GetString("transport") == "websocket");
+    CHECK(message.Has("audio_params", JsonMessage::kValueObject));
+
+    JsonMessage params;
+    CHECK(params.Parse(message.GetRaw("audio_params")));
+    CHECK(params.GetInt("sample_rate") == 24000);
+    CHECK(params.GetInt("frame_duration") == 60);
+    CHECK(params.GetInt("missing", 7) == 7);
+    CHECK(params.GetString("format") == "opus");
+
+    Buffer tts(kSamples[1]);
+    CHECK(message.Parse(tts.view()));
+    CHECK(JsonMessage::Hash(message.type()) == JsonMessage::Hash("tts"));
+    CHECK(message.GetString("state") == "sentence_start");
+    CHECK(JsonMessage::Unescape(message.GetString("text")) == "\xe4\xbd\xa0\xe5\xa5\xbd\xef\xbc\x8c\"world\"\n\xf0\x9f\x98\x80");
+
+    Buffer stt(kSamples[2]);
+    CHECK(message.Parse(stt.view()));
+    CHECK(message.type() == "stt");
+    CHECK(JsonMessage::Unescape(message.GetString("text")) == "hello \\ there");
+
+    Buffer mcp(kSamples[4]);
+    CHECK(message.Parse(mcp.view()));
+    CHECK(message.type() == "mcp");
+    CHECK(message.GetRaw("payload").front() == '{');
+    CHECK(message.GetRaw("payload").back() == '}');
+    CHECK(message.GetString("payload").empty());
+
+    Buffer alert(kSamples[6]);
+    CHECK(message.Parse(alert.view()));
+    CHECK(message.Has("emotion", JsonMessage::kValueLiteral));
+    CHECK(message.Has("ok", JsonMessage::kValueLiteral));
+    CHECK(message.GetInt("n") == -42);
+    CHECK(message.GetRaw("status") == "\"err\"");
+    CHECK(JsonMessage::Unescape(message.GetString("message")) == "/path");
+
+    Buffer empty(kSamples[7]);
+    CHECK(message.Parse(empty.view()));
+    CHECK(message.type().empty());
+}
+
+static void TestMalformed() {
+    const char* inputs[] = {
+        "", " ", "[]", "{", "{\"type\"", "{\"type\":", "{\"type\":}", "{\"type\":\"tts\"",
+        "{\"type\":\"tts\",}", "{\"type\" \"tts\"}", "{type:\"tts\"}", "{\"a\":{\"b\":1}",
+        "{\"a\":\"unterminated}", "{\"a\":[1,2}", "{\"a\":1 \"b\":2}", "{\"a\":\"x\\\"}",
+    };
+    for (auto input : inputs) {
+        JsonMessage message;
+        Buffer buffer(input);
+        if (message.Parse(buffer.view())) {
+            std::fprintf(stderr, "Accepted malformed input: %s\n", input);
+            CHECK(false);
+        }
+    }
+}
+
+static void TestUnescapeEdges() {
+    // Truncated and invalid escapes are copied, never read past the view
+    CHECK(JsonMessage::Unescape("abc\\") == "abc\\");
+    CHECK(JsonMessage::Unescape("\\u12") == "u12");
+    CHECK(JsonMessage::Unescape("\\uzzzz") == "uzzzz");
+    // A lone high surrogate is encoded on its own, the following text is kept
+    CHECK(JsonMessage::Unescape("\\ud83dx").size() == 4);
+    CHECK(JsonMessage::Unescape("\\ud83d\\u0041") == "\xed\xa0\xbd" "A");
+    CHECK(JsonMessage::Unescape("\\t\\r\\b\\f\\/") == "\t\r\b\f/");
+}
+
+static void TestTooManyFields() {
+    std::string json = "{";
+    for (int i = 0; i < JsonMessage::kMaxFields + 8; i++) {
+        json += "\"k" + std::to_string(i) + "\":" + std::to_string(i) + ",";
+    }
+    json += "\"type\":\"last\"}";
+    JsonMessage message;
+    Buffer buffer(json);
+    CHECK(message.Parse(buffer.view()));
+    // Fields past the limit are dropped, the type is still recorded
+    CHECK(message.type() == "last");
+    CHECK(message.GetInt("k0", -1) == 0);
+    CHECK(message.GetInt("k" + std::to_string(JsonMessage::kMaxFields), -1) == -1);
+}
+
+static void TestFuzz() {
+    // Random byte flips, insertions, deletions and truncations of the samples. A parse that
+    // succeeds must return views inside the buffer, and reading them must stay in bounds.
+    const char kAlphabet[] = "{}[]\":,\\u0123456789abcdef -tn \n";
+    std::mt19937 rng(20260419);
+    size_t accepted = 0;
+    for (int round = 0; round < 200000; round++) {
+        std::string text = kSamples[rng() % (sizeof(kSamples) / sizeof(kSamples[0]))];
+        int mutations = 1 + rng() % 4;
+        for (int m = 0; m < mutations && !text.empty(); m++) {
+            size_t pos = rng() % text.size();
+            switch (rng() % 4) {
+                case 0: text[pos] = kAlphabet[rng() % (sizeof(kAlphabet) - 1)]; break;
+                case 1: text.insert(text.begin() + pos, kAlphabet[rng() % (sizeof(kAlphabet) - 1)]); break;
+                case 2: text.erase(pos, 1 + rng() % 3); break;
+                case 3: text.resize(pos); break;
+            }
+        }
+
+        Buffer buffer(text);
+        JsonMessage message;
+        if (!message.Parse(buffer.view())) {
+            continue;
+        }
+        accepted++;
+        CHECK(Inside(message.type(), buffer.view()));
+        for (auto key : {"type", "text", "state", "payload", "audio_params", "n", "session_id"}) {
+            CHECK(Inside(message.GetRaw(key), buffer.view()));
+            CHECK(Inside(message.GetString(key), buffer.view()));
+            message.GetInt(key);
+            JsonMessage::Unescape(message.GetString(key));
+            if (message.Has(key, JsonMessage::kValueObject)) {
+                JsonMessage nested;
+                if (nested.Parse(message.GetRaw(key))) {
+                    CHECK(Inside(nested.source(), buffer.view()));
+                    nested.GetInt("sample_rate");
+                }
+            }
+        }
+    }
+    std::printf("Fuzz: %zu mutated messages accepted\n", accepted);
+    CHECK(accepted > 0);
+}
+
+int main() {
+    RUN_TEST(TestServerMessages);
+    RUN_TEST(TestMalformed);
+    RUN_TEST(TestUnescapeEdges);
+    RUN_TEST(TestTooManyFields);
+    RUN_TEST(TestFuzz);
+    return test_result();
+}
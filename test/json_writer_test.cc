@@ -0,0 +1,456 @@
+// JsonWriter: protocol messages, escaping of every byte, random documents against a reference
+// serializer and a strict parser, buffer overflow at every capacity, and a micro-benchmark against
+// the string concatenation the protocol messages were built with before
+
+#include "protocols/json_writer.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Strict JSON parser for checking the output, decodes strings so they can be compared with the input
+class Parser {
+public:
+    explicit Parser(std::string_view json) : json_(json) {}
+
+    bool Document() {
+        return Value() && pos_ == json_.size();
+    }
+
+    bool String(std::string& out) {
+        if (!Take('"')) {
+            return false;
+        }
+        while (pos_ < json_.size()) {
+            unsigned char c = json_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (c < 0x20) {
+                return false;
+            }
+            if (c != '\\') {
+                out += (char)c;
+                continue;
+            }
+            if (pos_ >= json_.size()) {
+                return false;
+            }
+            switch (json_[pos_++]) {
+                case '"': out += '"'; break;
+                case '\\': out += '\\'; break;
+                case '/': out += '/'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'n': out += '\n'; break;
+                case 'r': out += '\r'; break;
+                case 't': out += '\t'; break;
+                case 'u': {
+                    if (pos_ + 4 > json_.size()) {
+                        return false;
+                    }
+                    unsigned value = 0;
+                    for (int i = 0; i < 4; i++) {
+                        char h = json_[pos_++];
+                        value <<= 4;
+                        if (h >= '0' && h <= '9') value |= h - '0';
+                        else if (h >= 'a' && h <= 'f') value |= h - 'a' + 10;
+                        else if (h >= 'A' && h <= 'F') value |= h - 'A' + 10;
+                        else return false;
+                    }
+                    // The writer only escapes control characters this way
+                    if (value >= 0x20) {
+                        return false;
+                    }
+                    out += (char)value;
+                    break;
+                }
+                default:
+                    return false;
+            }
+        }
+        return false;
+    }
+
+private:
+    bool Take(char c) {
+        if (pos_ < json_.size() && json_[pos_] == c) {
+            pos_++;
+            return true;
+        }
+        return false;
+    }
+
+    bool Literal(const char* word) {
+        size_t length = strlen(word);
+        if (json_.compare(pos_, length, word) != 0) {
+            return false;
+        }
+        pos_ += length;
+        return true;
+    }
+
+    bool Number() {
+        size_t start = pos_;
+        Take('-');
+        if (Take('0')) {
+            return pos_ > start;
+        }
+        size_t digits = pos_;
+        while (pos_ < json_.size() && json_[pos_] >= '0' && json_[pos_] <= '9') {
+            pos_++;
+        }
+        return pos_ > digits;
+    }
+
+    bool Value() {
+        if (pos_ >= json_.size()) {
+            return false;
+        }
+        std::string unused;
+        switch (json_[pos_]) {
+            case '{':
+                pos_++;
+                if (Take('}')) {
+                    return true;
+                }
+                do {
+                    if (!String(unused) || !Take(':') || !Value()) {
+                        return false;
+                    }
+                } while (Take(','));
+                return Take('}');
+            case '[':
+                pos_++;
+                if (Take(']')) {
+                    return true;
+                }
+                do {
+                    if (!Value()) {
+                        return false;
+                    }
+                } while (Take(','));
+                return Take(']');
+            case '"':
+                return String(unused);
+            case 't':
+                return Literal("true");
+            case 'f':
+                return Literal("false");
+            default:
+                return Number();
+        }
+    }
+
+    std::string_view json_;
+    size_t pos_ = 0;
+};
+
+bool IsValidJson(std::string_view json) {
+    return Parser(json).Document();
+}
+
+// Reference escaping, one character at a time
+std::string Escape(std::string_view value) {
+    std::string out;
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                } else {
+                    out += (char)c;
+                }
+                break;
+        }
+    }
+    return out;
+}
+
+std::string RandomString(std::mt19937& rng) {
+    std::string value(rng() % 12, '\0');
+    for (auto& c : value) {
+        // Mostly printable, with quotes, backslashes, control characters and UTF-8 bytes
+        switch (rng() % 8) {
+            case 0: c = (char)(rng() % 0x20); break;
+            case 1: c = "\"\\/"[rng() % 3]; break;
+            case 2: c = (char)(0x80 + rng() % 0x80); break;
+            default: c = (char)('a' + rng() % 26); break;
+        }
+    }
+    return value;
+}
+
+// Writes the same random document with JsonWriter and with string concatenation
+void RandomValue(JsonWriter& writer, std::string& reference, const char* key, bool in_object, int depth,
+                 std::mt19937& rng, std::vector<std::string>& keys) {
+    if (in_object) {
+        reference += "\"" + Escape(key) + "\":";
+    }
+    int kind = depth >= 6 ? 2 + rng() % 4 : rng() % 6;
+    switch (kind) {
+        case 0:
+        case 1: {
+            bool object = kind == 0;
+            object ? writer.BeginObject(key) : writer.BeginArray(key);
+            reference += object ? "{" : "[";
+            int items = rng() % 5;
+            for (int i = 0; i < items; i++) {
+                if (i > 0) {
+                    reference += ",";
+                }
+                keys.push_back(RandomString(rng));
+                // Keys given inside an array are ignored
+                const char* item_key = object || rng() % 2 ? keys.back().c_str() : nullptr;
+                RandomValue(writer, reference, item_key, object, depth + 1, rng, keys);
+            }
+            object ? writer.EndObject() : writer.EndArray();
+            reference += object ? "}" : "]";
+            break;
+        }
+        case 2: {
+            auto value = RandomString(rng);
+            writer.AddString(key, value);
+            reference += "\"" + Escape(value) + "\"";
+            break;
+        }
+        case 3: {
+            int values[] = {0, -1, 1, INT_MAX, INT_MIN, (int)rng()};
+            int value = values[rng() % 6];
+            writer.AddInt(key, value);
+            reference += std::to_string(value);
+            break;
+        }
+        case 4: {
+            bool value = rng() & 1;
+            writer.AddBool(key, value);
+            reference += value ? "true" : "false";
+            break;
+        }
+        default:
+            writer.AddRaw(key, "{\"raw\":[1,2]}");
+            reference += "{\"raw\":[1,2]}";
+            break;
+    }
+}
+
+// The messages of Protocol, written the way they were before JsonWriter and with it
+std::string ConcatListen(const std::string& session_id) {
+    std::string message = "{\"session_id\":\"" + session_id + "\"";
+    message += ",\"type\":\"listen\",\"state\":\"start\"";
+    message += ",\"mode\":\"auto\"";
+    message += "}";
+    return message;
+}
+
+size_t WriterListen(char* buffer, size_t size, const std::string& session_id) {
+    JsonWriter writer(buffer, size);
+    writer.BeginObject()
+        .AddString("session_id", session_id)
+        .AddString("type", "listen")
+        .AddString("state", "start")
+        .AddString("mode", "auto")
+        .EndObject();
+    return writer.length();
+}
+
+std::string ConcatMcp(const std::string& session_id, const std::string& payload) {
+    return "{\"session_id\":\"" + session_id + "\",\"type\":\"mcp\",\"payload\":" + payload + "}";
+}
+
+std::string WriterMcp(const std::string& session_id, const std::string& payload) {
+    std::string buffer(payload.size() + JsonWriter::EscapedLength(session_id) + 64, '\0');
+    JsonWriter writer(buffer.data(), buffer.size());
+    writer.BeginObject()
+        .AddString("session_id", session_id)
+        .AddString("type", "mcp")
+        .AddRaw("payload", payload)
+        .EndObject();
+    buffer.resize(writer.length());
+    return buffer;
+}
+
+}  // namespace
+
+static void TestMessages() {
+    char buffer[256];
+    JsonWriter writer(buffer, sizeof(buffer));
+    writer.BeginObject()
+        .AddString("session_id", "abc")
+        .AddString("type", "abort")
+        .AddString("reason", "wake_word_detected")
+        .EndObject();
+    CHECK(writer.ok());
+    CHECK(writer.view() == "{\"session_id\":\"abc\",\"type\":\"abort\",\"reason\":\"wake_word_detected\"}");
+    CHECK(strlen(writer.data()) == writer.length());
+
+    // A wake word with quotes no longer breaks the message
+    JsonWriter detect(buffer, sizeof(buffer));
+    detect.BeginObject().AddString("text", "say \"hi\"\n").EndObject();
+    CHECK(detect.view() == "{\"text\":\"say \\\"hi\\\"\\n\"}");
+
+    JsonWriter nested(buffer, sizeof(buffer));
+    nested.BeginObject()
+        .BeginObject("empty").EndObject()
+        .BeginArray("list").AddInt(nullptr, INT_MIN).AddBool("ignored", true).BeginArray().EndArray().EndArray()
+        .AddInt("max", INT_MAX)
+        .AddRaw("result", "{\"a\":1}")
+        .EndObject();
+    CHECK(nested.ok());
+    CHECK(nested.view() ==
+          "{\"empty\":{},\"list\":[-2147483648,true,[]],\"max\":2147483647,\"result\":{\"a\":1}}");
+
+    CHECK(ConcatMcp("s1", "{\"id\":1}") == WriterMcp("s1", "{\"id\":1}"));
+    CHECK(WriterListen(buffer, sizeof(buffer), "s1") == ConcatListen("s1").size());
+    CHECK(ConcatListen("s1") == buffer);
+}
+
+static void TestEscaping() {
+    // Every byte value, inside a key and a value
+    std::string all;
+    for (int c = 1; c < 256; c++) {
+        all += (char)c;
+    }
+    std::vector<char> buffer(8 * all.size());
+    JsonWriter writer(buffer.data(), buffer.size());
+    writer.BeginObject().AddString(all.c_str(), all).EndObject();
+    CHECK(writer.ok() && IsValidJson(writer.view()));
+    CHECK(writer.length() == 2 * (JsonWriter::EscapedLength(all) + 2) + 3);
+
+    Parser parser(writer.view().substr(1));
+    std::string key, value;
+    CHECK(parser.String(key) && key == all);
+    Parser value_parser(writer.view().substr(writer.length() - JsonWriter::EscapedLength(all) - 3));
+    CHECK(value_parser.String(value) && value == all);
+
+    std::mt19937 rng(1);
+    for (int i = 0; i < 10000; i++) {
+        auto text = RandomString(rng);
+        CHECK(JsonWriter::EscapedLength(text) == Escape(text).size());
+    }
+}
+
+static void TestRandomDocuments() {
+    std::mt19937 rng(2);
+    std::vector<char> buffer(1 << 16);
+    for (int round = 0; round < 5000; round++) {
+        JsonWriter writer(buffer.data(), buffer.size());
+        std::string reference;
+        std::vector<std::string> keys;
+        keys.reserve(4096);
+        RandomValue(writer, reference, nullptr, false, 0, rng, keys);
+        CHECK(writer.ok());
+        if (writer.view() != reference) {
+            std::fprintf(stderr, "  round %d:\n  %s\n  %s\n", round, writer.data(), reference.c_str());
+            CHECK(false);
+            break;
+        }
+        CHECK(IsValidJson(writer.view()));
+    }
+}
+
+static void TestOverflow() {
+    // At every capacity the output is a null terminated prefix, and nothing is written past the buffer
+    std::string full;
+    auto write = [](JsonWriter& writer) {
+        writer.BeginObject()
+            .AddString("session_id", "0123\"4567")
+            .BeginArray("items").AddInt(nullptr, -12345).AddBool(nullptr, false).EndArray()
+            .AddRaw("payload", "{\"x\":1}")
+            .EndObject();
+    };
+    {
+        char buffer[256];
+        JsonWriter writer(buffer, sizeof(buffer));
+        write(writer);
+        CHECK(writer.ok());
+        full = buffer;
+    }
+    for (size_t capacity = 0; capacity <= full.size() + 2; capacity++) {
+        std::vector<char> buffer(capacity + 16, '#');
+        JsonWriter writer(buffer.data(), capacity);
+        write(writer);
+        bool fits = capacity > full.size();
+        CHECK(writer.ok() == fits);
+        CHECK(std::all_of(buffer.begin() + capacity, buffer.end(), [](char c) { return c == '#'; }));
+        if (capacity > 0) {
+            CHECK(writer.length() < capacity && buffer[writer.length()] == '\0');
+            CHECK(full.compare(0, writer.length(), writer.data()) == 0);
+        }
+    }
+}
+
+static void TestDepth() {
+    char buffer[256];
+    JsonWriter deep(buffer, sizeof(buffer));
+    for (int i = 0; i < 32; i++) {
+        deep.BeginArray();
+    }
+    for (int i = 0; i < 32; i++) {
+        deep.EndArray();
+    }
+    CHECK(deep.ok() && IsValidJson(deep.view()));
+
+    JsonWriter too_deep(buffer, sizeof(buffer));
+    for (int i = 0; i < 33; i++) {
+        too_deep.BeginObject(i > 0 ? "k" : nullptr);
+    }
+    CHECK(!too_deep.ok());
+
+    JsonWriter unbalanced(buffer, sizeof(buffer));
+    unbalanced.BeginObject().AddInt("a", 1);
+    CHECK(!unbalanced.ok());
+}
+
+static void TestBenchmark() {
+    // Host figures, relative only: the old string concatenation against the writer
+    const int kRounds = 100000;
+    std::string session_id = "6f2e4a1c-9b7d-4e0a-8c3f-2d1b5a7e9f04";
+    std::string payload = "{\"jsonrpc\":\"2.0\",\"id\":7,\"result\":{\"content\":[{\"type\":\"text\",\"text\":\"" +
+                          std::string(1500, 'x') + "\"}],\"isError\":false}}";
+    size_t sink = 0;
+    auto time = [&](auto&& build) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kRounds; i++) {
+            sink += build();
+        }
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / kRounds;
+    };
+
+    double concat_listen = time([&] { return ConcatListen(session_id).size(); });
+    double writer_listen = time([&] {
+        char buffer[256];
+        return WriterListen(buffer, sizeof(buffer), session_id);
+    });
+    double concat_mcp = time([&] { return ConcatMcp(session_id, payload).size(); });
+    double writer_mcp = time([&] { return WriterMcp(session_id, payload).size(); });
+    std::printf("  listen start: concatenation %.0f ns, writer %.0f ns\n", concat_listen, writer_listen);
+    std::printf("  mcp envelope: concatenation %.0f ns, writer %.0f ns\n", concat_mcp, writer_mcp);
+    CHECK(sink > 0);
+}
+
+int main() {
+    RUN_TEST(TestMessages);
+    RUN_TEST(TestEscaping);
+    RUN_TEST(TestRandomDocuments);
+    RUN_TEST(TestOverflow);
+    RUN_TEST(TestDepth);
+    RUN_TEST(TestBenchmark);
+    return test_result();
+}
@@ -0,0 +1,128 @@
+// LedAnimator: steps on the shared timer, Stop waiting for a running step before the owner goes away,
+// and steps that start or stop animations themselves
+
+#include "led_animator.h"
+#include "test_util.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace {
+
+// Stands in for an LED, the step writes its members like CircularStrip writes colors_
+struct FakeLed {
+    int frames = 0;
+    int colors[16] = {};
+};
+
+void WaitFor(const std::atomic<bool>& flag) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!flag.load() && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+}  // namespace
+
+static void TestStepsUntilFinished() {
+    auto& animator = LedAnimator::GetInstance();
+    FakeLed led;
+    std::atomic<bool> finished{false};
+    animator.Start(&led, 0, [&led, &finished]() {
+        if (++led.frames == 5) {
+            finished = true;
+            return -1;
+        }
+        return 2;
+    });
+    WaitFor(finished);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(led.frames == 5);
+}
+
+static void TestStopWaitsForRunningStep() {
+    // The owner is destroyed right after Stop returns, a step still running would write freed memory
+    auto& animator = LedAnimator::GetInstance();
+    for (int round = 0; round < 20; round++) {
+        auto led = std::make_unique<FakeLed>();
+        auto in_step = std::make_shared<std::atomic<bool>>(false);
+        auto step_done = std::make_shared<std::atomic<bool>>(false);
+        FakeLed* raw = led.get();
+        animator.Start(raw, 0, [raw, in_step, step_done]() {
+            in_step->store(true);
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            for (auto& color : raw->colors) {
+                color++;
+            }
+            raw->frames++;
+            step_done->store(true);
+            in_step->store(false);
+            return 1;
+        });
+        WaitFor(*in_step);
+        animator.Stop(raw);
+        CHECK(!in_step->load());
+        CHECK(step_done->load());
+        led.reset();
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+static void TestStartWaitsForRunningStep() {
+    // A new effect's state is not overwritten by the step of the effect it replaces
+    auto& animator = LedAnimator::GetInstance();
+    FakeLed led;
+    std::atomic<bool> in_step{false};
+    std::atomic<int> old_steps{0};
+    animator.Start(&led, 0, [&]() {
+        in_step = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        led.colors[0] = 1;
+        old_steps++;
+        in_step = false;
+        return 1;
+    });
+    WaitFor(in_step);
+    animator.Start(&led, 1000, [&]() {
+        led.colors[0] = 2;
+        return -1;
+    });
+    int steps = old_steps.load();
+    CHECK(steps >= 1);
+    led.colors[0] = 3;
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(old_steps == steps);
+    CHECK(led.colors[0] == 3);
+    animator.Stop(&led);
+}
+
+static void TestStepStartsAndStops() {
+    // Steps run in the timer task, stopping themselves or starting another owner must not wait
+    auto& animator = LedAnimator::GetInstance();
+    FakeLed first, second;
+    std::atomic<bool> done{false};
+    animator.Start(&first, 0, [&]() {
+        first.frames++;
+        animator.Stop(&first);
+        animator.Start(&second, 1, [&]() {
+            second.frames++;
+            done = true;
+            return -1;
+        });
+        return 1;
+    });
+    WaitFor(done);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    CHECK(first.frames == 1);
+    CHECK(second.frames == 1);
+}
+
+int main() {
+    RUN_TEST(TestStepsUntilFinished);
+    RUN_TEST(TestStopWaitsForRunningStep);
+    RUN_TEST(TestStartWaitsForRunningStep);
+    RUN_TEST(TestStepStartsAndStops);
+    return test_result();
+}
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""
+Write a sample asset tree and pack it with scripts/build_default_assets.py, for asset_pack_test
+
+Usage: make_asset_pack.py <output_dir>
+    <output_dir>/files   the source files
+    <output_dir>/assets.bin   the asset pack
+"""
+
+import os
+import random
+import shutil
+import struct
+import sys
+
+sys.dont_write_bytecode = True
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'scripts'))
+import build_default_assets  # noqa: E402
+
+
+def lvgl_image(width, height, seed):
+    rng = random.Random(seed)
+    header = struct.pack('<BBHHHHH', build_default_assets.LVGL_IMAGE_MAGIC, 0x12, 0, width, height, width * 2, 0)
+    return header + bytes(rng.getrandbits(8) for _ in range(width * height * 2))
+
+
+def main():
+    output_dir = sys.argv[1]
+    files_dir = os.path.join(output_dir, 'files')
+    shutil.rmtree(output_dir, ignore_errors=True)
+    os.makedirs(files_dir)
+
+    rng = random.Random(1)
+    text = ''.join(f'{{"name": "item_{i}", "value": {i * 7 % 13}}},\n' for i in range(400)).encode()
+    files = {
+        'index.json': text,
+        # Same content as index.json, stored once
+        'copy.json': text,
+        # Incompressible, stored as is
+        'noise.bin': bytes(rng.getrandbits(8) for _ in range(3000)),
+        # Long runs give overlapping matches and length bytes of 255
+        'runs.dat': b'a' * 5000 + b'bc' * 700 + bytes(range(256)) * 3,
+        'small.txt': b'tiny',
+        'empty.txt': b'',
+        'emoji_happy.bin': lvgl_image(16, 16, 2),
+        'emoji_sad.bin': lvgl_image(8, 24, 3),
+        'config.json': b'{}',  # Skipped by the packer
+    }
+    for name, content in files.items():
+        with open(os.path.join(files_dir, name), 'wb') as f:
+            f.write(content)
+
+    pack_file = os.path.join(output_dir, 'assets.bin')
+    build_default_assets.pack_assets(files_dir, pack_file, compress=True)
+    build_default_assets.verify_asset_pack(pack_file, files_dir)
+
+
+if __name__ == '__main__':
+    main()
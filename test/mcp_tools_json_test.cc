@@ -0,0 +1,221 @@
+// McpToolsJson: tools/list pages of a synthetic registry, cursors, the page size limit, and the time of
+// a session start (serialize the registry once, then list every page) with 100 tools
+
+#include "mcp_tools_json.h"
+#include "test_util.h"
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Tool {
+    std::string name;
+    std::string json;
+    bool user_only;
+};
+
+// Descriptors shaped like McpTool::to_json(), with a few properties each
+std::vector<Tool> MakeRegistry(size_t count, std::mt19937& rng) {
+    std::vector<Tool> tools;
+    for (size_t i = 0; i < count; i++) {
+        Tool tool;
+        tool.name = "self.board.tool_" + std::to_string(i);
+        tool.user_only = rng() % 5 == 0;
+        tool.json = "{\"name\":\"" + tool.name + "\",\"description\":\"" + std::string(40 + rng() % 200, 'd') +
+                    "\",\"inputSchema\":{\"type\":\"object\",\"properties\":{";
+        int properties = rng() % 4;
+        for (int p = 0; p < properties; p++) {
+            tool.json += (p > 0 ? "," : "") + std::string("\"arg") + std::to_string(p) +
+                         "\":{\"type\":\"integer\",\"minimum\":0,\"maximum\":100}";
+        }
+        tool.json += "},\"required\":[]}}";
+        tools.push_back(tool);
+    }
+    return tools;
+}
+
+McpToolsJson Build(const std::vector<Tool>& tools) {
+    McpToolsJson json;
+    size_t total = 0;
+    for (auto& tool : tools) {
+        total += tool.json.length();
+    }
+    json.Reserve(tools.size(), total);
+    for (auto& tool : tools) {
+        json.Add(tool.name, tool.json, tool.user_only);
+    }
+    return json;
+}
+
+// Lists every page like a client following nextCursor, returns the descriptors in the order received
+std::vector<std::string> ListAll(const McpToolsJson& json, bool user_only, size_t max_size, int& pages) {
+    std::vector<std::string> listed;
+    std::string cursor;
+    pages = 0;
+    while (true) {
+        std::string result, error;
+        if (!json.GetPage(cursor, user_only, max_size, result, error)) {
+            std::fprintf(stderr, "  page at cursor \"%s\": %s\n", cursor.c_str(), error.c_str());
+            CHECK(false);
+            return listed;
+        }
+        pages++;
+        CHECK(result.length() <= max_size);
+        CHECK(result.compare(0, 10, "{\"tools\":[") == 0);
+
+        // Descriptors hold no `}{` or `},{` inside, so split on the objects' boundaries
+        size_t end = result.rfind(']');
+        size_t pos = 10;
+        while (pos < end) {
+            int depth = 0;
+            size_t start = pos;
+            for (; pos < end; pos++) {
+                if (result[pos] == '{') {
+                    depth++;
+                } else if (result[pos] == '}' && --depth == 0) {
+                    break;
+                }
+            }
+            listed.push_back(result.substr(start, pos + 1 - start));
+            pos += 2;  // The closing brace and the comma
+        }
+
+        std::string tail = result.substr(end);
+        if (tail == "]}") {
+            return listed;
+        }
+        CHECK(tail.compare(0, 16, "],\"nextCursor\":\"") == 0 && tail.substr(tail.size() - 2) == "\"}");
+        std::string next = tail.substr(16, tail.size() - 18);
+        CHECK(next != cursor);
+        if (next == cursor || pages > 1000) {
+            return listed;
+        }
+        cursor = next;
+    }
+}
+
+}  // namespace
+
+static void TestPaging() {
+    std::mt19937 rng(1);
+    auto tools = MakeRegistry(100, rng);
+    auto json = Build(tools);
+    CHECK(json.size() == 100);
+
+    for (bool user_only : {false, true}) {
+        std::vector<std::string> expected;
+        for (auto& tool : tools) {
+            if (user_only || !tool.user_only) {
+                expected.push_back(tool.json);
+            }
+        }
+        for (size_t max_size : {600, 1000, 2000, 8000, 1000000}) {
+            int pages = 0;
+            auto listed = ListAll(json, user_only, max_size, pages);
+            if (listed != expected) {
+                std::fprintf(stderr, "  %zu byte pages%s: %zu of %zu tools listed\n", max_size,
+                    user_only ? " with user only tools" : "", listed.size(), expected.size());
+            }
+            CHECK(listed == expected);
+            CHECK(max_size < 1000000 || pages == 1);
+        }
+    }
+}
+
+static void TestExactPage() {
+    McpToolsJson json;
+    json.Add("a", "{\"name\":\"a\"}", false);
+    json.Add("b", "{\"name\":\"b\"}", true);
+    json.Add("c", "{\"name\":\"c\"}", false);
+    std::string result, error;
+    CHECK(json.GetPage("", false, 8000, result, error));
+    CHECK(result == "{\"tools\":[{\"name\":\"a\"},{\"name\":\"c\"}]}");
+    CHECK(json.GetPage("", true, 8000, result, error));
+    CHECK(result == "{\"tools\":[{\"name\":\"a\"},{\"name\":\"b\"},{\"name\":\"c\"}]}");
+    CHECK(json.GetPage("1", false, 8000, result, error));
+    CHECK(result == "{\"tools\":[{\"name\":\"c\"}]}");
+
+    // One tool per page: 10 bytes of prefix, 12 of the tool and 19 of the closing
+    CHECK(json.GetPage("", true, 41, result, error));
+    CHECK(result == "{\"tools\":[{\"name\":\"a\"}],\"nextCursor\":\"1\"}");
+    CHECK(result.length() == 41);
+    CHECK(!json.GetPage("", true, 40, result, error));
+
+    // Past the last tool the page is empty
+    CHECK(json.GetPage("3", true, 8000, result, error));
+    CHECK(result == "{\"tools\":[]}");
+
+    McpToolsJson empty;
+    CHECK(empty.GetPage("", false, 8000, result, error));
+    CHECK(result == "{\"tools\":[]}");
+}
+
+static void TestInvalidCursor() {
+    std::mt19937 rng(2);
+    auto json = Build(MakeRegistry(10, rng));
+    for (const char* cursor : {"x", "-1", "+1", " 1", "1 ", "1x", "11", "0x1", "18446744073709551617"}) {
+        std::string result, error;
+        CHECK(!json.GetPage(cursor, true, 8000, result, error));
+        CHECK(error == std::string("Invalid cursor: ") + cursor);
+    }
+}
+
+static void TestToolTooLarge() {
+    McpToolsJson json;
+    json.Add("small", "{\"name\":\"small\"}", false);
+    json.Add("large", "{\"name\":\"large\",\"description\":\"" + std::string(9000, 'x') + "\"}", false);
+    std::string result, error;
+    CHECK(json.GetPage("", false, 8000, result, error));
+    CHECK(result == "{\"tools\":[{\"name\":\"small\"}],\"nextCursor\":\"1\"}");
+    CHECK(!json.GetPage("1", false, 8000, result, error));
+    CHECK(error == "Failed to add tool large because of payload size limit");
+}
+
+static void TestSessionStartTime() {
+    // Serialize the registry once, then list it like a new session, on the host for a relative figure
+    std::mt19937 rng(3);
+    auto tools = MakeRegistry(100, rng);
+    const int kRounds = 200;
+    size_t listed = 0;
+    int pages = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        auto json = Build(tools);
+        listed += ListAll(json, false, 8000, pages).size();
+    }
+    auto build_and_list = std::chrono::steady_clock::now() - start;
+
+    auto json = Build(tools);
+    start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; round++) {
+        std::string result, error;
+        std::string cursor;
+        while (json.GetPage(cursor, false, 8000, result, error)) {
+            size_t at = result.rfind("\"nextCursor\":\"");
+            if (at == std::string::npos) {
+                break;
+            }
+            cursor = result.substr(at + 14, result.size() - at - 16);
+        }
+    }
+    auto list_only = std::chrono::steady_clock::now() - start;
+
+    auto us = [](auto duration) {
+        return std::chrono::duration<double, std::micro>(duration).count() / kRounds;
+    };
+    std::printf("  100 tools, %d pages of 8000 bytes: build and list %.1f us, list %.1f us\n", pages,
+        us(build_and_list), us(list_only));
+    CHECK(listed > 0);
+}
+
+int main() {
+    RUN_TEST(TestPaging);
+    RUN_TEST(TestExactPage);
+    RUN_TEST(TestInvalidCursor);
+    RUN_TEST(TestToolTooLarge);
+    RUN_TEST(TestSessionStartTime);
+    return test_result();
+}
@@ -0,0 +1,206 @@
+// MicArray: direction of arrival from a simulated two microphone array, steering of the mix and
+// the per-consumer mixer state
+
+#include "mic_array.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kSampleRate = 16000;
+const int kSpacingMm = 65;
+const int kBlockFrames = 512;  // One wake word feed
+
+// Speech-like source: band limited noise with a syllable envelope
+std::vector<float> Source(size_t samples, std::mt19937& rng) {
+    std::normal_distribution<float> noise(0, 1);
+    std::vector<float> source(samples);
+    float low = 0, band = 0;
+    for (size_t i = 0; i < samples; i++) {
+        // Crude 300-3400 Hz band pass
+        float x = noise(rng);
+        low += (x - low) * 0.75f;
+        band += (low - band) * 0.12f;
+        float envelope = 0.3f + std::fabs(std::sin(M_PI * 3 * i / kSampleRate));
+        source[i] = (low - band) * envelope * 6000;
+    }
+    return source;
+}
+
+// Windowed sinc interpolation of `signal` at fractional position `t`
+float Interpolate(const std::vector<float>& signal, double t) {
+    const int kTaps = 32;
+    int center = (int)std::floor(t);
+    double sum = 0;
+    for (int k = center - kTaps; k <= center + kTaps; k++) {
+        if (k < 0 || k >= (int)signal.size()) {
+            continue;
+        }
+        double x = t - k;
+        double sinc = std::fabs(x) < 1e-9 ? 1 : std::sin(M_PI * x) / (M_PI * x);
+        double window = 0.5 + 0.5 * std::cos(M_PI * x / (kTaps + 1));
+        sum += signal[k] * sinc * window;
+    }
+    return (float)sum;
+}
+
+// Interleaved capture of a talker at `angle` degrees (0 toward the first microphone's side, 90 is
+// broadside), with uncorrelated microphone noise and an optional reference channel
+std::vector<int16_t> Capture(const std::vector<float>& source, double angle, int channels, float noise_level,
+                             std::mt19937& rng) {
+    // The last microphone hears the talker later when it is on the first microphone's side
+    double lag = kSpacingMm / 1000.0 * std::cos(angle * M_PI / 180) / 343 * kSampleRate;
+    std::normal_distribution<float> noise(0, noise_level);
+    size_t frames = source.size();
+    std::vector<int16_t> data(frames * channels, 0);
+    for (size_t i = 0; i < frames; i++) {
+        float first = Interpolate(source, i + lag / 2);
+        float last = Interpolate(source, i - lag / 2);
+        data[i * channels] = (int16_t)std::clamp(std::lround(first + noise(rng)), -32768L, 32767L);
+        data[i * channels + 1] = (int16_t)std::clamp(std::lround(last + noise(rng)), -32768L, 32767L);
+    }
+    return data;
+}
+
+void Reset(MicArray& array, int channels, int mics) {
+    MicArray::Config config;
+    config.spacing_mm = kSpacingMm;
+    array.SetConfig(config);
+    array.Reset(channels, mics);
+}
+
+// Feed the capture block by block like the audio input task, returns the number of reports
+int Feed(MicArray& array, const std::vector<int16_t>& data, int channels) {
+    int reports = 0;
+    size_t block = kBlockFrames * channels;
+    for (size_t pos = 0; pos + block <= data.size(); pos += block) {
+        std::vector<int16_t> chunk(data.begin() + pos, data.begin() + pos + block);
+        reports += array.Process(chunk);
+    }
+    return reports;
+}
+
+}  // namespace
+
+static void TestDirectionOfArrival() {
+    std::mt19937 rng(1);
+    auto source = Source(kSampleRate * 2, rng);
+    // Noise floor first, so the gate learns it, then the talker
+    std::vector<float> silence(kSampleRate / 2, 0);
+    for (int channels : {2, 3}) {
+        for (double angle : {20.0, 45.0, 70.0, 90.0, 110.0, 135.0, 160.0}) {
+            MicArray array;
+            Reset(array, channels, 2);
+            Feed(array, Capture(silence, angle, channels, 30, rng), channels);
+            CHECK(array.direction() == -1);
+
+            int reports = Feed(array, Capture(source, angle, channels, 30, rng), channels);
+            int direction = array.direction();
+            if (std::abs(direction - angle) > 12) {
+                std::fprintf(stderr, "  talker at %.0f degrees, %d channels: estimated %d\n", angle, channels, direction);
+            }
+            CHECK(direction >= 0 && std::abs(direction - angle) <= 12);
+            CHECK(reports >= 1);
+        }
+    }
+}
+
+static void TestSilenceAndNoise() {
+    // Quiet input and diffuse noise (uncorrelated between the microphones) leave the direction unknown
+    std::mt19937 rng(2);
+    MicArray array;
+    Reset(array, 2, 2);
+    std::vector<float> silence(kSampleRate, 0);
+    CHECK(Feed(array, Capture(silence, 90, 2, 20, rng), 2) == 0);
+    CHECK(Feed(array, Capture(silence, 90, 2, 3000, rng), 2) == 0);
+    CHECK(array.direction() == -1);
+
+    cJSON* json = array.GetStatsJson();
+    CHECK(cJSON_GetObjectItem(json, "direction")->valueint == -1);
+    CHECK(cJSON_GetObjectItem(json, "direction_reports")->valueint == 0);
+    cJSON_Delete(json);
+}
+
+static void TestDisabled() {
+    MicArray array;
+    Reset(array, 2, 1);
+    CHECK(!array.enabled());
+    std::vector<int16_t> data = {1, 100, 2, 200, 3, 300};
+    CHECK(!array.Process(data));
+    MicArray::Mixer mixer(array);
+    std::vector<int16_t> mono;
+    mixer.Mix(data, mono);
+    CHECK((mono == std::vector<int16_t>{1, 2, 3}));
+}
+
+static void TestSteeredMix() {
+    // A talker at the first microphone's end: the mix delays the first microphone so both add in phase
+    std::mt19937 rng(3);
+    auto source = Source(kSampleRate, rng);
+    MicArray array;
+    Reset(array, 2, 2);
+    auto data = Capture(source, 0, 2, 0, rng);
+    Feed(array, data, 2);
+    CHECK(array.direction() >= 0 && array.direction() <= 15);
+
+    MicArray::Mixer mixer(array);
+    std::vector<int16_t> mixed;
+    double steered_power = 0, first_power = 0;
+    for (size_t pos = 0; pos + kBlockFrames * 2 <= data.size(); pos += kBlockFrames * 2) {
+        std::vector<int16_t> block(data.begin() + pos, data.begin() + pos + kBlockFrames * 2);
+        std::vector<int16_t> mono;
+        mixer.Mix(block, mono);
+        mixed.insert(mixed.end(), mono.begin(), mono.end());
+    }
+    double plain_power = 0;
+    for (size_t i = 0; i < mixed.size(); i++) {
+        int plain = (data[i * 2] + data[i * 2 + 1]) >> 1;
+        steered_power += double(mixed[i]) * mixed[i];
+        plain_power += double(plain) * plain;
+        first_power += double(data[i * 2]) * data[i * 2];
+    }
+    // In phase the average keeps the talker's level, a plain average of the pair loses its highs
+    std::printf("  steered %.2f, plain average %.2f of the first microphone's power\n",
+        steered_power / first_power, plain_power / first_power);
+    CHECK(steered_power / first_power > 0.95);
+    CHECK(steered_power > plain_power * 1.1);
+}
+
+static void TestMixersKeepTheirOwnHistory() {
+    // Two consumers mixing different streams must not see each other's previous block
+    std::mt19937 rng(4);
+    auto source = Source(kSampleRate, rng);
+    MicArray array;
+    Reset(array, 2, 2);
+    auto talker = Capture(source, 30, 2, 30, rng);
+    Feed(array, talker, 2);
+    CHECK(array.direction() >= 0);
+
+    auto other = Capture(Source(kSampleRate, rng), 120, 2, 30, rng);
+    MicArray::Mixer alone(array);
+    MicArray::Mixer first(array);
+    MicArray::Mixer second(array);
+    size_t block = kBlockFrames * 2;
+    for (size_t pos = 0; pos + block <= talker.size(); pos += block) {
+        std::vector<int16_t> a(talker.begin() + pos, talker.begin() + pos + block);
+        std::vector<int16_t> b(other.begin() + pos, other.begin() + pos + block);
+        std::vector<int16_t> expected, mono, unused;
+        alone.Mix(a, expected);
+        first.Mix(a, mono);
+        second.Mix(b, unused);
+        CHECK(mono == expected);
+    }
+}
+
+int main() {
+    RUN_TEST(TestDirectionOfArrival);
+    RUN_TEST(TestSilenceAndNoise);
+    RUN_TEST(TestDisabled);
+    RUN_TEST(TestSteeredMix);
+    RUN_TEST(TestMixersKeepTheirOwnHistory);
+    return test_result();
+}
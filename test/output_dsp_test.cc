@@ -0,0 +1,240 @@
+// OutputDsp: fixed-point biquads against the cookbook response, limiter ceiling and loudness control
+
+#include "output_dsp.h"
+#include "test_util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int kSampleRate = 16000;
+// 60 ms frames, as decoded from the server
+const size_t kFrameSamples = 960;
+
+void ProcessFrames(OutputDsp& dsp, std::vector<int16_t>& pcm, size_t frame_samples = kFrameSamples) {
+    for (size_t pos = 0; pos < pcm.size(); pos += frame_samples) {
+        dsp.Process(pcm.data() + pos, std::min(frame_samples, pcm.size() - pos));
+    }
+}
+
+std::vector<int16_t> Sine(double frequency, double amplitude, double seconds) {
+    std::vector<int16_t> pcm(seconds * kSampleRate);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        pcm[i] = std::lround(amplitude * std::sin(2 * M_PI * frequency * i / kSampleRate));
+    }
+    return pcm;
+}
+
+double RmsDb(const std::vector<int16_t>& pcm, size_t from) {
+    double sum = 0;
+    for (size_t i = from; i < pcm.size(); i++) {
+        sum += double(pcm[i]) * pcm[i];
+    }
+    return 10 * std::log10(sum / (pcm.size() - from) / (32768.0 * 32768.0));
+}
+
+// Magnitude of the double precision cookbook filter, the fixed-point one must match it
+double ReferenceGainDb(const OutputDsp::Filter& filter, double frequency) {
+    double w0 = 2 * M_PI * filter.frequency / kSampleRate;
+    double cos_w0 = std::cos(w0);
+    double alpha = std::sin(w0) / (2 * filter.q);
+    double a = std::pow(10.0, filter.gain_db / 40.0);
+    double s = 2 * std::sqrt(a) * alpha;
+    double b[3], den[3];
+    switch (filter.type) {
+        case OutputDsp::kHighPass:
+            b[0] = (1 + cos_w0) / 2; b[1] = -(1 + cos_w0); b[2] = (1 + cos_w0) / 2;
+            den[0] = 1 + alpha; den[1] = -2 * cos_w0; den[2] = 1 - alpha;
+            break;
+        case OutputDsp::kLowShelf:
+            b[0] = a * ((a + 1) - (a - 1) * cos_w0 + s); b[1] = 2 * a * ((a - 1) - (a + 1) * cos_w0);
+            b[2] = a * ((a + 1) - (a - 1) * cos_w0 - s);
+            den[0] = (a + 1) + (a - 1) * cos_w0 + s; den[1] = -2 * ((a - 1) + (a + 1) * cos_w0);
+            den[2] = (a + 1) + (a - 1) * cos_w0 - s;
+            break;
+        case OutputDsp::kHighShelf:
+            b[0] = a * ((a + 1) + (a - 1) * cos_w0 + s); b[1] = -2 * a * ((a - 1) + (a + 1) * cos_w0);
+            b[2] = a * ((a + 1) + (a - 1) * cos_w0 - s);
+            den[0] = (a + 1) - (a - 1) * cos_w0 + s; den[1] = 2 * ((a - 1) - (a + 1) * cos_w0);
+            den[2] = (a + 1) - (a - 1) * cos_w0 - s;
+            break;
+        default:
+            b[0] = 1 + alpha * a; b[1] = -2 * cos_w0; b[2] = 1 - alpha * a;
+            den[0] = 1 + alpha / a; den[1] = -2 * cos_w0; den[2] = 1 - alpha / a;
+            break;
+    }
+    auto z1 = std::polar(1.0, -2 * M_PI * frequency / kSampleRate);
+    auto z2 = z1 * z1;
+    return 20 * std::log10(std::abs((b[0] + b[1] * z1 + b[2] * z2) / (den[0] + den[1] * z1 + den[2] * z2)));
+}
+
+double MeasureGainDb(const OutputDsp::Filter& filter, double frequency) {
+    OutputDsp dsp;
+    OutputDsp::Config config;
+    config.eq = {filter};
+    CHECK(dsp.Configure(config, kSampleRate));
+    auto input = Sine(frequency, 8000, 1.5);
+    auto output = input;
+    ProcessFrames(dsp, output);
+    // Skip the first half second the filter settles in
+    return RmsDb(output, kSampleRate / 2) - RmsDb(input, kSampleRate / 2);
+}
+
+// Speech-like test signal: noise bursts shaped by a syllable envelope, with pauses
+std::vector<int16_t> Speech(double level_db, double seconds, std::mt19937& rng) {
+    std::normal_distribution<double> noise(0, 32768 * std::pow(10, level_db / 20));
+    std::vector<int16_t> pcm(seconds * kSampleRate);
+    for (size_t i = 0; i < pcm.size(); i++) {
+        double t = double(i) / kSampleRate;
+        bool pause = std::fmod(t, 2.0) > 1.6;
+        double envelope = pause ? 0 : 1.2 * std::fabs(std::sin(M_PI * 4 * t));
+        pcm[i] = std::clamp<long>(std::lround(noise(rng) * envelope), -32768, 32767);
+    }
+    return pcm;
+}
+
+}  // namespace
+
+static void TestFilterResponse() {
+    struct {
+        OutputDsp::Filter filter;
+        double frequencies[4];
+    } cases[] = {
+        {{OutputDsp::kHighPass, 180, 0, 0.707f}, {60, 180, 1000, 5000}},
+        {{OutputDsp::kPeaking, 3000, 3, 1.0f}, {300, 2000, 3000, 6000}},
+        {{OutputDsp::kLowShelf, 200, 6, 0.707f}, {50, 200, 800, 4000}},
+        {{OutputDsp::kHighShelf, 4000, -6, 0.707f}, {200, 2000, 4000, 7000}},
+    };
+    for (auto& test : cases) {
+        for (double frequency : test.frequencies) {
+            double measured = MeasureGainDb(test.filter, frequency);
+            double expected = ReferenceGainDb(test.filter, frequency);
+            if (std::fabs(measured - expected) > 0.1) {
+                std::fprintf(stderr, "  filter %d at %.0f Hz: %.2f dB, expected %.2f dB\n",
+                    test.filter.type, frequency, measured, expected);
+            }
+            CHECK_NEAR(measured, expected, 0.1);
+        }
+    }
+    // The high-pass corner is at -3 dB
+    CHECK_NEAR(MeasureGainDb({OutputDsp::kHighPass, 180, 0, 0.707f}, 180), -3, 0.1);
+}
+
+static void TestFilterSettlesToSilence() {
+    // No DC offset or limit cycles from the fixed-point rounding
+    OutputDsp dsp;
+    OutputDsp::Config config;
+    config.eq = {{OutputDsp::kHighPass, 180, 0, 0.707f}, {OutputDsp::kPeaking, 3000, 3, 1.0f},
+                 {OutputDsp::kLowShelf, 100, 9, 0.5f}};
+    CHECK(dsp.Configure(config, kSampleRate));
+    std::vector<int16_t> pcm(kSampleRate, 0);
+    pcm[0] = 32767;
+    pcm[1] = -32768;
+    ProcessFrames(dsp, pcm);
+    for (size_t i = kSampleRate / 2; i < pcm.size(); i++) {
+        CHECK(pcm[i] == 0);
+    }
+}
+
+static void TestLimiterCeiling() {
+    // Random peaks up to full scale, in frames of varying size so the state crosses frame boundaries
+    const float kThresholdDb = -6;
+    const int kCeiling = std::lround(32767 * std::pow(10, kThresholdDb / 20)) + 1;
+    std::mt19937 rng(3);
+    OutputDsp dsp;
+    OutputDsp::Config config;
+    config.limiter_threshold_db = kThresholdDb;
+    CHECK(dsp.Configure(config, kSampleRate));
+
+    auto pcm = Speech(-12, 10, rng);
+    for (int burst = 0; burst < 200; burst++) {
+        size_t at = rng() % (pcm.size() - 64);
+        for (size_t i = 0; i < 1 + rng() % 64; i++) {
+            pcm[at + i] = (rng() & 1) ? 32767 : -32768;
+        }
+    }
+    std::vector<int16_t> output = pcm;
+    for (size_t pos = 0; pos < output.size();) {
+        size_t count = std::min<size_t>(1 + rng() % 1500, output.size() - pos);
+        dsp.Process(output.data() + pos, count);
+        pos += count;
+    }
+    int peak = 0;
+    for (auto sample : output) {
+        peak = std::max(peak, std::abs(int(sample)));
+    }
+    std::printf("  peak %d, ceiling %d, %u samples limited\n", peak, kCeiling, dsp.limited_samples());
+    CHECK(peak <= kCeiling);
+    CHECK(dsp.limited_samples() > 0);
+}
+
+static void TestLimiterTransparent() {
+    // Below the threshold the limiter only delays the audio by its look-ahead
+    OutputDsp dsp;
+    OutputDsp::Config config;
+    config.limiter_threshold_db = -1;
+    CHECK(dsp.Configure(config, kSampleRate));
+    auto input = Sine(440, 20000, 0.5);
+    auto output = input;
+    ProcessFrames(dsp, output);
+    size_t delay = kSampleRate * config.limiter_lookahead_us / 1000000 - 1;
+    for (size_t i = 0; i + delay < input.size(); i++) {
+        CHECK(output[i + delay] == input[i]);
+    }
+    CHECK(dsp.limited_samples() == 0);
+}
+
+static void TestLoudness() {
+    std::mt19937 rng(5);
+    OutputDsp dsp;
+    OutputDsp::Config config;
+    config.loudness_target_db = -20;
+    CHECK(dsp.Configure(config, kSampleRate));
+
+    // About -26 dBFS of speech is raised towards the target, at most 6 dB per second
+    auto speech = Speech(-24, 0.5, rng);
+    ProcessFrames(dsp, speech);
+    CHECK(dsp.loudness_gain_db() > 0.5f && dsp.loudness_gain_db() <= 3.01f);
+
+    speech = Speech(-24, 10, rng);
+    auto input_db = RmsDb(speech, speech.size() / 2);
+    ProcessFrames(dsp, speech);
+    double gain = dsp.loudness_gain_db();
+    CHECK(gain > 4 && gain < 9.01);
+    CHECK_NEAR(RmsDb(speech, speech.size() / 2) - input_db, gain, 0.5);
+
+    // Silence is gated, the learned gain is kept over pauses and after Reset()
+    std::vector<int16_t> silence(kSampleRate * 3, 0);
+    ProcessFrames(dsp, silence);
+    CHECK_NEAR(dsp.loudness_gain_db(), gain, 0.01);
+    dsp.Reset();
+    CHECK_NEAR(dsp.loudness_gain_db(), gain, 0.01);
+
+    // Loud speech is cut by at most loudness_max_cut_db
+    auto loud = Speech(-3, 10, rng);
+    ProcessFrames(dsp, loud);
+    CHECK_NEAR(dsp.loudness_gain_db(), -config.loudness_max_cut_db, 0.01);
+}
+
+static void TestDisabled() {
+    OutputDsp dsp;
+    CHECK(!dsp.Configure(OutputDsp::Config(), kSampleRate));
+    auto input = Sine(1000, 10000, 0.1);
+    auto output = input;
+    ProcessFrames(dsp, output);
+    CHECK(output == input);
+}
+
+int main() {
+    RUN_TEST(TestFilterResponse);
+    RUN_TEST(TestFilterSettlesToSilence);
+    RUN_TEST(TestLimiterCeiling);
+    RUN_TEST(TestLimiterTransparent);
+    RUN_TEST(TestLoudness);
+    RUN_TEST(TestDisabled);
+    return test_result();
+}
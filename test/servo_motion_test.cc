@@ -0,0 +1,226 @@
+// Servo motion simulator: renders compiled ServoMotion tables the way ServoMotionPlayer samples them
+// on the device (a 10 ms timer) and checks positions, timing and angle limits of the timeline.
+
+#include "servo_motion.h"
+#include "test_util.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#define SERVO_COUNT 6
+#define TICK_MS 10
+
+namespace {
+
+struct Frame {
+    uint32_t time_ms;
+    int positions[SERVO_COUNT];
+};
+
+// Sample the motion at every player tick, plus one frame after the end
+std::vector<Frame> Render(const ServoMotion& motion, const int initial[], int tick_ms = TICK_MS) {
+    std::vector<Frame> frames;
+    for (uint32_t t = 0;; t += tick_ms) {
+        Frame frame = {};
+        frame.time_ms = t;
+        motion.Sample(t, initial, frame.positions);
+        frames.push_back(frame);
+        if (t > motion.duration_ms()) {
+            break;
+        }
+    }
+    return frames;
+}
+
+int MaxStep(const std::vector<Frame>& frames, int servo) {
+    int max_step = 0;
+    for (size_t i = 1; i < frames.size(); i++) {
+        max_step = std::max(max_step, std::abs(frames[i].positions[servo] - frames[i - 1].positions[servo]));
+    }
+    return max_step;
+}
+
+void CheckLimits(const std::vector<Frame>& frames) {
+    for (auto& frame : frames) {
+        for (int i = 0; i < SERVO_COUNT; i++) {
+            CHECK(frame.positions[i] >= 0 && frame.positions[i] <= 180);
+        }
+    }
+}
+
+const int kHome[SERVO_COUNT] = {90, 90, 90, 90, 45, 135};
+
+}  // namespace
+
+static void TestMove() {
+    int target[SERVO_COUNT] = {120, 60, 90, 100, 0, 180};
+    ServoMotion motion(SERVO_COUNT);
+    motion.Move(700, target);
+    CHECK(motion.duration_ms() == 700);
+
+    auto frames = Render(motion, kHome);
+    CheckLimits(frames);
+    CHECK(frames.front().positions[0] == 90);
+    for (auto& frame : frames) {
+        // Linear in time, independent of how often the table is sampled
+        CHECK(frame.positions[0] == 90 + 30 * (int)std::min<uint32_t>(frame.time_ms, 700) / 700);
+        CHECK(frame.positions[1] >= 60 && frame.positions[1] <= 90);
+    }
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        CHECK(frames.back().positions[i] == target[i]);
+        // 180 degrees over 700 ms at 10 ms ticks is at most 3 degrees per tick
+        CHECK(MaxStep(frames, i) <= 3);
+    }
+}
+
+static void TestSmallMoveReachesTarget() {
+    // Small moves used to be truncated to zero interpolation steps
+    int target[SERVO_COUNT] = {93, 88, 90, 90, 45, 135};
+    ServoMotion motion(SERVO_COUNT);
+    motion.Move(1000, target);
+
+    int positions[SERVO_COUNT];
+    motion.Sample(500, kHome, positions);
+    CHECK(positions[0] == 91);
+    CHECK(positions[1] == 89);
+    motion.Sample(1000, kHome, positions);
+    CHECK(positions[0] == 93);
+    CHECK(positions[1] == 88);
+}
+
+static void TestOscillate() {
+    int amplitude[SERVO_COUNT] = {30, 30, 20, 20, 0, 0};
+    int center[SERVO_COUNT] = {90, 90, 95, 85, 45, 135};
+    double phase[SERVO_COUNT] = {0, 0, -M_PI / 2, -M_PI / 2, 0, 0};
+    ServoMotion motion(SERVO_COUNT);
+    motion.Oscillate(1000, 2.5f, amplitude, center, phase);
+    CHECK(motion.duration_ms() == 2500);
+
+    auto frames = Render(motion, kHome);
+    CheckLimits(frames);
+    for (auto& frame : frames) {
+        for (int i = 0; i < SERVO_COUNT; i++) {
+            CHECK(frame.positions[i] >= center[i] - amplitude[i] - 1);
+            CHECK(frame.positions[i] <= center[i] + amplitude[i] + 1);
+        }
+        // After the fade in the positions follow the sine exactly
+        if (frame.time_ms >= 200 && frame.time_ms <= 2500) {
+            for (int i = 0; i < SERVO_COUNT; i++) {
+                double angle = 2 * M_PI * frame.time_ms / 1000 + phase[i];
+                CHECK_NEAR(frame.positions[i], center[i] + amplitude[i] * std::sin(angle), 1);
+            }
+        }
+    }
+    // The fade in starts from the pose the motion started from, without a jump on the feet
+    CHECK(frames.front().positions[2] == kHome[2]);
+    CHECK(MaxStep(frames, 2) <= 5);
+    // 2.5 cycles of a sine end half a period off the start, the final pose is the last sample
+    CHECK_NEAR(frames.back().positions[0], 90, 1);
+}
+
+static void TestInvalidSegmentsIgnored() {
+    int values[SERVO_COUNT] = {10, 10, 10, 10, 10, 10};
+    double phase[SERVO_COUNT] = {0};
+    ServoMotion motion(SERVO_COUNT);
+    motion.Oscillate(0, 2, values, values, phase);
+    motion.Oscillate(500, 0, values, values, phase);
+    motion.Hold(0);
+    motion.Hold(-10);
+    CHECK(motion.empty());
+    CHECK(motion.duration_ms() == 0);
+
+    int positions[SERVO_COUNT];
+    motion.Sample(100, kHome, positions);
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        CHECK(positions[i] == kHome[i]);
+    }
+}
+
+static void TestSequenceChaining() {
+    // A compiled servo sequence: move, hold, oscillate around the new pose, move home
+    int pose[SERVO_COUNT] = {60, 120, 90, 90, 160, 20};
+    int amplitude[SERVO_COUNT] = {0, 0, 15, 15, 0, 0};
+    double phase[SERVO_COUNT] = {0, 0, 0, M_PI, 0, 0};
+    int home[SERVO_COUNT];
+    std::copy(kHome, kHome + SERVO_COUNT, home);
+
+    ServoMotion motion(SERVO_COUNT);
+    motion.Move(500, pose);
+    motion.Hold(300);
+    motion.Oscillate(400, 3, amplitude, pose, phase);
+    motion.Move(0, home);
+    motion.Move(400, pose);
+    CHECK(motion.segments().size() == 5);
+    CHECK(motion.duration_ms() == 500 + 300 + 1200 + 0 + 400);
+
+    auto frames = Render(motion, kHome);
+    CheckLimits(frames);
+    int positions[SERVO_COUNT];
+    // Held at the pose reached by the move
+    for (uint32_t t = 500; t < 800; t += TICK_MS) {
+        motion.Sample(t, kHome, positions);
+        for (int i = 0; i < SERVO_COUNT; i++) {
+            CHECK(positions[i] == pose[i]);
+        }
+    }
+    // The oscillation fades in from the held pose, servos without amplitude do not move
+    motion.Sample(800, kHome, positions);
+    CHECK(positions[2] == pose[2]);
+    motion.Sample(1500, kHome, positions);
+    CHECK(positions[0] == pose[0]);
+    // The zero length move jumps home, the last move starts from there
+    motion.Sample(2000, kHome, positions);
+    CHECK(positions[0] == kHome[0]);
+    motion.Sample(2200, kHome, positions);
+    CHECK(positions[0] == 75);
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        CHECK(frames.back().positions[i] == pose[i]);
+    }
+}
+
+static void TestSamplingJitter() {
+    // The device timer may fire late, positions only depend on the time since the motion started
+    int amplitude[SERVO_COUNT] = {30, 30, 30, 30, 20, 20};
+    int center[SERVO_COUNT] = {90, 90, 95, 85, 45, 135};
+    double phase[SERVO_COUNT] = {0, 0, -M_PI / 2, -M_PI / 2, 0, M_PI};
+    ServoMotion motion(SERVO_COUNT);
+    motion.Oscillate(1000, 4, amplitude, center, phase);
+    motion.Move(700, kHome);
+
+    auto regular = Render(motion, kHome);
+    srand(1);
+    uint32_t t = 0;
+    while (t <= motion.duration_ms()) {
+        int positions[SERVO_COUNT];
+        motion.Sample(t, kHome, positions);
+        if (t % TICK_MS == 0) {
+            auto& expected = regular[t / TICK_MS];
+            for (int i = 0; i < SERVO_COUNT; i++) {
+                CHECK(positions[i] == expected.positions[i]);
+            }
+        }
+        t += 1 + rand() % 37;
+    }
+    CHECK(motion.duration_ms() == 4700);
+    CHECK(regular.back().time_ms >= 4700);
+}
+
+static void TestServoCountLimit() {
+    int values[SERVO_MOTION_MAX_SERVOS + 4] = {};
+    ServoMotion motion(SERVO_MOTION_MAX_SERVOS + 4);
+    CHECK(motion.servo_count() == SERVO_MOTION_MAX_SERVOS);
+    motion.Move(100, values);
+    CHECK(motion.duration_ms() == 100);
+}
+
+int main() {
+    RUN_TEST(TestMove);
+    RUN_TEST(TestSmallMoveReachesTarget);
+    RUN_TEST(TestOscillate);
+    RUN_TEST(TestInvalidSegmentsIgnored);
+    RUN_TEST(TestSequenceChaining);
+    RUN_TEST(TestSamplingJitter);
+    RUN_TEST(TestServoCountLimit);
+    return test_result();
+}
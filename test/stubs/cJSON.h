@@ -0,0 +1,123 @@
+#ifndef cJSON__h
+#define cJSON__h
+
+// Subset of cJSON for the host tests: objects and arrays of numbers, strings and bools, enough for the
+// stats getters
+
+#include <cstdlib>
+#include <cstring>
+
+#define cJSON_False (1 << 0)
+#define cJSON_True (1 << 1)
+#define cJSON_Number (1 << 3)
+#define cJSON_String (1 << 4)
+#define cJSON_Array (1 << 5)
+#define cJSON_Object (1 << 6)
+
+typedef struct cJSON {
+    struct cJSON* next;
+    struct cJSON* prev;
+    struct cJSON* child;
+    int type;
+    char* valuestring;
+    int valueint;
+    double valuedouble;
+    char* string;
+} cJSON;
+
+inline cJSON* cJSON_CreateObject(void) {
+    cJSON* item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = cJSON_Object;
+    return item;
+}
+
+inline cJSON* cJSON_CreateArray(void) {
+    cJSON* item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = cJSON_Array;
+    return item;
+}
+
+inline void cJSON_AddItemToArray(cJSON* array, cJSON* item) {
+    cJSON** last = &array->child;
+    while (*last != nullptr) {
+        item->prev = *last;
+        last = &(*last)->next;
+    }
+    *last = item;
+}
+
+inline void cJSON_AddItemToObject(cJSON* object, const char* name, cJSON* item) {
+    item->string = strdup(name);
+    cJSON_AddItemToArray(object, item);
+}
+
+inline cJSON* cJSON_AddNumberToObject(cJSON* object, const char* name, double number) {
+    cJSON* item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = cJSON_Number;
+    item->valuedouble = number;
+    item->valueint = (int)number;
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+inline cJSON* cJSON_AddStringToObject(cJSON* object, const char* name, const char* string) {
+    cJSON* item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = cJSON_String;
+    item->valuestring = strdup(string);
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+inline cJSON* cJSON_AddBoolToObject(cJSON* object, const char* name, bool boolean) {
+    cJSON* item = (cJSON*)calloc(1, sizeof(cJSON));
+    item->type = boolean ? cJSON_True : cJSON_False;
+    item->valueint = boolean;
+    cJSON_AddItemToObject(object, name, item);
+    return item;
+}
+
+inline int cJSON_GetArraySize(const cJSON* array) {
+    int size = 0;
+    for (cJSON* item = array != nullptr ? array->child : nullptr; item != nullptr; item = item->next) {
+        size++;
+    }
+    return size;
+}
+
+inline cJSON* cJSON_GetArrayItem(const cJSON* array, int index) {
+    cJSON* item = array != nullptr ? array->child : nullptr;
+    while (item != nullptr && index-- > 0) {
+        item = item->next;
+    }
+    return item;
+}
+
+inline cJSON* cJSON_GetObjectItem(const cJSON* object, const char* name) {
+    for (cJSON* item = object != nullptr ? object->child : nullptr; item != nullptr; item = item->next) {
+        if (item->string != nullptr && strcmp(item->string, name) == 0) {
+            return item;
+        }
+    }
+    return nullptr;
+}
+
+inline bool cJSON_IsNumber(const cJSON* item) {
+    return item != nullptr && item->type == cJSON_Number;
+}
+
+inline bool cJSON_IsString(const cJSON* item) {
+    return item != nullptr && item->type == cJSON_String;
+}
+
+inline void cJSON_Delete(cJSON* item) {
+    while (item != nullptr) {
+        cJSON* next = item->next;
+        cJSON_Delete(item->child);
+        free(item->string);
+        free(item->valuestring);
+        free(item);
+        item = next;
+    }
+}
+
+#endif // cJSON__h
@@ -0,0 +1,20 @@
+#ifndef ESP_ERR_H
+#define ESP_ERR_H
+
+#include <cstdio>
+#include <cstdlib>
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#define ESP_ERROR_CHECK(x) do {                                             \
+        esp_err_t err_rc_ = (x);                                            \
+        if (err_rc_ != ESP_OK) {                                            \
+            std::fprintf(stderr, "ESP_ERROR_CHECK failed: %s\n", #x);       \
+            std::abort();                                                   \
+        }                                                                   \
+    } while (0)
+
+#endif // ESP_ERR_H
@@ -0,0 +1,16 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <cstdio>
+
+// Errors and warnings go to stderr, the rest is only format checked
+inline void esp_log_discard(const char*, ...) __attribute__((format(printf, 1, 2)));
+inline void esp_log_discard(const char*, ...) {}
+
+#define ESP_LOGE(tag, format, ...) std::fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) std::fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) esp_log_discard(format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) esp_log_discard(format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...) esp_log_discard(format, ##__VA_ARGS__)
+
+#endif // ESP_LOG_H
@@ -0,0 +1,133 @@
+#ifndef ESP_TIMER_H
+#define ESP_TIMER_H
+
+#include "esp_err.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Microseconds since the first call, on the host's steady clock
+inline int64_t esp_timer_get_time() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+typedef void (*esp_timer_cb_t)(void* arg);
+
+typedef enum {
+    ESP_TIMER_TASK,
+} esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void* arg;
+    esp_timer_dispatch_t dispatch_method;
+    const char* name;
+    bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+struct esp_timer {
+    esp_timer_cb_t callback;
+    void* arg;
+    int64_t due_us;  // -1 when stopped
+};
+typedef esp_timer* esp_timer_handle_t;
+
+// One-shot timers, their callbacks run one at a time on a single thread like the esp_timer task
+class HostTimerTask {
+public:
+    static HostTimerTask& GetInstance() {
+        static HostTimerTask instance;
+        return instance;
+    }
+
+    void Add(esp_timer_handle_t timer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timers_.push_back(timer);
+    }
+
+    void Remove(esp_timer_handle_t timer) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timers_.erase(std::remove(timers_.begin(), timers_.end(), timer), timers_.end());
+    }
+
+    void Arm(esp_timer_handle_t timer, int64_t due_us) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        timer->due_us = due_us;
+        changed_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<esp_timer_handle_t> timers_;
+    bool quit_ = false;
+    std::thread thread_;
+
+    HostTimerTask() : thread_([this]() { Run(); }) {}
+
+    ~HostTimerTask() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            quit_ = true;
+        }
+        changed_.notify_all();
+        thread_.join();
+    }
+
+    void Run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!quit_) {
+            esp_timer_handle_t next = nullptr;
+            for (auto timer : timers_) {
+                if (timer->due_us >= 0 && (next == nullptr || timer->due_us < next->due_us)) {
+                    next = timer;
+                }
+            }
+            if (next == nullptr) {
+                changed_.wait(lock);
+                continue;
+            }
+            int64_t wait_us = next->due_us - esp_timer_get_time();
+            if (wait_us > 0) {
+                changed_.wait_for(lock, std::chrono::microseconds(wait_us));
+                continue;
+            }
+            next->due_us = -1;
+            auto callback = next->callback;
+            auto arg = next->arg;
+            lock.unlock();
+            callback(arg);
+            lock.lock();
+        }
+    }
+};
+
+inline esp_err_t esp_timer_create(const esp_timer_create_args_t* args, esp_timer_handle_t* out_handle) {
+    *out_handle = new esp_timer{args->callback, args->arg, -1};
+    HostTimerTask::GetInstance().Add(*out_handle);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us) {
+    HostTimerTask::GetInstance().Arm(timer, esp_timer_get_time() + (int64_t)timeout_us);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    HostTimerTask::GetInstance().Arm(timer, -1);
+    return ESP_OK;
+}
+
+inline esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    HostTimerTask::GetInstance().Remove(timer);
+    delete timer;
+    return ESP_OK;
+}
+
+#endif // ESP_TIMER_H
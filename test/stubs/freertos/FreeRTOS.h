@@ -0,0 +1,13 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+
+#endif // FREERTOS_H
@@ -0,0 +1,21 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include "freertos/FreeRTOS.h"
+
+#include <thread>
+
+typedef void* TaskHandle_t;
+
+// Delays only give up the time slice, the tests that spin on them run on host threads
+inline void vTaskDelay(TickType_t ticks) {
+    std::this_thread::yield();
+}
+
+// Every host thread gets its own handle
+inline TaskHandle_t xTaskGetCurrentTaskHandle() {
+    static thread_local char task;
+    return &task;
+}
+
+#endif // TASK_H
@@ -0,0 +1,44 @@
+#ifndef TEST_UTIL_H
+#define TEST_UTIL_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// Minimal checks for the host tests, a failed check is reported and the test exits non-zero at the end
+
+inline int& test_failures() {
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+            test_failures()++; \
+        } \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) \
+    do { \
+        double actual_ = (actual); \
+        double expected_ = (expected); \
+        if (actual_ < expected_ - (tolerance) || actual_ > expected_ + (tolerance)) { \
+            std::fprintf(stderr, "%s:%d: CHECK_NEAR failed: %s = %g, expected %g +- %g\n", __FILE__, __LINE__, \
+                #actual, actual_, expected_, (double)(tolerance)); \
+            test_failures()++; \
+        } \
+    } while (0)
+
+#define RUN_TEST(test) \
+    do { \
+        int failures_before_ = test_failures(); \
+        test(); \
+        std::printf("%s %s\n", test_failures() == failures_before_ ? "PASS" : "FAIL", #test); \
+    } while (0)
+
+inline int test_result() {
+    return test_failures() == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // TEST_UTIL_H